@@ -92,6 +92,7 @@ dependencies {
     
     // NanoHTTPD for embedded web server
     implementation("org.nanohttpd:nanohttpd:2.3.1")
+    implementation("org.nanohttpd:nanohttpd-websocket:2.3.1")
     
     testImplementation(libs.junit)
     androidTestImplementation(libs.androidx.junit)
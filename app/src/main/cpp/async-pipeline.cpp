@@ -0,0 +1,246 @@
+#define LOG_TAG "AsyncPipeline"
+
+#include "async-pipeline.h"
+#include "native-log.h"
+#include "native-stats.h"
+
+namespace ffddas {
+
+namespace {
+
+void raiseMax(std::atomic<int64_t> &max, int64_t value) {
+    int64_t current = max.load(std::memory_order_relaxed);
+    while (value > current &&
+           !max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+// avg += (value - avg) / 8; each average has a single writer thread, so load + store is enough
+void updateAverage(std::atomic<int64_t> &avg, int64_t value) {
+    int64_t current = avg.load(std::memory_order_relaxed);
+    avg.store(current == 0 ? value : current + (value - current) / 8, std::memory_order_relaxed);
+}
+
+} // namespace
+
+AsyncFramePipeline::AsyncFramePipeline()
+        : nextSequence_(1), resultSubscription_(0),
+          submitted_(0), processed_(0), failed_(0),
+          lastQueueLatencyNs_(0), avgQueueLatencyNs_(0), maxQueueLatencyNs_(0), avgProcessNs_(0) {
+    stages_.addStage("convert", [this](FrameJob &job) { return convertStage(job); });
+    stages_.addStage("detect", [this](FrameJob &job) { return detectStage(job); });
+    stages_.addStage("composite", [this](FrameJob &job) { return compositeStage(job); });
+    stages_.setSink([this](std::unique_ptr<FrameJob> job) { publish(std::move(job)); });
+}
+
+AsyncFramePipeline::~AsyncFramePipeline() {
+    stop();
+}
+
+bool AsyncFramePipeline::start(int capacity, ExecutionMode mode) {
+    std::lock_guard<std::mutex> lock(lifecycleMutex_);
+    if (stages_.running()) {
+        if (stages_.mode() == mode) return true;
+        stages_.stop(); // switching modes: in-flight frames are dropped
+    }
+    if (capacity < 1) capacity = kDefaultCapacity;
+    stages_.start(mode, static_cast<size_t>(capacity));
+    LOGI("Async pipeline started (%s, queue capacity %zu)",
+         mode == kExecutionPipelined ? "pipelined" : "serial", stages_.inputCapacity());
+    return true;
+}
+
+void AsyncFramePipeline::stop() {
+    std::lock_guard<std::mutex> lock(lifecycleMutex_);
+    if (!stages_.running()) return;
+    stages_.stop();
+    const int subscription = resultSubscription_.load();
+    if (subscription != 0) {
+        // Release anyone blocked in awaitResult() and the frame it would have returned
+        frameBus().clear(subscription);
+        frameBus().interrupt(subscription);
+    }
+    LOGI("Async pipeline stopped");
+}
+
+bool AsyncFramePipeline::running() const {
+    return stages_.running();
+}
+
+int64_t AsyncFramePipeline::submit(std::unique_ptr<FrameJob> job) {
+    if (!job) return -1;
+    job->descriptor.sequence = nextSequence_.fetch_add(1, std::memory_order_relaxed);
+    if (job->descriptor.stampNs[kStampIngest] == 0) job->descriptor.stamp(kStampIngest);
+    const int64_t sequence = job->descriptor.sequence;
+    if (!stages_.push(std::move(job))) return -1;
+    submitted_.fetch_add(1, std::memory_order_relaxed);
+    return sequence;
+}
+
+bool AsyncFramePipeline::convertStage(FrameJob &job) {
+    FrameDescriptor &descriptor = job.descriptor;
+    descriptor.stamp(kStampStarted);
+    const int64_t queueLatency = descriptor.between(kStampIngest, kStampStarted);
+    lastQueueLatencyNs_.store(queueLatency, std::memory_order_relaxed);
+    updateAverage(avgQueueLatencyNs_, queueLatency);
+    raiseMax(maxQueueLatencyNs_, queueLatency);
+
+    {
+        ConfigStore::Reader config(pipelineConfig());
+        descriptor.configVersion = config->version;
+        job.mode = static_cast<PreviewMode>(config->previewMode);
+        job.cannyLow = config->cannyLow;
+        job.cannyHigh = config->cannyHigh;
+    }
+
+    // Stages run on different threads, so each adds its own thread's count to the job
+    const int64_t allocationsBefore = threadAllocations();
+    try {
+        previewToGray(job.nv21, job.height, job.mode, job.format, job.quality, job.gray);
+    } catch (const std::exception &e) {
+        // cv::Exception, or std::bad_alloc from the frame pool: on a stage thread it would terminate
+        LOGE("Frame %lld: convert failed: %s", (long long)descriptor.sequence, e.what());
+        failed_.fetch_add(1, std::memory_order_relaxed);
+        recordFrame(job.allocations + threadAllocations() - allocationsBefore);
+        return false;
+    }
+    job.allocations += threadAllocations() - allocationsBefore;
+    job.width = job.gray.cols;
+    job.height = job.gray.rows;
+    descriptor.stamp(kStampConverted);
+    job.stageNs[LatencyScheduler::kStageConvert] = descriptor.between(kStampStarted, kStampConverted);
+    return true;
+}
+
+bool AsyncFramePipeline::detectStage(FrameJob &job) {
+    const int64_t begin = monotonicNs();
+    const int64_t allocationsBefore = threadAllocations();
+    try {
+        previewDetect(job.gray, job.mode, job.quality, job.cannyLow, job.cannyHigh, job.edges);
+    } catch (const std::exception &e) {
+        LOGE("Frame %lld: detect failed: %s", (long long)job.descriptor.sequence, e.what());
+        failed_.fetch_add(1, std::memory_order_relaxed);
+        recordFrame(job.allocations + threadAllocations() - allocationsBefore);
+        return false;
+    }
+    job.allocations += threadAllocations() - allocationsBefore;
+    job.descriptor.stamp(kStampDetected);
+    job.stageNs[LatencyScheduler::kStageDetect] = job.descriptor.stampNs[kStampDetected] - begin;
+    return true;
+}
+
+bool AsyncFramePipeline::compositeStage(FrameJob &job) {
+    const int64_t begin = monotonicNs();
+    const int64_t allocationsBefore = threadAllocations();
+    bool ok = false;
+    try {
+        ok = previewComposite(job.gray, job.edges, job.mode, job.format, job.output);
+    } catch (const std::exception &e) {
+        LOGE("Frame %lld: composite failed: %s", (long long)job.descriptor.sequence, e.what());
+    }
+    job.allocations += threadAllocations() - allocationsBefore;
+    // Hand the NV21 and intermediate blocks back to the pool before publishing
+    job.gray.release();
+    job.edges.release();
+    job.nv21.release();
+    if (!ok) {
+        failed_.fetch_add(1, std::memory_order_relaxed);
+        recordFrame(job.allocations);
+    }
+    job.descriptor.stamp(kStampComposited);
+    job.stageNs[LatencyScheduler::kStageComposite] = job.descriptor.stampNs[kStampComposited] - begin;
+    return ok;
+}
+
+void AsyncFramePipeline::publish(std::unique_ptr<FrameJob> job) {
+    std::shared_ptr<FrameResult> result;
+    try {
+        result.reset(new FrameResult());
+    } catch (const std::exception &e) {
+        LOGE("Frame %lld: publish failed: %s", (long long)job->descriptor.sequence, e.what());
+        failed_.fetch_add(1, std::memory_order_relaxed);
+        recordFrame(job->allocations);
+        return;
+    }
+    recordFrame(job->allocations);
+    result->pixels = job->output;
+    result->width = job->width;
+    result->height = job->height;
+    result->rotationDegrees = job->rotationDegrees;
+    result->format = job->format;
+    result->descriptor = job->descriptor;
+    result->descriptor.stamp(kStampPublished);
+    updateAverage(avgProcessNs_, result->processNs());
+    processed_.fetch_add(1, std::memory_order_relaxed);
+
+    const int64_t latencyNs = result->descriptor.between(kStampIngest, kStampPublished);
+    if (scheduler_.record(job->quality, job->stageNs, latencyNs)) {
+        const LatencySchedulerStats s = scheduler_.stats();
+        LOGI("Latency %lld us (target %lld us): quality level %lld (1/%lld scale, blur %lld, morph %lld, skip %lld)",
+             (long long)(s.lastLatencyNs / 1000), (long long)(s.targetNs / 1000), (long long)s.level,
+             (long long)s.scaleDivisor, (long long)s.gaussianKernel, (long long)s.morphIterations,
+             (long long)s.skipInterval);
+    }
+
+    // The job's reference goes away with it, so the bus subscribers own the pixels from here
+    job.reset();
+    frameBus().publish(result);
+}
+
+int AsyncFramePipeline::resultSubscription() {
+    int subscription = resultSubscription_.load();
+    if (subscription != 0) return subscription;
+    std::lock_guard<std::mutex> lock(resultMutex_);
+    subscription = resultSubscription_.load();
+    if (subscription == 0) {
+        subscription = frameBus().subscribe("async-result", 1, kDropOldest);
+        resultSubscription_.store(subscription);
+    }
+    return subscription;
+}
+
+bool AsyncFramePipeline::awaitResult(FrameResult &out, int timeoutMs) {
+    FrameBus<FrameResult>::FramePtr frame;
+    if (!frameBus().next(resultSubscription(), stages_.running() ? timeoutMs : 0, frame)) return false;
+    out = *frame; // copies the Mat header only; the pixels stay shared
+    return true;
+}
+
+bool AsyncFramePipeline::pollResult(FrameResult &out) {
+    return awaitResult(out, 0);
+}
+
+AsyncPipelineStats AsyncFramePipeline::stats() {
+    std::lock_guard<std::mutex> lock(lifecycleMutex_);
+    AsyncPipelineStats s;
+    s.running = stages_.running() ? 1 : 0;
+    s.capacity = static_cast<int64_t>(stages_.inputCapacity());
+    s.queueDepth = static_cast<int64_t>(stages_.queuedFrames());
+    s.submitted = submitted_.load(std::memory_order_relaxed);
+    s.processed = processed_.load(std::memory_order_relaxed);
+    s.dropped = static_cast<int64_t>(stages_.inputDropped());
+    s.failed = failed_.load(std::memory_order_relaxed);
+    const int subscription = resultSubscription_.load();
+    s.resultsOverwritten = subscription != 0 ? frameBus().dropped(subscription) : 0;
+    s.lastQueueLatencyNs = lastQueueLatencyNs_.load(std::memory_order_relaxed);
+    s.avgQueueLatencyNs = avgQueueLatencyNs_.load(std::memory_order_relaxed);
+    s.maxQueueLatencyNs = maxQueueLatencyNs_.load(std::memory_order_relaxed);
+    s.avgProcessNs = avgProcessNs_.load(std::memory_order_relaxed);
+    s.mode = stages_.mode();
+    s.stages = stages_.stats();
+    return s;
+}
+
+AsyncFramePipeline &asyncPipeline() {
+    // Intentionally leaked like framePool(): the worker may outlive static destruction order
+    static AsyncFramePipeline *pipeline = new AsyncFramePipeline();
+    return *pipeline;
+}
+
+FrameBus<FrameResult> &frameBus() {
+    // Leaked for the same reason; subscribers may still hold frames at exit
+    static FrameBus<FrameResult> *bus = new FrameBus<FrameResult>();
+    return *bus;
+}
+
+} // namespace ffddas
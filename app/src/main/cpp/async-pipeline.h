@@ -0,0 +1,149 @@
+#pragma once
+
+#include "edge-pipeline.h"
+#include "frame-bus.h"
+#include "frame-descriptor.h"
+#include "latency-scheduler.h"
+#include "pipeline-config.h"
+#include "stage-pipeline.h"
+
+#include <opencv2/core.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ffddas {
+
+// A camera frame travelling through the async stages (NV21 copy, the ImageProxy is already closed)
+struct FrameJob {
+    cv::Mat nv21;
+    int width;              // camera size; the convert stage changes it to the processing size
+    int height;
+    int rotationDegrees;
+    OutputFormat format;
+    PreviewQuality quality; // chosen by the latency scheduler when the frame was admitted
+    FrameDescriptor descriptor; // ingestFrame() on submit; each stage stamps its end
+
+    // Copied from the current PipelineConfig snapshot when the first stage starts (its version
+    // goes into the descriptor), so a config change never lands halfway through a frame
+    PreviewMode mode;
+    double cannyLow;
+    double cannyHigh;
+    int64_t stageNs[LatencyScheduler::kStageCount]; // time each stage spent on the frame
+    int64_t allocations;    // Mat allocations each stage made on its own thread for the frame
+
+    // Stage outputs; each stage releases what later stages no longer need
+    cv::Mat gray;
+    cv::Mat edges;
+    cv::Mat output;
+};
+
+// Published once on frameBus() and shared read-only by every subscriber
+struct FrameResult {
+    cv::Mat pixels;         // in FrameJob::format; pooled, back in the pool once the last reader lets go
+    int width;              // processing size, smaller than the camera's at low quality levels
+    int height;
+    int rotationDegrees;
+    OutputFormat format;
+    FrameDescriptor descriptor; // the job's, stamped kStampPublished
+
+    int64_t queueLatencyNs() const { return descriptor.between(kStampIngest, kStampStarted); }
+    // First stage -> published (includes hand-offs when pipelined)
+    int64_t processNs() const { return descriptor.between(kStampStarted, kStampPublished); }
+    int64_t publishedNs() const { return descriptor.stampNs[kStampPublished]; }
+};
+
+struct AsyncPipelineStats {
+    int64_t running;
+    int64_t capacity;
+    int64_t queueDepth;
+    int64_t submitted;
+    int64_t processed;
+    int64_t dropped;            // evicted from the input queue by newer frames
+    int64_t failed;
+    int64_t resultsOverwritten; // finished but replaced before awaitResult() collected them
+    int64_t lastQueueLatencyNs;
+    int64_t avgQueueLatencyNs;  // exponentially weighted, 1/8 per frame
+    int64_t maxQueueLatencyNs;
+    int64_t avgProcessNs;
+    int64_t mode;               // ExecutionMode
+    std::vector<StageStats> stages;
+};
+
+/**
+ * Moves preview processing off the camera thread. submit() only moves the job
+ * into a LatestFrameQueue and returns; native workers run the preview stages
+ * (convert -> detect -> composite) and publish every result once on
+ * frameBus(), where display, web server and any other consumer subscribe with
+ * their own queue and drop policy. awaitResult() / pollResult() are a
+ * latest-frame-wins subscription kept for callers that want a copy. The input
+ * queue is latest-frame-wins too, so a slow consumer costs frames, never latency.
+ *
+ * kExecutionSerial runs all stages on one worker (lowest per-frame latency);
+ * kExecutionPipelined gives each stage its own thread so consecutive frames
+ * overlap (highest sustained fps when no single stage dominates).
+ *
+ * Every published frame reports its stage timings to scheduler(), which picks
+ * the quality (or skips) for frames that are admitted afterwards.
+ */
+class AsyncFramePipeline {
+public:
+    static const int kDefaultCapacity = 2;
+
+    AsyncFramePipeline();
+    ~AsyncFramePipeline();
+
+    bool start(int capacity, ExecutionMode mode);
+    void stop();
+    bool running() const;
+
+    // Producer side: a single thread (the camera executor) at a time.
+    // Returns the frame's sequence number, or -1 if not running.
+    int64_t submit(std::unique_ptr<FrameJob> job);
+
+    // Blocks up to timeoutMs for a result newer than the last one returned.
+    // The first call subscribes to frameBus() as "async-result".
+    bool awaitResult(FrameResult &out, int timeoutMs);
+    bool pollResult(FrameResult &out);
+
+    AsyncPipelineStats stats();
+
+    // Producers ask it before copying a frame in; configured from JNI
+    LatencyScheduler &scheduler() { return scheduler_; }
+
+private:
+    AsyncFramePipeline(const AsyncFramePipeline &);
+    AsyncFramePipeline &operator=(const AsyncFramePipeline &);
+
+    bool convertStage(FrameJob &job);
+    bool detectStage(FrameJob &job);
+    bool compositeStage(FrameJob &job);
+    void publish(std::unique_ptr<FrameJob> job);
+    int resultSubscription();
+
+    StagePipeline<FrameJob> stages_;
+    LatencyScheduler scheduler_;
+    std::mutex lifecycleMutex_; // start / stop / stats
+    std::atomic<int64_t> nextSequence_;
+
+    std::mutex resultMutex_;  // guards creating resultSubscription_
+    std::atomic<int> resultSubscription_;
+
+    std::atomic<int64_t> submitted_;
+    std::atomic<int64_t> processed_;
+    std::atomic<int64_t> failed_;
+    std::atomic<int64_t> lastQueueLatencyNs_;
+    std::atomic<int64_t> avgQueueLatencyNs_;
+    std::atomic<int64_t> maxQueueLatencyNs_;
+    std::atomic<int64_t> avgProcessNs_;
+};
+
+// Process-wide instance driven from JNI
+AsyncFramePipeline &asyncPipeline();
+
+// Every frame asyncPipeline() finishes is published here exactly once
+FrameBus<FrameResult> &frameBus();
+
+} // namespace ffddas
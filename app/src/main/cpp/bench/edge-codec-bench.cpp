@@ -0,0 +1,159 @@
+// Host benchmark: compact edge map wire format against the JPEG the server sent before.
+//
+// Runs Canny (with the pipeline's close + dilate) over a sequence of frames and
+// sends each edge map both ways: as the quality-85 gray JPEG /frame used to serve,
+// and through encodeEdgeMap() from packed bits (kOutputPackedEdges frames) and
+// from a 0/255 gray mask (kOutputGray8 edge frames). Reports bytes and encode
+// time per frame and checks every edge map round-trips exactly. The same edges traced
+// into /api/contours polylines (edge-contours.h) are listed for comparison. Frames are
+// every image in a directory, or a synthetic scene of shapes over a textured background.
+//
+//   g++ -std=c++11 -O2 -I.. edge-codec-bench.cpp ../edge-codec.cpp ../edge-contours.cpp `pkg-config --cflags --libs opencv4` -o edge-codec-bench
+//   ./edge-codec-bench [frame-dir|-] [canny-low] [canny-high]
+
+#include "edge-codec.h"
+#include "edge-contours.h"
+
+#include <opencv2/core.hpp>
+#include <opencv2/core/utility.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace ffddas;
+
+namespace {
+
+const int kSyntheticFrames = 120;
+const int kJpegQuality = 85;
+
+bool loadFrames(const std::string &dir, std::vector<cv::Mat> &frames) {
+    std::vector<cv::String> paths;
+    cv::glob(dir + "/*", paths, false);
+    std::sort(paths.begin(), paths.end());
+    for (size_t i = 0; i < paths.size(); ++i) {
+        cv::Mat frame = cv::imread(paths[i], cv::IMREAD_GRAYSCALE);
+        if (!frame.empty()) frames.push_back(frame);
+    }
+    return !frames.empty();
+}
+
+// 640x480 gray: blurred noise texture, a few shapes drifting across it
+void syntheticFrames(std::vector<cv::Mat> &frames) {
+    cv::Mat background(480, 640, CV_8UC1);
+    cv::RNG rng(12345);
+    rng.fill(background, cv::RNG::UNIFORM, 60, 190);
+    cv::GaussianBlur(background, background, cv::Size(15, 15), 0);
+    for (int i = 0; i < kSyntheticFrames; ++i) {
+        cv::Mat frame = background.clone();
+        cv::rectangle(frame, cv::Rect(40 + i, 60, 160, 120), cv::Scalar(240), cv::FILLED);
+        cv::circle(frame, cv::Point(420 - i, 300), 70, cv::Scalar(20), cv::FILLED);
+        cv::line(frame, cv::Point(0, 400 + i % 40), cv::Point(639, 360), cv::Scalar(230), 3);
+        frames.push_back(frame);
+    }
+}
+
+// Canny with the close + dilate runEdgePipeline applies for one morphology iteration
+void edges(const cv::Mat &gray, double low, double high, cv::Mat &out) {
+    cv::Mat blurred;
+    cv::GaussianBlur(gray, blurred, cv::Size(5, 5), 0);
+    cv::Canny(blurred, out, low, high);
+    const cv::Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3, 3));
+    cv::morphologyEx(out, out, cv::MORPH_CLOSE, kernel);
+    cv::dilate(out, out, kernel);
+}
+
+void pack(const cv::Mat &mask, cv::Mat &packed) {
+    packed.create(mask.rows, (mask.cols + 7) / 8, CV_8UC1);
+    packed.setTo(0);
+    for (int y = 0; y < mask.rows; ++y) {
+        for (int x = 0; x < mask.cols; ++x) {
+            if (mask.at<uchar>(y, x)) packed.at<uchar>(y, x >> 3) |= static_cast<uchar>(0x80 >> (x & 7));
+        }
+    }
+}
+
+struct Totals {
+    int64_t bytes;
+    int64_t ticks;
+};
+
+void report(const char *name, const Totals &totals, double frames, const Totals &baseline) {
+    const double tickMs = 1000.0 / cv::getTickFrequency();
+    std::printf("%-14s %8.1f KB/frame  encode %.3f ms/frame  (%.1f%% of jpeg)\n", name,
+                totals.bytes / frames / 1024, totals.ticks * tickMs / frames,
+                100.0 * totals.bytes / std::max<int64_t>(baseline.bytes, 1));
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const char *dir = argc > 1 ? argv[1] : "-";
+    const double low = argc > 2 ? std::atof(argv[2]) : 50;
+    const double high = argc > 3 ? std::atof(argv[3]) : 150;
+
+    std::vector<cv::Mat> frames;
+    if (std::strcmp(dir, "-") == 0) {
+        syntheticFrames(frames);
+    } else if (!loadFrames(dir, frames)) {
+        std::fprintf(stderr, "No usable frames in %s\n", dir);
+        return 1;
+    }
+
+    std::vector<int> jpegParams;
+    jpegParams.push_back(cv::IMWRITE_JPEG_QUALITY);
+    jpegParams.push_back(kJpegQuality);
+    Totals jpeg = {0, 0}, fromPacked = {0, 0}, fromGray = {0, 0}, contours = {0, 0};
+    ContourTracer tracer;
+    int packedFallbacks = 0;
+    std::vector<uchar> bytes;
+    cv::Mat mask, packed, decoded;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        edges(frames[i], low, high, mask);
+        pack(mask, packed);
+
+        int64_t start = cv::getTickCount();
+        cv::imencode(".jpg", mask, bytes, jpegParams);
+        jpeg.ticks += cv::getTickCount() - start;
+        jpeg.bytes += static_cast<int64_t>(bytes.size());
+
+        start = cv::getTickCount();
+        encodeEdgeMap(mask, kOutputGray8, mask.cols, mask.rows, bytes);
+        fromGray.ticks += cv::getTickCount() - start;
+        fromGray.bytes += static_cast<int64_t>(bytes.size());
+
+        start = cv::getTickCount();
+        if (!encodeEdgeMap(packed, kOutputPackedEdges, mask.cols, mask.rows, bytes)) {
+            std::fprintf(stderr, "Encoding frame %zu failed\n", i);
+            return 1;
+        }
+        fromPacked.ticks += cv::getTickCount() - start;
+        fromPacked.bytes += static_cast<int64_t>(bytes.size());
+        if (bytes[4] == kEdgeMapPacked) ++packedFallbacks;
+        if (!decodeEdgeMap(bytes.data(), bytes.size(), decoded) || cv::norm(decoded, mask, cv::NORM_INF) != 0) {
+            std::fprintf(stderr, "Frame %zu did not round-trip\n", i);
+            return 1;
+        }
+
+        start = cv::getTickCount();
+        tracer.encode(mask, bytes);
+        contours.ticks += cv::getTickCount() - start;
+        contours.bytes += static_cast<int64_t>(bytes.size());
+    }
+
+    const double n = static_cast<double>(frames.size());
+    std::printf("%zu frames %dx%d, Canny %.0f/%.0f, %.1f KB/frame packed bits\n", frames.size(), frames[0].cols,
+                frames[0].rows, low, high, (frames[0].cols + 7) / 8 * frames[0].rows / 1024.0);
+    report("jpeg q85", jpeg, n, jpeg);
+    report("edges (packed)", fromPacked, n, jpeg);
+    report("edges (gray)", fromGray, n, jpeg);
+    report("contours", contours, n, jpeg);
+    std::printf("%d frames fell back to plain packed bits\n", packedFallbacks);
+    return 0;
+}
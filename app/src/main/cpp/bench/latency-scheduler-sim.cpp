@@ -0,0 +1,196 @@
+// Host simulation test for LatencyScheduler.
+//
+// Replays a synthetic camera session through a discrete-event model of the
+// async path (frames every 1/30 s, a 2-slot latest-wins queue, one serial
+// worker) with a per-level cost model and a scene whose load rises to 4x and
+// falls back. No clock or threads are involved, so the run is exactly
+// reproducible; it fails if the scheduler misses the budget once settled,
+// does not recover quality afterwards, or decides differently on a replay.
+//
+//   g++ -std=c++11 -O2 -pthread -I.. latency-scheduler-sim.cpp ../latency-scheduler.cpp -o latency-scheduler-sim
+//   ./latency-scheduler-sim [-v]
+
+#include "latency-scheduler.h"
+
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+using namespace ffddas;
+
+namespace {
+
+const int64_t kMs = 1000000;
+const int64_t kFramePeriodNs = 33333333;
+const int64_t kTargetNs = 33 * kMs;
+const int kFrames = 2700; // 90 s
+
+struct SimFrame {
+    int64_t arrivalNs;
+    PreviewQuality quality;
+};
+
+struct Phase {
+    int firstFrame;
+    double load;  // level-0 cost multiplier, 1.0 = 20 ms per frame
+};
+
+// light -> heavy -> very heavy -> light again
+const Phase kPhases[] = {{0, 1.0}, {600, 2.5}, {1200, 4.0}, {1800, 1.0}};
+
+double loadAt(int frame) {
+    double load = kPhases[0].load;
+    for (size_t i = 0; i < sizeof(kPhases) / sizeof(kPhases[0]); ++i) {
+        if (frame >= kPhases[i].firstFrame) load = kPhases[i].load;
+    }
+    return load;
+}
+
+// Deterministic +-10% jitter
+uint32_t gRandom = 12345;
+double jitter() {
+    gRandom = gRandom * 1664525u + 1013904223u;
+    return 0.9 + 0.2 * ((gRandom >> 8) & 0xffff) / 65535.0;
+}
+
+// Stage costs at 1/scale resolution: area shrinks with scale^2, blur and morphology add to detect
+void stageCosts(const PreviewQuality &q, double load, int64_t out[LatencyScheduler::kStageCount]) {
+    const double area = 1.0 / (q.scaleDivisor * q.scaleDivisor);
+    const double blur = q.gaussianKernel >= 5 ? 4.0 : (q.gaussianKernel >= 3 ? 2.0 : 0.0);
+    const double morph = 2.0 * q.morphIterations;
+    const double convert = 3.0 + 3.0 * area; // the full-size Y plane is always read once
+    const double detect = (10.0 + blur + morph) * area;
+    const double composite = 1.0 * area;
+    out[LatencyScheduler::kStageConvert] = static_cast<int64_t>(convert * load * jitter() * kMs);
+    out[LatencyScheduler::kStageDetect] = static_cast<int64_t>(detect * load * jitter() * kMs);
+    out[LatencyScheduler::kStageComposite] = static_cast<int64_t>(composite * load * jitter() * kMs);
+}
+
+struct Trace {
+    std::vector<int> levelByFrame;      // scheduler level when each frame arrived
+    std::vector<int64_t> latencyByFrame; // -1 for skipped / dropped frames
+    int delivered;
+};
+
+Trace simulate() {
+    gRandom = 12345;
+    LatencyScheduler scheduler;
+    scheduler.configure(kTargetNs);
+
+    Trace trace;
+    trace.levelByFrame.assign(kFrames, 0);
+    trace.latencyByFrame.assign(kFrames, -1);
+    trace.delivered = 0;
+
+    std::deque<std::pair<int, SimFrame> > queue;
+    bool busy = false;
+    int current = -1;
+    SimFrame currentFrame;
+    int64_t finishNs = 0;
+    int64_t stageNs[LatencyScheduler::kStageCount];
+
+    for (int i = 0; i < kFrames; ++i) {
+        const int64_t now = i * kFramePeriodNs;
+        // Let the worker finish everything due before this arrival
+        while (busy && finishNs <= now) {
+            const int64_t latency = finishNs - currentFrame.arrivalNs;
+            scheduler.record(currentFrame.quality, stageNs, latency);
+            trace.latencyByFrame[current] = latency;
+            ++trace.delivered;
+            busy = false;
+            if (!queue.empty()) {
+                current = queue.front().first;
+                currentFrame = queue.front().second;
+                queue.pop_front();
+                stageCosts(currentFrame.quality, loadAt(current), stageNs);
+                finishNs += stageNs[0] + stageNs[1] + stageNs[2];
+                busy = true;
+            }
+        }
+
+        trace.levelByFrame[i] = static_cast<int>(scheduler.stats().level);
+        SimFrame frame;
+        frame.arrivalNs = now;
+        if (!scheduler.admit(frame.quality)) continue;
+        if (queue.size() == 2) queue.pop_front(); // latest frame wins
+        queue.push_back(std::make_pair(i, frame));
+
+        if (!busy) {
+            current = queue.front().first;
+            currentFrame = queue.front().second;
+            queue.pop_front();
+            stageCosts(currentFrame.quality, loadAt(current), stageNs);
+            finishNs = now + stageNs[0] + stageNs[1] + stageNs[2];
+            busy = true;
+        }
+    }
+    return trace;
+}
+
+int failures = 0;
+
+void expect(bool ok, const char *what) {
+    std::printf("%s  %s\n", ok ? "ok  " : "FAIL", what);
+    if (!ok) ++failures;
+}
+
+// Share of delivered frames in [from, to) that met the budget, and how often the level changed
+void phaseSummary(const Trace &t, int from, int to, double &onTime, int &changes, int &lastLevel) {
+    int delivered = 0, met = 0;
+    changes = 0;
+    for (int i = from; i < to; ++i) {
+        if (i > from && t.levelByFrame[i] != t.levelByFrame[i - 1]) ++changes;
+        if (t.latencyByFrame[i] < 0) continue;
+        ++delivered;
+        if (t.latencyByFrame[i] <= kTargetNs) ++met;
+    }
+    onTime = delivered > 0 ? static_cast<double>(met) / delivered : 0;
+    lastLevel = t.levelByFrame[to - 1];
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const bool verbose = argc > 1 && std::strcmp(argv[1], "-v") == 0;
+    const Trace first = simulate();
+    const Trace replay = simulate();
+
+    if (verbose) {
+        for (int i = 0; i < kFrames; i += 30) {
+            std::printf("t=%3ds load %.1f level %d latency %6.2f ms\n", i / 30, loadAt(i),
+                        first.levelByFrame[i], first.latencyByFrame[i] / 1e6);
+        }
+    }
+
+    // Skip the first 5 s of each phase while the controller settles
+    const int settle = 150;
+    const size_t phaseCount = sizeof(kPhases) / sizeof(kPhases[0]);
+    for (size_t p = 0; p < phaseCount; ++p) {
+        const int from = kPhases[p].firstFrame + settle;
+        const int to = p + 1 < phaseCount ? kPhases[p + 1].firstFrame : kFrames;
+        double onTime;
+        int changes, lastLevel;
+        phaseSummary(first, from, to, onTime, changes, lastLevel);
+        std::printf("phase %zu (load %.1f): %.1f%% on time, %d level changes, ends at level %d\n",
+                    p, kPhases[p].load, onTime * 100, changes, lastLevel);
+        char what[96];
+        std::snprintf(what, sizeof(what), "phase %zu: >= 95%% of settled frames within budget", p);
+        expect(onTime >= 0.95, what);
+        std::snprintf(what, sizeof(what), "phase %zu: no more than 8 level changes once settled", p);
+        expect(changes <= 8, what);
+    }
+
+    int lastLevel;
+    double onTime;
+    int changes;
+    phaseSummary(first, kFrames - 30, kFrames, onTime, changes, lastLevel);
+    expect(lastLevel <= 1, "quality recovers once the load drops");
+    phaseSummary(first, kPhases[2].firstFrame + settle, kPhases[3].firstFrame, onTime, changes, lastLevel);
+    expect(lastLevel >= 3, "heavy load is handled by lowering resolution");
+    expect(first.levelByFrame == replay.levelByFrame && first.latencyByFrame == replay.latencyByFrame,
+           "replay makes identical decisions");
+
+    std::printf("%d frames offered, %d delivered, %d failure(s)\n", kFrames, first.delivered, failures);
+    return failures == 0 ? 0 : 1;
+}
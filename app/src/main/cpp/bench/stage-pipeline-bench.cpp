@@ -0,0 +1,118 @@
+// Host benchmark: sustained fps of StagePipeline in serial vs pipelined mode.
+//
+// Stages burn a fixed amount of CPU work, calibrated on one core to roughly match
+// 720p preview on a mid-range phone (convert 5 ms, detect 12 ms, composite 4 ms),
+// while a producer offers frames at camera rate. Pipelining only pays off with a
+// free core per stage. No OpenCV or Android needed:
+//
+//   g++ -std=c++11 -O2 -pthread -I.. stage-pipeline-bench.cpp -o stage-pipeline-bench
+//   ./stage-pipeline-bench [seconds-per-mode] [camera-fps]
+
+#include "stage-pipeline.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+using namespace ffddas;
+
+namespace {
+
+struct BenchFrame {
+    int64_t enqueuedNs;
+    uint64_t checksum;
+};
+
+uint64_t gItersPerMs = 0;
+
+uint64_t work(uint64_t iterations, uint64_t seed) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+    return seed;
+}
+
+void calibrate() {
+    uint64_t iterations = 1 << 16;
+    for (;;) {
+        const int64_t begin = monotonicNs();
+        volatile uint64_t sink = work(iterations, 1);
+        (void)sink;
+        const int64_t elapsed = monotonicNs() - begin;
+        if (elapsed > 50000000) {
+            gItersPerMs = iterations * 1000000 / elapsed;
+            return;
+        }
+        iterations *= 2;
+    }
+}
+
+void spin(int ms, BenchFrame &frame) {
+    frame.checksum = work(gItersPerMs * ms, frame.checksum);
+}
+
+struct Result {
+    double fps;
+    double avgLatencyMs;
+    std::vector<StageStats> stages;
+    uint64_t dropped;
+};
+
+Result run(ExecutionMode mode, int seconds, int cameraFps) {
+    StagePipeline<BenchFrame> pipeline;
+    pipeline.addStage("convert", [](BenchFrame &f) { spin(5, f); return true; });
+    pipeline.addStage("detect", [](BenchFrame &f) { spin(12, f); return true; });
+    pipeline.addStage("composite", [](BenchFrame &f) { spin(4, f); return true; });
+
+    std::atomic<int64_t> completed(0);
+    std::atomic<int64_t> latencySumNs(0);
+    pipeline.setSink([&](std::unique_ptr<BenchFrame> f) {
+        latencySumNs.fetch_add(monotonicNs() - f->enqueuedNs);
+        completed.fetch_add(1);
+    });
+
+    pipeline.start(mode, 2);
+    const int64_t period = 1000000000LL / cameraFps;
+    const int64_t begin = monotonicNs();
+    const int64_t end = begin + seconds * 1000000000LL;
+    int64_t next = begin;
+    while (monotonicNs() < end) {
+        std::unique_ptr<BenchFrame> frame(new BenchFrame());
+        frame->enqueuedNs = monotonicNs();
+        frame->checksum = 1;
+        pipeline.push(std::move(frame));
+        next += period;
+        while (monotonicNs() < next) std::this_thread::yield();
+    }
+    const double elapsed = (monotonicNs() - begin) / 1e9;
+    Result r;
+    r.stages = pipeline.stats();
+    r.dropped = pipeline.inputDropped();
+    pipeline.stop();
+    r.fps = completed.load() / elapsed;
+    r.avgLatencyMs = completed.load() ? latencySumNs.load() / 1e6 / completed.load() : 0;
+    return r;
+}
+
+void print(const char *label, const Result &r) {
+    std::printf("%-10s %6.1f fps  avg latency %6.2f ms  input drops %llu\n",
+                label, r.fps, r.avgLatencyMs, (unsigned long long)r.dropped);
+    for (size_t i = 0; i < r.stages.size(); ++i) {
+        const StageStats &s = r.stages[i];
+        std::printf("    %-10s frames %5lld  occupancy %5.1f%%  handoff drops %lld\n",
+                    s.name.c_str(), (long long)s.frames, s.occupancyPermille / 10.0,
+                    (long long)s.inputDropped);
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const int seconds = argc > 1 ? std::atoi(argv[1]) : 3;
+    const int cameraFps = argc > 2 ? std::atoi(argv[2]) : 60;
+    calibrate();
+    std::printf("stage costs 5 / 12 / 4 ms, camera %d fps, %d s per mode, %u cores\n",
+                cameraFps, seconds, std::thread::hardware_concurrency());
+    print("serial", run(kExecutionSerial, seconds, cameraFps));
+    print("pipelined", run(kExecutionPipelined, seconds, cameraFps));
+    return 0;
+}
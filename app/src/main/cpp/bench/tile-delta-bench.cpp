@@ -0,0 +1,132 @@
+// Host benchmark: bytes per second of tile-delta streaming against full-frame MJPEG.
+//
+// Feeds a sequence of frames through TileDeltaEncoder and through plain imencode
+// (what /stream sends per part) at the same quality, and reports what each would
+// put on the wire at the given frame rate. Frames are either a recorded sequence,
+// every image in a directory in name order (e.g. frames dumped from /frame or
+// extracted with ffmpeg), or a synthetic fixed-camera scene: a textured
+// background with sensor noise and one object moving across it.
+//
+//   g++ -std=c++11 -O2 -I.. tile-delta-bench.cpp ../tile-delta.cpp `pkg-config --cflags --libs opencv4` -o tile-delta-bench
+//   ./tile-delta-bench [frame-dir|-] [fps] [quality] [tile-size]
+
+#include "tile-delta.h"
+
+#include <opencv2/core.hpp>
+#include <opencv2/core/utility.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace ffddas;
+
+namespace {
+
+const int kSyntheticFrames = 300;
+const int kSyntheticWidth = 640;
+const int kSyntheticHeight = 480;
+
+bool loadFrames(const std::string &dir, std::vector<cv::Mat> &frames) {
+    std::vector<cv::String> paths;
+    cv::glob(dir + "/*", paths, false);
+    std::sort(paths.begin(), paths.end());
+    for (size_t i = 0; i < paths.size(); ++i) {
+        cv::Mat frame = cv::imread(paths[i], cv::IMREAD_COLOR);
+        if (frame.empty()) continue; // not an image
+        if (!frames.empty() && frame.size() != frames[0].size()) {
+            std::fprintf(stderr, "%s: %dx%d, expected %dx%d\n", paths[i].c_str(), frame.cols, frame.rows,
+                         frames[0].cols, frames[0].rows);
+            return false;
+        }
+        frames.push_back(frame);
+    }
+    return !frames.empty();
+}
+
+// Fixed camera: static texture, +-4 noise per pixel, a 96 px object crossing the frame
+void syntheticFrames(std::vector<cv::Mat> &frames) {
+    cv::Mat background(kSyntheticHeight, kSyntheticWidth, CV_8UC3);
+    cv::RNG rng(12345);
+    rng.fill(background, cv::RNG::UNIFORM, 40, 200);
+    cv::GaussianBlur(background, background, cv::Size(9, 9), 0);
+    cv::Mat noise(background.size(), CV_16SC3);
+    for (int i = 0; i < kSyntheticFrames; ++i) {
+        cv::Mat frame;
+        rng.fill(noise, cv::RNG::UNIFORM, -4, 5);
+        background.convertTo(frame, CV_16SC3);
+        frame += noise;
+        frame.convertTo(frame, CV_8UC3);
+        const int x = (i * 4) % (kSyntheticWidth + 96) - 96;
+        cv::rectangle(frame, cv::Rect(x, kSyntheticHeight / 3, 96, 96), cv::Scalar(30, 160, 230), cv::FILLED);
+        frames.push_back(frame);
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const char *dir = argc > 1 ? argv[1] : "-";
+    const double fps = argc > 2 ? std::atof(argv[2]) : 30.0;
+    const int quality = argc > 3 ? std::atoi(argv[3]) : 85;
+    TileDeltaParams params = kDefaultTileDeltaParams;
+    if (argc > 4) params.tileSize = std::atoi(argv[4]);
+
+    std::vector<cv::Mat> frames;
+    if (std::strcmp(dir, "-") == 0) {
+        syntheticFrames(frames);
+    } else if (!loadFrames(dir, frames)) {
+        std::fprintf(stderr, "No usable frames in %s\n", dir);
+        return 1;
+    }
+
+    std::vector<int> jpegParams;
+    jpegParams.push_back(cv::IMWRITE_JPEG_QUALITY);
+    jpegParams.push_back(quality);
+    std::vector<uchar> bytes;
+    int64_t mjpegBytes = 0;
+    int64_t mjpegTicks = 0;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        const int64_t start = cv::getTickCount();
+        cv::imencode(".jpg", frames[i], bytes, jpegParams);
+        mjpegTicks += cv::getTickCount() - start;
+        mjpegBytes += static_cast<int64_t>(bytes.size());
+    }
+
+    TileDeltaEncoder encoder(params);
+    TileDeltaResult result;
+    int64_t deltaBytes = 0;
+    int64_t deltaTicks = 0;
+    int64_t changedTiles = 0;
+    int counts[3] = {0, 0, 0};
+    for (size_t i = 0; i < frames.size(); ++i) {
+        const int64_t start = cv::getTickCount();
+        if (!encoder.encode(frames[i], quality, false, bytes, result)) {
+            std::fprintf(stderr, "Encoding frame %zu failed\n", i);
+            return 1;
+        }
+        deltaTicks += cv::getTickCount() - start;
+        deltaBytes += static_cast<int64_t>(bytes.size());
+        ++counts[result.kind];
+        if (result.kind == kDeltaTiles) changedTiles += result.changedTiles;
+    }
+
+    const double n = static_cast<double>(frames.size());
+    const double tickMs = 1000.0 / cv::getTickFrequency();
+    std::printf("%zu frames %dx%d, quality %d, %d px tiles, %.0f fps\n", frames.size(), frames[0].cols,
+                frames[0].rows, quality, params.tileSize, fps);
+    std::printf("mjpeg  %8.1f KB/s  %6.1f KB/frame  encode %.2f ms/frame\n", mjpegBytes / n * fps / 1024,
+                mjpegBytes / n / 1024, mjpegTicks * tickMs / n);
+    std::printf("delta  %8.1f KB/s  %6.1f KB/frame  encode %.2f ms/frame  (%.1f%% of mjpeg)\n",
+                deltaBytes / n * fps / 1024, deltaBytes / n / 1024, deltaTicks * tickMs / n,
+                100.0 * deltaBytes / std::max<int64_t>(mjpegBytes, 1));
+    std::printf("       %d keyframes, %d tile messages (%.1f tiles avg), %d unchanged\n", counts[kDeltaKeyframe],
+                counts[kDeltaTiles], counts[kDeltaTiles] ? static_cast<double>(changedTiles) / counts[kDeltaTiles] : 0.0,
+                counts[kDeltaUnchanged]);
+    return 0;
+}
@@ -0,0 +1,104 @@
+// Host benchmark: task-spawn overhead and scaling of WorkStealingPool.
+//
+// Spawn: ns per submitted empty task (vs. a std::thread per task) and per
+// parallelFor() call with an empty body. Scaling: a fixed CPU-bound loop run
+// with 0..2x cores workers. Numbers only mean something on a multi-core host.
+//
+//   g++ -std=c++11 -O2 -pthread -I.. work-pool-bench.cpp ../work-pool.cpp -o work-pool-bench
+//   ./work-pool-bench [max-workers]
+
+#include "work-pool.h"
+#include "stage-pipeline.h" // monotonicNs()
+
+#include <cstdio>
+#include <cstdlib>
+
+using namespace ffddas;
+
+namespace {
+
+volatile uint64_t gSink;
+
+uint64_t burn(int iterations, uint64_t seed) {
+    for (int i = 0; i < iterations; ++i) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+    return seed;
+}
+
+double submitOverheadNs(WorkStealingPool &pool, int tasks) {
+    std::atomic<int> done(0);
+    const int64_t begin = monotonicNs();
+    for (int i = 0; i < tasks; ++i) {
+        pool.submit([&done] { done.fetch_add(1, std::memory_order_relaxed); });
+    }
+    while (done.load() < tasks) std::this_thread::yield();
+    return static_cast<double>(monotonicNs() - begin) / tasks;
+}
+
+double threadOverheadNs(int tasks) {
+    std::atomic<int> done(0);
+    const int64_t begin = monotonicNs();
+    for (int i = 0; i < tasks; ++i) {
+        std::thread t([&done] { done.fetch_add(1, std::memory_order_relaxed); });
+        t.join();
+    }
+    return static_cast<double>(monotonicNs() - begin) / tasks;
+}
+
+double parallelForOverheadNs(WorkStealingPool &pool, int calls) {
+    std::atomic<int> items(0);
+    const int64_t begin = monotonicNs();
+    for (int i = 0; i < calls; ++i) {
+        pool.parallelFor(0, 64, [&items](int from, int to) {
+            items.fetch_add(to - from, std::memory_order_relaxed);
+        }, 1);
+    }
+    return static_cast<double>(monotonicNs() - begin) / calls;
+}
+
+double scalingMs(WorkStealingPool &pool, int items, int iterationsPerItem) {
+    std::vector<uint64_t> out(items);
+    const int64_t begin = monotonicNs();
+    pool.parallelFor(0, items, [&](int from, int to) {
+        for (int i = from; i < to; ++i) out[i] = burn(iterationsPerItem, i);
+    });
+    const int64_t elapsed = monotonicNs() - begin;
+    uint64_t sum = 0;
+    for (int i = 0; i < items; ++i) sum += out[i];
+    gSink = sum;
+    return elapsed / 1e6;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const int cores = static_cast<int>(std::thread::hardware_concurrency());
+    const int maxWorkers = argc > 1 ? std::atoi(argv[1]) : (cores > 0 ? cores * 2 : 4);
+    std::printf("%d hardware threads\n\n", cores);
+
+    WorkStealingPool pool;
+    pool.start(WorkStealingPool::defaultWorkerCount());
+    std::printf("spawn overhead (%d workers)\n", pool.workerCount());
+    std::printf("  submit, empty task       %8.0f ns/task\n", submitOverheadNs(pool, 200000));
+    std::printf("  std::thread per task     %8.0f ns/task\n", threadOverheadNs(2000));
+    std::printf("  parallelFor, 64 items    %8.0f ns/call\n", parallelForOverheadNs(pool, 20000));
+    pool.start(0);
+    std::printf("  parallelFor, no workers  %8.0f ns/call\n\n", parallelForOverheadNs(pool, 20000));
+
+    const int items = 512;
+    const int iterations = 200000;
+    std::printf("scaling: %d items x %d iterations\n", items, iterations);
+    double serial = 0;
+    for (int workers = 0; workers <= maxWorkers; workers = workers == 0 ? 1 : workers * 2) {
+        pool.start(workers);
+        scalingMs(pool, items, iterations / 10); // warm up the workers
+        const int64_t stolenBefore = pool.stats().stolen;
+        const double ms = scalingMs(pool, items, iterations);
+        if (workers == 0) serial = ms;
+        std::printf("  %2d workers  %8.1f ms  speedup %.2fx  stolen %lld\n",
+                    workers, ms, serial / ms, (long long)(pool.stats().stolen - stolenBefore));
+    }
+    pool.stop();
+    return 0;
+}
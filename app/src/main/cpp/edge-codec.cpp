@@ -0,0 +1,191 @@
+#include "edge-codec.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace ffddas {
+
+namespace {
+
+int rowBytes(int width) {
+    return (width + 7) / 8; // packedRowStride(), kept here so the codec links on its own
+}
+
+void putU16(std::vector<uchar> &out, int value) {
+    out.push_back(static_cast<uchar>(value & 0xFF));
+    out.push_back(static_cast<uchar>((value >> 8) & 0xFF));
+}
+
+// Alternating clear / set runs as LEB128; gives up once the output passes limit
+class RunWriter {
+public:
+    RunWriter(std::vector<uchar> &out, size_t limit) : out_(out), limit_(limit), set_(false), run_(0) {}
+
+    void add(bool set, uint32_t count) {
+        if (set != set_) {
+            flush();
+            set_ = set;
+        }
+        run_ += count;
+    }
+
+    void finish() { flush(); }
+
+    bool full() const { return out_.size() > limit_; }
+
+private:
+    void flush() {
+        uint32_t value = run_;
+        while (value >= 0x80) {
+            out_.push_back(static_cast<uchar>(value | 0x80));
+            value >>= 7;
+        }
+        out_.push_back(static_cast<uchar>(value));
+        run_ = 0;
+    }
+
+    std::vector<uchar> &out_;
+    size_t limit_;
+    bool set_;
+    uint32_t run_;
+};
+
+// Runs of one row of packed bits; whole 0x00 / 0xFF bytes are taken 8 pixels at a time
+void packedRowRuns(const uchar *row, int width, RunWriter &writer) {
+    for (int x = 0; x < width; x += 8) {
+        const uchar byte = row[x >> 3];
+        const int bits = std::min(8, width - x);
+        if (byte == 0) {
+            writer.add(false, bits);
+        } else if (byte == 0xFF && bits == 8) {
+            writer.add(true, 8);
+        } else {
+            for (int bit = 0; bit < bits; ++bit) writer.add((byte & (0x80 >> bit)) != 0, 1);
+        }
+    }
+}
+
+// False at the first pixel that is neither 0 nor 255
+bool grayRowRuns(const uchar *row, int width, RunWriter &writer) {
+    int x = 0;
+    while (x < width) {
+        const uchar value = row[x];
+        if (value != 0 && value != 255) return false;
+        int end = x + 1;
+        while (end < width && row[end] == value) ++end;
+        writer.add(value != 0, static_cast<uint32_t>(end - x));
+        x = end;
+    }
+    return true;
+}
+
+void packGrayRow(const uchar *row, int width, uchar *out) {
+    std::fill(out, out + rowBytes(width), 0);
+    for (int x = 0; x < width; ++x) {
+        if (row[x]) out[x >> 3] |= static_cast<uchar>(0x80 >> (x & 7));
+    }
+}
+
+} // namespace
+
+bool encodeEdgeMap(const cv::Mat &pixels, OutputFormat format, int width, int height, std::vector<uchar> &out) {
+    out.clear();
+    if (pixels.empty() || pixels.type() != CV_8UC1 || width <= 0 || height <= 0 || width > 0xFFFF ||
+        height > 0xFFFF || pixels.rows < height) {
+        return false;
+    }
+    const bool packed = format == kOutputPackedEdges;
+    if (packed ? pixels.cols < rowBytes(width) : (format != kOutputGray8 || pixels.cols < width)) return false;
+
+    const size_t packedSize = static_cast<size_t>(rowBytes(width)) * height;
+    putU16(out, width);
+    putU16(out, height);
+    out.push_back(kEdgeMapRuns);
+    {
+        RunWriter writer(out, kEdgeMapHeaderBytes + packedSize);
+        for (int y = 0; y < height && !writer.full(); ++y) {
+            if (packed) {
+                packedRowRuns(pixels.ptr<uchar>(y), width, writer);
+            } else if (!grayRowRuns(pixels.ptr<uchar>(y), width, writer)) {
+                out.clear();
+                return false;
+            }
+        }
+        writer.finish();
+        if (!writer.full()) return true;
+    }
+
+    // Too busy for runs: plain packed rows. Gray input was fully checked only if the runs got
+    // through every row, so the rest is checked while packing.
+    out.resize(kEdgeMapHeaderBytes);
+    out[4] = kEdgeMapPacked;
+    const int stride = rowBytes(width);
+    out.resize(kEdgeMapHeaderBytes + packedSize);
+    for (int y = 0; y < height; ++y) {
+        uchar *dst = &out[kEdgeMapHeaderBytes + static_cast<size_t>(y) * stride];
+        const uchar *row = pixels.ptr<uchar>(y);
+        if (packed) {
+            std::copy(row, row + stride, dst);
+            continue;
+        }
+        for (int x = 0; x < width; ++x) {
+            if (row[x] != 0 && row[x] != 255) {
+                out.clear();
+                return false;
+            }
+        }
+        packGrayRow(row, width, dst);
+    }
+    return true;
+}
+
+bool decodeEdgeMap(const uchar *data, size_t size, cv::Mat &mask) {
+    if (data == nullptr || size < static_cast<size_t>(kEdgeMapHeaderBytes)) return false;
+    const int width = data[0] | (data[1] << 8);
+    const int height = data[2] | (data[3] << 8);
+    const int encoding = data[4];
+    if (width == 0 || height == 0) return false;
+    mask.create(height, width, CV_8UC1);
+    const uchar *src = data + kEdgeMapHeaderBytes;
+    const uchar *end = data + size;
+
+    if (encoding == kEdgeMapPacked) {
+        const int stride = rowBytes(width);
+        if (static_cast<size_t>(end - src) < static_cast<size_t>(stride) * height) return false;
+        for (int y = 0; y < height; ++y, src += stride) {
+            uchar *dst = mask.ptr<uchar>(y);
+            for (int x = 0; x < width; ++x) dst[x] = (src[x >> 3] & (0x80 >> (x & 7))) ? 255 : 0;
+        }
+        return true;
+    }
+    if (encoding != kEdgeMapRuns) return false;
+
+    // Runs cross row ends; a reused mask may be a ROI, so each row is addressed on its own
+    const size_t total = static_cast<size_t>(width) * height;
+    size_t position = 0;
+    bool set = false;
+    while (position < total) {
+        uint32_t run = 0;
+        for (int shift = 0;; shift += 7) {
+            if (src == end || shift > 28) return false;
+            const uchar byte = *src++;
+            run |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) break;
+        }
+        if (run > total - position) return false;
+        const uchar value = set ? 255 : 0;
+        while (run > 0) {
+            const int y = static_cast<int>(position / width);
+            const int x = static_cast<int>(position % width);
+            const uint32_t count = std::min<uint32_t>(run, static_cast<uint32_t>(width - x));
+            uchar *row = mask.ptr<uchar>(y);
+            std::fill(row + x, row + x + count, value);
+            position += count;
+            run -= count;
+        }
+        set = !set;
+    }
+    return true;
+}
+
+} // namespace ffddas
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "edge-pipeline.h"
+
+#include <opencv2/core.hpp>
+
+#include <vector>
+
+namespace ffddas {
+
+// How an edge map payload is stored; the encoder picks whichever is smaller
+enum EdgeMapEncoding {
+    kEdgeMapPacked = 0,  // packBits() rows, packedRowStride(width) bytes each
+    kEdgeMapRuns = 1     // run lengths, see below
+};
+
+const int kEdgeMapHeaderBytes = 5;
+
+/**
+ * Wire format for binary edge maps, served instead of a JPEG when a frame is
+ * nothing but edges. 1 bit per pixel has no ringing and is already 8x smaller
+ * than gray; thin Canny edges on an empty background then compress to a few
+ * bytes per edge crossing as runs.
+ *
+ * Layout, little-endian:
+ *   u16 width, u16 height, u8 encoding (EdgeMapEncoding), then
+ *   kEdgeMapPacked: height rows of packed bits
+ *   kEdgeMapRuns:   unsigned LEB128 run lengths over the width * height pixels
+ *                   in row-major order, alternating clear and set and starting
+ *                   with clear (the first run may be 0). Runs cross row ends.
+ *
+ * Worst case (a noise-like mask) is the packed size plus the header.
+ */
+
+// Encodes pixels in format: kOutputPackedEdges always, kOutputGray8 only if every pixel is
+// 0 or 255. False for anything else, i.e. the frame is not a binary edge map.
+bool encodeEdgeMap(const cv::Mat &pixels, OutputFormat format, int width, int height, std::vector<uchar> &out);
+
+// Inverse of encodeEdgeMap into a CV_8UC1 mask of 0 and 255. False on a malformed payload.
+bool decodeEdgeMap(const uchar *data, size_t size, cv::Mat &mask);
+
+} // namespace ffddas
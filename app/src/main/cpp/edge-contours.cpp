@@ -0,0 +1,124 @@
+#include "edge-contours.h"
+
+#include <opencv2/imgproc.hpp>
+
+#include <cstdint>
+
+namespace ffddas {
+
+// 1.5 px keeps curves smooth at preview sizes; under 8 px of outline is speckle
+const ContourParams kDefaultContourParams = {1.5, 8.0};
+
+namespace {
+
+void putU16(std::vector<uchar> &out, int value) {
+    out.push_back(static_cast<uchar>(value & 0xFF));
+    out.push_back(static_cast<uchar>((value >> 8) & 0xFF));
+}
+
+void putVarint(std::vector<uchar> &out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uchar>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uchar>(value));
+}
+
+void putSigned(std::vector<uchar> &out, int value) {
+    putVarint(out, (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31));
+}
+
+bool getVarint(const uchar *&src, const uchar *end, uint32_t &value) {
+    value = 0;
+    for (int shift = 0; shift <= 28; shift += 7) {
+        if (src == end) return false;
+        const uchar byte = *src++;
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+bool getSigned(const uchar *&src, const uchar *end, int &value) {
+    uint32_t raw;
+    if (!getVarint(src, end, raw)) return false;
+    value = static_cast<int>(raw >> 1) ^ -static_cast<int>(raw & 1);
+    return true;
+}
+
+} // namespace
+
+ContourTracer::ContourTracer(const ContourParams &params) : params_(params) {}
+
+void ContourTracer::trace(const cv::Mat &mask, std::vector<Polyline> &polylines) {
+    polylines.clear();
+    cv::findContours(mask, traced_, cv::RETR_LIST, cv::CHAIN_APPROX_SIMPLE);
+    for (size_t i = 0; i < traced_.size(); ++i) {
+        if (cv::arcLength(traced_[i], true) < params_.minLength) continue;
+        polylines.push_back(Polyline());
+        if (params_.epsilon > 0) {
+            cv::approxPolyDP(traced_[i], polylines.back(), params_.epsilon, true);
+        } else {
+            polylines.back().swap(traced_[i]);
+        }
+    }
+}
+
+bool ContourTracer::encode(const cv::Mat &mask, std::vector<uchar> &out) {
+    out.clear();
+    if (mask.empty() || mask.type() != CV_8UC1 || mask.cols > 0xFFFF || mask.rows > 0xFFFF) return false;
+    trace(mask, polylines_);
+    encodeContours(mask.cols, mask.rows, polylines_, out);
+    return true;
+}
+
+void encodeContours(int width, int height, const std::vector<Polyline> &polylines, std::vector<uchar> &out) {
+    out.clear();
+    putU16(out, width);
+    putU16(out, height);
+    putVarint(out, static_cast<uint32_t>(polylines.size()));
+    cv::Point origin(0, 0);
+    for (size_t i = 0; i < polylines.size(); ++i) {
+        const Polyline &polyline = polylines[i];
+        putVarint(out, static_cast<uint32_t>(polyline.size()));
+        cv::Point previous = origin;
+        for (size_t j = 0; j < polyline.size(); ++j) {
+            putSigned(out, polyline[j].x - previous.x);
+            putSigned(out, polyline[j].y - previous.y);
+            previous = polyline[j];
+        }
+        if (!polyline.empty()) origin = polyline[0];
+    }
+}
+
+bool decodeContours(const uchar *data, size_t size, int &width, int &height, std::vector<Polyline> &polylines) {
+    polylines.clear();
+    if (data == nullptr || size < 4) return false;
+    width = data[0] | (data[1] << 8);
+    height = data[2] | (data[3] << 8);
+    const uchar *src = data + 4;
+    const uchar *end = data + size;
+    uint32_t count;
+    if (!getVarint(src, end, count)) return false;
+    cv::Point origin(0, 0);
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t points;
+        // Every point takes at least two bytes, which bounds the allocation
+        if (!getVarint(src, end, points) || points > static_cast<size_t>(end - src) / 2) return false;
+        polylines.push_back(Polyline());
+        Polyline &polyline = polylines.back();
+        polyline.reserve(points);
+        cv::Point point = origin;
+        for (uint32_t j = 0; j < points; ++j) {
+            int dx, dy;
+            if (!getSigned(src, end, dx) || !getSigned(src, end, dy)) return false;
+            point.x += dx;
+            point.y += dy;
+            polyline.push_back(point);
+        }
+        if (points > 0) origin = polyline[0];
+    }
+    return src == end;
+}
+
+} // namespace ffddas
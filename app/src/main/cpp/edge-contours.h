@@ -0,0 +1,57 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+
+#include <vector>
+
+namespace ffddas {
+
+struct ContourParams {
+    double epsilon;    // Douglas-Peucker tolerance in pixels; 0 keeps every traced point
+    double minLength;  // contours shorter than this (perimeter, pixels) are dropped as noise
+};
+
+extern const ContourParams kDefaultContourParams;
+
+typedef std::vector<cv::Point> Polyline;
+
+/**
+ * Edge geometry instead of pixels: the outlines of an edge mask traced with
+ * cv::findContours and simplified with cv::approxPolyDP, for consumers that
+ * only need shapes. A thin Canny edge comes back as a loop along both of its
+ * sides that simplifies to the edge drawn there and back.
+ *
+ * Wire format, little-endian (LEB128 = unsigned varint, zigzag for signed):
+ *   u16 width, u16 height, LEB128 polylineCount, then per polyline
+ *   LEB128 pointCount and pointCount zigzag LEB128 (dx, dy) pairs. Each
+ *   point is relative to the one before it; a polyline's first point is
+ *   relative to the first point of the previous polyline (or 0,0). Polylines
+ *   are closed: the last point joins the first.
+ *
+ * Not thread-safe; keep one per thread.
+ */
+class ContourTracer {
+public:
+    explicit ContourTracer(const ContourParams &params = kDefaultContourParams);
+
+    // Traces mask (CV_8UC1, non-zero = edge) into polylines. The mask is not modified.
+    void trace(const cv::Mat &mask, std::vector<Polyline> &polylines);
+
+    // trace() and encodeContours() in one; false for an unusable mask
+    bool encode(const cv::Mat &mask, std::vector<uchar> &out);
+
+private:
+    ContourTracer(const ContourTracer &);
+    ContourTracer &operator=(const ContourTracer &);
+
+    ContourParams params_;
+    std::vector<Polyline> traced_;     // findContours output, before simplification
+    std::vector<Polyline> polylines_;  // encode()'s
+};
+
+void encodeContours(int width, int height, const std::vector<Polyline> &polylines, std::vector<uchar> &out);
+
+// Inverse of encodeContours; false on a malformed payload
+bool decodeContours(const uchar *data, size_t size, int &width, int &height, std::vector<Polyline> &polylines);
+
+} // namespace ffddas
@@ -0,0 +1,416 @@
+#define LOG_TAG "EdgePipeline"
+
+#include "edge-pipeline.h"
+#include "native-log.h"
+#include "native-stats.h"
+#include "work-pool.h"
+
+#include <opencv2/imgproc.hpp>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+namespace ffddas {
+
+// Helper: validate odd kernel size >=1
+int ensureOddKernel(int k) {
+    if (k < 1) k = 1;
+    if (k % 2 == 0) k += 1; // make odd
+    return k;
+}
+
+bool toGray(const cv::Mat &src, cv::Mat &gray) {
+    switch (src.channels()) {
+        case 1: gray = src; return true;
+        case 2: cv::cvtColor(src, gray, cv::COLOR_BGR5652GRAY); return true; // Android RGB_565 layout
+        case 3: cv::cvtColor(src, gray, cv::COLOR_RGB2GRAY); return true;
+        case 4: cv::cvtColor(src, gray, cv::COLOR_RGBA2GRAY); return true;
+        default: return false;
+    }
+}
+
+int packedRowStride(int width) {
+    return (width + 7) / 8;
+}
+
+void packBits(const cv::Mat &mask, cv::Mat &packed) {
+    CV_Assert(mask.type() == CV_8UC1);
+    const int stride = packedRowStride(mask.cols);
+    const int whole = mask.cols / 8;
+    packed.create(mask.rows, stride, CV_8UC1);
+    for (int y = 0; y < mask.rows; ++y) {
+        const uchar *src = mask.ptr<uchar>(y);
+        uchar *dst = packed.ptr<uchar>(y);
+        for (int i = 0; i < whole; ++i, src += 8) {
+            dst[i] = static_cast<uchar>((src[0] ? 0x80 : 0) | (src[1] ? 0x40 : 0) |
+                                        (src[2] ? 0x20 : 0) | (src[3] ? 0x10 : 0) |
+                                        (src[4] ? 0x08 : 0) | (src[5] ? 0x04 : 0) |
+                                        (src[6] ? 0x02 : 0) | (src[7] ? 0x01 : 0));
+        }
+        if (whole < stride) {
+            // Tail byte: unused low bits stay zero
+            uchar tail = 0;
+            for (int bit = 0; bit < mask.cols - whole * 8; ++bit) {
+                if (src[bit]) tail |= static_cast<uchar>(0x80 >> bit);
+            }
+            dst[whole] = tail;
+        }
+    }
+}
+
+void unpackBits(const cv::Mat &packed, int width, cv::Mat &mask) {
+    CV_Assert(packed.type() == CV_8UC1 && packed.cols >= packedRowStride(width));
+    mask.create(packed.rows, width, CV_8UC1);
+    for (int y = 0; y < packed.rows; ++y) {
+        const uchar *src = packed.ptr<uchar>(y);
+        uchar *dst = mask.ptr<uchar>(y);
+        for (int x = 0; x < width; ++x) {
+            dst[x] = (src[x >> 3] & (0x80 >> (x & 7))) ? 255 : 0;
+        }
+    }
+}
+
+void grayToOutput(const cv::Mat &gray, cv::Mat &out, OutputFormat format) {
+    switch (format) {
+        case kOutputRgb565: cv::cvtColor(gray, out, cv::COLOR_GRAY2BGR565); break;
+        case kOutputGray8: out = gray; break;
+        case kOutputPackedEdges: packBits(gray, out); break;
+        default: cv::cvtColor(gray, out, cv::COLOR_GRAY2RGBA); break;
+    }
+}
+
+// Core pipeline applying blur, canny, morphology; returns a Mat in the input's format unless overridden
+cv::Mat runEdgePipeline(const cv::Mat &src,
+                        int gaussianKernel,
+                        double sigmaX,
+                        double sigmaY,
+                        double cannyLow,
+                        double cannyHigh,
+                        int morphIterations,
+                        bool outputGray,
+                        int outputFormat) {
+    SubsystemScope scope(kSubsystemPipeline);
+    if (src.empty()) {
+        LOGE("runEdgePipeline: empty input Mat");
+        return cv::Mat();
+    }
+    if (src.type() != CV_8UC4 && src.type() != CV_8UC2) {
+        LOGE("runEdgePipeline: unsupported input type %d", src.type());
+        return cv::Mat();
+    }
+    if (outputFormat < kOutputMatchInput || outputFormat > kOutputPackedEdges) {
+        LOGE("runEdgePipeline: unknown output format %d", outputFormat);
+        return cv::Mat();
+    }
+    const OutputFormat format = outputFormat != kOutputMatchInput
+            ? static_cast<OutputFormat>(outputFormat)
+            : (src.type() == CV_8UC2 ? kOutputRgb565 : kOutputRgba);
+
+    // Convert to grayscale (565 goes straight to luma, no RGBA intermediate)
+    cv::Mat gray;
+    toGray(src, gray);
+
+    // Gaussian blur (kept apart from gray, which is the base of a gray overlay)
+    gaussianKernel = ensureOddKernel(gaussianKernel);
+    cv::Mat blurred;
+    try {
+        cv::GaussianBlur(gray, blurred, cv::Size(gaussianKernel, gaussianKernel), sigmaX, sigmaY);
+    } catch (const cv::Exception &e) {
+        LOGE("GaussianBlur failed: %s", e.what());
+        return cv::Mat();
+    }
+
+    // Canny edge detection
+    cv::Mat edges;
+    try {
+        cv::Canny(blurred, edges, cannyLow, cannyHigh);
+    } catch (const cv::Exception &e) {
+        LOGE("Canny failed: %s", e.what());
+        return cv::Mat();
+    }
+
+    // Morphological post-processing (close + optional dilate/erode)
+    if (morphIterations > 0) {
+        cv::Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3,3));
+        try {
+            cv::morphologyEx(edges, edges, cv::MORPH_CLOSE, kernel);
+            for (int i = 1; i < morphIterations; ++i) {
+                cv::dilate(edges, edges, kernel);
+            }
+        } catch (const cv::Exception &e) {
+            LOGE("Morphology failed: %s", e.what());
+        }
+    }
+
+    cv::Mat output;
+    if (outputGray || format == kOutputPackedEdges) {
+        // Edges as grayscale in the caller's pixel format
+        grayToOutput(edges, output, format);
+    } else if (format == kOutputGray8) {
+        // Edges painted white over the luma of the input (gray is ours, src is never 1-channel)
+        output = gray;
+        output.setTo(cv::Scalar::all(255), edges);
+    } else if (format != (src.type() == CV_8UC2 ? kOutputRgb565 : kOutputRgba)) {
+        // Color overlay in the other color format: convert the base first
+        if (format == kOutputRgb565) {
+            cv::cvtColor(src, output, cv::COLOR_RGBA2BGR565);
+        } else {
+            cv::cvtColor(src, output, cv::COLOR_BGR5652RGBA);
+        }
+        output.setTo(cv::Scalar::all(255), edges);
+    } else {
+        // For visualization, paint edges white over the base image.
+        // White is all bytes 0xFF in both RGBA and RGB565.
+        output = src.clone();
+        output.setTo(cv::Scalar::all(255), edges);
+    }
+    return output;
+}
+
+cv::Mat runEdgePipeline(const cv::Mat &src, const PipelineParams &params) {
+    return runEdgePipeline(src, params.gaussianKernel, params.sigmaX, params.sigmaY,
+                           params.cannyLow, params.cannyHigh, params.morphIterations, params.outputGray,
+                           params.outputFormat);
+}
+
+void yuvPlanesToNv21(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                     int width, int height, int yRowStride, int uvRowStride, int uvPixelStride,
+                     cv::Mat &nv21) {
+    SubsystemScope scope(kSubsystemConversion);
+    const int chromaWidth = width / 2;
+    const int chromaHeight = height / 2;
+    nv21.create(height + chromaHeight, width, CV_8UC1);
+    for (int r = 0; r < height; ++r) {
+        std::memcpy(nv21.ptr<uint8_t>(r), y + static_cast<size_t>(r) * yRowStride, width);
+    }
+    // Most devices hand out the chroma planes as views of one interleaved VU buffer
+    const bool interleavedVu = uvPixelStride == 2 && u == v + 1;
+    for (int r = 0; r < chromaHeight; ++r) {
+        uint8_t *dst = nv21.ptr<uint8_t>(height + r);
+        const uint8_t *vRow = v + static_cast<size_t>(r) * uvRowStride;
+        const uint8_t *uRow = u + static_cast<size_t>(r) * uvRowStride;
+        if (interleavedVu) {
+            std::memcpy(dst, vRow, chromaWidth * 2);
+        } else {
+            for (int c = 0; c < chromaWidth; ++c) {
+                dst[2 * c] = vRow[c * uvPixelStride];
+                dst[2 * c + 1] = uRow[c * uvPixelStride];
+            }
+        }
+    }
+}
+
+void previewToGray(const cv::Mat &nv21, int height, PreviewMode mode, OutputFormat format,
+                   const PreviewQuality &quality, cv::Mat &gray) {
+    if (mode == kPreviewEdges && format == kOutputRgba) {
+        // Convert YUV to RGB
+        cv::Mat rgbMat;
+        {
+            SubsystemScope scope(kSubsystemConversion);
+            cv::cvtColor(nv21, rgbMat, cv::COLOR_YUV2RGBA_NV21);
+        }
+        SubsystemScope scope(kSubsystemPipeline);
+        cv::cvtColor(rgbMat, gray, cv::COLOR_RGBA2GRAY);
+    } else {
+        // Every other combination never materializes color: the NV21 Y plane is the gray image
+        gray = nv21.rowRange(0, height);
+    }
+    if (quality.scaleDivisor > 1) {
+        SubsystemScope scope(kSubsystemPipeline);
+        cv::Mat full = gray;
+        cv::resize(full, gray, cv::Size(full.cols / quality.scaleDivisor, full.rows / quality.scaleDivisor),
+                   0, 0, cv::INTER_AREA);
+    }
+}
+
+void previewDetect(const cv::Mat &gray, PreviewMode mode, const PreviewQuality &quality,
+                   double cannyLow, double cannyHigh, cv::Mat &edges) {
+    if (mode != kPreviewEdges) return;
+    SubsystemScope scope(kSubsystemPipeline);
+    if (quality.gaussianKernel > 1) {
+        const int k = ensureOddKernel(quality.gaussianKernel);
+        cv::Mat blurred;
+        cv::GaussianBlur(gray, blurred, cv::Size(k, k), 0);
+        cv::Canny(blurred, edges, cannyLow, cannyHigh);
+    } else {
+        cv::Canny(gray, edges, cannyLow, cannyHigh);
+    }
+    // Same morphology as runEdgePipeline: a close, then one dilation per extra iteration
+    if (quality.morphIterations > 0) {
+        cv::Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3,3));
+        cv::morphologyEx(edges, edges, cv::MORPH_CLOSE, kernel);
+        for (int i = 1; i < quality.morphIterations; ++i) {
+            cv::dilate(edges, edges, kernel);
+        }
+    }
+}
+
+bool previewComposite(const cv::Mat &gray, const cv::Mat &edges, PreviewMode mode,
+                      OutputFormat format, cv::Mat &out) {
+    SubsystemScope scope(kSubsystemPipeline);
+    if (mode == kPreviewGray) {
+        // gray may be a view of the caller's Y plane, so gray output must not alias it
+        if (format == kOutputGray8) {
+            out = gray.clone();
+        } else {
+            grayToOutput(gray, out, format);
+        }
+    } else {
+        grayToOutput(edges, out, format);
+    }
+    return !out.empty();
+}
+
+bool processPreview(const cv::Mat &nv21, int width, int height, PreviewMode mode,
+                    OutputFormat format, cv::Mat &out, const PreviewQuality &quality) {
+    CV_Assert(nv21.cols == width);
+    cv::Mat gray;
+    previewToGray(nv21, height, mode, format, quality, gray);
+    cv::Mat edges;
+    previewDetect(gray, mode, quality, 50, 150, edges);
+    return previewComposite(gray, edges, mode, format, out);
+}
+
+namespace {
+
+void detectBranchEdges(const cv::Mat &blurred, const ViewBranch &branch, cv::Mat &edges) {
+    cv::Canny(blurred, edges, branch.cannyLow, branch.cannyHigh);
+    if (branch.morphIterations > 0) {
+        cv::Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3,3));
+        cv::morphologyEx(edges, edges, cv::MORPH_CLOSE, kernel);
+        for (int i = 1; i < branch.morphIterations; ++i) {
+            cv::dilate(edges, edges, kernel);
+        }
+    }
+}
+
+// gray may be a view of the caller's NV21 buffer and color is shared by every branch,
+// so gray output is cloned and overlays paint on a copy
+void runViewBranch(const cv::Mat &gray, const cv::Mat &blurred, const cv::Mat &color,
+                   const ViewBranch &branch, OutputFormat format, cv::Mat &out) {
+    const cv::Mat &base = format == kOutputGray8 ? gray : color;
+    cv::Mat edges;
+    switch (branch.kind) {
+        case kViewNormal:
+            out = format == kOutputGray8 ? gray.clone() : color;
+            break;
+        case kViewGray:
+            if (format == kOutputGray8) {
+                out = gray.clone();
+            } else {
+                grayToOutput(gray, out, format);
+            }
+            break;
+        case kViewEdges:
+            detectBranchEdges(blurred, branch, edges);
+            grayToOutput(edges, out, format);
+            break;
+        case kViewOverlay:
+            detectBranchEdges(blurred, branch, edges);
+            // White is all bytes 0xFF in gray, RGBA and RGB565 alike
+            out = base.clone();
+            out.setTo(cv::Scalar::all(255), edges);
+            break;
+    }
+}
+
+} // namespace
+
+bool processMultiView(const cv::Mat &nv21, int width, int height, int gaussianKernel, int scaleDivisor,
+                      const std::vector<ViewBranch> &branches, OutputFormat format, std::vector<cv::Mat> &outs) {
+    CV_Assert(nv21.cols == width);
+    if (branches.empty() || scaleDivisor < 1 ||
+        (format != kOutputRgba && format != kOutputRgb565 && format != kOutputGray8)) {
+        LOGE("processMultiView: unsupported request (%zu branches, 1/%d scale, format %d)",
+             branches.size(), scaleDivisor, format);
+        return false;
+    }
+    bool needsColor = false;
+    bool needsEdges = false;
+    for (size_t i = 0; i < branches.size(); ++i) {
+        const ViewKind kind = branches[i].kind;
+        if ((kind == kViewNormal || kind == kViewOverlay) && format != kOutputGray8) needsColor = true;
+        if (kind == kViewEdges || kind == kViewOverlay) needsEdges = true;
+    }
+
+    // Shared by every branch: luma, color, blur
+    cv::Mat gray = nv21.rowRange(0, height);
+    cv::Mat color;
+    try {
+        if (needsColor) {
+            SubsystemScope scope(kSubsystemConversion);
+            cv::Mat rgba;
+            cv::cvtColor(nv21, rgba, cv::COLOR_YUV2RGBA_NV21);
+            if (format == kOutputRgb565) {
+                cv::cvtColor(rgba, color, cv::COLOR_RGBA2BGR565);
+            } else {
+                color = rgba;
+            }
+        }
+        SubsystemScope scope(kSubsystemPipeline);
+        if (scaleDivisor > 1) {
+            const cv::Size size(width / scaleDivisor, height / scaleDivisor);
+            cv::Mat full = gray;
+            cv::resize(full, gray, size, 0, 0, cv::INTER_AREA);
+            if (!color.empty()) {
+                full = color;
+                // INTER_AREA has no 16-bit packed path; nearest keeps RGB565 words intact
+                cv::resize(full, color, size, 0, 0, format == kOutputRgb565 ? cv::INTER_NEAREST : cv::INTER_AREA);
+            }
+        }
+    } catch (const cv::Exception &e) {
+        LOGE("processMultiView: conversion failed: %s", e.what());
+        return false;
+    }
+    cv::Mat blurred = gray;
+    const int k = ensureOddKernel(gaussianKernel);
+    if (needsEdges && k > 1) {
+        SubsystemScope scope(kSubsystemPipeline);
+        cv::GaussianBlur(gray, blurred, cv::Size(k, k), 0);
+    }
+
+    // Fan out: each branch reads the shared Mats and writes only its own output
+    outs.assign(branches.size(), cv::Mat());
+    std::atomic<int> failures(0);
+    workPool().parallelFor(0, static_cast<int>(branches.size()), [&](int begin, int end) {
+        SubsystemScope scope(kSubsystemPipeline);
+        for (int i = begin; i < end; ++i) {
+            try {
+                runViewBranch(gray, blurred, color, branches[i], format, outs[i]);
+            } catch (const cv::Exception &e) {
+                LOGE("processMultiView: branch %d failed: %s", i, e.what());
+                failures.fetch_add(1);
+            }
+        }
+    }, 1);
+    for (size_t i = 0; i < outs.size(); ++i) {
+        if (outs[i].empty()) return false;
+    }
+    return failures.load() == 0;
+}
+
+bool composeGrid(const std::vector<cv::Mat> &views, cv::Mat &grid) {
+    if (views.empty()) return false;
+    const cv::Size tile = views[0].size();
+    const int type = views[0].type();
+    for (size_t i = 1; i < views.size(); ++i) {
+        if (views[i].size() != tile || views[i].type() != type) {
+            LOGE("composeGrid: view %zu does not match the first view", i);
+            return false;
+        }
+    }
+    const int count = static_cast<int>(views.size());
+    const int columns = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(count))));
+    const int rows = (count + columns - 1) / columns;
+    SubsystemScope scope(kSubsystemPipeline);
+    grid.create(rows * tile.height, columns * tile.width, type);
+    // Opaque black, also in RGBA
+    grid.setTo(type == CV_8UC4 ? cv::Scalar(0, 0, 0, 255) : cv::Scalar::all(0));
+    for (int i = 0; i < count; ++i) {
+        const cv::Rect cell((i % columns) * tile.width, (i / columns) * tile.height, tile.width, tile.height);
+        views[i].copyTo(grid(cell));
+    }
+    return true;
+}
+
+} // namespace ffddas
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "latency-scheduler.h"
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+namespace ffddas {
+
+// Pixel format of frames returned to Kotlin; values mirror NativeOpenCVHelper.OUTPUT_*
+enum OutputFormat {
+    kOutputMatchInput = -1, // pipeline only: same format as the input Mat
+    kOutputRgba = 0,        // CV_8UC4, Bitmap.Config.ARGB_8888
+    kOutputRgb565 = 1,      // CV_8UC2 holding 16-bit RGB565, Bitmap.Config.RGB_565
+    kOutputGray8 = 2,       // CV_8UC1, one luma / edge byte per pixel
+    kOutputPackedEdges = 3  // 1 bit per pixel, MSB first, rows padded to packedRowStride(width) bytes
+};
+
+// What the live preview path renders; values mirror NativeOpenCVHelper.PREVIEW_*
+enum PreviewMode {
+    kPreviewEdges = 0,  // Canny edges of the luma plane
+    kPreviewGray = 1    // the luma plane itself
+};
+
+// Parameters shared by every entry point that runs the blur -> Canny -> morphology pipeline
+struct PipelineParams {
+    int gaussianKernel;
+    double sigmaX;
+    double sigmaY;
+    double cannyLow;
+    double cannyHigh;
+    int morphIterations;
+    bool outputGray;
+    int outputFormat;   // OutputFormat; kOutputMatchInput keeps the input's format
+};
+
+// Helper: validate odd kernel size >=1
+int ensureOddKernel(int k);
+
+// Helper: luma of a gray, RGB565 (CV_8UC2), RGB or RGBA Mat; gray input is shared, not copied
+bool toGray(const cv::Mat &src, cv::Mat &gray);
+
+// Bytes per row of a kOutputPackedEdges frame
+int packedRowStride(int width);
+
+// Helper: pack a mask (non-zero = set) into 1 bit per pixel; out is CV_8UC1 of packedRowStride(cols) bytes per row
+void packBits(const cv::Mat &mask, cv::Mat &packed);
+
+// Helper: inverse of packBits, set bits become 255; width is the unpacked column count
+void unpackBits(const cv::Mat &packed, int width, cv::Mat &mask);
+
+// Helper: convert a single-channel (edge or gray) Mat to the requested output format.
+// kOutputGray8 shares the input; kOutputPackedEdges treats any non-zero pixel as an edge.
+void grayToOutput(const cv::Mat &gray, cv::Mat &out, OutputFormat format);
+
+// Core pipeline applying blur, canny, morphology (empty on failure).
+// Accepts RGBA (CV_8UC4) or RGB565 (CV_8UC2) input and by default returns the same format,
+// so a 565 frame never gets widened to 4 bytes per pixel. outputFormat can instead ask for
+// gray or packed edges; a packed frame has no room for the base image, so it always holds
+// just the edges regardless of outputGray.
+cv::Mat runEdgePipeline(const cv::Mat &src,
+                        int gaussianKernel,
+                        double sigmaX,
+                        double sigmaY,
+                        double cannyLow,
+                        double cannyHigh,
+                        int morphIterations,
+                        bool outputGray,
+                        int outputFormat = kOutputMatchInput);
+
+cv::Mat runEdgePipeline(const cv::Mat &src, const PipelineParams &params);
+
+// Helper: gather CameraX YUV_420_888 planes (any row / pixel stride) into one NV21 Mat
+// of (height + height/2) x width. Interleaved VU planes are copied row by row.
+void yuvPlanesToNv21(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                     int width, int height, int yRowStride, int uvRowStride, int uvPixelStride,
+                     cv::Mat &nv21);
+
+// Live preview stages. processPreview() runs them back to back; the async pipeline can
+// also run each one on its own thread. Only RGBA edge output goes through a color
+// conversion; everything else works on the Y plane (gray is then a view of nv21).
+// quality.scaleDivisor > 1 shrinks gray, so every later stage and the output are smaller.
+void previewToGray(const cv::Mat &nv21, int height, PreviewMode mode, OutputFormat format,
+                   const PreviewQuality &quality, cv::Mat &gray);
+void previewDetect(const cv::Mat &gray, PreviewMode mode, const PreviewQuality &quality,
+                   double cannyLow, double cannyHigh, cv::Mat &edges); // no-op for kPreviewGray
+bool previewComposite(const cv::Mat &gray, const cv::Mat &edges, PreviewMode mode,
+                      OutputFormat format, cv::Mat &out);
+
+// Live preview: NV21 frame -> edges or gray in the requested output format (false on failure)
+bool processPreview(const cv::Mat &nv21, int width, int height, PreviewMode mode,
+                    OutputFormat format, cv::Mat &out,
+                    const PreviewQuality &quality = kUnscheduledPreviewQuality);
+
+// One output of processMultiView(); values mirror NativeOpenCVHelper.VIEW_*
+enum ViewKind {
+    kViewNormal = 0,   // the camera image (luma in kOutputGray8)
+    kViewGray = 1,     // the luma plane
+    kViewEdges = 2,    // edges of the shared blurred luma
+    kViewOverlay = 3   // edges painted white over the camera image
+};
+
+struct ViewBranch {
+    ViewKind kind;
+    double cannyLow;      // edge and overlay branches only
+    double cannyHigh;
+    int morphIterations;  // same close + dilate scheme as runEdgePipeline
+};
+
+// Several views of one NV21 frame from one call. The shared work (luma, an optional
+// 1/scaleDivisor resize, one Gaussian blur, one color conversion if any branch shows
+// color) runs once; the branches then run in parallel on workPool(). outs[i] is branch i
+// in format (RGBA, RGB565 or gray; packed edges cannot hold color views). False on failure.
+bool processMultiView(const cv::Mat &nv21, int width, int height, int gaussianKernel, int scaleDivisor,
+                      const std::vector<ViewBranch> &branches, OutputFormat format, std::vector<cv::Mat> &outs);
+
+// Tiles equally sized views row-major into a grid of ceil(sqrt(n)) columns; spare cells are black
+bool composeGrid(const std::vector<cv::Mat> &views, cv::Mat &grid);
+
+} // namespace ffddas
@@ -0,0 +1,186 @@
+#include "fair-scheduler.h"
+#include "stage-pipeline.h" // monotonicNs()
+
+#include <algorithm>
+
+namespace ffddas {
+
+namespace {
+
+// Set while a thread is inside pump(). A pool without workers runs tasks inline, so a
+// finishing task would otherwise re-enter pump() once per queued task.
+thread_local bool tPumping = false;
+thread_local bool tPumpAgain = false;
+
+int clampWeight(int weight) {
+    return std::min<int>(std::max<int>(weight, FairScheduler::kMinWeight), FairScheduler::kMaxWeight);
+}
+
+} // namespace
+
+FairScheduler::FairScheduler(WorkStealingPool &pool)
+        : pool_(pool), nextId_(1), maxInFlight_(0), inFlight_(0), virtualNow_(0), dispatched_(0) {
+}
+
+int FairScheduler::addFlow(const std::string &name, int weight, size_t capacity) {
+    std::shared_ptr<Flow> flow(new Flow());
+    flow->name = name;
+    flow->weight = clampWeight(weight);
+    flow->capacity = std::max<size_t>(capacity, 1);
+    flow->running = false;
+    flow->dispatched = 0;
+    flow->dropped = 0;
+    flow->busyNs = 0;
+    std::lock_guard<std::mutex> lock(mutex_);
+    flow->id = nextId_++;
+    flow->virtualNs = virtualNow_;
+    flows_.push_back(flow);
+    return flow->id;
+}
+
+bool FairScheduler::removeFlow(int id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < flows_.size(); ++i) {
+        if (flows_[i]->id != id) continue;
+        flows_[i]->queue.clear();
+        flows_.erase(flows_.begin() + i);
+        return true;
+    }
+    return false;
+}
+
+bool FairScheduler::setWeight(int id, int weight) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_ptr<Flow> flow = findLocked(id);
+    if (!flow) return false;
+    flow->weight = clampWeight(weight);
+    return true;
+}
+
+bool FairScheduler::submit(int id, const Task &task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::shared_ptr<Flow> flow = findLocked(id);
+        if (!flow) return false;
+        if (flow->queue.empty() && !flow->running) {
+            // Waking from idle: no credit for the time it did not compete
+            flow->virtualNs = std::max(flow->virtualNs, virtualNow_);
+        }
+        if (flow->queue.size() >= flow->capacity) {
+            flow->queue.pop_front();
+            ++flow->dropped;
+        }
+        flow->queue.push_back(task);
+    }
+    pump();
+    return true;
+}
+
+void FairScheduler::setMaxInFlight(int n) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        maxInFlight_ = std::max(n, 0);
+    }
+    pump();
+}
+
+int FairScheduler::maxInFlightLocked() const {
+    if (maxInFlight_ > 0) return maxInFlight_;
+    return std::max(pool_.workerCount() - 1, 1);
+}
+
+std::shared_ptr<FairScheduler::Flow> FairScheduler::findLocked(int id) const {
+    for (size_t i = 0; i < flows_.size(); ++i) {
+        if (flows_[i]->id == id) return flows_[i];
+    }
+    return std::shared_ptr<Flow>();
+}
+
+void FairScheduler::pump() {
+    if (tPumping) {
+        tPumpAgain = true;
+        return;
+    }
+    tPumping = true;
+    for (;;) {
+        tPumpAgain = false;
+        std::shared_ptr<Flow> next;
+        Task task;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (inFlight_ < maxInFlightLocked()) {
+                for (size_t i = 0; i < flows_.size(); ++i) {
+                    const std::shared_ptr<Flow> &flow = flows_[i];
+                    if (flow->running || flow->queue.empty()) continue;
+                    if (!next || flow->virtualNs < next->virtualNs) next = flow;
+                }
+            }
+            if (next) {
+                task = next->queue.front();
+                next->queue.pop_front();
+                next->running = true;
+                ++next->dispatched;
+                ++dispatched_;
+                ++inFlight_;
+                virtualNow_ = std::max(virtualNow_, next->virtualNs);
+            }
+        }
+        if (next) {
+            // Outside the lock: with no workers the pool runs the task right here
+            std::shared_ptr<Flow> flow = next;
+            FairScheduler *self = this;
+            pool_.submit([self, flow, task] { self->run(flow, task); });
+            continue;
+        }
+        if (!tPumpAgain) break;
+    }
+    tPumping = false;
+}
+
+void FairScheduler::run(const std::shared_ptr<Flow> &flow, const Task &task) {
+    const int64_t begin = monotonicNs();
+    try {
+        task();
+    } catch (...) {
+        // Release the flow and its slot anyway, or the stream never runs again; the pool counts it
+        finish(flow, monotonicNs() - begin);
+        throw;
+    }
+    finish(flow, monotonicNs() - begin);
+}
+
+void FairScheduler::finish(const std::shared_ptr<Flow> &flow, int64_t costNs) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        flow->running = false;
+        flow->busyNs += costNs;
+        flow->virtualNs += costNs / flow->weight;
+        --inFlight_;
+    }
+    pump();
+}
+
+FairSchedulerStats FairScheduler::stats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    FairSchedulerStats s;
+    s.maxInFlight = maxInFlightLocked();
+    s.inFlight = inFlight_;
+    s.dispatched = dispatched_;
+    for (size_t i = 0; i < flows_.size(); ++i) {
+        const Flow &flow = *flows_[i];
+        FlowStats entry;
+        entry.name = flow.name;
+        entry.id = flow.id;
+        entry.weight = flow.weight;
+        entry.queued = static_cast<int64_t>(flow.queue.size());
+        entry.running = flow.running ? 1 : 0;
+        entry.dispatched = flow.dispatched;
+        entry.dropped = flow.dropped;
+        entry.busyNs = flow.busyNs;
+        entry.virtualNs = flow.virtualNs;
+        s.flows.push_back(entry);
+    }
+    return s;
+}
+
+} // namespace ffddas
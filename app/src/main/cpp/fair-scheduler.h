@@ -0,0 +1,106 @@
+#pragma once
+
+#include "work-pool.h"
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ffddas {
+
+struct FlowStats {
+    std::string name;
+    int64_t id;
+    int64_t weight;
+    int64_t queued;      // tasks waiting for their turn
+    int64_t running;     // 1 while one of its tasks is on the pool
+    int64_t dispatched;
+    int64_t dropped;     // evicted from the flow's queue by newer tasks
+    int64_t busyNs;      // pool time consumed by its tasks
+    int64_t virtualNs;   // busyNs / weight, plus catch-up when it woke from idle
+};
+
+struct FairSchedulerStats {
+    int64_t maxInFlight;
+    int64_t inFlight;
+    int64_t dispatched;
+    std::vector<FlowStats> flows;
+};
+
+/**
+ * Weighted fair queueing of independent task flows onto a WorkStealingPool.
+ *
+ * Each flow (one per pipeline stream) owns a bounded latest-wins queue and runs
+ * at most one task at a time, so its frames finish in order and its context
+ * needs no locking. Whenever a pool slot is free the flow with the smallest
+ * virtual time goes next; a finished task advances its flow's virtual time by
+ * its measured cost divided by the flow's weight. Busy flows therefore share
+ * the pool in proportion to their weights whatever their per-task cost, and a
+ * flow that was idle rejoins at the current virtual time instead of cashing in
+ * the time it missed.
+ *
+ * At most maxInFlight tasks are handed to the pool at once (default: workers
+ * minus one), so the remaining worker stays free to help parallelFor() calls
+ * from the live preview, which keeps its own stage threads.
+ */
+class FairScheduler {
+public:
+    typedef std::function<void()> Task;
+
+    enum { kMinWeight = 1, kMaxWeight = 1000 };
+
+    explicit FairScheduler(WorkStealingPool &pool);
+
+    // Returns the flow id (> 0); weight is clamped to [kMinWeight, kMaxWeight]
+    int addFlow(const std::string &name, int weight, size_t capacity);
+    // Drops queued tasks; a task that is already running still finishes
+    bool removeFlow(int id);
+    bool setWeight(int id, int weight);
+
+    // Queues task behind the flow's earlier ones; a full queue evicts its oldest task.
+    // Returns false for an unknown flow.
+    bool submit(int id, const Task &task);
+
+    // n <= 0 restores the default (pool workers - 1, at least 1)
+    void setMaxInFlight(int n);
+
+    FairSchedulerStats stats();
+
+private:
+    FairScheduler(const FairScheduler &);
+    FairScheduler &operator=(const FairScheduler &);
+
+    struct Flow {
+        std::string name;
+        int id;
+        int weight;
+        size_t capacity;
+        std::deque<Task> queue;
+        bool running;
+        int64_t virtualNs;
+        int64_t dispatched;
+        int64_t dropped;
+        int64_t busyNs;
+    };
+
+    int maxInFlightLocked() const;
+    std::shared_ptr<Flow> findLocked(int id) const;
+    void pump();
+    void run(const std::shared_ptr<Flow> &flow, const Task &task);
+    void finish(const std::shared_ptr<Flow> &flow, int64_t costNs); // frees the flow, pumps the next
+
+    WorkStealingPool &pool_;
+    std::mutex mutex_;
+    std::vector<std::shared_ptr<Flow> > flows_;
+    int nextId_;
+    int maxInFlight_;     // 0 = default
+    int inFlight_;
+    int64_t virtualNow_;  // virtual time of the last flow dispatched
+    int64_t dispatched_;
+};
+
+} // namespace ffddas
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ffddas {
+
+// Values mirror FrameBus.DROP_* in Kotlin
+enum DropPolicy {
+    kDropOldest = 0,  // latest-frame-wins: a full queue evicts its oldest frame (display, HTTP)
+    kDropNewest = 1   // keep what is queued and refuse new frames until there is room (recorder)
+};
+
+struct SubscriberStats {
+    std::string name;
+    int64_t id;
+    int64_t channel;    // stream whose frames it receives
+    int64_t capacity;
+    int64_t policy;     // DropPolicy
+    int64_t queued;     // frames waiting to be taken
+    int64_t delivered;  // frames handed out by next()
+    int64_t dropped;    // frames this subscriber lost to its drop policy
+};
+
+struct FrameBusStats {
+    int64_t published;
+    int64_t fanOut;       // subscriber deliveries queued, summed over every publish
+    int64_t unclaimed;    // published while nobody was subscribed to the frame's channel
+    std::vector<SubscriberStats> subscribers;
+};
+
+/**
+ * Publish-once fan-out of immutable frames. A frame is handed out as a
+ * shared_ptr<const Frame>, so every subscriber reads the same pixels and the
+ * last one to drop its reference returns them to the pool; nothing is copied
+ * per consumer.
+ *
+ * Each subscriber has its own bounded queue and DropPolicy, so a slow consumer
+ * (HTTP clients, a recorder) only ever loses its own frames and never holds up
+ * the publisher or the display. publish() takes one short lock per subscriber
+ * and never blocks on a consumer. Frames are published on a channel (one per
+ * pipeline stream) and only reach subscribers of that channel. Free of OpenCV
+ * like StagePipeline.
+ */
+template <typename Frame>
+class FrameBus {
+public:
+    typedef std::shared_ptr<const Frame> FramePtr;
+
+    FrameBus() : nextId_(1), published_(0), fanOut_(0), unclaimed_(0) {}
+
+    // Returns the subscription id (> 0) used by next(), interrupt() and unsubscribe()
+    int subscribe(const std::string &name, size_t capacity, DropPolicy policy, int channel = 0) {
+        std::shared_ptr<Subscriber> subscriber(new Subscriber());
+        subscriber->name = name;
+        subscriber->channel = channel;
+        subscriber->capacity = std::max<size_t>(capacity, 1);
+        subscriber->policy = policy;
+        std::lock_guard<std::mutex> lock(busMutex_);
+        subscriber->id = nextId_++;
+        subscribers_.push_back(subscriber);
+        return subscriber->id;
+    }
+
+    // Drops the subscriber's queued frames and wakes a next() blocked on it
+    bool unsubscribe(int id) {
+        std::shared_ptr<Subscriber> subscriber;
+        {
+            std::lock_guard<std::mutex> lock(busMutex_);
+            for (size_t i = 0; i < subscribers_.size(); ++i) {
+                if (subscribers_[i]->id != id) continue;
+                subscriber = subscribers_[i];
+                subscribers_.erase(subscribers_.begin() + i);
+                break;
+            }
+        }
+        if (!subscriber) return false;
+        {
+            std::lock_guard<std::mutex> lock(subscriber->mutex);
+            subscriber->closed = true;
+            subscriber->queue.clear();
+        }
+        subscriber->ready.notify_all();
+        return true;
+    }
+
+    // Returns how many subscribers queued the frame
+    size_t publish(const FramePtr &frame, int channel = 0) {
+        if (!frame) return 0;
+        size_t accepted = 0;
+        bool claimed = false;
+        std::lock_guard<std::mutex> lock(busMutex_);
+        ++published_;
+        for (size_t i = 0; i < subscribers_.size(); ++i) {
+            Subscriber &subscriber = *subscribers_[i];
+            if (subscriber.channel != channel) continue;
+            claimed = true;
+            {
+                std::lock_guard<std::mutex> subscriberLock(subscriber.mutex);
+                if (subscriber.queue.size() >= subscriber.capacity) {
+                    ++subscriber.dropped;
+                    if (subscriber.policy == kDropNewest) continue;
+                    subscriber.queue.pop_front();
+                }
+                subscriber.queue.push_back(frame);
+            }
+            subscriber.ready.notify_one();
+            ++accepted;
+        }
+        if (!claimed) ++unclaimed_;
+        fanOut_ += static_cast<int64_t>(accepted);
+        return accepted;
+    }
+
+    // Takes the subscriber's oldest queued frame, waiting up to timeoutMs (0 = poll).
+    // Returns false on timeout, interrupt() or unsubscribe().
+    bool next(int id, int timeoutMs, FramePtr &out) {
+        std::shared_ptr<Subscriber> subscriber = find(id);
+        if (!subscriber) return false;
+        std::unique_lock<std::mutex> lock(subscriber->mutex);
+        const uint64_t wakeups = subscriber->wakeups;
+        if (timeoutMs > 0) {
+            subscriber->ready.wait_for(lock, std::chrono::milliseconds(timeoutMs), [&] {
+                return !subscriber->queue.empty() || subscriber->closed || subscriber->wakeups != wakeups;
+            });
+        }
+        if (subscriber->queue.empty() || subscriber->closed) return false;
+        out = subscriber->queue.front();
+        subscriber->queue.pop_front();
+        ++subscriber->delivered;
+        return true;
+    }
+
+    // Wakes a next() blocked on id without a frame (used on pipeline stop)
+    void interrupt(int id) {
+        std::shared_ptr<Subscriber> subscriber = find(id);
+        if (!subscriber) return;
+        {
+            std::lock_guard<std::mutex> lock(subscriber->mutex);
+            ++subscriber->wakeups;
+        }
+        subscriber->ready.notify_all();
+    }
+
+    // Releases queued frames without delivering them
+    void clear(int id) {
+        std::shared_ptr<Subscriber> subscriber = find(id);
+        if (!subscriber) return;
+        std::lock_guard<std::mutex> lock(subscriber->mutex);
+        subscriber->queue.clear();
+    }
+
+    int64_t dropped(int id) {
+        std::shared_ptr<Subscriber> subscriber = find(id);
+        if (!subscriber) return 0;
+        std::lock_guard<std::mutex> lock(subscriber->mutex);
+        return subscriber->dropped;
+    }
+
+    FrameBusStats stats() {
+        std::lock_guard<std::mutex> lock(busMutex_);
+        FrameBusStats s;
+        s.published = published_;
+        s.fanOut = fanOut_;
+        s.unclaimed = unclaimed_;
+        for (size_t i = 0; i < subscribers_.size(); ++i) {
+            Subscriber &subscriber = *subscribers_[i];
+            std::lock_guard<std::mutex> subscriberLock(subscriber.mutex);
+            SubscriberStats entry;
+            entry.name = subscriber.name;
+            entry.id = subscriber.id;
+            entry.channel = subscriber.channel;
+            entry.capacity = static_cast<int64_t>(subscriber.capacity);
+            entry.policy = subscriber.policy;
+            entry.queued = static_cast<int64_t>(subscriber.queue.size());
+            entry.delivered = subscriber.delivered;
+            entry.dropped = subscriber.dropped;
+            s.subscribers.push_back(entry);
+        }
+        return s;
+    }
+
+private:
+    FrameBus(const FrameBus &);
+    FrameBus &operator=(const FrameBus &);
+
+    struct Subscriber {
+        Subscriber() : id(0), channel(0), capacity(1), policy(kDropOldest), closed(false),
+                       wakeups(0), delivered(0), dropped(0) {}
+        std::string name;
+        int id;
+        int channel;
+        size_t capacity;
+        DropPolicy policy;
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::deque<FramePtr> queue;
+        bool closed;
+        uint64_t wakeups;
+        int64_t delivered;
+        int64_t dropped;
+    };
+
+    std::shared_ptr<Subscriber> find(int id) {
+        std::lock_guard<std::mutex> lock(busMutex_);
+        for (size_t i = 0; i < subscribers_.size(); ++i) {
+            if (subscribers_[i]->id == id) return subscribers_[i];
+        }
+        return std::shared_ptr<Subscriber>();
+    }
+
+    // Lock order: busMutex_ before any Subscriber::mutex
+    std::mutex busMutex_;
+    std::vector<std::shared_ptr<Subscriber> > subscribers_;
+    int nextId_;
+    int64_t published_;
+    int64_t fanOut_;
+    int64_t unclaimed_;
+};
+
+} // namespace ffddas
@@ -0,0 +1,221 @@
+#pragma once
+
+#include "frame-bus.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ffddas {
+
+struct CallbackStats {
+    std::string name;
+    int64_t id;             // the dispatcher's frame bus subscription
+    int64_t channel;
+    int64_t maxInFlight;
+    int64_t inFlight;       // delivered frames the listener has not completed yet
+    int64_t delivered;
+    int64_t coalesced;      // frames replaced by a newer one before the listener was free (0 once stopped)
+    int64_t failed;         // deliveries the listener rejected
+    int64_t lastLatencyNs;  // frame published -> listener invoked
+    int64_t avgLatencyNs;   // exponentially weighted, 1/8 per frame
+    int64_t maxLatencyNs;
+    int64_t avgCallbackNs;  // time spent inside the listener call
+    int64_t avgHoldNs;      // listener invoked -> frame completed
+};
+
+/**
+ * Pushes the frames of one frame bus channel to a listener from a dedicated
+ * thread, so consumers never poll. The thread runs onThreadStart once before
+ * the first delivery (JNI attaches to the VM there) and onThreadExit after the
+ * last one.
+ *
+ * Each delivered frame gets a ticket that the listener hands back to
+ * complete() when it is done with the frame, possibly much later and from
+ * another thread. While maxInFlight frames are outstanding the dispatcher does
+ * not deliver; its subscription keeps only the newest frame, so everything
+ * published meanwhile is coalesced into that one instead of queueing up behind
+ * a slow listener, and the publisher never waits for it.
+ *
+ * Frame needs an int64_t publishedNs() on the steady clock for the latency
+ * figures. Free of OpenCV like FrameBus.
+ */
+template <typename Frame>
+class FrameCallbackDispatcher : public std::enable_shared_from_this<FrameCallbackDispatcher<Frame> > {
+public:
+    typedef typename FrameBus<Frame>::FramePtr FramePtr;
+    // Returns false if the listener did not take the frame; the ticket is then completed right away
+    typedef std::function<bool(const FramePtr &frame, uint64_t ticket)> Deliver;
+    typedef std::function<void()> ThreadHook;
+
+    FrameCallbackDispatcher(FrameBus<Frame> &bus, const std::string &name, int channel, int maxInFlight)
+            : bus_(bus), name_(name), channel_(channel), maxInFlight_(std::max(maxInFlight, 1)),
+              subscription_(0), running_(false), nextTicket_(1), delivered_(0), failed_(0),
+              lastLatencyNs_(0), avgLatencyNs_(0), maxLatencyNs_(0), avgCallbackNs_(0), avgHoldNs_(0) {}
+
+    // Subscribes and starts the delivery thread; the dispatcher must be owned by a shared_ptr.
+    // Returns the subscription id, or -1 if already started.
+    int start(const Deliver &deliver, const ThreadHook &onThreadStart, const ThreadHook &onThreadExit) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (running_ || subscription_ > 0) return -1;
+        deliver_ = deliver;
+        onThreadStart_ = onThreadStart;
+        onThreadExit_ = onThreadExit;
+        subscription_ = bus_.subscribe(name_, 1, kDropOldest, channel_);
+        running_ = true;
+        // The thread keeps the dispatcher alive until it has run onThreadExit
+        thread_ = std::thread(&FrameCallbackDispatcher::run, this->shared_from_this());
+        return subscription_;
+    }
+
+    // Stops delivering, unsubscribes and waits for the thread. Frames still held by the
+    // listener stay valid and may be completed later. Safe to call from inside the listener.
+    void stop() {
+        std::thread thread;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!running_) return;
+            running_ = false;
+            thread.swap(thread_);
+        }
+        slotFree_.notify_all();
+        // Also wakes the thread if it is waiting for a frame
+        bus_.unsubscribe(subscription_);
+        if (thread.get_id() == std::this_thread::get_id()) {
+            thread.detach();
+        } else if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    // The listener is done with the frame delivered under ticket; unknown tickets are ignored
+    bool complete(uint64_t ticket) {
+        const int64_t now = steadyNs();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            size_t i = 0;
+            while (i < inFlight_.size() && inFlight_[i].first != ticket) ++i;
+            if (i == inFlight_.size()) return false;
+            updateAverage(avgHoldNs_, now - inFlight_[i].second);
+            inFlight_.erase(inFlight_.begin() + i);
+        }
+        slotFree_.notify_one();
+        return true;
+    }
+
+    int subscription() const { return subscription_; }
+    const std::string &name() const { return name_; }
+
+    CallbackStats stats() {
+        CallbackStats s;
+        s.coalesced = subscription_ > 0 ? bus_.dropped(subscription_) : 0;
+        std::lock_guard<std::mutex> lock(mutex_);
+        s.name = name_;
+        s.id = subscription_;
+        s.channel = channel_;
+        s.maxInFlight = maxInFlight_;
+        s.inFlight = static_cast<int64_t>(inFlight_.size());
+        s.delivered = delivered_;
+        s.failed = failed_;
+        s.lastLatencyNs = lastLatencyNs_;
+        s.avgLatencyNs = avgLatencyNs_;
+        s.maxLatencyNs = maxLatencyNs_;
+        s.avgCallbackNs = avgCallbackNs_;
+        s.avgHoldNs = avgHoldNs_;
+        return s;
+    }
+
+private:
+    FrameCallbackDispatcher(const FrameCallbackDispatcher &);
+    FrameCallbackDispatcher &operator=(const FrameCallbackDispatcher &);
+
+    static const int kWaitMs = 100;
+
+    static int64_t steadyNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static void updateAverage(int64_t &average, int64_t sample) {
+        average = average == 0 ? sample : average + (sample - average) / 8;
+    }
+
+    // Holds a reference to the dispatcher for as long as the thread runs
+    static void run(std::shared_ptr<FrameCallbackDispatcher> self) {
+        if (self->onThreadStart_) self->onThreadStart_();
+        self->loop();
+        if (self->onThreadExit_) self->onThreadExit_();
+    }
+
+    void loop() {
+        while (true) {
+            {
+                // Take nothing off the bus until the listener has a free slot: the subscription
+                // meanwhile keeps replacing its single queued frame with the newest one
+                std::unique_lock<std::mutex> lock(mutex_);
+                slotFree_.wait(lock, [this] {
+                    return !running_ || static_cast<int>(inFlight_.size()) < maxInFlight_;
+                });
+                if (!running_) return;
+            }
+            FramePtr frame;
+            if (!bus_.next(subscription_, kWaitMs, frame)) continue;
+
+            uint64_t ticket;
+            const int64_t invokedNs = steadyNs();
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!running_) return;
+                ticket = nextTicket_++;
+                inFlight_.push_back(std::make_pair(ticket, invokedNs));
+                const int64_t latency = std::max<int64_t>(invokedNs - frame->publishedNs(), 0);
+                lastLatencyNs_ = latency;
+                updateAverage(avgLatencyNs_, latency);
+                maxLatencyNs_ = std::max(maxLatencyNs_, latency);
+                ++delivered_;
+            }
+            const bool taken = deliver_(frame, ticket);
+            frame.reset();
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                updateAverage(avgCallbackNs_, steadyNs() - invokedNs);
+                if (!taken) ++failed_;
+            }
+            if (!taken) complete(ticket);
+        }
+    }
+
+    FrameBus<Frame> &bus_;
+    const std::string name_;
+    const int channel_;
+    const int maxInFlight_;
+    int subscription_;        // set once by start()
+
+    Deliver deliver_;
+    ThreadHook onThreadStart_;
+    ThreadHook onThreadExit_;
+    std::thread thread_;
+
+    std::mutex mutex_;
+    std::condition_variable slotFree_;
+    bool running_;
+    uint64_t nextTicket_;
+    std::vector<std::pair<uint64_t, int64_t> > inFlight_;  // ticket, invoked at
+    int64_t delivered_;
+    int64_t failed_;
+    int64_t lastLatencyNs_;
+    int64_t avgLatencyNs_;
+    int64_t maxLatencyNs_;
+    int64_t avgCallbackNs_;
+    int64_t avgHoldNs_;
+};
+
+} // namespace ffddas
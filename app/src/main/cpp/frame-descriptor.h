@@ -0,0 +1,74 @@
+#pragma once
+
+#include "stage-pipeline.h"
+
+#include <cstdint>
+#include <time.h>
+
+namespace ffddas {
+
+// Points on a frame's way through the native pipeline; values mirror FrameTiming.STAMP_* in Kotlin
+enum FrameStamp {
+    kStampIngest = 0,   // submitted by the camera thread
+    kStampStarted,      // first stage picked it up
+    kStampConverted,    // stage boundaries
+    kStampDetected,
+    kStampComposited,
+    kStampPublished,    // handed to the frame bus
+    kStampCount
+};
+
+/**
+ * Identity and timing of one camera frame, carried unchanged from ingest to
+ * every output so latency can be measured end to end. All stamps are on the
+ * steady clock (CLOCK_MONOTONIC, System.nanoTime() in Kotlin); a stamp of 0
+ * means the frame never reached that point (or the path has no such stage).
+ */
+struct FrameDescriptor {
+    int64_t sequence;
+    int64_t sensorTimestampNs;  // ImageProxy timestamp, passed through untouched
+    int64_t sensorMonotonicNs;  // the same instant on the steady clock, 0 if its clock is unknown
+    uint64_t configVersion;     // PipelineConfig the frame was processed with
+    int64_t stampNs[kStampCount];
+
+    void stamp(FrameStamp point) { stampNs[point] = monotonicNs(); }
+
+    // Time between two stamps, 0 unless both were taken
+    int64_t between(FrameStamp from, FrameStamp to) const {
+        return stampNs[from] != 0 && stampNs[to] != 0 ? stampNs[to] - stampNs[from] : 0;
+    }
+};
+
+/**
+ * Maps a camera sensor timestamp onto the steady clock. Camera HALs stamp
+ * frames with either CLOCK_BOOTTIME (timestamp source REALTIME) or
+ * CLOCK_MONOTONIC (source UNKNOWN); the clock for which the frame is a few
+ * moments old is the one it was taken on. Returns 0 if neither fits, e.g. for
+ * synthetic timestamps.
+ */
+inline int64_t sensorToMonotonicNs(int64_t sensorTimestampNs) {
+    static const int64_t kMaxAgeNs = 5000000000LL;
+    if (sensorTimestampNs <= 0) return 0;
+    const int64_t now = monotonicNs();
+    int64_t age = now - sensorTimestampNs;
+    if (age >= 0 && age < kMaxAgeNs) return sensorTimestampNs;
+#ifdef CLOCK_BOOTTIME
+    timespec boot;
+    if (clock_gettime(CLOCK_BOOTTIME, &boot) == 0) {
+        age = static_cast<int64_t>(boot.tv_sec) * 1000000000LL + boot.tv_nsec - sensorTimestampNs;
+        if (age >= 0 && age < kMaxAgeNs) return now - age;
+    }
+#endif
+    return 0;
+}
+
+// Descriptor of a frame entering the pipeline now; the pipeline assigns the sequence number
+inline FrameDescriptor ingestFrame(int64_t sensorTimestampNs) {
+    FrameDescriptor descriptor = FrameDescriptor();
+    descriptor.sensorTimestampNs = sensorTimestampNs;
+    descriptor.sensorMonotonicNs = sensorToMonotonicNs(sensorTimestampNs);
+    descriptor.stamp(kStampIngest);
+    return descriptor;
+}
+
+} // namespace ffddas
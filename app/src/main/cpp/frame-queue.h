@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+
+namespace ffddas {
+
+/**
+ * Bounded lock-free single-producer / single-consumer queue where the newest
+ * frame always wins: pushing into a full queue evicts the oldest queued item
+ * instead of blocking the producer (the camera thread).
+ *
+ * Cells carry a sequence number (Vyukov bounded queue) so the producer can
+ * safely act as a second dequeuer when it evicts; this is the only reason the
+ * read side uses a CAS. Capacity is rounded up to a power of two.
+ */
+template <typename T>
+class LatestFrameQueue {
+public:
+    explicit LatestFrameQueue(size_t capacity) : head_(0), tail_(0), dropped_(0) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        mask_ = size - 1;
+        cells_.reset(new Cell[size]);
+        for (size_t i = 0; i < size; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+    // Producer only. Returns true if an older item had to be dropped to make room.
+    bool push(T item) {
+        bool evicted = false;
+        while (!tryPush(item)) {
+            T oldest;
+            if (size() < capacity()) {
+                // Not full: the consumer has claimed the tail cell and is about to release it
+                std::this_thread::yield();
+            } else if (tryPop(oldest)) {
+                evicted = true;
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        return evicted;
+    }
+
+    // Consumer (or the producer evicting). Returns false if the queue is empty.
+    bool tryPop(T &out) {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = cells_[pos & mask_];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    out = std::move(cell.value);
+                    cell.value = T();
+                    cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Approximate number of queued items
+    size_t size() const {
+        size_t tail = tail_.load(std::memory_order_acquire);
+        size_t head = head_.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+
+        Cell() : sequence(0), value() {}
+    };
+
+    bool tryPush(T &item) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        Cell &cell = cells_[pos & mask_];
+        size_t seq = cell.sequence.load(std::memory_order_acquire);
+        if (seq != pos) return false; // full, or the cell is still being read
+        cell.value = std::move(item);
+        cell.sequence.store(pos + 1, std::memory_order_release);
+        tail_.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    LatestFrameQueue(const LatestFrameQueue &);
+    LatestFrameQueue &operator=(const LatestFrameQueue &);
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_;
+    // Producer and consumer indices on separate cache lines (padding rather than
+    // alignas, which C++11 operator new does not honour)
+    char padHead_[64];
+    std::atomic<size_t> head_;
+    char padTail_[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> tail_;
+    char padEnd_[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<uint64_t> dropped_;
+};
+
+} // namespace ffddas
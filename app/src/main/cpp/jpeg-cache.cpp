@@ -0,0 +1,215 @@
+#define LOG_TAG "JpegCache"
+
+#include "jpeg-cache.h"
+#include "edge-pipeline.h"
+#include "native-log.h"
+#include "native-stats.h"
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include <algorithm>
+
+namespace ffddas {
+
+const int kJpegScaleDivisors[kJpegRenditions] = {1, 2, 4};
+
+namespace {
+
+// Returned buffers kept per rendition: one being served while the next frame is encoded, plus slack
+const size_t kMaxSpareBuffers = 2;
+
+void updateAverage(int64_t &average, int64_t sample) {
+    average = average == 0 ? sample : average + (sample - average) / 8;
+}
+
+} // namespace
+
+JpegCache::JpegCache() : stats_() {}
+
+int JpegCache::renditionFor(int scaleDivisor) {
+    int rendition = 0;
+    while (rendition + 1 < kJpegRenditions && kJpegScaleDivisors[rendition + 1] <= scaleDivisor) ++rendition;
+    return rendition;
+}
+
+bool JpegCache::matches(const EncodedJpeg &jpeg, const FrameResult &frame, int quality) {
+    return jpeg.sequence == frame.descriptor.sequence && jpeg.publishedNs == frame.publishedNs() &&
+           jpeg.quality == quality;
+}
+
+void JpegCache::dropIdle(int64_t nowNs, std::vector<JpegPtr> &dropped) {
+    for (int i = 0; i < kJpegRenditions; ++i) {
+        Rendition &rendition = renditions_[i];
+        if (!rendition.latest || nowNs - rendition.lastRequestNs < kJpegRenditionIdleNs) continue;
+        dropped.push_back(JpegPtr());
+        dropped.back().swap(rendition.latest);
+        std::vector<std::vector<uchar> >().swap(rendition.spare);
+    }
+}
+
+JpegCache::JpegPtr JpegCache::get(const FrameResult &frame, int quality, bool *encodedNow, int scaleDivisor) {
+    if (encodedNow) *encodedNow = false;
+    quality = std::min(std::max(quality, 1), 100);
+    const int index = renditionFor(scaleDivisor);
+    // Released outside mutex_, since their deleters take it
+    std::vector<JpegPtr> dropped;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++stats_.requests;
+        const int64_t now = monotonicNs();
+        renditions_[index].lastRequestNs = now;
+        dropIdle(now, dropped);
+        const JpegPtr &latest = renditions_[index].latest;
+        if (latest && matches(*latest, frame, quality)) return latest;
+    }
+
+    // Only requests for the same size wait here; other renditions encode in parallel
+    Rendition &slot = renditions_[index];
+    std::lock_guard<std::mutex> encodeLock(slot.encodeMutex);
+    std::vector<uchar> bytes;
+    {
+        // Another request may have encoded it while we waited
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (slot.latest && matches(*slot.latest, frame, quality)) return slot.latest;
+        if (!slot.spare.empty()) {
+            bytes.swap(slot.spare.back());
+            slot.spare.pop_back();
+            ++stats_.recycled;
+        }
+    }
+
+    const int divisor = kJpegScaleDivisors[index];
+    const int64_t start = monotonicNs();
+    if (!encode(frame, quality, divisor, slot, bytes)) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++stats_.failed;
+        return JpegPtr();
+    }
+    const int64_t elapsed = monotonicNs() - start;
+
+    EncodedJpeg *jpeg = new EncodedJpeg();
+    jpeg->sequence = frame.descriptor.sequence;
+    jpeg->publishedNs = frame.publishedNs();
+    jpeg->scaleDivisor = divisor;
+    jpeg->width = divisor == 1 ? frame.width : slot.scaled.cols;
+    jpeg->height = divisor == 1 ? frame.height : slot.scaled.rows;
+    jpeg->quality = quality;
+    jpeg->encodeNs = elapsed;
+    jpeg->bytes.swap(bytes);
+    Recycler recycler = {this, index};
+    JpegPtr encoded(jpeg, recycler);
+
+    JpegPtr replaced;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // A late request for an older frame is served but must not evict a newer frame's encode
+        if (!slot.latest || frame.descriptor.sequence >= slot.latest->sequence) {
+            replaced.swap(slot.latest);
+            slot.latest = encoded;
+        }
+        ++stats_.encoded;
+        if (divisor > 1) ++stats_.scaledEncoded;
+        stats_.lastBytes = static_cast<int64_t>(encoded->bytes.size());
+        updateAverage(stats_.avgBytes, stats_.lastBytes);
+        stats_.lastEncodeNs = elapsed;
+        updateAverage(stats_.avgEncodeNs, elapsed);
+        stats_.maxEncodeNs = std::max(stats_.maxEncodeNs, elapsed);
+    }
+    // replaced goes out of scope here, outside mutex_, since its deleter takes it
+    if (encodedNow) *encodedNow = true;
+    return encoded;
+}
+
+bool JpegCache::encode(const FrameResult &frame, int quality, int scaleDivisor, Rendition &rendition,
+                       std::vector<uchar> &bytes) {
+    SubsystemScope scope(kSubsystemConversion);
+    cv::Mat image;
+    if (!jpegSource(frame, rendition.scratch, image)) return false;
+    if (scaleDivisor > 1) {
+        const cv::Size size(std::max(1, frame.width / scaleDivisor), std::max(1, frame.height / scaleDivisor));
+        try {
+            cv::resize(image, rendition.scaled, size, 0, 0, cv::INTER_AREA);
+        } catch (const cv::Exception &e) {
+            LOGE("Scaling frame %lld by 1/%d failed: %s", static_cast<long long>(frame.descriptor.sequence),
+                 scaleDivisor, e.what());
+            return false;
+        }
+        image = rendition.scaled;
+    }
+    if (!encodeJpeg(image, quality, bytes)) {
+        LOGE("Encoding %dx%d frame %lld failed", frame.width, frame.height,
+             static_cast<long long>(frame.descriptor.sequence));
+        return false;
+    }
+    return true;
+}
+
+void JpegCache::recycle(int rendition, EncodedJpeg *jpeg) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // A rendition dropped as idle keeps no spares either
+        std::vector<std::vector<uchar> > &spare = renditions_[rendition].spare;
+        if (renditions_[rendition].latest && spare.size() < kMaxSpareBuffers) {
+            spare.push_back(std::vector<uchar>());
+            spare.back().swap(jpeg->bytes);
+        }
+    }
+    delete jpeg;
+}
+
+JpegCache::JpegPtr JpegCache::latest() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return renditions_[0].latest;
+}
+
+JpegCacheStats JpegCache::stats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    JpegCacheStats stats = stats_;
+    const int64_t now = monotonicNs();
+    for (int i = 0; i < kJpegRenditions; ++i) {
+        const int64_t requested = renditions_[i].lastRequestNs;
+        if (requested != 0 && now - requested < kJpegRenditionIdleNs) ++stats.activeRenditions;
+    }
+    return stats;
+}
+
+bool jpegSource(const FrameResult &frame, cv::Mat &scratch, cv::Mat &image) {
+    if (frame.pixels.empty()) return false;
+    try {
+        switch (frame.format) {
+            case kOutputRgba: cv::cvtColor(frame.pixels, scratch, cv::COLOR_RGBA2BGR); break;
+            case kOutputRgb565: cv::cvtColor(frame.pixels, scratch, cv::COLOR_BGR5652BGR); break; // Android RGB_565 layout
+            case kOutputGray8: image = frame.pixels; return true;
+            case kOutputPackedEdges: unpackBits(frame.pixels, frame.width, scratch); break;
+            default:
+                LOGE("Unsupported frame format %d", static_cast<int>(frame.format));
+                return false;
+        }
+    } catch (const cv::Exception &e) {
+        LOGE("Converting frame %lld failed: %s", static_cast<long long>(frame.descriptor.sequence), e.what());
+        return false;
+    }
+    image = scratch;
+    return true;
+}
+
+bool encodeJpeg(const cv::Mat &image, int quality, std::vector<uchar> &bytes) {
+    std::vector<int> params;
+    params.push_back(cv::IMWRITE_JPEG_QUALITY);
+    params.push_back(quality);
+    try {
+        return cv::imencode(".jpg", image, bytes, params);
+    } catch (const cv::Exception &e) {
+        LOGE("imencode failed: %s", e.what());
+        return false;
+    }
+}
+
+JpegCache &jpegCache() {
+    // Intentionally leaked like frameBus(): JPEG leases may be released during static destruction
+    static JpegCache *cache = new JpegCache();
+    return *cache;
+}
+
+} // namespace ffddas
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "async-pipeline.h"
+
+#include <opencv2/core.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ffddas {
+
+// Sizes the cache keeps an encode of: full, 1/2 and 1/4 of the frame's width and height
+const int kJpegRenditions = 3;
+extern const int kJpegScaleDivisors[kJpegRenditions];
+
+// A rendition nobody requested for this long drops its JPEG and spare buffers
+const int64_t kJpegRenditionIdleNs = 5000000000LL;
+
+// One published frame as JPEG; immutable once handed out
+struct EncodedJpeg {
+    int64_t sequence;       // with publishedNs, identifies the frame it was encoded from
+    int64_t publishedNs;
+    int scaleDivisor;       // 1, 2 or 4; width and height are already divided
+    int width;
+    int height;
+    int quality;
+    int64_t encodeNs;
+    std::vector<uchar> bytes;
+};
+
+struct JpegCacheStats {
+    int64_t requests;      // get() calls
+    int64_t encoded;       // frames actually encoded; requests - encoded were served from the cache
+    int64_t scaledEncoded; // of those, encodes of a 1/2 or 1/4 rendition
+    int64_t failed;
+    int64_t recycled;      // encodes that reused a returned buffer instead of allocating
+    int64_t lastBytes;
+    int64_t avgBytes;      // exponentially weighted, 1/8 per encode
+    int64_t lastEncodeNs;
+    int64_t avgEncodeNs;
+    int64_t maxEncodeNs;
+    int64_t activeRenditions; // renditions requested within kJpegRenditionIdleNs
+};
+
+/**
+ * Encode-once JPEG of the latest published frame for the web server. The
+ * first get() for a frame encodes it with cv::imencode; every later request
+ * for the same frame, from any HTTP thread, gets the same immutable bytes
+ * back. Concurrent requests for a new frame wait for the one encode in
+ * progress instead of running their own. A request for a frame older than
+ * the cached one gets its own encode, which is not cached.
+ *
+ * Smaller clients can ask for a 1/2 or 1/4 rendition instead. Each size is
+ * cached on its own and encoded only when requested, from a cv::resize of the
+ * frame, so a thumbnail never pays for the full-size encode or transfer. Sizes
+ * encode under their own locks and scratch Mats, so a full-size encode never
+ * holds up thumbnail clients. A size nobody asked for in
+ * kJpegRenditionIdleNs gives its memory back.
+ *
+ * Encoded buffers are handed out as shared_ptr<const EncodedJpeg> and go back
+ * to their rendition's small spare list when the last reader lets go, so
+ * steady-state serving reuses the same couple of vectors rather than
+ * allocating per frame.
+ */
+class JpegCache {
+public:
+    typedef std::shared_ptr<const EncodedJpeg> JpegPtr;
+
+    JpegCache();
+
+    // JPEG of frame at quality (1..100), encoded only if the cache does not already hold it.
+    // scaleDivisor picks the rendition (one of kJpegScaleDivisors; anything else is rounded
+    // down to one). encodedNow reports whether this call did the encode. Null on failure.
+    JpegPtr get(const FrameResult &frame, int quality, bool *encodedNow = nullptr, int scaleDivisor = 1);
+
+    // The most recently encoded full-size frame, or null
+    JpegPtr latest();
+
+    JpegCacheStats stats();
+
+private:
+    JpegCache(const JpegCache &);
+    JpegCache &operator=(const JpegCache &);
+
+    struct Recycler {
+        JpegCache *cache;
+        int rendition;
+        void operator()(EncodedJpeg *jpeg) const { cache->recycle(rendition, jpeg); }
+    };
+
+    struct Rendition {
+        Rendition() : lastRequestNs(0) {}
+        // Guarded by JpegCache::mutex_
+        JpegPtr latest;
+        std::vector<std::vector<uchar> > spare;
+        int64_t lastRequestNs;
+
+        std::mutex encodeMutex; // one encode of this size at a time; also guards scratch and scaled
+        cv::Mat scratch;        // BGR or unpacked gray image handed to imencode
+        cv::Mat scaled;         // scratch resized for a smaller rendition
+    };
+
+    static int renditionFor(int scaleDivisor);
+    static bool matches(const EncodedJpeg &jpeg, const FrameResult &frame, int quality);
+    static bool encode(const FrameResult &frame, int quality, int scaleDivisor, Rendition &rendition,
+                       std::vector<uchar> &bytes);
+    void recycle(int rendition, EncodedJpeg *jpeg);
+    // Empties renditions idle since before nowNs - kJpegRenditionIdleNs into dropped; mutex_ held
+    void dropIdle(int64_t nowNs, std::vector<JpegPtr> &dropped);
+
+    std::mutex mutex_;         // guards stats_ and each rendition's latest, spare and lastRequestNs
+    Rendition renditions_[kJpegRenditions];
+    JpegCacheStats stats_;
+};
+
+// Process-wide cache the HTTP server serves /frame from
+JpegCache &jpegCache();
+
+// The image imencode takes for frame: gray as it is, color converted to BGR and packed edges
+// unpacked, both into scratch. False for a format JPEG cannot hold.
+bool jpegSource(const FrameResult &frame, cv::Mat &scratch, cv::Mat &image);
+
+// imencode of a gray or BGR image (or ROI) at quality into bytes, reusing their capacity
+bool encodeJpeg(const cv::Mat &image, int quality, std::vector<uchar> &bytes);
+
+} // namespace ffddas
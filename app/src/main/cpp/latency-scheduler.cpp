@@ -0,0 +1,176 @@
+#include "latency-scheduler.h"
+
+namespace ffddas {
+
+namespace {
+
+// Best first. Each step should cost noticeably less than the one above it so
+// a downgrade actually moves the latency; resolution steps cut work ~4x.
+const PreviewQuality kLadder[] = {
+    // level, scale, blur, morph, skip
+    {0, 1, 5, 1, 1},
+    {1, 1, 3, 1, 1},
+    {2, 1, 3, 0, 1},
+    {3, 2, 3, 0, 1},
+    {4, 2, 1, 0, 1},
+    {5, 4, 1, 0, 1},
+    {6, 4, 1, 0, 2},
+    {7, 4, 1, 0, 3},
+};
+const int kLevels = sizeof(kLadder) / sizeof(kLadder[0]);
+
+const int kDowngradeFrames = 3;      // react quickly to being late
+const int kUpgradeFrames = 30;       // ...and only slowly to having headroom
+const int kMaxUpgradeFrames = 480;   // backoff cap when an upgrade keeps bouncing back
+const int kHeadroomPercent = 70;     // upgrade only after frames keep finishing under 70% of target
+const int kPanicFactor = 2;          // averaging over 2x target drops two levels at once
+
+int64_t weighted(int64_t current, int64_t value, int shift) {
+    return current == 0 ? value : current + (value - current) / (1 << shift);
+}
+
+} // namespace
+
+LatencyScheduler::LatencyScheduler()
+        : targetNs_(0), level_(0), frameCounter_(0), overBudgetFrames_(0), underBudgetFrames_(0),
+          samplesAtLevel_(0), upgradeWaitFrames_(kUpgradeFrames), reachedByUpgrade_(false),
+          avgBeforeUpgradeNs_(0), bounceBaselineNs_(0),
+          lastLatencyNs_(0), avgLatencyNs_(0),
+          admitted_(0), skipped_(0), downgrades_(0), upgrades_(0) {
+    for (int i = 0; i < kStageCount; ++i) avgStageNs_[i] = 0;
+}
+
+int LatencyScheduler::levelCount() {
+    return kLevels;
+}
+
+PreviewQuality LatencyScheduler::qualityForLevel(int level) {
+    if (level < 0) level = 0;
+    if (level >= kLevels) level = kLevels - 1;
+    return kLadder[level];
+}
+
+void LatencyScheduler::configure(int64_t targetNs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    targetNs_ = targetNs > 0 ? targetNs : 0;
+    upgradeWaitFrames_ = kUpgradeFrames;
+    reachedByUpgrade_ = false;
+    avgBeforeUpgradeNs_ = 0;
+    bounceBaselineNs_ = 0;
+    setLevelLocked(0);
+}
+
+bool LatencyScheduler::enabled() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return targetNs_ > 0;
+}
+
+bool LatencyScheduler::admit(PreviewQuality &quality) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (targetNs_ <= 0) {
+        quality = kUnscheduledPreviewQuality;
+        ++admitted_;
+        return true;
+    }
+    quality = kLadder[level_];
+    if (quality.skipInterval > 1 && frameCounter_++ % quality.skipInterval != 0) {
+        ++skipped_;
+        return false;
+    }
+    ++admitted_;
+    return true;
+}
+
+bool LatencyScheduler::record(const PreviewQuality &quality, const int64_t stageNs[kStageCount],
+                              int64_t latencyNs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int i = 0; i < kStageCount; ++i) {
+        avgStageNs_[i] = weighted(avgStageNs_[i], stageNs[i], 3);
+    }
+    lastLatencyNs_ = latencyNs;
+    // Frames still in flight from before a level change say nothing about the new level
+    if (targetNs_ <= 0 || quality.level != level_) return false;
+
+    avgLatencyNs_ = weighted(avgLatencyNs_, latencyNs, 2);
+    ++samplesAtLevel_;
+    if (reachedByUpgrade_ && samplesAtLevel_ >= upgradeWaitFrames_) {
+        // The last upgrade held; go back to probing at the normal pace
+        reachedByUpgrade_ = false;
+        upgradeWaitFrames_ = kUpgradeFrames;
+    }
+    if (bounceBaselineNs_ > 0 && samplesAtLevel_ >= kDowngradeFrames && avgLatencyNs_ * 2 < bounceBaselineNs_) {
+        // Frames got much cheaper since the last bounce (scene change): drop the backoff
+        upgradeWaitFrames_ = kUpgradeFrames;
+        bounceBaselineNs_ = 0;
+    }
+
+    // Counters look at single frames so one slow straggler after a level change (queued
+    // behind older, more expensive work) cannot keep the average above target on its own
+    if (latencyNs > targetNs_) {
+        underBudgetFrames_ = 0;
+        if (++overBudgetFrames_ >= kDowngradeFrames && level_ + 1 < kLevels) {
+            if (reachedByUpgrade_) {
+                // The level above was too expensive: wait longer before trying it again
+                upgradeWaitFrames_ = upgradeWaitFrames_ * 2 < kMaxUpgradeFrames
+                                     ? upgradeWaitFrames_ * 2 : kMaxUpgradeFrames;
+                bounceBaselineNs_ = avgBeforeUpgradeNs_;
+            } else {
+                upgradeWaitFrames_ = kUpgradeFrames;
+                bounceBaselineNs_ = 0;
+            }
+            const int steps = avgLatencyNs_ > targetNs_ * kPanicFactor ? 2 : 1;
+            reachedByUpgrade_ = false;
+            setLevelLocked(level_ + steps < kLevels ? level_ + steps : kLevels - 1);
+            ++downgrades_;
+            return true;
+        }
+    } else if (latencyNs * 100 < targetNs_ * kHeadroomPercent) {
+        overBudgetFrames_ = 0;
+        if (++underBudgetFrames_ >= upgradeWaitFrames_ && level_ > 0) {
+            reachedByUpgrade_ = true;
+            avgBeforeUpgradeNs_ = avgLatencyNs_;
+            setLevelLocked(level_ - 1);
+            ++upgrades_;
+            return true;
+        }
+    } else {
+        // Inside the band: hold the level
+        overBudgetFrames_ = 0;
+        underBudgetFrames_ = 0;
+    }
+    return false;
+}
+
+void LatencyScheduler::setLevelLocked(int level) {
+    level_ = level;
+    overBudgetFrames_ = 0;
+    underBudgetFrames_ = 0;
+    samplesAtLevel_ = 0;
+    avgLatencyNs_ = 0; // re-seeded by the first frame processed at the new level
+    frameCounter_ = 0;
+}
+
+LatencySchedulerStats LatencyScheduler::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const PreviewQuality quality = targetNs_ > 0 ? kLadder[level_] : kUnscheduledPreviewQuality;
+    LatencySchedulerStats s;
+    s.enabled = targetNs_ > 0 ? 1 : 0;
+    s.targetNs = targetNs_;
+    s.level = quality.level;
+    s.scaleDivisor = quality.scaleDivisor;
+    s.gaussianKernel = quality.gaussianKernel;
+    s.morphIterations = quality.morphIterations;
+    s.skipInterval = quality.skipInterval;
+    s.lastLatencyNs = lastLatencyNs_;
+    s.avgLatencyNs = avgLatencyNs_;
+    s.avgConvertNs = avgStageNs_[kStageConvert];
+    s.avgDetectNs = avgStageNs_[kStageDetect];
+    s.avgCompositeNs = avgStageNs_[kStageComposite];
+    s.admitted = admitted_;
+    s.skipped = skipped_;
+    s.downgrades = downgrades_;
+    s.upgrades = upgrades_;
+    return s;
+}
+
+} // namespace ffddas
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+
+namespace ffddas {
+
+// How much work one preview frame gets; the scheduler walks a fixed ladder of these
+struct PreviewQuality {
+    int level;            // index in the scheduler's ladder, 0 = best
+    int scaleDivisor;     // process at 1/scaleDivisor of the camera resolution
+    int gaussianKernel;   // blur before Canny, 1 = none
+    int morphIterations;  // 3x3 dilations of the edge map
+    int skipInterval;     // process one frame out of every skipInterval
+};
+
+// What the preview path does when no latency budget is set (full resolution, bare Canny)
+static const PreviewQuality kUnscheduledPreviewQuality = {0, 1, 1, 0, 1};
+
+struct LatencySchedulerStats {
+    int64_t enabled;
+    int64_t targetNs;
+    int64_t level;
+    int64_t scaleDivisor;
+    int64_t gaussianKernel;
+    int64_t morphIterations;
+    int64_t skipInterval;
+    int64_t lastLatencyNs;
+    int64_t avgLatencyNs;   // at the current level, exponentially weighted 1/4 per frame
+    int64_t avgConvertNs;
+    int64_t avgDetectNs;
+    int64_t avgCompositeNs;
+    int64_t admitted;
+    int64_t skipped;
+    int64_t downgrades;
+    int64_t upgrades;
+};
+
+/**
+ * Holds preview latency (submit -> result published) under a target by trading
+ * quality for time. Every finished frame reports its stage timings; a few late
+ * frames in a row step the scheduler down its quality ladder (smaller blur, no
+ * morphology, 1/2 then 1/4 resolution, finally frame skipping), a long run of
+ * frames well under budget steps it back up. Upgrades that bounce straight back
+ * make the next attempt wait twice as long.
+ *
+ * Decisions depend only on the sequence of reported timings, never on the
+ * clock, so a recorded or simulated trace always replays the same way.
+ */
+class LatencyScheduler {
+public:
+    enum Stage { kStageConvert, kStageDetect, kStageComposite, kStageCount };
+
+    LatencyScheduler();
+
+    // targetNs <= 0 disables scheduling: every frame is admitted at kUnscheduledPreviewQuality
+    void configure(int64_t targetNs);
+    bool enabled() const;
+
+    // Called once per incoming frame. Returns false if the frame should be skipped;
+    // otherwise quality holds the settings to process it with.
+    bool admit(PreviewQuality &quality);
+
+    // Feeds back a finished frame (processed at quality.level). Returns true if the level changed.
+    bool record(const PreviewQuality &quality, const int64_t stageNs[kStageCount], int64_t latencyNs);
+
+    LatencySchedulerStats stats() const;
+
+    static int levelCount();
+    static PreviewQuality qualityForLevel(int level);
+
+private:
+    LatencyScheduler(const LatencyScheduler &);
+    LatencyScheduler &operator=(const LatencyScheduler &);
+
+    void setLevelLocked(int level);
+
+    mutable std::mutex mutex_;
+    int64_t targetNs_;
+    int level_;
+    int64_t frameCounter_;      // drives skipInterval
+    int overBudgetFrames_;      // consecutive frames over target
+    int underBudgetFrames_;     // consecutive frames under the headroom mark
+    int samplesAtLevel_;
+    int upgradeWaitFrames_;     // under-budget samples needed before an upgrade, backs off on bounces
+    bool reachedByUpgrade_;     // current level was entered from below and has not proven itself yet
+    int64_t avgBeforeUpgradeNs_; // average at the level we last upgraded from
+    int64_t bounceBaselineNs_;  // that average when the upgrade bounced; halving it resets the backoff
+    int64_t lastLatencyNs_;
+    int64_t avgLatencyNs_;
+    int64_t avgStageNs_[kStageCount];
+    int64_t admitted_;
+    int64_t skipped_;
+    int64_t downgrades_;
+    int64_t upgrades_;
+};
+
+} // namespace ffddas
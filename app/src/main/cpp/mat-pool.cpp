@@ -0,0 +1,228 @@
+#define LOG_TAG "MatPool"
+
+#include "mat-pool.h"
+#include "native-log.h"
+#include "native-stats.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+namespace ffddas {
+
+namespace {
+
+struct Resolution { int width; int height; };
+
+// Preview / analysis / capture sizes CameraX hands us on the devices we ship to
+const Resolution kCameraResolutions[] = {
+        {320, 240}, {640, 480}, {960, 540}, {1280, 720}, {1440, 1080},
+        {1920, 1080}, {2560, 1440}, {3264, 2448}, {3840, 2160}, {4000, 3000},
+};
+
+size_t pageSize() {
+    static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE) > 0 ? sysconf(_SC_PAGESIZE) : 4096);
+    return size;
+}
+
+void addClass(std::vector<size_t> &classes, int cols, int rows, int elemSize) {
+    size_t bytes = static_cast<size_t>(cols) * elemSize * rows;
+    if (bytes >= FramePoolAllocator::kMinPooledBytes) {
+        classes.push_back(bytes);
+    }
+}
+
+void *alignedAlloc(size_t bytes) {
+    void *ptr = nullptr;
+    if (posix_memalign(&ptr, FramePoolAllocator::kRowAlign, bytes) != 0) {
+        return nullptr;
+    }
+    return ptr;
+}
+
+// StdMatAllocator's step / size computation: rows packed back to back, as Mat::create() promises
+size_t matLayout(int dims, const int *sizes, int type, void *data0, size_t *step) {
+    size_t total = CV_ELEM_SIZE(type);
+    for (int i = dims - 1; i >= 0; i--) {
+        if (step) {
+            if (data0 && step[i] != cv::Mat::AUTO_STEP) {
+                CV_Assert(total <= step[i]);
+                total = step[i];
+            } else {
+                step[i] = total;
+            }
+        }
+        total *= sizes[i];
+    }
+    return total;
+}
+
+} // namespace
+
+FramePoolAllocator::FramePoolAllocator(size_t retentionCapBytes) {
+    std::memset(&stats_, 0, sizeof(stats_));
+    stats_.retentionCap = retentionCapBytes;
+
+    for (const Resolution &r : kCameraResolutions) {
+        for (int elemSize = 1; elemSize <= 4; ++elemSize) {
+            addClass(classes_, r.width, r.height, elemSize);
+            addClass(classes_, r.height, r.width, elemSize);
+        }
+        // YUV420 (NV21 / I420) single-channel buffers are height * 3/2 rows
+        addClass(classes_, r.width, r.height + r.height / 2, 1);
+    }
+    std::sort(classes_.begin(), classes_.end());
+    classes_.erase(std::unique(classes_.begin(), classes_.end()), classes_.end());
+    freeLists_.resize(classes_.size());
+}
+
+FramePoolAllocator::~FramePoolAllocator() {
+    trim();
+}
+
+int FramePoolAllocator::classFor(size_t bytes) const {
+    if (bytes < kMinPooledBytes) return -1;
+    std::vector<size_t>::const_iterator it = std::lower_bound(classes_.begin(), classes_.end(), bytes);
+    if (it == classes_.end()) return -1;
+    // Do not burn more than 25% of a block on an unrelated size
+    if (*it - bytes > bytes / 4) return -1;
+    return static_cast<int>(it - classes_.begin());
+}
+
+void *FramePoolAllocator::acquire(size_t bytes, int cls) const {
+    if (cls < 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.bypassed++;
+        return alignedAlloc(bytes);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<void *> &list = freeLists_[cls];
+        if (!list.empty()) {
+            void *block = list.back();
+            list.pop_back();
+            stats_.hits++;
+            stats_.retainedBytes -= classes_[cls];
+            stats_.retainedBlocks--;
+            stats_.pageFaultsAvoided += classes_[cls] / pageSize();
+            return block;
+        }
+        stats_.misses++;
+    }
+    return alignedAlloc(classes_[cls]);
+}
+
+void FramePoolAllocator::recycle(void *block, int cls) const {
+    if (cls >= 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stats_.retainedBytes + classes_[cls] <= stats_.retentionCap) {
+            freeLists_[cls].push_back(block);
+            stats_.retainedBytes += classes_[cls];
+            stats_.retainedBlocks++;
+            return;
+        }
+        stats_.released++;
+    }
+    free(block);
+}
+
+cv::UMatData *FramePoolAllocator::allocate(int dims, const int *sizes, int type, void *data0,
+                                           size_t *step, cv::AccessFlag /*flags*/,
+                                           cv::UMatUsageFlags /*usageFlags*/) const {
+    // Exactly StdMatAllocator's layout: as the default allocator this serves OpenCV's own
+    // temporaries too (Canny's map, for one), which index rows by cols and rely on create()
+    // returning a continuous Mat. Only the base address is aligned to kRowAlign.
+    const size_t total = matLayout(dims, sizes, type, data0, step);
+
+    uchar *data = static_cast<uchar *>(data0);
+    if (!data) {
+        data = static_cast<uchar *>(acquire(total, classFor(total)));
+        if (!data) {
+            CV_Error_(cv::Error::StsNoMem, ("FramePoolAllocator: failed to allocate %zu bytes", total));
+        }
+    }
+
+    cv::UMatData *u = new cv::UMatData(this);
+    u->data = u->origdata = data;
+    u->size = total;
+    if (data0) {
+        u->flags |= cv::UMatData::USER_ALLOCATED;
+    } else {
+        // Remember who allocated the buffer so the free is charged to the same subsystem
+        u->allocatorFlags_ = currentSubsystem();
+        recordAllocation(currentSubsystem(), total);
+    }
+    return u;
+}
+
+bool FramePoolAllocator::allocate(cv::UMatData *u, cv::AccessFlag /*accessFlags*/,
+                                  cv::UMatUsageFlags /*usageFlags*/) const {
+    return u != nullptr;
+}
+
+void FramePoolAllocator::deallocate(cv::UMatData *u) const {
+    if (!u) return;
+    CV_Assert(u->urefcount == 0);
+    CV_Assert(u->refcount == 0);
+    if (!(u->flags & cv::UMatData::USER_ALLOCATED)) {
+        recordDeallocation(static_cast<Subsystem>(u->allocatorFlags_), u->size);
+        recycle(u->origdata, classFor(u->size));
+        u->origdata = nullptr;
+    }
+    delete u;
+}
+
+void FramePoolAllocator::setRetentionCap(size_t bytes) {
+    std::vector<void *> evicted;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.retentionCap = bytes;
+        // Drop the largest blocks first until we are back under the new cap
+        for (size_t cls = freeLists_.size(); cls-- > 0 && stats_.retainedBytes > bytes;) {
+            std::vector<void *> &list = freeLists_[cls];
+            while (!list.empty() && stats_.retainedBytes > bytes) {
+                evicted.push_back(list.back());
+                list.pop_back();
+                stats_.retainedBytes -= classes_[cls];
+                stats_.retainedBlocks--;
+                stats_.released++;
+            }
+        }
+    }
+    for (void *block : evicted) free(block);
+    LOGD("Retention cap set to %zu bytes (%zu blocks evicted)", bytes, evicted.size());
+}
+
+void FramePoolAllocator::trim() {
+    std::vector<void *> evicted;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (std::vector<void *> &list : freeLists_) {
+            evicted.insert(evicted.end(), list.begin(), list.end());
+            list.clear();
+        }
+        stats_.released += evicted.size();
+        stats_.retainedBytes = 0;
+        stats_.retainedBlocks = 0;
+    }
+    for (void *block : evicted) free(block);
+}
+
+MatPoolStats FramePoolAllocator::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+FramePoolAllocator &framePool() {
+    // Intentionally leaked: Mats may still be released during static destruction
+    static FramePoolAllocator *pool = new FramePoolAllocator();
+    return *pool;
+}
+
+void installFramePool() {
+    cv::Mat::setDefaultAllocator(&framePool());
+    LOGI("Frame pool allocator installed");
+}
+
+} // namespace ffddas
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace ffddas {
+
+// Snapshot of the frame pool counters (all values are cumulative except retained*)
+struct MatPoolStats {
+    uint64_t hits;              // allocations served from a retained block
+    uint64_t misses;            // pooled size class, but no free block was retained
+    uint64_t bypassed;          // too small / too odd-sized for any size class
+    uint64_t released;          // blocks returned to the system because of the cap
+    uint64_t retainedBytes;     // bytes currently parked in free lists
+    uint64_t retainedBlocks;
+    uint64_t retentionCap;
+    uint64_t pageFaultsAvoided; // estimated: pages of every reused block
+};
+
+/**
+ * cv::MatAllocator that recycles frame-sized buffers.
+ *
+ * Size classes are derived from common camera resolutions (both orientations)
+ * times the channel layouts the pipeline produces (gray, 565, RGB, RGBA, YUV420).
+ * Installed as OpenCV's default allocator, so every buffer keeps
+ * StdMatAllocator's continuous layout; only the base address is aligned to a
+ * 64-byte cache-line / NEON friendly boundary. Freed blocks are kept up to a
+ * retention cap; anything above it goes straight back to the system.
+ */
+class FramePoolAllocator : public cv::MatAllocator {
+public:
+    static const size_t kRowAlign = 64;
+    static const size_t kMinPooledBytes = 64 * 1024;
+    static const size_t kDefaultRetentionCap = 64u * 1024u * 1024u;
+
+    explicit FramePoolAllocator(size_t retentionCapBytes = kDefaultRetentionCap);
+    ~FramePoolAllocator() CV_OVERRIDE;
+
+    cv::UMatData *allocate(int dims, const int *sizes, int type, void *data, size_t *step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const CV_OVERRIDE;
+    bool allocate(cv::UMatData *data, cv::AccessFlag accessFlags,
+                  cv::UMatUsageFlags usageFlags) const CV_OVERRIDE;
+    void deallocate(cv::UMatData *data) const CV_OVERRIDE;
+
+    void setRetentionCap(size_t bytes);
+    void trim();
+    MatPoolStats stats() const;
+
+private:
+    int classFor(size_t bytes) const;
+    void *acquire(size_t bytes, int cls) const;
+    void recycle(void *block, int cls) const;
+
+    std::vector<size_t> classes_;
+    mutable std::vector<std::vector<void *> > freeLists_;
+    mutable std::mutex mutex_;
+    mutable MatPoolStats stats_;
+};
+
+// Process-wide pool used for every Mat allocated inside libffddas
+FramePoolAllocator &framePool();
+
+// Makes framePool() the default allocator of the OpenCV copy linked into libffddas
+void installFramePool();
+
+} // namespace ffddas
@@ -2,15 +2,41 @@
 #include <string>
 #include <android/bitmap.h>
 #include <opencv2/opencv.hpp>
-#include <android/log.h>
+#include <algorithm>
 #include <memory>
+#include <mutex>
 
 #define LOG_TAG "NativeLib"
-#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
-#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#include "native-log.h"
+#include "mat-pool.h"
+#include "native-stats.h"
+#include "edge-pipeline.h"
+#include "async-pipeline.h"
+#include "frame-callbacks.h"
+#include "edge-codec.h"
+#include "edge-contours.h"
+#include "jpeg-cache.h"
+#include "tile-delta.h"
+#include "pipeline-config.h"
+#include "pipeline-stream.h"
+#include "work-pool.h"
+
+using ffddas::SubsystemScope;
+using ffddas::runEdgePipeline;
+
+static JavaVM *gJavaVm = nullptr;
+
+extern "C" JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void * /*reserved*/) {
+    gJavaVm = vm;
+    // Route every Mat allocated by this library through the frame pool
+    ffddas::installFramePool();
+    ffddas::workPool().start(ffddas::WorkStealingPool::defaultWorkerCount());
+    return JNI_VERSION_1_6;
+}
 
 // Helper function to convert Android Bitmap to OpenCV Mat
 cv::Mat bitmapToMat(JNIEnv *env, jobject bitmap) {
+    SubsystemScope scope(ffddas::kSubsystemConversion);
     AndroidBitmapInfo info;
     void *pixels = nullptr;
 
@@ -30,11 +56,12 @@ cv::Mat bitmapToMat(JNIEnv *env, jobject bitmap) {
         return cv::Mat();
     }
 
+    // RGB_565 stays 2 bytes per pixel: CV_8UC2 Mats are treated as RGB565 throughout this library
     cv::Mat mat;
     if (info.format == ANDROID_BITMAP_FORMAT_RGBA_8888) {
-        mat = cv::Mat(info.height, info.width, CV_8UC4, pixels);
+        mat = cv::Mat(info.height, info.width, CV_8UC4, pixels, info.stride);
     } else if (info.format == ANDROID_BITMAP_FORMAT_RGB_565) {
-        mat = cv::Mat(info.height, info.width, CV_8UC2, pixels);
+        mat = cv::Mat(info.height, info.width, CV_8UC2, pixels, info.stride);
     }
 
     // Clone the mat to ensure proper memory management
@@ -46,6 +73,7 @@ cv::Mat bitmapToMat(JNIEnv *env, jobject bitmap) {
 
 // Helper function to convert OpenCV Mat to Android Bitmap
 bool matToBitmap(JNIEnv *env, cv::Mat &mat, jobject bitmap) {
+    SubsystemScope scope(ffddas::kSubsystemConversion);
     AndroidBitmapInfo info;
     void *pixels = nullptr;
 
@@ -54,17 +82,46 @@ bool matToBitmap(JNIEnv *env, cv::Mat &mat, jobject bitmap) {
         return false;
     }
 
-    if (info.format != ANDROID_BITMAP_FORMAT_RGBA_8888) {
+    if (info.format != ANDROID_BITMAP_FORMAT_RGBA_8888 &&
+        info.format != ANDROID_BITMAP_FORMAT_RGB_565) {
         LOGE("Unsupported bitmap format");
         return false;
     }
 
+    if (mat.cols != (int)info.width || mat.rows != (int)info.height) {
+        // e.g. a packed edge map, whose columns are bytes rather than pixels
+        LOGE("matToBitmap: Mat %dx%d does not match bitmap %ux%u", mat.cols, mat.rows, info.width, info.height);
+        return false;
+    }
+
     if (AndroidBitmap_lockPixels(env, bitmap, &pixels) < 0) {
         LOGE("Failed to lock bitmap pixels");
         return false;
     }
 
-    cv::Mat tmp(info.height, info.width, CV_8UC4, pixels);
+    if (info.format == ANDROID_BITMAP_FORMAT_RGB_565) {
+        // Convert straight into the locked 565 pixels, no RGBA intermediate
+        cv::Mat tmp(info.height, info.width, CV_8UC2, pixels, info.stride);
+        bool ok = true;
+        try {
+            switch (mat.type()) {
+                case CV_8UC2: mat.copyTo(tmp); break;
+                case CV_8UC4: cv::cvtColor(mat, tmp, cv::COLOR_RGBA2BGR565); break;
+                case CV_8UC3: cv::cvtColor(mat, tmp, cv::COLOR_RGB2BGR565); break;
+                case CV_8UC1: cv::cvtColor(mat, tmp, cv::COLOR_GRAY2BGR565); break;
+                default:
+                    LOGE("matToBitmap: Unsupported Mat type %d for RGB_565", mat.type());
+                    ok = false;
+            }
+        } catch (const cv::Exception &e) {
+            LOGE("matToBitmap: cv exception %s", e.what());
+            ok = false;
+        }
+        AndroidBitmap_unlockPixels(env, bitmap);
+        return ok;
+    }
+
+    cv::Mat tmp(info.height, info.width, CV_8UC4, pixels, info.stride);
 
     // Ensure source matches RGBA for safe copy
     try {
@@ -75,9 +132,9 @@ bool matToBitmap(JNIEnv *env, cv::Mat &mat, jobject bitmap) {
             cv::cvtColor(mat, rgba, cv::COLOR_RGB2RGBA);
             rgba.copyTo(tmp);
         } else if (mat.type() == CV_8UC1) {
-            cv::Mat rgba;
-            cv::cvtColor(mat, rgba, cv::COLOR_GRAY2RGBA);
-            rgba.copyTo(tmp);
+            cv::cvtColor(mat, tmp, cv::COLOR_GRAY2RGBA);
+        } else if (mat.type() == CV_8UC2) {
+            cv::cvtColor(mat, tmp, cv::COLOR_BGR5652RGBA);
         } else {
             LOGE("matToBitmap: Unsupported Mat type %d", mat.type());
             AndroidBitmap_unlockPixels(env, bitmap);
@@ -93,6 +150,37 @@ bool matToBitmap(JNIEnv *env, cv::Mat &mat, jobject bitmap) {
     return true;
 }
 
+// Helper: copy Mat pixels into a new Java byte array (a ROI's rows are not contiguous)
+static jbyteArray matToByteArray(JNIEnv *env, const cv::Mat &mat) {
+    const size_t rowBytes = mat.cols * mat.elemSize();
+    jsize outSize = static_cast<jsize>(rowBytes * mat.rows);
+    jbyteArray outArray = env->NewByteArray(outSize);
+    if (outArray == nullptr) {
+        return nullptr;
+    }
+    if (mat.isContinuous()) {
+        env->SetByteArrayRegion(outArray, 0, outSize, reinterpret_cast<const jbyte*>(mat.data));
+    } else {
+        for (int y = 0; y < mat.rows; ++y) {
+            env->SetByteArrayRegion(outArray, static_cast<jsize>(y * rowBytes), static_cast<jsize>(rowBytes),
+                                    reinterpret_cast<const jbyte*>(mat.ptr(y)));
+        }
+    }
+    return outArray;
+}
+
+// Helpers: Mats handed to Kotlin live in heap-allocated shared_ptrs addressed by a jlong handle
+static jlong newMatHandle(const cv::Mat &mat) {
+    ffddas::recordHandleCreated(mat.total() * mat.elemSize());
+    return reinterpret_cast<jlong>(new std::shared_ptr<cv::Mat>(std::make_shared<cv::Mat>(mat)));
+}
+
+static void deleteMatHandle(jlong handle) {
+    std::shared_ptr<cv::Mat> *matPtr = reinterpret_cast<std::shared_ptr<cv::Mat>*>(handle);
+    ffddas::recordHandleReleased((*matPtr)->total() * (*matPtr)->elemSize());
+    delete matPtr;
+}
+
 extern "C" JNIEXPORT jstring JNICALL
 Java_com_example_ffddas_MainActivity_stringFromJNI(
         JNIEnv* env,
@@ -109,6 +197,7 @@ Java_com_example_ffddas_MainActivity_processPhotoFrame(
         jobject bitmapInput) {
     
     LOGD("Processing photo frame");
+    ffddas::FrameScope frameScope;
     
     if (bitmapInput == nullptr) {
         LOGE("Input bitmap is null");
@@ -126,23 +215,28 @@ Java_com_example_ffddas_MainActivity_processPhotoFrame(
     
     // Process the image (example: convert to grayscale)
     cv::Mat processedMat;
+    SubsystemScope pipelineScope(ffddas::kSubsystemPipeline);
     if (inputMat.channels() == 4) {
         cv::cvtColor(inputMat, processedMat, cv::COLOR_RGBA2GRAY);
         cv::cvtColor(processedMat, processedMat, cv::COLOR_GRAY2RGBA);
     } else if (inputMat.channels() == 3) {
         cv::cvtColor(inputMat, processedMat, cv::COLOR_RGB2GRAY);
         cv::cvtColor(processedMat, processedMat, cv::COLOR_GRAY2RGB);
+    } else if (inputMat.channels() == 2) {
+        cv::cvtColor(inputMat, processedMat, cv::COLOR_BGR5652GRAY);
+        cv::cvtColor(processedMat, processedMat, cv::COLOR_GRAY2BGR565);
     } else {
         processedMat = inputMat.clone();
     }
     
-    // Create output bitmap
+    // Create output bitmap (565 input keeps a 565 output)
     jclass bitmapClass = env->FindClass("android/graphics/Bitmap");
     jclass bitmapConfigClass = env->FindClass("android/graphics/Bitmap$Config");
     
-    jfieldID argb8888FieldID = env->GetStaticFieldID(bitmapConfigClass, "ARGB_8888",
-                                                      "Landroid/graphics/Bitmap$Config;");
-    jobject bitmapConfig = env->GetStaticObjectField(bitmapConfigClass, argb8888FieldID);
+    const char *configName = processedMat.type() == CV_8UC2 ? "RGB_565" : "ARGB_8888";
+    jfieldID configFieldID = env->GetStaticFieldID(bitmapConfigClass, configName,
+                                                    "Landroid/graphics/Bitmap$Config;");
+    jobject bitmapConfig = env->GetStaticObjectField(bitmapConfigClass, configFieldID);
     
     jclass bitmapCreateClass = env->FindClass("android/graphics/Bitmap");
     jmethodID createBitmapMethodID = env->GetStaticMethodID(bitmapCreateClass, "createBitmap",
@@ -166,6 +260,10 @@ Java_com_example_ffddas_MainActivity_processPhotoFrame(
     return outputBitmap;
 }
 
+// Preview edge pipeline shared by the RGBA and low-bandwidth entry points
+static jbyteArray processPreviewFrameImpl(JNIEnv *env, jobject yuvImageBuffer, jint width, jint height,
+                                          ffddas::OutputFormat format);
+
 // 2. Native method for processing YUV_420_888 camera frames (live mode)
 extern "C" JNIEXPORT jbyteArray JNICALL
 Java_com_example_ffddas_MainActivity_processPreviewFrame(
@@ -174,8 +272,14 @@ Java_com_example_ffddas_MainActivity_processPreviewFrame(
         jobject yuvImageBuffer,
         jint width,
         jint height) {
+    return processPreviewFrameImpl(env, yuvImageBuffer, width, height, ffddas::kOutputRgba);
+}
+
+static jbyteArray processPreviewFrameImpl(JNIEnv *env, jobject yuvImageBuffer, jint width, jint height,
+                                          ffddas::OutputFormat format) {
     
     LOGD("Processing preview frame: %dx%d", width, height);
+    ffddas::FrameScope frameScope;
     
     if (yuvImageBuffer == nullptr) {
         LOGE("YUV image buffer is null");
@@ -192,33 +296,23 @@ Java_com_example_ffddas_MainActivity_processPreviewFrame(
     jsize yuvDataLength = env->GetDirectBufferCapacity(yuvImageBuffer);
     LOGD("YUV data length: %d", yuvDataLength);
     
-    // Convert YUV to RGB
     cv::Mat yuvMat(height + height/2, width, CV_8UC1, (unsigned char*)yuvData);
-    cv::Mat rgbMat;
-    cv::cvtColor(yuvMat, rgbMat, cv::COLOR_YUV2RGBA_NV21);
     
     // Process the image (example: apply edge detection)
-    cv::Mat grayMat;
-    cv::cvtColor(rgbMat, grayMat, cv::COLOR_RGBA2GRAY);
-    
-    cv::Mat edges;
-    cv::Canny(grayMat, edges, 50, 150);
-    
     cv::Mat resultMat;
-    cv::cvtColor(edges, resultMat, cv::COLOR_GRAY2RGBA);
+    if (!ffddas::processPreview(yuvMat, width, height, ffddas::kPreviewEdges, format, resultMat)) {
+        LOGE("Preview processing failed");
+        return nullptr;
+    }
     
     // Convert result to byte array
-    jsize resultSize = resultMat.total() * resultMat.elemSize();
-    jbyteArray resultArray = env->NewByteArray(resultSize);
+    jbyteArray resultArray = matToByteArray(env, resultMat);
     
     if (resultArray == nullptr) {
         LOGE("Failed to create result byte array");
         return nullptr;
     }
     
-    env->SetByteArrayRegion(resultArray, 0, resultSize,
-                            reinterpret_cast<const jbyte*>(resultMat.data));
-    
     LOGD("Preview frame processed successfully");
     return resultArray;
 }
@@ -244,9 +338,8 @@ Java_com_example_ffddas_MainActivity_bitmapToMat(
     }
     
     // Store Mat in a smart pointer to manage memory
-    std::shared_ptr<cv::Mat> matPtr = std::make_shared<cv::Mat>(mat);
     LOGD("Bitmap converted to Mat successfully: %dx%d", mat.cols, mat.rows);
-    return reinterpret_cast<jlong>(new std::shared_ptr<cv::Mat>(matPtr));
+    return newMatHandle(mat);
 }
 
 // 4. Method for converting OpenCV Mat to Android Bitmap
@@ -306,12 +399,13 @@ Java_com_example_ffddas_MainActivity_applyCannyDetection(
         return 0;
     }
     
+    SubsystemScope scope(ffddas::kSubsystemPipeline);
+
     // Convert to grayscale if needed
     cv::Mat grayMat;
-    if (inputMat.channels() == 3 || inputMat.channels() == 4) {
-        cv::cvtColor(inputMat, grayMat, cv::COLOR_RGBA2GRAY);
-    } else {
-        grayMat = inputMat;
+    if (!ffddas::toGray(inputMat, grayMat)) {
+        LOGE("Unsupported channel count %d", inputMat.channels());
+        return 0;
     }
     
     // Apply Gaussian blur to reduce noise
@@ -323,9 +417,8 @@ Java_com_example_ffddas_MainActivity_applyCannyDetection(
     cv::Canny(blurredMat, edgesMat, lowThreshold, highThreshold);
     
     // Store result in a smart pointer
-    std::shared_ptr<cv::Mat> resultPtr = std::make_shared<cv::Mat>(edgesMat);
     LOGD("Canny edge detection applied successfully");
-    return reinterpret_cast<jlong>(new std::shared_ptr<cv::Mat>(resultPtr));
+    return newMatHandle(edgesMat);
 }
 
 // 6. Grayscale conversion implementation
@@ -350,17 +443,18 @@ Java_com_example_ffddas_MainActivity_convertToGrayscaleNative(
         return 0;
     }
     
+    SubsystemScope scope(ffddas::kSubsystemPipeline);
     cv::Mat grayMat;
-    if (inputMat.channels() == 3 || inputMat.channels() == 4) {
-        cv::cvtColor(inputMat, grayMat, cv::COLOR_RGBA2GRAY);
-    } else {
+    if (inputMat.channels() == 1) {
         grayMat = inputMat.clone();
+    } else if (!ffddas::toGray(inputMat, grayMat)) {
+        LOGE("Unsupported channel count %d", inputMat.channels());
+        return 0;
     }
     
     // Store result in a smart pointer
-    std::shared_ptr<cv::Mat> resultPtr = std::make_shared<cv::Mat>(grayMat);
     LOGD("Grayscale conversion completed successfully");
-    return reinterpret_cast<jlong>(new std::shared_ptr<cv::Mat>(resultPtr));
+    return newMatHandle(grayMat);
 }
 
 // 7. Memory management for native image buffers
@@ -377,94 +471,10 @@ Java_com_example_ffddas_MainActivity_releaseMatNative(
         return;
     }
     
-    std::shared_ptr<cv::Mat> *matPtr = reinterpret_cast<std::shared_ptr<cv::Mat>*>(matAddr);
-    delete matPtr;
+    deleteMatHandle(matAddr);
     LOGD("Mat memory released successfully");
 }
 
-// Helper: validate odd kernel size >=1
-static int ensureOddKernel(int k) {
-    if (k < 1) k = 1;
-    if (k % 2 == 0) k += 1; // make odd
-    return k;
-}
-
-// Core pipeline applying blur, canny, morphology; returns RGBA Mat
-static cv::Mat runEdgePipeline(const cv::Mat &srcRgba,
-                               int gaussianKernel,
-                               double sigmaX,
-                               double sigmaY,
-                               double cannyLow,
-                               double cannyHigh,
-                               int morphIterations,
-                               bool outputGray) {
-    cv::Mat working = srcRgba.clone();
-    if (working.empty()) {
-        LOGE("runEdgePipeline: empty input Mat");
-        return cv::Mat();
-    }
-    // Convert to grayscale
-    cv::Mat gray;
-    cv::cvtColor(working, gray, cv::COLOR_RGBA2GRAY);
-
-    // Gaussian blur
-    gaussianKernel = ensureOddKernel(gaussianKernel);
-    try {
-        cv::GaussianBlur(gray, gray, cv::Size(gaussianKernel, gaussianKernel), sigmaX, sigmaY);
-    } catch (const cv::Exception &e) {
-        LOGE("GaussianBlur failed: %s", e.what());
-        return cv::Mat();
-    }
-
-    // Canny edge detection
-    cv::Mat edges;
-    try {
-        cv::Canny(gray, edges, cannyLow, cannyHigh);
-    } catch (const cv::Exception &e) {
-        LOGE("Canny failed: %s", e.what());
-        return cv::Mat();
-    }
-
-    // Morphological post-processing (close + optional dilate/erode)
-    if (morphIterations > 0) {
-        cv::Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3,3));
-        try {
-            cv::morphologyEx(edges, edges, cv::MORPH_CLOSE, kernel);
-            for (int i = 1; i < morphIterations; ++i) {
-                cv::dilate(edges, edges, kernel);
-            }
-        } catch (const cv::Exception &e) {
-            LOGE("Morphology failed: %s", e.what());
-        }
-    }
-
-    cv::Mat outputRgba;
-    if (outputGray) {
-        // Return blurred grayscale (optional), or edges as grayscale overlay
-        cv::cvtColor(edges, outputRgba, cv::COLOR_GRAY2RGBA);
-    } else {
-        // For visualization, put edges (white) on transparent background
-        cv::Mat edgeMask;
-        cv::threshold(edges, edgeMask, 0, 255, cv::THRESH_BINARY);
-        outputRgba = cv::Mat(working.rows, working.cols, CV_8UC4, cv::Scalar(0,0,0,0));
-        working.copyTo(outputRgba); // base image
-        // paint edges in outputRgba as white
-        for (int y=0; y<edgeMask.rows; ++y) {
-            uchar* em = edgeMask.ptr<uchar>(y);
-            cv::Vec4b* out = outputRgba.ptr<cv::Vec4b>(y);
-            for (int x=0; x<edgeMask.cols; ++x) {
-                if (em[x]) {
-                    out[x][0] = 255; // B
-                    out[x][1] = 255; // G
-                    out[x][2] = 255; // R
-                    out[x][3] = 255; // A
-                }
-            }
-        }
-    }
-    return outputRgba;
-}
-
 // 8. Pipeline for RGBA byte array input
 extern "C" JNIEXPORT jbyteArray JNICALL
 Java_com_example_ffddas_MainActivity_processRgbaBufferPipeline(
@@ -484,6 +494,7 @@ Java_com_example_ffddas_MainActivity_processRgbaBufferPipeline(
         LOGE("processRgbaBufferPipeline: rgbaBytes is null");
         return nullptr;
     }
+    ffddas::FrameScope frameScope;
     jsize len = env->GetArrayLength(rgbaBytes);
     int expected = width * height * 4;
     if (len < expected) {
@@ -499,10 +510,7 @@ Java_com_example_ffddas_MainActivity_processRgbaBufferPipeline(
         LOGE("processRgbaBufferPipeline: output empty");
         return nullptr;
     }
-    jsize outSize = output.total() * output.elemSize();
-    jbyteArray outArray = env->NewByteArray(outSize);
-    env->SetByteArrayRegion(outArray, 0, outSize, (jbyte*)output.data);
-    return outArray;
+    return matToByteArray(env, output);
 }
 
 // 9. Pipeline for separate YUV_420_888 planes
@@ -529,6 +537,7 @@ Java_com_example_ffddas_MainActivity_processYuvPlanesPipeline(
         LOGE("processYuvPlanesPipeline: one or more planes null");
         return nullptr;
     }
+    ffddas::FrameScope frameScope;
     int chromaWidth = (width + 1) / 2;
     int chromaHeight = (height + 1) / 2;
     jsize ySize = env->GetArrayLength(yPlane);
@@ -564,6 +573,7 @@ Java_com_example_ffddas_MainActivity_processYuvPlanesPipeline(
     cv::Mat yuvMat(height + chromaHeight*2, width, CV_8UC1, i420.data()); // (height + height/2) for 420, using chromaHeight*2 ensures correctness with rounding
     cv::Mat rgba;
     try {
+        SubsystemScope scope(ffddas::kSubsystemConversion);
         cv::cvtColor(yuvMat, rgba, cv::COLOR_YUV2RGBA_I420);
     } catch (const cv::Exception &e) {
         LOGE("YUV->RGBA conversion failed: %s", e.what());
@@ -584,10 +594,22 @@ Java_com_example_ffddas_MainActivity_processYuvPlanesPipeline(
         LOGE("processYuvPlanesPipeline: output empty");
         return nullptr;
     }
-    jsize outSize = output.total() * output.elemSize();
-    jbyteArray outArray = env->NewByteArray(outSize);
-    env->SetByteArrayRegion(outArray, 0, outSize, (jbyte*)output.data);
-    return outArray;
+    return matToByteArray(env, output);
+}
+
+// Helper: bring a Mat to a format runEdgePipeline accepts (RGBA and RGB565 pass through uncopied)
+static bool toPipelineInput(const cv::Mat &in, cv::Mat &rgba) {
+    SubsystemScope scope(ffddas::kSubsystemConversion);
+    if (in.channels() == 4 || in.channels() == 2) {
+        rgba = in;
+    } else if (in.channels() == 3) {
+        cv::cvtColor(in, rgba, cv::COLOR_RGB2RGBA);
+    } else if (in.channels() == 1) {
+        cv::cvtColor(in, rgba, cv::COLOR_GRAY2RGBA);
+    } else {
+        return false;
+    }
+    return true;
 }
 
 // 10. Pipeline on existing Mat (pointer) returning new Mat pointer
@@ -607,6 +629,7 @@ Java_com_example_ffddas_MainActivity_runPipelineOnMat(
         LOGE("runPipelineOnMat: invalid matAddr");
         return 0;
     }
+    ffddas::FrameScope frameScope;
     auto inputPtr = reinterpret_cast<std::shared_ptr<cv::Mat>*>(matAddr);
     cv::Mat &in = **inputPtr;
     if (in.empty()) {
@@ -614,13 +637,7 @@ Java_com_example_ffddas_MainActivity_runPipelineOnMat(
         return 0;
     }
     cv::Mat rgba;
-    if (in.channels() == 4) {
-        rgba = in;
-    } else if (in.channels() == 3) {
-        cv::cvtColor(in, rgba, cv::COLOR_RGB2RGBA);
-    } else if (in.channels() == 1) {
-        cv::cvtColor(in, rgba, cv::COLOR_GRAY2RGBA);
-    } else {
+    if (!toPipelineInput(in, rgba)) {
         LOGE("runPipelineOnMat: unsupported channel count %d", in.channels());
         return 0;
     }
@@ -629,8 +646,7 @@ Java_com_example_ffddas_MainActivity_runPipelineOnMat(
         LOGE("runPipelineOnMat: pipeline failed");
         return 0;
     }
-    auto resultPtr = std::make_shared<cv::Mat>(output);
-    return reinterpret_cast<jlong>(new std::shared_ptr<cv::Mat>(resultPtr));
+    return newMatHandle(output);
 }
 
 // -------- Glue exports for NativeOpenCVHelper (static methods) ---------
@@ -646,6 +662,17 @@ Java_com_example_ffddas_NativeOpenCVHelper_processPreviewFrame(
     return Java_com_example_ffddas_MainActivity_processPreviewFrame(env, nullptr, yuvImageBuffer, width, height);
 }
 
+extern "C" JNIEXPORT jbyteArray JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_processPreviewFrameFormat(
+        JNIEnv* env, jclass /*clazz*/, jobject yuvImageBuffer, jint width, jint height, jint outputFormat) {
+    if (outputFormat < ffddas::kOutputRgba || outputFormat > ffddas::kOutputPackedEdges) {
+        LOGE("processPreviewFrameFormat: unknown output format %d", outputFormat);
+        return nullptr;
+    }
+    return processPreviewFrameImpl(env, yuvImageBuffer, width, height,
+                                   static_cast<ffddas::OutputFormat>(outputFormat));
+}
+
 extern "C" JNIEXPORT jlong JNICALL
 Java_com_example_ffddas_NativeOpenCVHelper_bitmapToMat(
         JNIEnv* env, jclass /*clazz*/, jobject bitmap) {
@@ -675,3 +702,1493 @@ Java_com_example_ffddas_NativeOpenCVHelper_releaseMatNative(
         JNIEnv* env, jclass /*clazz*/, jlong matAddr) {
     Java_com_example_ffddas_MainActivity_releaseMatNative(env, nullptr, matAddr);
 }
+
+// -------- Frame pool allocator controls ---------
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_setMatPoolRetentionCap(
+        JNIEnv* /*env*/, jclass /*clazz*/, jlong bytes) {
+    ffddas::framePool().setRetentionCap(bytes > 0 ? static_cast<size_t>(bytes) : 0);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_trimMatPool(
+        JNIEnv* /*env*/, jclass /*clazz*/) {
+    ffddas::framePool().trim();
+}
+
+// Returns [hits, misses, bypassed, released, retainedBytes, retainedBlocks, retentionCap, pageFaultsAvoided]
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_getMatPoolStats(
+        JNIEnv* env, jclass /*clazz*/) {
+    ffddas::MatPoolStats s = ffddas::framePool().stats();
+    const jlong values[] = {
+            (jlong)s.hits, (jlong)s.misses, (jlong)s.bypassed, (jlong)s.released,
+            (jlong)s.retainedBytes, (jlong)s.retainedBlocks, (jlong)s.retentionCap, (jlong)s.pageFaultsAvoided
+    };
+    const jsize count = sizeof(values) / sizeof(values[0]);
+    jlongArray out = env->NewLongArray(count);
+    if (out == nullptr) {
+        LOGE("getMatPoolStats: failed to allocate result");
+        return nullptr;
+    }
+    env->SetLongArrayRegion(out, 0, count, values);
+    return out;
+}
+
+// -------- Native memory telemetry ---------
+// Returns [liveBytes, peakBytes, allocations, frames, lastFrameAllocations, outstandingHandles, peakHandles,
+//          then liveBytes, peakBytes, allocations for each subsystem: other, conversion, pipeline, handleTable]
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_getNativeStats(
+        JNIEnv* env, jclass /*clazz*/) {
+    ffddas::NativeStats s = ffddas::nativeStats();
+    std::vector<jlong> values;
+    values.push_back(s.liveBytes);
+    values.push_back(s.peakBytes);
+    values.push_back(s.allocations);
+    values.push_back(s.frames);
+    values.push_back(s.lastFrameAllocations);
+    values.push_back(s.outstandingHandles);
+    values.push_back(s.peakHandles);
+    for (int i = 0; i < ffddas::kSubsystemCount; ++i) {
+        values.push_back(s.subsystems[i].liveBytes);
+        values.push_back(s.subsystems[i].peakBytes);
+        values.push_back(s.subsystems[i].allocations);
+    }
+    jlongArray out = env->NewLongArray(static_cast<jsize>(values.size()));
+    if (out == nullptr) {
+        LOGE("getNativeStats: failed to allocate result");
+        return nullptr;
+    }
+    env->SetLongArrayRegion(out, 0, static_cast<jsize>(values.size()), values.data());
+    return out;
+}
+
+// -------- Batched pipeline (NativeOpenCVHelper) ---------
+// Per-item status codes, mirrored by NativeOpenCVHelper.BATCH_*
+enum BatchStatus {
+    kBatchOk = 0,
+    kBatchInvalidInput = 1,
+    kBatchFailed = 2
+};
+
+// Inputs are pinned and outputs materialized in chunks so local refs and pinned memory stay bounded
+static const int kBatchChunk = 32;
+
+static ffddas::PipelineParams makePipelineParams(jint gaussianKernel, jdouble sigmaX, jdouble sigmaY,
+                                                 jdouble cannyLow, jdouble cannyHigh,
+                                                 jint morphIterations, jboolean outputGray,
+                                                 jint outputFormat) {
+    ffddas::PipelineParams params;
+    params.gaussianKernel = gaussianKernel;
+    params.sigmaX = sigmaX;
+    params.sigmaY = sigmaY;
+    params.cannyLow = cannyLow;
+    params.cannyHigh = cannyHigh;
+    params.morphIterations = morphIterations;
+    params.outputGray = outputGray == JNI_TRUE;
+    params.outputFormat = outputFormat;
+    return params;
+}
+
+// Runs the pipeline over [begin, end) of inputs on the work pool, one item per task;
+// empty inputs keep their preset status
+static void runPipelineBatch(const std::vector<cv::Mat> &inputs, std::vector<cv::Mat> &outputs,
+                             std::vector<jint> &status, int begin, int end,
+                             const ffddas::PipelineParams &params) {
+    ffddas::workPool().parallelFor(begin, end, [&](int from, int to) {
+        for (int i = from; i < to; ++i) {
+            if (status[i] != kBatchOk) continue;
+            try {
+                ffddas::FrameScope frameScope;
+                cv::Mat rgba;
+                if (!toPipelineInput(inputs[i], rgba)) {
+                    status[i] = kBatchInvalidInput;
+                    continue;
+                }
+                outputs[i] = runEdgePipeline(rgba, params);
+                if (outputs[i].empty()) status[i] = kBatchFailed;
+            } catch (const std::exception &e) {
+                // cv::Exception or std::bad_alloc from the frame pool; rethrown by parallelFor it
+                // would leave this JNI call and abort the VM
+                LOGE("runPipelineBatch: item %d failed: %s", i, e.what());
+                outputs[i].release();
+                status[i] = kBatchFailed;
+            }
+        }
+    }, 1);
+}
+
+static jintArray statusToJava(JNIEnv *env, const std::vector<jint> &status) {
+    jintArray out = env->NewIntArray(static_cast<jsize>(status.size()));
+    if (out != nullptr && !status.empty()) {
+        env->SetIntArrayRegion(out, 0, static_cast<jsize>(status.size()), status.data());
+    }
+    return out;
+}
+
+// Batch over existing Mat handles; writes one result handle (or 0) per input into outHandles
+extern "C" JNIEXPORT jintArray JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_runPipelineOnMatBatch(
+        JNIEnv *env,
+        jclass /*clazz*/,
+        jlongArray matAddrs,
+        jlongArray outHandles,
+        jint gaussianKernel,
+        jdouble sigmaX,
+        jdouble sigmaY,
+        jdouble cannyLow,
+        jdouble cannyHigh,
+        jint morphIterations,
+        jboolean outputGray,
+        jint outputFormat) {
+    if (matAddrs == nullptr || outHandles == nullptr) {
+        LOGE("runPipelineOnMatBatch: null arrays");
+        return nullptr;
+    }
+    const jsize count = env->GetArrayLength(matAddrs);
+    if (env->GetArrayLength(outHandles) < count) {
+        LOGE("runPipelineOnMatBatch: outHandles shorter than input (%d)", (int)count);
+        return nullptr;
+    }
+    std::vector<jlong> addrs(count);
+    if (count > 0) env->GetLongArrayRegion(matAddrs, 0, count, addrs.data());
+
+    std::vector<cv::Mat> inputs(count);
+    std::vector<cv::Mat> outputs(count);
+    std::vector<jint> status(count, kBatchOk);
+    for (jsize i = 0; i < count; ++i) {
+        if (addrs[i] == 0) {
+            status[i] = kBatchInvalidInput;
+            continue;
+        }
+        inputs[i] = **reinterpret_cast<std::shared_ptr<cv::Mat>*>(addrs[i]);
+        if (inputs[i].empty()) status[i] = kBatchInvalidInput;
+    }
+
+    const ffddas::PipelineParams params = makePipelineParams(gaussianKernel, sigmaX, sigmaY, cannyLow,
+                                                             cannyHigh, morphIterations, outputGray,
+                                                             outputFormat);
+    runPipelineBatch(inputs, outputs, status, 0, count, params);
+
+    std::vector<jlong> handles(count, 0);
+    for (jsize i = 0; i < count; ++i) {
+        if (status[i] == kBatchOk) handles[i] = newMatHandle(outputs[i]);
+    }
+    if (count > 0) env->SetLongArrayRegion(outHandles, 0, count, handles.data());
+    LOGD("runPipelineOnMatBatch: processed %d items", (int)count);
+    return statusToJava(env, status);
+}
+
+// Batch over RGBA byte arrays (individual sizes); fills outputs[i] with the result (RGBA unless outputFormat says otherwise) or null
+extern "C" JNIEXPORT jintArray JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_processRgbaBufferBatch(
+        JNIEnv *env,
+        jclass /*clazz*/,
+        jobjectArray rgbaBuffers,
+        jintArray widths,
+        jintArray heights,
+        jobjectArray outputs,
+        jint gaussianKernel,
+        jdouble sigmaX,
+        jdouble sigmaY,
+        jdouble cannyLow,
+        jdouble cannyHigh,
+        jint morphIterations,
+        jboolean outputGray,
+        jint outputFormat) {
+    if (rgbaBuffers == nullptr || widths == nullptr || heights == nullptr || outputs == nullptr) {
+        LOGE("processRgbaBufferBatch: null arrays");
+        return nullptr;
+    }
+    const jsize count = env->GetArrayLength(rgbaBuffers);
+    if (env->GetArrayLength(widths) < count || env->GetArrayLength(heights) < count ||
+        env->GetArrayLength(outputs) < count) {
+        LOGE("processRgbaBufferBatch: size arrays shorter than input (%d)", (int)count);
+        return nullptr;
+    }
+    std::vector<jint> w(count), h(count);
+    if (count > 0) {
+        env->GetIntArrayRegion(widths, 0, count, w.data());
+        env->GetIntArrayRegion(heights, 0, count, h.data());
+    }
+
+    const ffddas::PipelineParams params = makePipelineParams(gaussianKernel, sigmaX, sigmaY, cannyLow,
+                                                             cannyHigh, morphIterations, outputGray,
+                                                             outputFormat);
+    std::vector<cv::Mat> inputs(count);
+    std::vector<cv::Mat> results(count);
+    std::vector<jint> status(count, kBatchOk);
+    std::vector<jbyteArray> arrays(kBatchChunk);
+    std::vector<jbyte*> pinned(kBatchChunk);
+    // Set once the Java heap refused an output array; no further JNI allocation is attempted
+    bool outOfMemory = false;
+    jsize done = 0;
+
+    for (jsize begin = 0; begin < count && !outOfMemory; begin += kBatchChunk) {
+        const jsize end = std::min<jsize>(count, begin + kBatchChunk);
+        done = end;
+        // Pin this chunk on the JNI thread; workers only see plain Mats
+        for (jsize i = begin; i < end; ++i) {
+            const jsize slot = i - begin;
+            arrays[slot] = static_cast<jbyteArray>(env->GetObjectArrayElement(rgbaBuffers, i));
+            pinned[slot] = nullptr;
+            if (arrays[slot] == nullptr || w[i] <= 0 || h[i] <= 0 ||
+                env->GetArrayLength(arrays[slot]) < w[i] * h[i] * 4) {
+                status[i] = kBatchInvalidInput;
+                continue;
+            }
+            pinned[slot] = env->GetByteArrayElements(arrays[slot], nullptr);
+            inputs[i] = cv::Mat(h[i], w[i], CV_8UC4, reinterpret_cast<unsigned char*>(pinned[slot]));
+        }
+
+        runPipelineBatch(inputs, results, status, begin, end, params);
+
+        for (jsize i = begin; i < end; ++i) {
+            const jsize slot = i - begin;
+            inputs[i].release();
+            if (pinned[slot] != nullptr) {
+                env->ReleaseByteArrayElements(arrays[slot], pinned[slot], JNI_ABORT); // input is read-only
+            }
+            if (arrays[slot] != nullptr) env->DeleteLocalRef(arrays[slot]);
+            if (status[i] == kBatchOk) {
+                jbyteArray out = outOfMemory ? nullptr : matToByteArray(env, results[i]);
+                if (out == nullptr) {
+                    if (!outOfMemory && env->ExceptionCheck()) {
+                        // Clear the pending OutOfMemoryError so the cleanup JNI calls below stay legal
+                        env->ExceptionClear();
+                        LOGE("processRgbaBufferBatch: out of memory at item %d, failing the rest", (int)i);
+                    }
+                    outOfMemory = true;
+                    status[i] = kBatchFailed;
+                } else {
+                    env->SetObjectArrayElement(outputs, i, out);
+                    env->DeleteLocalRef(out);
+                }
+            }
+            results[i].release();
+        }
+    }
+    // Chunks after an out-of-memory never ran
+    for (jsize i = done; i < count; ++i) {
+        if (status[i] == kBatchOk) status[i] = kBatchFailed;
+    }
+    LOGD("processRgbaBufferBatch: processed %d items", (int)count);
+    return statusToJava(env, status);
+}
+
+// -------- Compact output formats ---------
+// Expands a kOutputPackedEdges frame to one byte per pixel (0 / 255) for consumers that need gray
+extern "C" JNIEXPORT jbyteArray JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_unpackEdges(
+        JNIEnv *env, jclass /*clazz*/, jbyteArray packed, jint width, jint height) {
+    if (packed == nullptr || width <= 0 || height <= 0) {
+        LOGE("unpackEdges: invalid arguments");
+        return nullptr;
+    }
+    const int stride = ffddas::packedRowStride(width);
+    if (env->GetArrayLength(packed) < stride * height) {
+        LOGE("unpackEdges: buffer too small for %dx%d", width, height);
+        return nullptr;
+    }
+    SubsystemScope scope(ffddas::kSubsystemConversion);
+    jbyte *bits = env->GetByteArrayElements(packed, nullptr);
+    if (bits == nullptr) return nullptr;
+    cv::Mat mask;
+    ffddas::unpackBits(cv::Mat(height, stride, CV_8UC1, reinterpret_cast<unsigned char*>(bits)), width, mask);
+    env->ReleaseByteArrayElements(packed, bits, JNI_ABORT);
+    return matToByteArray(env, mask);
+}
+
+// -------- Multi-view ---------
+// Several views of one NV21 frame (direct buffer) from one call. Branch i is described by
+// kinds[i] (VIEW_*), cannyLow[i], cannyHigh[i] and morphIterations[i]; luma, blur and color
+// conversion are shared. grid = true returns one array holding all views tiled row-major,
+// otherwise one array per branch. dims receives [width, height] of each returned image.
+extern "C" JNIEXPORT jobjectArray JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_processMultiViewFrame(
+        JNIEnv* env, jclass /*clazz*/, jobject yuvImageBuffer, jint width, jint height,
+        jintArray kinds, jdoubleArray cannyLow, jdoubleArray cannyHigh, jintArray morphIterations,
+        jint gaussianKernel, jint scaleDivisor, jint outputFormat, jboolean grid, jintArray dims) {
+    if (yuvImageBuffer == nullptr || kinds == nullptr || cannyLow == nullptr || cannyHigh == nullptr ||
+        morphIterations == nullptr || dims == nullptr || env->GetArrayLength(dims) < 2 || width <= 0 || height <= 0) {
+        LOGE("processMultiViewFrame: invalid arguments");
+        return nullptr;
+    }
+    const jsize count = env->GetArrayLength(kinds);
+    if (count == 0 || env->GetArrayLength(cannyLow) < count || env->GetArrayLength(cannyHigh) < count ||
+        env->GetArrayLength(morphIterations) < count) {
+        LOGE("processMultiViewFrame: %d branches need a value in every parameter array", count);
+        return nullptr;
+    }
+    const uint8_t *yuv = static_cast<const uint8_t *>(env->GetDirectBufferAddress(yuvImageBuffer));
+    if (yuv == nullptr || env->GetDirectBufferCapacity(yuvImageBuffer) < (jlong)width * (height + height / 2)) {
+        LOGE("processMultiViewFrame: need a direct NV21 buffer of %dx%d", width, height);
+        return nullptr;
+    }
+
+    std::vector<jint> kindValues(count), morphValues(count);
+    std::vector<jdouble> lowValues(count), highValues(count);
+    env->GetIntArrayRegion(kinds, 0, count, kindValues.data());
+    env->GetIntArrayRegion(morphIterations, 0, count, morphValues.data());
+    env->GetDoubleArrayRegion(cannyLow, 0, count, lowValues.data());
+    env->GetDoubleArrayRegion(cannyHigh, 0, count, highValues.data());
+    std::vector<ffddas::ViewBranch> branches(count);
+    for (jsize i = 0; i < count; ++i) {
+        if (kindValues[i] < ffddas::kViewNormal || kindValues[i] > ffddas::kViewOverlay) {
+            LOGE("processMultiViewFrame: unknown view kind %d", kindValues[i]);
+            return nullptr;
+        }
+        branches[i].kind = static_cast<ffddas::ViewKind>(kindValues[i]);
+        branches[i].cannyLow = lowValues[i];
+        branches[i].cannyHigh = highValues[i];
+        branches[i].morphIterations = morphValues[i];
+    }
+
+    ffddas::FrameScope frameScope;
+    cv::Mat nv21(height + height / 2, width, CV_8UC1, const_cast<uint8_t *>(yuv));
+    std::vector<cv::Mat> views;
+    if (!ffddas::processMultiView(nv21, width, height, gaussianKernel, scaleDivisor, branches,
+                                  static_cast<ffddas::OutputFormat>(outputFormat), views)) {
+        return nullptr;
+    }
+    if (grid == JNI_TRUE) {
+        cv::Mat tiled;
+        if (!ffddas::composeGrid(views, tiled)) return nullptr;
+        views.assign(1, tiled);
+    }
+
+    jclass byteArrayClass = env->FindClass("[B");
+    if (byteArrayClass == nullptr) return nullptr;
+    jobjectArray out = env->NewObjectArray(static_cast<jsize>(views.size()), byteArrayClass, nullptr);
+    if (out == nullptr) {
+        LOGE("processMultiViewFrame: failed to allocate result");
+        return nullptr;
+    }
+    for (size_t i = 0; i < views.size(); ++i) {
+        jbyteArray pixels = matToByteArray(env, views[i]);
+        if (pixels == nullptr) return nullptr;
+        env->SetObjectArrayElement(out, static_cast<jsize>(i), pixels);
+        env->DeleteLocalRef(pixels);
+    }
+    const jint size[] = {views[0].cols, views[0].rows};
+    env->SetIntArrayRegion(dims, 0, 2, size);
+    return out;
+}
+
+// -------- Async frame pipeline ---------
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_startAsyncPipeline(
+        JNIEnv* /*env*/, jclass /*clazz*/, jint capacity, jint executionMode) {
+    if (executionMode != ffddas::kExecutionSerial && executionMode != ffddas::kExecutionPipelined) {
+        LOGE("startAsyncPipeline: unknown execution mode %d", executionMode);
+        return JNI_FALSE;
+    }
+    return ffddas::asyncPipeline().start(capacity, static_cast<ffddas::ExecutionMode>(executionMode))
+           ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_stopAsyncPipeline(
+        JNIEnv* /*env*/, jclass /*clazz*/) {
+    ffddas::asyncPipeline().stop();
+}
+
+// Copies the YUV_420_888 planes (direct buffers) into a pooled NV21 Mat and queues it.
+// Preview mode and thresholds come from the PipelineConfig current when processing starts.
+// Returns the frame's sequence number, 0 if the latency scheduler skipped the frame,
+// or -1 if the pipeline is stopped or the input is invalid.
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_submitYuvFrame(
+        JNIEnv *env,
+        jclass /*clazz*/,
+        jobject yPlane,
+        jobject uPlane,
+        jobject vPlane,
+        jint width,
+        jint height,
+        jint yRowStride,
+        jint uvRowStride,
+        jint uvPixelStride,
+        jint rotationDegrees,
+        jint outputFormat,
+        jlong timestampNs) {
+    if (!ffddas::asyncPipeline().running()) return -1;
+    if (width <= 0 || height <= 0 || yRowStride < width || uvPixelStride < 1 ||
+        uvRowStride < (width / 2 - 1) * uvPixelStride + 1) {
+        LOGE("submitYuvFrame: invalid geometry %dx%d", width, height);
+        return -1;
+    }
+    if (outputFormat < ffddas::kOutputRgba || outputFormat > ffddas::kOutputPackedEdges) {
+        LOGE("submitYuvFrame: unknown format %d", outputFormat);
+        return -1;
+    }
+    const uint8_t *y = static_cast<const uint8_t *>(env->GetDirectBufferAddress(yPlane));
+    const uint8_t *u = static_cast<const uint8_t *>(env->GetDirectBufferAddress(uPlane));
+    const uint8_t *v = static_cast<const uint8_t *>(env->GetDirectBufferAddress(vPlane));
+    if (y == nullptr || u == nullptr || v == nullptr) {
+        LOGE("submitYuvFrame: planes must be direct buffers");
+        return -1;
+    }
+    const jlong chromaRows = height / 2;
+    const jlong uvNeeded = (chromaRows - 1) * uvRowStride + (width / 2 - 1) * uvPixelStride + 1;
+    if (env->GetDirectBufferCapacity(yPlane) < (jlong)(height - 1) * yRowStride + width ||
+        env->GetDirectBufferCapacity(uPlane) < uvNeeded || env->GetDirectBufferCapacity(vPlane) < uvNeeded) {
+        LOGE("submitYuvFrame: plane buffers too small for %dx%d", width, height);
+        return -1;
+    }
+
+    // Decide before copying: a skipped frame costs nothing
+    ffddas::PreviewQuality quality;
+    if (!ffddas::asyncPipeline().scheduler().admit(quality)) return 0;
+
+    std::unique_ptr<ffddas::FrameJob> job(new ffddas::FrameJob());
+    job->descriptor = ffddas::ingestFrame(timestampNs);
+    job->quality = quality;
+    ffddas::yuvPlanesToNv21(y, u, v, width, height, yRowStride, uvRowStride, uvPixelStride, job->nv21);
+    job->width = width;
+    job->height = height;
+    job->rotationDegrees = rotationDegrees;
+    job->format = static_cast<ffddas::OutputFormat>(outputFormat);
+    return ffddas::asyncPipeline().submit(std::move(job));
+}
+
+// Waits up to timeoutMs for the newest finished frame. On success fills meta with
+// [sequence, width, height, format, rotationDegrees, timestampNs, queueLatencyNs, processNs,
+//  configVersion] and returns the pixels; returns null on timeout or when the pipeline stops.
+extern "C" JNIEXPORT jbyteArray JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_awaitAsyncResult(
+        JNIEnv *env, jclass /*clazz*/, jlong timeoutMs, jlongArray meta) {
+    if (meta == nullptr || env->GetArrayLength(meta) < 9) {
+        LOGE("awaitAsyncResult: meta must hold 9 values");
+        return nullptr;
+    }
+    ffddas::FrameResult result;
+    const int timeout = static_cast<int>(std::min<jlong>(std::max<jlong>(timeoutMs, 0), 60000));
+    const bool ok = timeout > 0 ? ffddas::asyncPipeline().awaitResult(result, timeout)
+                                : ffddas::asyncPipeline().pollResult(result);
+    if (!ok) return nullptr;
+    const jlong values[] = {
+            result.descriptor.sequence, result.width, result.height, result.format, result.rotationDegrees,
+            result.descriptor.sensorTimestampNs, result.queueLatencyNs(), result.processNs(),
+            static_cast<jlong>(result.descriptor.configVersion)
+    };
+    env->SetLongArrayRegion(meta, 0, 9, values);
+    return matToByteArray(env, result.pixels);
+}
+
+// Returns [running, capacity, queueDepth, submitted, processed, dropped, failed, resultsOverwritten,
+//          lastQueueLatencyNs, avgQueueLatencyNs, maxQueueLatencyNs, avgProcessNs, mode,
+//          then frames, busyNs, occupancyPermille, inputDepth, inputDropped for each stage:
+//          convert, detect, composite]
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_getAsyncPipelineStats(
+        JNIEnv* env, jclass /*clazz*/) {
+    ffddas::AsyncPipelineStats s = ffddas::asyncPipeline().stats();
+    std::vector<jlong> values = {
+            s.running, s.capacity, s.queueDepth, s.submitted, s.processed, s.dropped, s.failed,
+            s.resultsOverwritten, s.lastQueueLatencyNs, s.avgQueueLatencyNs, s.maxQueueLatencyNs,
+            s.avgProcessNs, s.mode
+    };
+    for (const ffddas::StageStats &stage : s.stages) {
+        values.push_back(stage.frames);
+        values.push_back(stage.busyNs);
+        values.push_back(stage.occupancyPermille);
+        values.push_back(stage.inputDepth);
+        values.push_back(stage.inputDropped);
+    }
+    jlongArray out = env->NewLongArray(static_cast<jsize>(values.size()));
+    if (out == nullptr) {
+        LOGE("getAsyncPipelineStats: failed to allocate result");
+        return nullptr;
+    }
+    env->SetLongArrayRegion(out, 0, static_cast<jsize>(values.size()), values.data());
+    return out;
+}
+
+// -------- Frame timing ---------
+// The capture instant of a camera frame on the steady clock (System.nanoTime()), for frames that
+// bypass the async pipeline; 0 if the sensor clock cannot be determined
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_sensorTimeToMonotonic(
+        JNIEnv* /*env*/, jclass /*clazz*/, jlong sensorTimestampNs) {
+    return ffddas::sensorToMonotonicNs(sensorTimestampNs);
+}
+
+// -------- Latency budget ---------
+// targetMs <= 0 turns the scheduler off (full quality, no skipping)
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_setLatencyBudget(
+        JNIEnv* /*env*/, jclass /*clazz*/, jint targetMs) {
+    ffddas::asyncPipeline().scheduler().configure(static_cast<int64_t>(targetMs) * 1000000);
+    LOGI("Latency budget %s", targetMs > 0 ? "set" : "disabled");
+}
+
+// Returns [enabled, targetNs, level, scaleDivisor, gaussianKernel, morphIterations, skipInterval,
+//          lastLatencyNs, avgLatencyNs, avgConvertNs, avgDetectNs, avgCompositeNs,
+//          admitted, skipped, downgrades, upgrades]
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_getLatencySchedulerStats(
+        JNIEnv* env, jclass /*clazz*/) {
+    ffddas::LatencySchedulerStats s = ffddas::asyncPipeline().scheduler().stats();
+    const jlong values[] = {
+            s.enabled, s.targetNs, s.level, s.scaleDivisor, s.gaussianKernel, s.morphIterations,
+            s.skipInterval, s.lastLatencyNs, s.avgLatencyNs, s.avgConvertNs, s.avgDetectNs,
+            s.avgCompositeNs, s.admitted, s.skipped, s.downgrades, s.upgrades
+    };
+    const jsize count = sizeof(values) / sizeof(values[0]);
+    jlongArray out = env->NewLongArray(count);
+    if (out == nullptr) {
+        LOGE("getLatencySchedulerStats: failed to allocate result");
+        return nullptr;
+    }
+    env->SetLongArrayRegion(out, 0, count, values);
+    return out;
+}
+
+// -------- Work pool ---------
+// Resizes / re-pins the shared worker pool. A no-op when nothing changes; otherwise queued
+// tasks move to the new workers, so it is safe while frames are in flight.
+// workers <= 0 picks one per core (per big core when pinning), minus one for the caller.
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_configureWorkPool(
+        JNIEnv* /*env*/, jclass /*clazz*/, jint workers, jboolean pinToFastCores, jboolean useForOpenCv) {
+    std::vector<int> cpus;
+    if (pinToFastCores == JNI_TRUE) {
+        cpus = ffddas::WorkStealingPool::fastestCpus();
+        if (cpus.empty()) LOGW("configureWorkPool: CPU frequencies unavailable, not pinning");
+    }
+    if (workers <= 0) {
+        workers = cpus.empty() ? ffddas::WorkStealingPool::defaultWorkerCount()
+                               : std::max<jint>(1, static_cast<jint>(cpus.size()) - 1);
+    }
+    ffddas::workPool().start(workers, cpus);
+    LOGI("Work pool: %d workers, pinned to %zu CPUs", workers, cpus.size());
+    if (useForOpenCv == JNI_TRUE && !ffddas::installWorkPoolAsOpenCvBackend()) return JNI_FALSE;
+    return JNI_TRUE;
+}
+
+// Returns [workers, pinnedCpus, pinFailures, openCvBackend, submitted, executed, stolen, parks, failed]
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_getWorkPoolStats(
+        JNIEnv* env, jclass /*clazz*/) {
+    ffddas::WorkPoolStats s = ffddas::workPool().stats();
+    const jlong values[] = {
+            s.workers, s.pinnedCpus, s.pinFailures, s.openCvBackend,
+            s.submitted, s.executed, s.stolen, s.parks, s.failed
+    };
+    const jsize count = sizeof(values) / sizeof(values[0]);
+    jlongArray out = env->NewLongArray(count);
+    if (out == nullptr) {
+        LOGE("getWorkPoolStats: failed to allocate result");
+        return nullptr;
+    }
+    env->SetLongArrayRegion(out, 0, count, values);
+    return out;
+}
+
+// -------- Pipeline configuration ---------
+// Publishes a new preview configuration snapshot; frames starting after this call use it.
+// Returns the new config version (tagged on every async result), or -1 if the values are invalid.
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_publishPipelineConfig(
+        JNIEnv* /*env*/, jclass /*clazz*/, jint previewMode, jdouble cannyLow, jdouble cannyHigh) {
+    if (previewMode != ffddas::kPreviewEdges && previewMode != ffddas::kPreviewGray) {
+        LOGE("publishPipelineConfig: unknown preview mode %d", previewMode);
+        return -1;
+    }
+    if (cannyLow < 0 || cannyHigh < cannyLow) {
+        LOGE("publishPipelineConfig: invalid Canny thresholds %.1f / %.1f", cannyLow, cannyHigh);
+        return -1;
+    }
+    ffddas::PipelineConfig config;
+    config.version = 0;
+    config.previewMode = previewMode;
+    config.cannyLow = cannyLow;
+    config.cannyHigh = cannyHigh;
+    return static_cast<jlong>(ffddas::pipelineConfig().publish(config));
+}
+
+// Returns [version, previewMode, cannyLow, cannyHigh, published, retiredPending, reclaimed]
+// (thresholds rounded to integers)
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_getPipelineConfig(
+        JNIEnv* env, jclass /*clazz*/) {
+    ffddas::ConfigStoreStats s = ffddas::pipelineConfig().stats();
+    jlong previewMode, cannyLow, cannyHigh;
+    {
+        ffddas::ConfigStore::Reader config(ffddas::pipelineConfig());
+        previewMode = config->previewMode;
+        cannyLow = static_cast<jlong>(config->cannyLow + 0.5);
+        cannyHigh = static_cast<jlong>(config->cannyHigh + 0.5);
+    }
+    const jlong values[] = {
+            static_cast<jlong>(s.version), previewMode, cannyLow, cannyHigh,
+            static_cast<jlong>(s.published), static_cast<jlong>(s.retiredPending),
+            static_cast<jlong>(s.reclaimed)
+    };
+    const jsize count = sizeof(values) / sizeof(values[0]);
+    jlongArray out = env->NewLongArray(count);
+    if (out == nullptr) {
+        LOGE("getPipelineConfig: failed to allocate result");
+        return nullptr;
+    }
+    env->SetLongArrayRegion(out, 0, count, values);
+    return out;
+}
+
+// -------- Frame bus ---------
+// Frames handed to Kotlin by busNextFrame() or a frame listener stay pinned by a heap BusLease
+// addressed by a jlong lease token until busReleaseFrame(); the ByteBuffer points straight at the
+// pooled pixels.
+typedef ffddas::FrameBus<ffddas::FrameResult>::FramePtr BusFramePtr;
+typedef ffddas::FrameCallbackDispatcher<ffddas::FrameResult> CallbackDispatcher;
+
+struct BusLease {
+    BusFramePtr frame;
+    // Set for listener deliveries: releasing the lease completes the callback's ticket
+    std::shared_ptr<CallbackDispatcher> dispatcher;
+    uint64_t ticket;
+};
+
+static const int kBusMetaSize = 12 + ffddas::kStampCount;
+
+static size_t busFrameBytes(const cv::Mat &pixels) {
+    if (pixels.empty()) return 0;
+    return (pixels.rows - 1) * pixels.step[0] + pixels.cols * pixels.elemSize();
+}
+
+// Pins frame behind a new lease and wraps its pixels; fills meta with the busNextFrame() layout.
+// Returns null (and pins nothing) if the buffer cannot be created.
+static jobject leaseBusFrame(JNIEnv *env, const BusFramePtr &frame, jlongArray meta,
+                             const std::shared_ptr<CallbackDispatcher> &dispatcher, uint64_t ticket) {
+    const size_t bytes = busFrameBytes(frame->pixels);
+    if (bytes == 0) return nullptr;
+    jobject buffer = env->NewDirectByteBuffer(const_cast<uchar *>(frame->pixels.data), static_cast<jlong>(bytes));
+    if (buffer == nullptr) {
+        LOGE("Frame bus: failed to wrap %zu bytes", bytes);
+        return nullptr;
+    }
+    BusLease *lease = new BusLease();
+    lease->frame = frame;
+    lease->dispatcher = dispatcher;
+    lease->ticket = ticket;
+    ffddas::recordHandleCreated(bytes);
+    const ffddas::FrameDescriptor &descriptor = frame->descriptor;
+    jlong values[kBusMetaSize] = {
+            reinterpret_cast<jlong>(lease), descriptor.sequence, frame->width, frame->height, frame->format,
+            static_cast<jlong>(frame->pixels.step[0]), frame->rotationDegrees, descriptor.sensorTimestampNs,
+            static_cast<jlong>(descriptor.configVersion), frame->queueLatencyNs(), frame->processNs(),
+            descriptor.sensorMonotonicNs
+    };
+    std::copy(descriptor.stampNs, descriptor.stampNs + ffddas::kStampCount, values + 12);
+    env->SetLongArrayRegion(meta, 0, kBusMetaSize, values);
+    return buffer;
+}
+
+// policy: 0 drop oldest (latest wins), 1 drop newest. stream: 0 for the live preview, otherwise
+// a createStream() id. Returns the subscription id, or -1.
+extern "C" JNIEXPORT jint JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_busSubscribe(
+        JNIEnv* env, jclass /*clazz*/, jstring name, jint capacity, jint policy, jint stream) {
+    if (name == nullptr || capacity < 1 || stream < 0 ||
+        (policy != ffddas::kDropOldest && policy != ffddas::kDropNewest)) {
+        LOGE("busSubscribe: invalid arguments (capacity %d, policy %d)", capacity, policy);
+        return -1;
+    }
+    const char *chars = env->GetStringUTFChars(name, nullptr);
+    if (chars == nullptr) return -1;
+    const std::string subscriberName(chars);
+    env->ReleaseStringUTFChars(name, chars);
+    const int id = ffddas::frameBus().subscribe(subscriberName, static_cast<size_t>(capacity),
+                                                static_cast<ffddas::DropPolicy>(policy), stream);
+    LOGI("Frame bus: '%s' subscribed to stream %d as %d (capacity %d, %s)", subscriberName.c_str(), stream, id,
+         capacity, policy == ffddas::kDropOldest ? "drop oldest" : "drop newest");
+    return id;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_busUnsubscribe(
+        JNIEnv* /*env*/, jclass /*clazz*/, jint subscription) {
+    ffddas::frameBus().unsubscribe(subscription);
+}
+
+// Wakes a busNextFrame() blocked on the subscription without a frame
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_busInterrupt(
+        JNIEnv* /*env*/, jclass /*clazz*/, jint subscription) {
+    ffddas::frameBus().interrupt(subscription);
+}
+
+// Waits up to timeoutMs (0 = poll) for the subscription's next frame. On success fills meta with
+// [leaseToken, sequence, width, height, format, rowStride, rotationDegrees, sensorTimestampNs,
+//  configVersion, queueLatencyNs, processNs, sensorMonotonicNs, then the FrameStamp times ingest,
+//  started, converted, detected, composited, published] and returns a direct ByteBuffer over the shared
+// pixels, valid until busReleaseFrame(leaseToken). Returns null on timeout, interrupt or error.
+extern "C" JNIEXPORT jobject JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_busNextFrame(
+        JNIEnv* env, jclass /*clazz*/, jint subscription, jlong timeoutMs, jlongArray meta) {
+    if (meta == nullptr || env->GetArrayLength(meta) < kBusMetaSize) {
+        LOGE("busNextFrame: meta must hold %d values", kBusMetaSize);
+        return nullptr;
+    }
+    BusFramePtr frame;
+    const int timeout = static_cast<int>(std::min<jlong>(std::max<jlong>(timeoutMs, 0), 60000));
+    if (!ffddas::frameBus().next(subscription, timeout, frame)) return nullptr;
+    return leaseBusFrame(env, frame, meta, std::shared_ptr<CallbackDispatcher>(), 0);
+}
+
+// Drops Kotlin's reference; the pixels return to the pool once no subscriber holds the frame.
+// For a listener delivery this also frees the listener's slot for the next frame.
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_busReleaseFrame(
+        JNIEnv* /*env*/, jclass /*clazz*/, jlong leaseToken) {
+    if (leaseToken == 0) return;
+    BusLease *lease = reinterpret_cast<BusLease *>(leaseToken);
+    ffddas::recordHandleReleased(busFrameBytes(lease->frame->pixels));
+    if (lease->dispatcher) lease->dispatcher->complete(lease->ticket);
+    delete lease;
+}
+
+// Returns [published, fanOut, unclaimed, subscriberCount,
+//          then id, stream, capacity, policy, queued, delivered, dropped for each subscriber
+//          in the order of getFrameBusSubscribers()]
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_getFrameBusStats(
+        JNIEnv* env, jclass /*clazz*/) {
+    ffddas::FrameBusStats s = ffddas::frameBus().stats();
+    std::vector<jlong> values = {
+            s.published, s.fanOut, s.unclaimed, static_cast<jlong>(s.subscribers.size())
+    };
+    for (const ffddas::SubscriberStats &subscriber : s.subscribers) {
+        values.push_back(subscriber.id);
+        values.push_back(subscriber.channel);
+        values.push_back(subscriber.capacity);
+        values.push_back(subscriber.policy);
+        values.push_back(subscriber.queued);
+        values.push_back(subscriber.delivered);
+        values.push_back(subscriber.dropped);
+    }
+    jlongArray out = env->NewLongArray(static_cast<jsize>(values.size()));
+    if (out == nullptr) {
+        LOGE("getFrameBusStats: failed to allocate result");
+        return nullptr;
+    }
+    env->SetLongArrayRegion(out, 0, static_cast<jsize>(values.size()), values.data());
+    return out;
+}
+
+// Subscriber names, one per subscriber block of getFrameBusStats()
+extern "C" JNIEXPORT jobjectArray JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_getFrameBusSubscribers(
+        JNIEnv* env, jclass /*clazz*/) {
+    ffddas::FrameBusStats s = ffddas::frameBus().stats();
+    jclass stringClass = env->FindClass("java/lang/String");
+    if (stringClass == nullptr) return nullptr;
+    jobjectArray out = env->NewObjectArray(static_cast<jsize>(s.subscribers.size()), stringClass, nullptr);
+    if (out == nullptr) {
+        LOGE("getFrameBusSubscribers: failed to allocate result");
+        return nullptr;
+    }
+    for (size_t i = 0; i < s.subscribers.size(); ++i) {
+        jstring name = env->NewStringUTF(s.subscribers[i].name.c_str());
+        if (name == nullptr) return nullptr;
+        env->SetObjectArrayElement(out, static_cast<jsize>(i), name);
+        env->DeleteLocalRef(name);
+    }
+    return out;
+}
+
+// -------- JPEG cache ---------
+// The web server serves /frame from ffddas::jpegCache(): each frame is encoded once per rendition
+// size, on the first request for it, and every request gets the same bytes. A JpegLease pins the encoded buffer while
+// Kotlin streams it out, addressed by a jlong token until releaseJpeg().
+struct JpegLease {
+    ffddas::JpegCache::JpegPtr jpeg;
+};
+
+static const int kJpegMetaSize = 6;
+
+// JPEG of the frame behind a bus lease token at quality (1..100), scaled down by scaleDivisor
+// (1, 2 or 4; see kJpegScaleDivisors). Fills meta with
+// [jpegToken, sequence, byteCount, encodedNow (1 if this call encoded, 0 if cached), width, height]
+// and returns a direct ByteBuffer over the encoded bytes, valid until releaseJpeg(jpegToken).
+// The bus lease can be released as soon as this returns. Null on error.
+extern "C" JNIEXPORT jobject JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_encodeBusFrameJpeg(
+        JNIEnv* env, jclass /*clazz*/, jlong leaseToken, jint quality, jint scaleDivisor, jlongArray meta) {
+    if (leaseToken == 0 || scaleDivisor < 1 || meta == nullptr || env->GetArrayLength(meta) < kJpegMetaSize) {
+        LOGE("encodeBusFrameJpeg: invalid arguments");
+        return nullptr;
+    }
+    const BusLease *lease = reinterpret_cast<const BusLease *>(leaseToken);
+    bool encodedNow = false;
+    ffddas::JpegCache::JpegPtr jpeg = ffddas::jpegCache().get(*lease->frame, quality, &encodedNow, scaleDivisor);
+    if (!jpeg || jpeg->bytes.empty()) return nullptr;
+    const size_t bytes = jpeg->bytes.size();
+    jobject buffer = env->NewDirectByteBuffer(const_cast<uchar *>(jpeg->bytes.data()), static_cast<jlong>(bytes));
+    if (buffer == nullptr) {
+        LOGE("encodeBusFrameJpeg: failed to wrap %zu bytes", bytes);
+        return nullptr;
+    }
+    JpegLease *pinned = new JpegLease();
+    pinned->jpeg = jpeg;
+    ffddas::recordHandleCreated(bytes);
+    jlong values[kJpegMetaSize] = {
+            reinterpret_cast<jlong>(pinned), jpeg->sequence, static_cast<jlong>(bytes), encodedNow ? 1 : 0,
+            jpeg->width, jpeg->height
+    };
+    env->SetLongArrayRegion(meta, 0, kJpegMetaSize, values);
+    return buffer;
+}
+
+// Unpins an encodeBusFrameJpeg() buffer; it is recycled once the cache has moved on as well
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_releaseJpeg(
+        JNIEnv* /*env*/, jclass /*clazz*/, jlong jpegToken) {
+    if (jpegToken == 0) return;
+    JpegLease *pinned = reinterpret_cast<JpegLease *>(jpegToken);
+    ffddas::recordHandleReleased(pinned->jpeg->bytes.size());
+    delete pinned;
+}
+
+// A tightly packed frame (a ProcessedFrame's data) scaled down by scaleDivisor with INTER_AREA, for
+// JPEG renditions of frames that never went through the frame bus. The result is
+// max(1, width / scaleDivisor) x max(1, height / scaleDivisor), in the same format except that
+// packed edges come back as kOutputGray8. Null on error.
+extern "C" JNIEXPORT jbyteArray JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_scaleFrameDown(
+        JNIEnv* env, jclass /*clazz*/, jbyteArray pixels, jint width, jint height, jint format, jint scaleDivisor) {
+    if (pixels == nullptr || width <= 0 || height <= 0 || scaleDivisor < 1 ||
+        format < ffddas::kOutputRgba || format > ffddas::kOutputPackedEdges) {
+        LOGE("scaleFrameDown: invalid arguments");
+        return nullptr;
+    }
+    static const int kTypes[] = {CV_8UC4, CV_8UC2, CV_8UC1, CV_8UC1};
+    const int type = kTypes[format];
+    const int stride = format == ffddas::kOutputPackedEdges ? ffddas::packedRowStride(width)
+                                                            : width * CV_ELEM_SIZE(type);
+    if (env->GetArrayLength(pixels) < stride * height) {
+        LOGE("scaleFrameDown: buffer too small for %dx%d", width, height);
+        return nullptr;
+    }
+    SubsystemScope scope(ffddas::kSubsystemConversion);
+    jbyte *data = env->GetByteArrayElements(pixels, nullptr);
+    if (data == nullptr) return nullptr;
+    const cv::Mat frame(height, format == ffddas::kOutputPackedEdges ? stride : width, type, data, stride);
+    const cv::Size size(std::max(1, width / scaleDivisor), std::max(1, height / scaleDivisor));
+    cv::Mat source, scaled;
+    try {
+        if (format == ffddas::kOutputPackedEdges) {
+            ffddas::unpackBits(frame, width, source);
+        } else if (format == ffddas::kOutputRgb565) {
+            cv::cvtColor(frame, source, cv::COLOR_BGR5652BGR); // INTER_AREA cannot average packed 565
+        } else {
+            source = frame;
+        }
+        cv::resize(source, scaled, size, 0, 0, cv::INTER_AREA);
+        if (format == ffddas::kOutputRgb565) cv::cvtColor(scaled, scaled, cv::COLOR_BGR2BGR565);
+    } catch (const cv::Exception &e) {
+        LOGE("scaleFrameDown: %s", e.what());
+        scaled.release();
+    }
+    env->ReleaseByteArrayElements(pixels, data, JNI_ABORT);
+    return scaled.empty() ? nullptr : matToByteArray(env, scaled);
+}
+
+// Returns [requests, encoded, scaledEncoded, failed, recycled, lastBytes, avgBytes, lastEncodeNs,
+// avgEncodeNs, maxEncodeNs, activeRenditions]
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_getJpegCacheStats(
+        JNIEnv* env, jclass /*clazz*/) {
+    const ffddas::JpegCacheStats s = ffddas::jpegCache().stats();
+    const jlong values[] = {
+            s.requests, s.encoded, s.scaledEncoded, s.failed, s.recycled, s.lastBytes, s.avgBytes,
+            s.lastEncodeNs, s.avgEncodeNs, s.maxEncodeNs, s.activeRenditions
+    };
+    const jsize count = sizeof(values) / sizeof(values[0]);
+    jlongArray out = env->NewLongArray(count);
+    if (out == nullptr) {
+        LOGE("getJpegCacheStats: failed to allocate result");
+        return nullptr;
+    }
+    env->SetLongArrayRegion(out, 0, count, values);
+    return out;
+}
+
+// -------- Edge map wire format ---------
+static jbyteArray bytesToByteArray(JNIEnv *env, const std::vector<uchar> &bytes, const char *caller) {
+    jbyteArray out = env->NewByteArray(static_cast<jsize>(bytes.size()));
+    if (out == nullptr) {
+        LOGE("%s: failed to allocate %zu bytes", caller, bytes.size());
+        return nullptr;
+    }
+    env->SetByteArrayRegion(out, 0, static_cast<jsize>(bytes.size()), reinterpret_cast<const jbyte *>(bytes.data()));
+    return out;
+}
+
+// The frame behind a bus lease token in the edge-codec.h wire format, or null if it is not a
+// binary edge map (packed edges, or gray holding only 0 and 255)
+extern "C" JNIEXPORT jbyteArray JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_encodeBusFrameEdges(
+        JNIEnv* env, jclass /*clazz*/, jlong leaseToken) {
+    if (leaseToken == 0) {
+        LOGE("encodeBusFrameEdges: invalid lease");
+        return nullptr;
+    }
+    const ffddas::FrameResult &frame = *reinterpret_cast<const BusLease *>(leaseToken)->frame;
+    SubsystemScope scope(ffddas::kSubsystemConversion);
+    std::vector<uchar> bytes;
+    if (!ffddas::encodeEdgeMap(frame.pixels, frame.format, frame.width, frame.height, bytes)) return nullptr;
+    return bytesToByteArray(env, bytes, "encodeBusFrameEdges");
+}
+
+// Same for a tightly packed frame in a Java array (a ProcessedFrame's data)
+extern "C" JNIEXPORT jbyteArray JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_encodeFrameEdges(
+        JNIEnv* env, jclass /*clazz*/, jbyteArray pixels, jint width, jint height, jint format) {
+    if (pixels == nullptr || width <= 0 || height <= 0 ||
+        (format != ffddas::kOutputPackedEdges && format != ffddas::kOutputGray8)) {
+        return nullptr;
+    }
+    const int stride = format == ffddas::kOutputPackedEdges ? ffddas::packedRowStride(width) : width;
+    if (env->GetArrayLength(pixels) < stride * height) {
+        LOGE("encodeFrameEdges: buffer too small for %dx%d", width, height);
+        return nullptr;
+    }
+    SubsystemScope scope(ffddas::kSubsystemConversion);
+    jbyte *data = env->GetByteArrayElements(pixels, nullptr);
+    if (data == nullptr) return nullptr;
+    std::vector<uchar> bytes;
+    const bool encoded = ffddas::encodeEdgeMap(cv::Mat(height, stride, CV_8UC1, reinterpret_cast<uchar *>(data)),
+                                               static_cast<ffddas::OutputFormat>(format), width, height, bytes);
+    env->ReleaseByteArrayElements(pixels, data, JNI_ABORT);
+    return encoded ? bytesToByteArray(env, bytes, "encodeFrameEdges") : nullptr;
+}
+
+// -------- Edge contours ---------
+// The edge mask contours are traced from: packed edges unpacked, a gray frame holding only 0 and
+// 255 as it is, anything else through the usual blur and Canny of its luma
+static bool contourMask(const ffddas::FrameResult &frame, double cannyLow, double cannyHigh, cv::Mat &mask) {
+    try {
+        if (frame.format == ffddas::kOutputPackedEdges) {
+            ffddas::unpackBits(frame.pixels, frame.width, mask);
+            return true;
+        }
+        if (frame.format == ffddas::kOutputGray8) {
+            cv::Mat between;
+            cv::inRange(frame.pixels, 1, 254, between);
+            if (cv::countNonZero(between) == 0) {
+                mask = frame.pixels;
+                return true;
+            }
+        }
+        cv::Mat gray;
+        if (!ffddas::toGray(frame.pixels, gray)) return false;
+        cv::GaussianBlur(gray, mask, cv::Size(5, 5), 0);
+        cv::Canny(mask, mask, cannyLow, cannyHigh);
+        return true;
+    } catch (const cv::Exception &e) {
+        LOGE("contourMask: %s", e.what());
+        return false;
+    }
+}
+
+// The edges of the frame behind a bus lease token as simplified polylines, in the edge-contours.h
+// wire format. epsilon is the Douglas-Peucker tolerance in pixels; the Canny thresholds apply only
+// to frames that are not already an edge map. Null on error.
+extern "C" JNIEXPORT jbyteArray JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_traceBusFrameContours(
+        JNIEnv* env, jclass /*clazz*/, jlong leaseToken, jdouble epsilon, jdouble cannyLow, jdouble cannyHigh) {
+    if (leaseToken == 0) {
+        LOGE("traceBusFrameContours: invalid lease");
+        return nullptr;
+    }
+    const ffddas::FrameResult &frame = *reinterpret_cast<const BusLease *>(leaseToken)->frame;
+    SubsystemScope scope(ffddas::kSubsystemPipeline);
+    cv::Mat mask;
+    if (frame.pixels.empty() || !contourMask(frame, cannyLow, cannyHigh, mask)) return nullptr;
+    ffddas::ContourParams params = ffddas::kDefaultContourParams;
+    params.epsilon = std::max(0.0, static_cast<double>(epsilon));
+    ffddas::ContourTracer tracer(params);
+    std::vector<uchar> bytes;
+    try {
+        if (!tracer.encode(mask, bytes)) return nullptr;
+    } catch (const cv::Exception &e) {
+        LOGE("traceBusFrameContours: %s", e.what());
+        return nullptr;
+    }
+    return bytesToByteArray(env, bytes, "traceBusFrameContours");
+}
+
+// -------- Server filters ---------
+// Gray or Canny edges (0 / 255) of an RGBA or RGB_565 bitmap as tightly packed kOutputGray8 bytes,
+// for web clients asking for a different filter than the app shows. mode is PREVIEW_*. The pixels
+// are read in place, with no copy of the bitmap. Null on error.
+extern "C" JNIEXPORT jbyteArray JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_filterBitmapGray(
+        JNIEnv* env, jclass /*clazz*/, jobject bitmap, jint mode, jdouble cannyLow, jdouble cannyHigh) {
+    if (bitmap == nullptr || (mode != ffddas::kPreviewEdges && mode != ffddas::kPreviewGray)) {
+        LOGE("filterBitmapGray: invalid arguments");
+        return nullptr;
+    }
+    AndroidBitmapInfo info;
+    if (AndroidBitmap_getInfo(env, bitmap, &info) < 0 ||
+        (info.format != ANDROID_BITMAP_FORMAT_RGBA_8888 && info.format != ANDROID_BITMAP_FORMAT_RGB_565)) {
+        LOGE("filterBitmapGray: unsupported bitmap");
+        return nullptr;
+    }
+    void *pixels = nullptr;
+    if (AndroidBitmap_lockPixels(env, bitmap, &pixels) < 0) {
+        LOGE("filterBitmapGray: failed to lock bitmap pixels");
+        return nullptr;
+    }
+    SubsystemScope scope(ffddas::kSubsystemPipeline);
+    cv::Mat gray;
+    try {
+        const int type = info.format == ANDROID_BITMAP_FORMAT_RGBA_8888 ? CV_8UC4 : CV_8UC2;
+        // Both formats convert into a new Mat, so gray outlives the lock
+        ffddas::toGray(cv::Mat(info.height, info.width, type, pixels, info.stride), gray);
+    } catch (const cv::Exception &e) {
+        LOGE("filterBitmapGray: %s", e.what());
+    }
+    AndroidBitmap_unlockPixels(env, bitmap);
+    if (gray.empty()) return nullptr;
+    if (mode == ffddas::kPreviewEdges) {
+        try {
+            cv::GaussianBlur(gray, gray, cv::Size(5, 5), 0);
+            cv::Canny(gray, gray, cannyLow, cannyHigh);
+        } catch (const cv::Exception &e) {
+            LOGE("filterBitmapGray: %s", e.what());
+            return nullptr;
+        }
+    }
+    return matToByteArray(env, gray);
+}
+
+// -------- Tile delta streaming ---------
+// One TileDeltaSession per delta-streaming client, addressed by a jlong handle from createTileDelta()
+// until releaseTileDelta(); calls on one handle must not overlap.
+struct TileDeltaSession {
+    explicit TileDeltaSession(const ffddas::TileDeltaParams &params) : encoder(params) {}
+    ffddas::TileDeltaEncoder encoder;
+    cv::Mat scratch;             // the frame converted for imencode
+    std::vector<uchar> payload;  // the last encodeTileDelta() message
+};
+
+static const int kTileDeltaMetaSize = 4;
+
+// tileSize and keyframeInterval <= 0 keep the defaults. Returns a handle, or 0 on failure.
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_createTileDelta(
+        JNIEnv* /*env*/, jclass /*clazz*/, jint tileSize, jint keyframeInterval) {
+    ffddas::TileDeltaParams params = ffddas::kDefaultTileDeltaParams;
+    if (tileSize > 0) params.tileSize = tileSize;
+    if (keyframeInterval > 0) params.keyframeInterval = keyframeInterval;
+    return reinterpret_cast<jlong>(new TileDeltaSession(params));
+}
+
+// Delta message for the frame behind a bus lease token. Fills meta with
+// [kind (TileDeltaKind), changedTiles, totalTiles, payloadBytes] and returns a direct ByteBuffer over
+// the payload, valid until the next call on this handle; kind 0 (unchanged) returns an empty buffer.
+// Keyframes reuse the JPEG cache's encode of the frame. Null on error.
+extern "C" JNIEXPORT jobject JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_encodeTileDelta(
+        JNIEnv* env, jclass /*clazz*/, jlong handle, jlong leaseToken, jint quality, jboolean forceKeyframe,
+        jlongArray meta) {
+    if (handle == 0 || leaseToken == 0 || meta == nullptr || env->GetArrayLength(meta) < kTileDeltaMetaSize) {
+        LOGE("encodeTileDelta: invalid arguments");
+        return nullptr;
+    }
+    TileDeltaSession *session = reinterpret_cast<TileDeltaSession *>(handle);
+    const ffddas::FrameResult &frame = *reinterpret_cast<const BusLease *>(leaseToken)->frame;
+    quality = std::min(std::max(quality, 1), 100);
+    SubsystemScope scope(ffddas::kSubsystemConversion);
+    cv::Mat image;
+    if (!ffddas::jpegSource(frame, session->scratch, image)) return nullptr;
+    ffddas::JpegCache::JpegPtr keyframe;
+    if (forceKeyframe || session->encoder.wantsKeyframe(image)) keyframe = ffddas::jpegCache().get(frame, quality);
+    ffddas::TileDeltaResult result;
+    if (!session->encoder.encode(image, quality, forceKeyframe, session->payload, result,
+                                 keyframe ? &keyframe->bytes : nullptr)) {
+        LOGE("encodeTileDelta: encoding frame %lld failed", static_cast<long long>(frame.descriptor.sequence));
+        return nullptr;
+    }
+    // A zero-length direct buffer still needs a valid address
+    static uchar empty = 0;
+    uchar *data = session->payload.empty() ? &empty : session->payload.data();
+    jobject buffer = env->NewDirectByteBuffer(data, static_cast<jlong>(session->payload.size()));
+    if (buffer == nullptr) {
+        LOGE("encodeTileDelta: failed to wrap %zu bytes", session->payload.size());
+        return nullptr;
+    }
+    const jlong values[kTileDeltaMetaSize] = {
+            result.kind, result.changedTiles, result.totalTiles, static_cast<jlong>(session->payload.size())
+    };
+    env->SetLongArrayRegion(meta, 0, kTileDeltaMetaSize, values);
+    return buffer;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_releaseTileDelta(
+        JNIEnv* /*env*/, jclass /*clazz*/, jlong handle) {
+    delete reinterpret_cast<TileDeltaSession *>(handle);
+}
+
+// -------- Frame listeners ---------
+// Native threads that call into Kotlin attach to the VM once and keep their JNIEnv for their whole
+// life instead of attaching around every call; the thread_local guard detaches them on exit.
+class AttachedThread {
+public:
+    AttachedThread() : env_(nullptr) {}
+    ~AttachedThread() { detach(); }
+
+    JNIEnv *env(const char *name) {
+        if (env_ != nullptr || gJavaVm == nullptr) return env_;
+        JavaVMAttachArgs args;
+        args.version = JNI_VERSION_1_6;
+        args.name = name;
+        args.group = nullptr;
+        if (gJavaVm->AttachCurrentThreadAsDaemon(&env_, &args) != JNI_OK) {
+            LOGE("Failed to attach thread '%s' to the VM", name);
+            env_ = nullptr;
+        }
+        return env_;
+    }
+
+    void detach() {
+        if (env_ == nullptr) return;
+        gJavaVm->DetachCurrentThread();
+        env_ = nullptr;
+    }
+
+private:
+    JNIEnv *env_;
+};
+
+static thread_local AttachedThread tAttachedThread;
+
+// A Kotlin FrameBus.Listener fed by a CallbackDispatcher. The refs are global and outlive the
+// dispatcher's thread: unregisterFrameListener() stops the dispatcher before deleting them.
+struct FrameListener {
+    std::shared_ptr<CallbackDispatcher> dispatcher;
+    jobject listener;
+    jlongArray meta;    // reused for every delivery; Kotlin copies it before returning
+};
+
+static std::mutex gFrameListenersMutex;
+static std::vector<FrameListener> gFrameListeners;
+
+// Delivers on the dispatcher's thread: one direct ByteBuffer per frame over the shared pixels,
+// leased until Kotlin releases it, which is what frees the listener's slot.
+static bool deliverToListener(const std::weak_ptr<CallbackDispatcher> &owner, jobject listener, jmethodID onFrame,
+                              jlongArray meta, const BusFramePtr &frame, uint64_t ticket) {
+    JNIEnv *env = tAttachedThread.env("ffddas-callbacks");
+    std::shared_ptr<CallbackDispatcher> dispatcher = owner.lock();
+    if (env == nullptr || !dispatcher) return false;
+    jobject buffer = leaseBusFrame(env, frame, meta, dispatcher, ticket);
+    if (buffer == nullptr) return false;
+    // From here the lease belongs to Kotlin, which releases it even if the listener throws
+    env->CallVoidMethod(listener, onFrame, buffer, meta);
+    if (env->ExceptionCheck()) {
+        LOGE("Frame listener '%s' threw on frame %lld", dispatcher->name().c_str(),
+             (long long)frame->descriptor.sequence);
+        env->ExceptionDescribe();
+        env->ExceptionClear();
+    }
+    // The thread never returns to Java, so its local references are never freed for it
+    env->DeleteLocalRef(buffer);
+    return true;
+}
+
+// Starts pushing the stream's frames (0 = live preview, else a createStream() id) to
+// listener.onNativeFrame(ByteBuffer, LongArray) from a native thread. The LongArray has the
+// busNextFrame() meta layout and is only valid during the call. At most maxInFlight frames are
+// leased to the listener at once; anything published meanwhile is coalesced into the newest frame.
+// Returns the listener id, or -1.
+extern "C" JNIEXPORT jint JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_registerFrameListener(
+        JNIEnv* env, jclass /*clazz*/, jobject listener, jstring name, jint stream, jint maxInFlight) {
+    if (listener == nullptr || name == nullptr || stream < 0 || maxInFlight < 1) {
+        LOGE("registerFrameListener: invalid arguments (stream %d, maxInFlight %d)", stream, maxInFlight);
+        return -1;
+    }
+    jclass listenerClass = env->GetObjectClass(listener);
+    jmethodID onFrame = env->GetMethodID(listenerClass, "onNativeFrame", "(Ljava/nio/ByteBuffer;[J)V");
+    env->DeleteLocalRef(listenerClass);
+    if (onFrame == nullptr) {
+        LOGE("registerFrameListener: listener has no onNativeFrame(ByteBuffer, long[])");
+        return -1;
+    }
+    const char *chars = env->GetStringUTFChars(name, nullptr);
+    if (chars == nullptr) return -1;
+    const std::string listenerName(chars);
+    env->ReleaseStringUTFChars(name, chars);
+    jlongArray localMeta = env->NewLongArray(kBusMetaSize);
+    if (localMeta == nullptr) {
+        LOGE("registerFrameListener: failed to allocate meta");
+        return -1;
+    }
+
+    FrameListener entry;
+    entry.listener = env->NewGlobalRef(listener);
+    entry.meta = static_cast<jlongArray>(env->NewGlobalRef(localMeta));
+    env->DeleteLocalRef(localMeta);
+    entry.dispatcher.reset(new CallbackDispatcher(ffddas::frameBus(), listenerName, stream, maxInFlight));
+    // The dispatcher owns the delivery function, so it must not own itself through it
+    const std::weak_ptr<CallbackDispatcher> owner(entry.dispatcher);
+    const jobject target = entry.listener;
+    const jlongArray meta = entry.meta;
+    const int id = entry.dispatcher->start(
+            [owner, target, onFrame, meta](const BusFramePtr &frame, uint64_t ticket) {
+                return deliverToListener(owner, target, onFrame, meta, frame, ticket);
+            },
+            [] { tAttachedThread.env("ffddas-callbacks"); },
+            [] { tAttachedThread.detach(); });
+    {
+        std::lock_guard<std::mutex> lock(gFrameListenersMutex);
+        gFrameListeners.push_back(entry);
+    }
+    LOGI("Frame listener '%s' on stream %d registered as %d (%d in flight)", listenerName.c_str(), stream, id,
+         maxInFlight);
+    return id;
+}
+
+// Stops deliveries and waits for a running callback to return (unless called from inside it).
+// Frames the listener still holds stay valid until released.
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_unregisterFrameListener(
+        JNIEnv* env, jclass /*clazz*/, jint id) {
+    FrameListener entry;
+    {
+        std::lock_guard<std::mutex> lock(gFrameListenersMutex);
+        size_t i = 0;
+        while (i < gFrameListeners.size() && gFrameListeners[i].dispatcher->subscription() != id) ++i;
+        if (i == gFrameListeners.size()) return;
+        entry = gFrameListeners[i];
+        gFrameListeners.erase(gFrameListeners.begin() + i);
+    }
+    entry.dispatcher->stop();
+    env->DeleteGlobalRef(entry.listener);
+    env->DeleteGlobalRef(entry.meta);
+}
+
+// Returns [listenerCount, then id, stream, maxInFlight, inFlight, delivered, coalesced, failed,
+//          lastLatencyNs, avgLatencyNs, maxLatencyNs, avgCallbackNs, avgHoldNs for each listener
+//          in the order of getFrameListenerNames()]
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_getFrameListenerStats(
+        JNIEnv* env, jclass /*clazz*/) {
+    std::vector<std::shared_ptr<CallbackDispatcher> > dispatchers;
+    {
+        std::lock_guard<std::mutex> lock(gFrameListenersMutex);
+        for (const FrameListener &entry : gFrameListeners) dispatchers.push_back(entry.dispatcher);
+    }
+    std::vector<jlong> values = { static_cast<jlong>(dispatchers.size()) };
+    for (const std::shared_ptr<CallbackDispatcher> &dispatcher : dispatchers) {
+        const ffddas::CallbackStats s = dispatcher->stats();
+        const jlong entry[] = {
+                s.id, s.channel, s.maxInFlight, s.inFlight, s.delivered, s.coalesced, s.failed,
+                s.lastLatencyNs, s.avgLatencyNs, s.maxLatencyNs, s.avgCallbackNs, s.avgHoldNs
+        };
+        values.insert(values.end(), entry, entry + sizeof(entry) / sizeof(entry[0]));
+    }
+    jlongArray out = env->NewLongArray(static_cast<jsize>(values.size()));
+    if (out == nullptr) {
+        LOGE("getFrameListenerStats: failed to allocate result");
+        return nullptr;
+    }
+    env->SetLongArrayRegion(out, 0, static_cast<jsize>(values.size()), values.data());
+    return out;
+}
+
+// Listener names, one per listener block of getFrameListenerStats()
+extern "C" JNIEXPORT jobjectArray JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_getFrameListenerNames(
+        JNIEnv* env, jclass /*clazz*/) {
+    std::vector<std::string> names;
+    {
+        std::lock_guard<std::mutex> lock(gFrameListenersMutex);
+        for (const FrameListener &entry : gFrameListeners) names.push_back(entry.dispatcher->name());
+    }
+    jclass stringClass = env->FindClass("java/lang/String");
+    if (stringClass == nullptr) return nullptr;
+    jobjectArray out = env->NewObjectArray(static_cast<jsize>(names.size()), stringClass, nullptr);
+    if (out == nullptr) {
+        LOGE("getFrameListenerNames: failed to allocate result");
+        return nullptr;
+    }
+    for (size_t i = 0; i < names.size(); ++i) {
+        jstring name = env->NewStringUTF(names[i].c_str());
+        if (name == nullptr) return nullptr;
+        env->SetObjectArrayElement(out, static_cast<jsize>(i), name);
+        env->DeleteLocalRef(name);
+    }
+    return out;
+}
+
+// -------- Pipeline streams ---------
+// Creates an independent stream with its own config and quality; its results are published on the
+// frame bus under the returned id (subscribe with busSubscribe(..., stream = id)). weight sets its
+// share of the work pool relative to other streams; capacity is its latest-wins queue length.
+// Returns the stream id, or -1 if the arguments are invalid.
+extern "C" JNIEXPORT jint JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_createStream(
+        JNIEnv* env, jclass /*clazz*/, jstring name, jint weight, jint capacity,
+        jint previewMode, jdouble cannyLow, jdouble cannyHigh,
+        jint scaleDivisor, jint gaussianKernel, jint morphIterations) {
+    if (name == nullptr) return -1;
+    if (previewMode != ffddas::kPreviewEdges && previewMode != ffddas::kPreviewGray) {
+        LOGE("createStream: unknown preview mode %d", previewMode);
+        return -1;
+    }
+    if (cannyLow < 0 || cannyHigh < cannyLow) {
+        LOGE("createStream: invalid Canny thresholds %.1f / %.1f", cannyLow, cannyHigh);
+        return -1;
+    }
+    const char *chars = env->GetStringUTFChars(name, nullptr);
+    if (chars == nullptr) return -1;
+    const std::string streamName(chars);
+    env->ReleaseStringUTFChars(name, chars);
+
+    ffddas::PipelineConfig config;
+    config.version = 0;
+    config.previewMode = previewMode;
+    config.cannyLow = cannyLow;
+    config.cannyHigh = cannyHigh;
+    ffddas::PreviewQuality quality = ffddas::kUnscheduledPreviewQuality;
+    quality.scaleDivisor = scaleDivisor;
+    quality.gaussianKernel = gaussianKernel;
+    quality.morphIterations = morphIterations;
+    return ffddas::pipelineStreams().create(streamName, weight, static_cast<size_t>(std::max<jint>(capacity, 0)),
+                                            config, quality);
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_destroyStream(
+        JNIEnv* /*env*/, jclass /*clazz*/, jint stream) {
+    return ffddas::pipelineStreams().destroy(stream) ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_setStreamWeight(
+        JNIEnv* /*env*/, jclass /*clazz*/, jint stream, jint weight) {
+    return ffddas::pipelineStreams().setWeight(stream, weight) ? JNI_TRUE : JNI_FALSE;
+}
+
+// Returns the stream's new config version, or -1 for an unknown stream or invalid values
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_publishStreamConfig(
+        JNIEnv* /*env*/, jclass /*clazz*/, jint stream, jint previewMode, jdouble cannyLow, jdouble cannyHigh) {
+    if ((previewMode != ffddas::kPreviewEdges && previewMode != ffddas::kPreviewGray) ||
+        cannyLow < 0 || cannyHigh < cannyLow) {
+        LOGE("publishStreamConfig: invalid config (mode %d, %.1f / %.1f)", previewMode, cannyLow, cannyHigh);
+        return -1;
+    }
+    ffddas::PipelineConfig config;
+    config.version = 0;
+    config.previewMode = previewMode;
+    config.cannyLow = cannyLow;
+    config.cannyHigh = cannyHigh;
+    const uint64_t version = ffddas::pipelineStreams().publishConfig(stream, config);
+    return version == 0 ? -1 : static_cast<jlong>(version);
+}
+
+// Same plane contract as submitYuvFrame. Returns the frame's per-stream sequence number,
+// or -1 for an unknown stream or invalid input.
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_submitStreamFrame(
+        JNIEnv *env,
+        jclass /*clazz*/,
+        jint stream,
+        jobject yPlane,
+        jobject uPlane,
+        jobject vPlane,
+        jint width,
+        jint height,
+        jint yRowStride,
+        jint uvRowStride,
+        jint uvPixelStride,
+        jint rotationDegrees,
+        jint outputFormat,
+        jlong timestampNs) {
+    if (width <= 0 || height <= 0 || yRowStride < width || uvPixelStride < 1 ||
+        uvRowStride < (width / 2 - 1) * uvPixelStride + 1) {
+        LOGE("submitStreamFrame: invalid geometry %dx%d", width, height);
+        return -1;
+    }
+    if (outputFormat < ffddas::kOutputRgba || outputFormat > ffddas::kOutputPackedEdges) {
+        LOGE("submitStreamFrame: unknown format %d", outputFormat);
+        return -1;
+    }
+    const uint8_t *y = static_cast<const uint8_t *>(env->GetDirectBufferAddress(yPlane));
+    const uint8_t *u = static_cast<const uint8_t *>(env->GetDirectBufferAddress(uPlane));
+    const uint8_t *v = static_cast<const uint8_t *>(env->GetDirectBufferAddress(vPlane));
+    if (y == nullptr || u == nullptr || v == nullptr) {
+        LOGE("submitStreamFrame: planes must be direct buffers");
+        return -1;
+    }
+    const jlong chromaRows = height / 2;
+    const jlong uvNeeded = (chromaRows - 1) * uvRowStride + (width / 2 - 1) * uvPixelStride + 1;
+    if (env->GetDirectBufferCapacity(yPlane) < (jlong)(height - 1) * yRowStride + width ||
+        env->GetDirectBufferCapacity(uPlane) < uvNeeded || env->GetDirectBufferCapacity(vPlane) < uvNeeded) {
+        LOGE("submitStreamFrame: plane buffers too small for %dx%d", width, height);
+        return -1;
+    }
+
+    std::unique_ptr<ffddas::FrameJob> job(new ffddas::FrameJob());
+    job->descriptor = ffddas::ingestFrame(timestampNs);
+    ffddas::yuvPlanesToNv21(y, u, v, width, height, yRowStride, uvRowStride, uvPixelStride, job->nv21);
+    job->width = width;
+    job->height = height;
+    job->rotationDegrees = rotationDegrees;
+    job->format = static_cast<ffddas::OutputFormat>(outputFormat);
+    return ffddas::pipelineStreams().submit(stream, std::move(job));
+}
+
+// Returns [maxInFlight, inFlight, streamCount,
+//          then id, weight, queued, running, submitted, processed, dropped, failed, busyNs,
+//          avgProcessNs, configVersion for each stream in the order of getStreamNames()]
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_getStreamStats(
+        JNIEnv* env, jclass /*clazz*/) {
+    int64_t maxInFlight = 0, inFlight = 0;
+    std::vector<ffddas::StreamStats> streams = ffddas::pipelineStreams().stats(maxInFlight, inFlight);
+    std::vector<jlong> values = {maxInFlight, inFlight, static_cast<jlong>(streams.size())};
+    for (const ffddas::StreamStats &s : streams) {
+        const jlong stream[] = {
+                s.id, s.weight, s.queued, s.running, s.submitted, s.processed, s.dropped, s.failed,
+                s.busyNs, s.avgProcessNs, s.configVersion
+        };
+        values.insert(values.end(), stream, stream + sizeof(stream) / sizeof(stream[0]));
+    }
+    jlongArray out = env->NewLongArray(static_cast<jsize>(values.size()));
+    if (out == nullptr) {
+        LOGE("getStreamStats: failed to allocate result");
+        return nullptr;
+    }
+    env->SetLongArrayRegion(out, 0, static_cast<jsize>(values.size()), values.data());
+    return out;
+}
+
+// Stream names, one per stream block of getStreamStats()
+extern "C" JNIEXPORT jobjectArray JNICALL
+Java_com_example_ffddas_NativeOpenCVHelper_getStreamNames(
+        JNIEnv* env, jclass /*clazz*/) {
+    int64_t maxInFlight = 0, inFlight = 0;
+    std::vector<ffddas::StreamStats> streams = ffddas::pipelineStreams().stats(maxInFlight, inFlight);
+    jclass stringClass = env->FindClass("java/lang/String");
+    if (stringClass == nullptr) return nullptr;
+    jobjectArray out = env->NewObjectArray(static_cast<jsize>(streams.size()), stringClass, nullptr);
+    if (out == nullptr) {
+        LOGE("getStreamNames: failed to allocate result");
+        return nullptr;
+    }
+    for (size_t i = 0; i < streams.size(); ++i) {
+        jstring name = env->NewStringUTF(streams[i].name.c_str());
+        if (name == nullptr) return nullptr;
+        env->SetObjectArrayElement(out, static_cast<jsize>(i), name);
+        env->DeleteLocalRef(name);
+    }
+    return out;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <android/log.h>
+
+// Each translation unit may define its own LOG_TAG before including this header
+#ifndef LOG_TAG
+#define LOG_TAG "NativeLib"
+#endif
+
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGW(...) __android_log_print(ANDROID_LOG_WARN, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
@@ -0,0 +1,142 @@
+#define LOG_TAG "NativeStats"
+
+#include "native-stats.h"
+#include "native-log.h"
+
+#include <atomic>
+
+namespace ffddas {
+
+namespace {
+
+// Warn once the number of live handles crosses this, it almost always means a missing releaseMat
+const int64_t kHandleLeakWarning = 64;
+
+struct Counter {
+    std::atomic<int64_t> live;
+    std::atomic<int64_t> peak;
+    std::atomic<int64_t> allocations;
+};
+
+Counter gTotal;
+Counter gSubsystems[kSubsystemCount];
+std::atomic<int64_t> gFrames(0);
+std::atomic<int64_t> gLastFrameAllocations(0);
+std::atomic<int64_t> gOutstandingHandles(0);
+std::atomic<int64_t> gPeakHandles(0);
+
+thread_local Subsystem tCurrentSubsystem = kSubsystemOther;
+thread_local int64_t tAllocations = 0;
+
+void raisePeak(std::atomic<int64_t> &peak, int64_t value) {
+    int64_t current = peak.load(std::memory_order_relaxed);
+    while (value > current &&
+           !peak.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+void add(Counter &counter, int64_t bytes) {
+    int64_t live = counter.live.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    counter.allocations.fetch_add(1, std::memory_order_relaxed);
+    raisePeak(counter.peak, live);
+}
+
+void remove(Counter &counter, int64_t bytes) {
+    counter.live.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+SubsystemStats snapshot(const Counter &counter) {
+    SubsystemStats s;
+    s.liveBytes = counter.live.load(std::memory_order_relaxed);
+    s.peakBytes = counter.peak.load(std::memory_order_relaxed);
+    s.allocations = counter.allocations.load(std::memory_order_relaxed);
+    return s;
+}
+
+Subsystem clamp(Subsystem subsystem) {
+    return (subsystem >= 0 && subsystem < kSubsystemCount) ? subsystem : kSubsystemOther;
+}
+
+} // namespace
+
+SubsystemScope::SubsystemScope(Subsystem subsystem) : previous_(tCurrentSubsystem) {
+    tCurrentSubsystem = subsystem;
+}
+
+SubsystemScope::~SubsystemScope() {
+    tCurrentSubsystem = previous_;
+}
+
+Subsystem currentSubsystem() {
+    return tCurrentSubsystem;
+}
+
+void recordAllocation(Subsystem subsystem, size_t bytes) {
+    add(gTotal, static_cast<int64_t>(bytes));
+    add(gSubsystems[clamp(subsystem)], static_cast<int64_t>(bytes));
+    ++tAllocations;
+}
+
+void recordDeallocation(Subsystem subsystem, size_t bytes) {
+    remove(gTotal, static_cast<int64_t>(bytes));
+    remove(gSubsystems[clamp(subsystem)], static_cast<int64_t>(bytes));
+}
+
+int64_t threadAllocations() {
+    return tAllocations;
+}
+
+void recordFrame(int64_t allocations) {
+    gFrames.fetch_add(1, std::memory_order_relaxed);
+    gLastFrameAllocations.store(allocations, std::memory_order_relaxed);
+}
+
+FrameScope::FrameScope() : start_(tAllocations) {
+}
+
+FrameScope::~FrameScope() {
+    recordFrame(tAllocations - start_);
+}
+
+void recordHandleCreated(size_t bytes) {
+    // For the handle table, live/peak track the pixels pinned by handles and
+    // "allocations" counts handles created.
+    add(gSubsystems[kSubsystemHandleTable], static_cast<int64_t>(bytes));
+    int64_t outstanding = gOutstandingHandles.fetch_add(1, std::memory_order_relaxed) + 1;
+    raisePeak(gPeakHandles, outstanding);
+    if (outstanding == kHandleLeakWarning) {
+        LOGW("%lld Mat handles outstanding - is releaseMat being called?", (long long)outstanding);
+    }
+}
+
+void recordHandleReleased(size_t bytes) {
+    remove(gSubsystems[kSubsystemHandleTable], static_cast<int64_t>(bytes));
+    gOutstandingHandles.fetch_sub(1, std::memory_order_relaxed);
+}
+
+NativeStats nativeStats() {
+    NativeStats s;
+    SubsystemStats total = snapshot(gTotal);
+    s.liveBytes = total.liveBytes;
+    s.peakBytes = total.peakBytes;
+    s.allocations = total.allocations;
+    s.frames = gFrames.load(std::memory_order_relaxed);
+    s.lastFrameAllocations = gLastFrameAllocations.load(std::memory_order_relaxed);
+    for (int i = 0; i < kSubsystemCount; ++i) {
+        s.subsystems[i] = snapshot(gSubsystems[i]);
+    }
+    s.outstandingHandles = gOutstandingHandles.load(std::memory_order_relaxed);
+    s.peakHandles = gPeakHandles.load(std::memory_order_relaxed);
+    return s;
+}
+
+const char *subsystemName(Subsystem subsystem) {
+    switch (subsystem) {
+        case kSubsystemConversion: return "conversion";
+        case kSubsystemPipeline: return "pipeline";
+        case kSubsystemHandleTable: return "handleTable";
+        default: return "other";
+    }
+}
+
+} // namespace ffddas
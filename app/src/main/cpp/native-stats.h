@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ffddas {
+
+// Owner an allocation is charged to; stored per buffer so frees are attributed correctly
+enum Subsystem {
+    kSubsystemOther = 0,
+    kSubsystemConversion,   // Bitmap/YUV <-> Mat conversions
+    kSubsystemPipeline,     // blur, Canny, morphology, compositing
+    kSubsystemHandleTable,  // Mats kept alive by jlong handles handed to Kotlin
+    kSubsystemCount
+};
+
+struct SubsystemStats {
+    int64_t liveBytes;
+    int64_t peakBytes;
+    int64_t allocations;
+};
+
+struct NativeStats {
+    int64_t liveBytes;
+    int64_t peakBytes;
+    int64_t allocations;
+    int64_t frames;
+    int64_t lastFrameAllocations;
+    int64_t outstandingHandles;
+    int64_t peakHandles;
+    SubsystemStats subsystems[kSubsystemCount];
+};
+
+/**
+ * Tags every Mat allocation made on the current thread with a subsystem
+ * for as long as the scope is alive. Scopes nest; the innermost one wins.
+ */
+class SubsystemScope {
+public:
+    explicit SubsystemScope(Subsystem subsystem);
+    ~SubsystemScope();
+
+private:
+    SubsystemScope(const SubsystemScope &);
+    SubsystemScope &operator=(const SubsystemScope &);
+
+    Subsystem previous_;
+};
+
+Subsystem currentSubsystem();
+
+// Called by the frame pool allocator for every buffer it owns
+void recordAllocation(Subsystem subsystem, size_t bytes);
+void recordDeallocation(Subsystem subsystem, size_t bytes);
+
+// Mat allocations made on the calling thread so far
+int64_t threadAllocations();
+
+// Counts a finished frame and publishes its allocations as lastFrameAllocations
+void recordFrame(int64_t allocations);
+
+/**
+ * One frame on the current thread: counts the Mat allocations this thread
+ * makes while the scope is alive and publishes them when it ends, so frames
+ * running on other threads at the same time are not mixed in. Allocations
+ * made by work pool threads on the frame's behalf are not included.
+ */
+class FrameScope {
+public:
+    FrameScope();
+    ~FrameScope();
+
+private:
+    FrameScope(const FrameScope &);
+    FrameScope &operator=(const FrameScope &);
+
+    int64_t start_;
+};
+
+// Handle table bookkeeping: bytes are the pixels the handle keeps alive
+void recordHandleCreated(size_t bytes);
+void recordHandleReleased(size_t bytes);
+
+NativeStats nativeStats();
+
+const char *subsystemName(Subsystem subsystem);
+
+} // namespace ffddas
@@ -0,0 +1,104 @@
+#include "pipeline-config.h"
+
+#include <functional>
+#include <thread>
+
+namespace ffddas {
+
+namespace {
+
+// Start the slot search at a per-thread position so concurrent readers rarely collide
+size_t slotHint() {
+    static thread_local size_t hint = std::hash<std::thread::id>()(std::this_thread::get_id());
+    return hint;
+}
+
+} // namespace
+
+ConfigStore::ConfigStore(const PipelineConfig &defaults)
+        : current_(nullptr), epoch_(1), published_(0), reclaimed_(0) {
+    for (int i = 0; i < kReaderSlots; ++i) slots_[i].store(0);
+    PipelineConfig *initial = new PipelineConfig(defaults);
+    initial->version = 1;
+    current_.store(initial);
+}
+
+ConfigStore::~ConfigStore() {
+    // Only safe without readers; the process-wide store is never destroyed
+    std::lock_guard<std::mutex> lock(writerMutex_);
+    for (size_t i = 0; i < retired_.size(); ++i) delete retired_[i].config;
+    delete current_.load();
+}
+
+uint64_t ConfigStore::publish(const PipelineConfig &config) {
+    std::lock_guard<std::mutex> lock(writerMutex_);
+    PipelineConfig *next = new PipelineConfig(config);
+    const PipelineConfig *old = current_.load();
+    next->version = old->version + 1;
+    old = current_.exchange(next);
+    // Readers that read the epoch after this increment also load the pointer after the
+    // exchange above (all seq_cst), so they can only see next
+    Retired retired = {old, epoch_.fetch_add(1) + 1};
+    retired_.push_back(retired);
+    ++published_;
+    reclaimLocked();
+    return next->version;
+}
+
+void ConfigStore::reclaimLocked() {
+    uint64_t oldestReader = UINT64_MAX;
+    for (int i = 0; i < kReaderSlots; ++i) {
+        const uint64_t entered = slots_[i].load();
+        if (entered != 0 && entered < oldestReader) oldestReader = entered;
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < retired_.size(); ++i) {
+        if (retired_[i].epoch <= oldestReader) {
+            delete retired_[i].config;
+            ++reclaimed_;
+        } else {
+            retired_[kept++] = retired_[i];
+        }
+    }
+    retired_.resize(kept);
+}
+
+ConfigStore::Reader::Reader(ConfigStore &store) : store_(store), slot_(-1), config_(nullptr) {
+    const uint64_t entered = store.epoch_.load();
+    size_t i = slotHint();
+    for (;;) {
+        i %= kReaderSlots;
+        uint64_t expected = 0;
+        if (store.slots_[i].compare_exchange_strong(expected, entered)) break;
+        ++i;
+        // Every slot busy would take 64 simultaneous readers; yield once per full lap
+        if (i % kReaderSlots == slotHint() % kReaderSlots) std::this_thread::yield();
+    }
+    slot_ = static_cast<int>(i);
+    config_ = store.current_.load();
+}
+
+ConfigStore::Reader::~Reader() {
+    store_.slots_[slot_].store(0, std::memory_order_release);
+}
+
+ConfigStoreStats ConfigStore::stats() {
+    std::lock_guard<std::mutex> lock(writerMutex_);
+    reclaimLocked();
+    ConfigStoreStats s;
+    s.version = current_.load()->version;
+    s.published = published_;
+    s.retiredPending = retired_.size();
+    s.reclaimed = reclaimed_;
+    return s;
+}
+
+ConfigStore &pipelineConfig() {
+    // Defaults match the fixed preview settings used before configs could be published
+    static const PipelineConfig defaults = {1, 0 /* kPreviewEdges */, 50, 150};
+    // Intentionally leaked like framePool(): workers may read it during static destruction
+    static ConfigStore *store = new ConfigStore(defaults);
+    return *store;
+}
+
+} // namespace ffddas
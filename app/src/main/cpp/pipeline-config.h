@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace ffddas {
+
+// Live preview settings shared by every native worker; values are copied into each frame at its start
+struct PipelineConfig {
+    uint64_t version;   // assigned by ConfigStore::publish(), 1 = built-in defaults
+    int previewMode;    // PreviewMode
+    double cannyLow;
+    double cannyHigh;
+};
+
+struct ConfigStoreStats {
+    uint64_t version;
+    uint64_t published;
+    uint64_t retiredPending;  // old snapshots a reader may still be looking at
+    uint64_t reclaimed;
+};
+
+/**
+ * Read-copy-update holder for PipelineConfig.
+ *
+ * Writers (UI thread, web server, controllers) build a new immutable snapshot
+ * and swap it in; readers pin whatever is current with a Reader, which costs a
+ * CAS on a free reader slot plus one atomic load and never blocks. A replaced
+ * snapshot is freed only once every reader that could have seen it has left
+ * (epoch-based reclamation), so a frame never observes a half-applied change.
+ */
+class ConfigStore {
+public:
+    enum { kReaderSlots = 64 };
+
+    explicit ConfigStore(const PipelineConfig &defaults);
+    ~ConfigStore();
+
+    // Publishes a copy of config (its version is ignored) and returns the new version
+    uint64_t publish(const PipelineConfig &config);
+
+    class Reader {
+    public:
+        explicit Reader(ConfigStore &store);
+        ~Reader();
+        const PipelineConfig &operator*() const { return *config_; }
+        const PipelineConfig *operator->() const { return config_; }
+
+    private:
+        Reader(const Reader &);
+        Reader &operator=(const Reader &);
+
+        ConfigStore &store_;
+        int slot_;
+        const PipelineConfig *config_;
+    };
+
+    ConfigStoreStats stats();
+
+private:
+    ConfigStore(const ConfigStore &);
+    ConfigStore &operator=(const ConfigStore &);
+
+    struct Retired {
+        const PipelineConfig *config;
+        uint64_t epoch;   // readers that entered at this epoch or later cannot hold it
+    };
+
+    void reclaimLocked();
+
+    std::atomic<const PipelineConfig *> current_;
+    std::atomic<uint64_t> epoch_;
+    std::atomic<uint64_t> slots_[kReaderSlots]; // entry epoch of an active reader, 0 = free
+
+    std::mutex writerMutex_;  // writers only
+    std::vector<Retired> retired_;
+    uint64_t published_;
+    uint64_t reclaimed_;
+};
+
+// Process-wide preview configuration, published from Kotlin
+ConfigStore &pipelineConfig();
+
+} // namespace ffddas
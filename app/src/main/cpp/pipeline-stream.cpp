@@ -0,0 +1,164 @@
+#define LOG_TAG "PipelineStream"
+
+#include "pipeline-stream.h"
+#include "native-log.h"
+#include "native-stats.h"
+
+namespace ffddas {
+
+PipelineStream::PipelineStream(int id, const std::string &name, const PipelineConfig &config,
+                               const PreviewQuality &quality)
+        : id_(id), name_(name), quality_(quality), config_(config),
+          nextSequence_(1), submitted_(0), processed_(0), failed_(0), avgProcessNs_(0) {
+}
+
+void PipelineStream::process(FrameJob &job) {
+    job.descriptor.stamp(kStampStarted);
+    {
+        ConfigStore::Reader config(config_);
+        job.descriptor.configVersion = config->version;
+        job.mode = static_cast<PreviewMode>(config->previewMode);
+        job.cannyLow = config->cannyLow;
+        job.cannyHigh = config->cannyHigh;
+    }
+    job.quality = quality_;
+
+    FrameScope frameScope;
+    bool ok = false;
+    try {
+        previewToGray(job.nv21, job.height, job.mode, job.format, job.quality, job.gray);
+        job.descriptor.stamp(kStampConverted);
+        previewDetect(job.gray, job.mode, job.quality, job.cannyLow, job.cannyHigh, job.edges);
+        job.descriptor.stamp(kStampDetected);
+        ok = previewComposite(job.gray, job.edges, job.mode, job.format, job.output);
+        job.descriptor.stamp(kStampComposited);
+    } catch (const std::exception &e) {
+        // cv::Exception, and std::bad_alloc from the frame pool: either way this frame is lost
+        LOGE("Stream '%s' frame %lld failed: %s", name_.c_str(), (long long)job.descriptor.sequence, e.what());
+    }
+    const int width = job.gray.cols;
+    const int height = job.gray.rows;
+    job.gray.release();
+    job.edges.release();
+    job.nv21.release();
+    if (!ok) {
+        failed_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    std::shared_ptr<FrameResult> result(new FrameResult());
+    result->pixels = job.output;
+    job.output.release();
+    result->width = width;
+    result->height = height;
+    result->rotationDegrees = job.rotationDegrees;
+    result->format = job.format;
+    result->descriptor = job.descriptor;
+    result->descriptor.stamp(kStampPublished);
+
+    const int64_t processNs = result->processNs();
+    const int64_t avg = avgProcessNs_.load(std::memory_order_relaxed);
+    avgProcessNs_.store(avg == 0 ? processNs : avg + (processNs - avg) / 8, std::memory_order_relaxed);
+    processed_.fetch_add(1, std::memory_order_relaxed);
+    frameBus().publish(result, id_);
+}
+
+void PipelineStream::fillStats(StreamStats &s) {
+    s.name = name_;
+    s.id = id_;
+    s.submitted = submitted_.load(std::memory_order_relaxed);
+    s.processed = processed_.load(std::memory_order_relaxed);
+    s.failed = failed_.load(std::memory_order_relaxed);
+    s.avgProcessNs = avgProcessNs_.load(std::memory_order_relaxed);
+    s.configVersion = static_cast<int64_t>(config_.stats().version);
+}
+
+StreamRegistry::StreamRegistry() : scheduler_(workPool()) {
+}
+
+int StreamRegistry::create(const std::string &name, int weight, size_t capacity,
+                           const PipelineConfig &config, const PreviewQuality &quality) {
+    if (capacity < 1 || quality.scaleDivisor < 1 || quality.gaussianKernel < 1 || quality.morphIterations < 0) {
+        LOGE("Stream '%s': invalid settings", name.c_str());
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int id = scheduler_.addFlow(name, weight, capacity);
+    streams_.push_back(std::shared_ptr<PipelineStream>(new PipelineStream(id, name, config, quality)));
+    LOGI("Stream '%s' created as %d (weight %d, 1/%d scale)", name.c_str(), id, weight, quality.scaleDivisor);
+    return id;
+}
+
+bool StreamRegistry::destroy(int id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < streams_.size(); ++i) {
+        if (streams_[i]->id() != id) continue;
+        // A frame already on the pool still finishes; its task holds the stream alive
+        scheduler_.removeFlow(id);
+        LOGI("Stream '%s' (%d) destroyed", streams_[i]->name().c_str(), id);
+        streams_.erase(streams_.begin() + i);
+        return true;
+    }
+    return false;
+}
+
+bool StreamRegistry::setWeight(int id, int weight) {
+    return find(id) && scheduler_.setWeight(id, weight);
+}
+
+uint64_t StreamRegistry::publishConfig(int id, const PipelineConfig &config) {
+    std::shared_ptr<PipelineStream> stream = find(id);
+    return stream ? stream->config().publish(config) : 0;
+}
+
+int64_t StreamRegistry::submit(int id, std::unique_ptr<FrameJob> job) {
+    std::shared_ptr<PipelineStream> stream = find(id);
+    if (!stream || !job) return -1;
+    job->descriptor.sequence = stream->nextSequence();
+    if (job->descriptor.stampNs[kStampIngest] == 0) job->descriptor.stamp(kStampIngest);
+    const int64_t sequence = job->descriptor.sequence;
+    // std::function needs a copyable capture
+    std::shared_ptr<FrameJob> shared(job.release());
+    if (!scheduler_.submit(id, [stream, shared] { stream->process(*shared); })) return -1;
+    stream->countSubmitted();
+    return sequence;
+}
+
+std::vector<StreamStats> StreamRegistry::stats(int64_t &maxInFlight, int64_t &inFlight) {
+    const FairSchedulerStats scheduling = scheduler_.stats();
+    maxInFlight = scheduling.maxInFlight;
+    inFlight = scheduling.inFlight;
+    std::vector<StreamStats> out;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < streams_.size(); ++i) {
+        StreamStats s = StreamStats();
+        streams_[i]->fillStats(s);
+        for (size_t f = 0; f < scheduling.flows.size(); ++f) {
+            const FlowStats &flow = scheduling.flows[f];
+            if (flow.id != s.id) continue;
+            s.weight = flow.weight;
+            s.queued = flow.queued;
+            s.running = flow.running;
+            s.dropped = flow.dropped;
+            s.busyNs = flow.busyNs;
+        }
+        out.push_back(s);
+    }
+    return out;
+}
+
+std::shared_ptr<PipelineStream> StreamRegistry::find(int id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < streams_.size(); ++i) {
+        if (streams_[i]->id() == id) return streams_[i];
+    }
+    return std::shared_ptr<PipelineStream>();
+}
+
+StreamRegistry &pipelineStreams() {
+    // Intentionally leaked like workPool(): tasks on the pool may outlive static destruction
+    static StreamRegistry *registry = new StreamRegistry();
+    return *registry;
+}
+
+} // namespace ffddas
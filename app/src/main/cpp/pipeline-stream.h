@@ -0,0 +1,109 @@
+#pragma once
+
+#include "async-pipeline.h"
+#include "fair-scheduler.h"
+#include "pipeline-config.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ffddas {
+
+struct StreamStats {
+    std::string name;
+    int64_t id;
+    int64_t weight;
+    int64_t queued;         // frames waiting for the stream's turn on the pool
+    int64_t running;        // 1 while a frame of this stream is being processed
+    int64_t submitted;
+    int64_t processed;
+    int64_t dropped;        // evicted by newer frames while waiting
+    int64_t failed;
+    int64_t busyNs;         // pool time the stream consumed
+    int64_t avgProcessNs;   // exponentially weighted, 1/8 per frame
+    int64_t configVersion;  // of its own ConfigStore
+};
+
+/**
+ * One independent frame stream (a second analysis stream, a second camera)
+ * with its own configuration, quality, sequence numbers and statistics. Its
+ * frames run the same convert -> detect -> composite stages as the live
+ * preview, one frame at a time, on the shared work pool, and every result is
+ * published on frameBus() under the stream's id as channel.
+ */
+class PipelineStream {
+public:
+    PipelineStream(int id, const std::string &name, const PipelineConfig &config, const PreviewQuality &quality);
+
+    int id() const { return id_; }
+    const std::string &name() const { return name_; }
+    ConfigStore &config() { return config_; }
+
+    // Runs on a pool worker; the FairScheduler never runs two frames of one stream at once
+    void process(FrameJob &job);
+
+    int64_t nextSequence() { return nextSequence_.fetch_add(1, std::memory_order_relaxed); }
+    void countSubmitted() { submitted_.fetch_add(1, std::memory_order_relaxed); }
+    void fillStats(StreamStats &s);
+
+private:
+    PipelineStream(const PipelineStream &);
+    PipelineStream &operator=(const PipelineStream &);
+
+    const int id_;
+    const std::string name_;
+    const PreviewQuality quality_;
+    ConfigStore config_;
+    std::atomic<int64_t> nextSequence_;
+    std::atomic<int64_t> submitted_;
+    std::atomic<int64_t> processed_;
+    std::atomic<int64_t> failed_;
+    std::atomic<int64_t> avgProcessNs_;
+};
+
+/**
+ * The set of live PipelineStreams. Stream ids double as frame bus channels;
+ * channel 0 is the live preview (asyncPipeline()), so ids start at 1.
+ * All streams share workPool() through one FairScheduler, so their pool
+ * time follows their weights no matter how expensive each one's frames are.
+ */
+class StreamRegistry {
+public:
+    static const int kDefaultWeight = 10;
+
+    StreamRegistry();
+
+    // Returns the stream id, or -1 if the arguments are invalid
+    int create(const std::string &name, int weight, size_t capacity,
+               const PipelineConfig &config, const PreviewQuality &quality);
+    bool destroy(int id);
+    bool setWeight(int id, int weight);
+    // Returns the stream's new config version, or 0 for an unknown stream
+    uint64_t publishConfig(int id, const PipelineConfig &config);
+
+    // Returns the frame's sequence number, or -1 for an unknown stream
+    int64_t submit(int id, std::unique_ptr<FrameJob> job);
+
+    std::vector<StreamStats> stats(int64_t &maxInFlight, int64_t &inFlight);
+    FairScheduler &scheduler() { return scheduler_; }
+
+private:
+    StreamRegistry(const StreamRegistry &);
+    StreamRegistry &operator=(const StreamRegistry &);
+
+    std::shared_ptr<PipelineStream> find(int id);
+
+    FairScheduler scheduler_;
+    std::mutex mutex_;
+    // Keyed by FairScheduler flow id, which is also the stream id
+    std::vector<std::shared_ptr<PipelineStream> > streams_;
+};
+
+// Process-wide registry driven from JNI
+StreamRegistry &pipelineStreams();
+
+} // namespace ffddas
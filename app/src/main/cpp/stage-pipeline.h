@@ -0,0 +1,234 @@
+#pragma once
+
+#include "frame-queue.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ffddas {
+
+// Monotonic clock shared by everything that stamps frames
+inline int64_t monotonicNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Values mirror NativeOpenCVHelper.ASYNC_MODE_*
+enum ExecutionMode {
+    kExecutionSerial = 0,    // low latency: one thread runs every stage of a frame back to back
+    kExecutionPipelined = 1  // high throughput: one thread per stage, frame N+1 overlaps frame N
+};
+
+struct StageStats {
+    std::string name;
+    int64_t frames;            // frames this stage finished
+    int64_t busyNs;            // time spent inside the stage function
+    int64_t occupancyPermille; // busyNs / time since start, 1000 = never idle
+    int64_t inputDepth;        // frames waiting in front of this stage
+    int64_t inputDropped;      // evicted from that queue by newer frames
+};
+
+/**
+ * Runs frames through an ordered list of stages, either serially on one thread
+ * or pipelined with a thread per stage and a LatestFrameQueue hand-off between
+ * neighbours (each queue has exactly one producer and one consumer thread).
+ * Free of OpenCV so the same code runs in the host benchmark.
+ */
+template <typename Frame>
+class StagePipeline {
+public:
+    typedef std::function<bool(Frame &)> Stage;   // returning false drops the frame
+    typedef std::function<void(std::unique_ptr<Frame>)> Sink;
+
+    StagePipeline() : running_(false), mode_(kExecutionSerial), startNs_(0) {}
+    ~StagePipeline() { stop(); }
+
+    // Configure before the first start()
+    void addStage(const char *name, const Stage &stage) {
+        stages_.push_back(std::unique_ptr<StageSlot>(new StageSlot(name, stage)));
+    }
+    void setSink(const Sink &sink) { sink_ = sink; }
+
+    void start(ExecutionMode mode, size_t inputCapacity, size_t handoffCapacity = 2) {
+        if (running_.load() || stages_.empty()) return;
+        mode_ = mode;
+        lanes_.clear();
+        std::shared_ptr<Lane> input(new Lane(inputCapacity));
+        lanes_.push_back(input);
+        if (mode == kExecutionPipelined) {
+            for (size_t i = 1; i < stages_.size(); ++i) {
+                lanes_.push_back(std::shared_ptr<Lane>(new Lane(handoffCapacity)));
+            }
+        }
+        for (size_t i = 0; i < stages_.size(); ++i) {
+            stages_[i]->frames.store(0);
+            stages_[i]->busyNs.store(0);
+        }
+        startNs_ = monotonicNs();
+        std::atomic_store(&input_, input);
+        running_.store(true);
+        if (mode == kExecutionPipelined) {
+            for (size_t i = 0; i < stages_.size(); ++i) {
+                threads_.push_back(std::thread(&StagePipeline::pipelinedLoop, this, i));
+            }
+        } else {
+            threads_.push_back(std::thread(&StagePipeline::serialLoop, this));
+        }
+    }
+
+    void stop() {
+        if (!running_.exchange(false)) return;
+        for (size_t i = 0; i < lanes_.size(); ++i) lanes_[i]->wake();
+        for (size_t i = 0; i < threads_.size(); ++i) {
+            if (threads_[i].joinable()) threads_[i].join();
+        }
+        threads_.clear();
+    }
+
+    bool running() const { return running_.load(std::memory_order_acquire); }
+    ExecutionMode mode() const { return mode_; }
+
+    // Producer side, one thread at a time. Returns false if the pipeline is stopped.
+    bool push(std::unique_ptr<Frame> frame) {
+        std::shared_ptr<Lane> input = std::atomic_load(&input_);
+        if (!input || !running()) return false;
+        input->push(std::move(frame));
+        return true;
+    }
+
+    size_t queuedFrames() const {
+        std::shared_ptr<Lane> input = std::atomic_load(&input_);
+        return input ? input->queue.size() : 0;
+    }
+
+    uint64_t inputDropped() const {
+        std::shared_ptr<Lane> input = std::atomic_load(&input_);
+        return input ? input->queue.dropped() : 0;
+    }
+
+    size_t inputCapacity() const {
+        std::shared_ptr<Lane> input = std::atomic_load(&input_);
+        return input ? input->queue.capacity() : 0;
+    }
+
+    // Only call while running or after stop() returned (lanes are rebuilt by start())
+    std::vector<StageStats> stats() const {
+        std::vector<StageStats> out;
+        const int64_t elapsed = monotonicNs() - startNs_;
+        for (size_t i = 0; i < stages_.size(); ++i) {
+            StageStats s;
+            s.name = stages_[i]->name;
+            s.frames = stages_[i]->frames.load(std::memory_order_relaxed);
+            s.busyNs = stages_[i]->busyNs.load(std::memory_order_relaxed);
+            s.occupancyPermille = elapsed > 0 ? s.busyNs * 1000 / elapsed : 0;
+            const bool hasLane = i < lanes_.size() && (mode_ == kExecutionPipelined || i == 0);
+            s.inputDepth = hasLane ? static_cast<int64_t>(lanes_[i]->queue.size()) : 0;
+            s.inputDropped = hasLane ? static_cast<int64_t>(lanes_[i]->queue.dropped()) : 0;
+            out.push_back(s);
+        }
+        return out;
+    }
+
+private:
+    StagePipeline(const StagePipeline &);
+    StagePipeline &operator=(const StagePipeline &);
+
+    struct StageSlot {
+        std::string name;
+        Stage fn;
+        std::atomic<int64_t> frames;
+        std::atomic<int64_t> busyNs;
+
+        StageSlot(const char *n, const Stage &f) : name(n), fn(f), frames(0), busyNs(0) {}
+    };
+
+    // Lock-free queue plus a condition variable the consumer parks on when it runs dry
+    struct Lane {
+        LatestFrameQueue<std::unique_ptr<Frame> > queue;
+        std::mutex mutex;
+        std::condition_variable ready;
+
+        explicit Lane(size_t capacity) : queue(capacity) {}
+
+        void push(std::unique_ptr<Frame> frame) {
+            queue.push(std::move(frame));
+            wake();
+        }
+
+        bool pop(std::unique_ptr<Frame> &frame, const std::atomic<bool> &running) {
+            if (queue.tryPop(frame)) return true;
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait_for(lock, std::chrono::milliseconds(kIdleWaitMs), [&] {
+                return !queue.empty() || !running.load(std::memory_order_acquire);
+            });
+            return queue.tryPop(frame);
+        }
+
+        void wake() {
+            {
+                // Empty critical section orders the push before the consumer's predicate check
+                std::lock_guard<std::mutex> lock(mutex);
+            }
+            ready.notify_all();
+        }
+    };
+
+    enum { kIdleWaitMs = 50 }; // consumers re-check the queue at least this often
+
+    bool runStage(size_t index, Frame &frame) {
+        StageSlot &stage = *stages_[index];
+        const int64_t begin = monotonicNs();
+        const bool ok = stage.fn(frame);
+        stage.busyNs.fetch_add(monotonicNs() - begin, std::memory_order_relaxed);
+        if (ok) stage.frames.fetch_add(1, std::memory_order_relaxed);
+        return ok;
+    }
+
+    void serialLoop() {
+        std::unique_ptr<Frame> frame;
+        Lane &input = *lanes_[0];
+        while (running()) {
+            if (!input.pop(frame, running_)) continue;
+            bool ok = true;
+            for (size_t i = 0; ok && i < stages_.size(); ++i) ok = runStage(i, *frame);
+            if (ok && sink_) sink_(std::move(frame));
+            frame.reset();
+        }
+    }
+
+    void pipelinedLoop(size_t index) {
+        std::unique_ptr<Frame> frame;
+        Lane &input = *lanes_[index];
+        const bool last = index + 1 == stages_.size();
+        while (running()) {
+            if (!input.pop(frame, running_)) continue;
+            if (runStage(index, *frame)) {
+                if (!last) {
+                    lanes_[index + 1]->push(std::move(frame));
+                } else if (sink_) {
+                    sink_(std::move(frame));
+                }
+            }
+            frame.reset();
+        }
+    }
+
+    std::vector<std::unique_ptr<StageSlot> > stages_;
+    std::vector<std::shared_ptr<Lane> > lanes_;
+    std::shared_ptr<Lane> input_; // lanes_[0], swapped atomically for push()
+    std::vector<std::thread> threads_;
+    Sink sink_;
+    std::atomic<bool> running_;
+    ExecutionMode mode_;
+    int64_t startNs_;
+};
+
+} // namespace ffddas
@@ -0,0 +1,123 @@
+#include "tile-delta.h"
+
+#include <opencv2/imgcodecs.hpp>
+
+#include <algorithm>
+
+namespace ffddas {
+
+// 32 px tiles, a keyframe every 2 s at 30 fps, noise floor above sensor and JPEG noise
+const TileDeltaParams kDefaultTileDeltaParams = {32, 60, 24, 0.5};
+
+namespace {
+
+void putU16(std::vector<uchar> &out, int value) {
+    out.push_back(static_cast<uchar>(value & 0xFF));
+    out.push_back(static_cast<uchar>((value >> 8) & 0xFF));
+}
+
+void putU32(std::vector<uchar> &out, size_t value) {
+    for (int shift = 0; shift < 32; shift += 8) out.push_back(static_cast<uchar>((value >> shift) & 0xFF));
+}
+
+bool imencodeJpeg(const cv::Mat &image, int quality, std::vector<uchar> &bytes) {
+    std::vector<int> params;
+    params.push_back(cv::IMWRITE_JPEG_QUALITY);
+    params.push_back(quality);
+    try {
+        return cv::imencode(".jpg", image, bytes, params);
+    } catch (const cv::Exception &) {
+        return false;
+    }
+}
+
+} // namespace
+
+TileDeltaEncoder::TileDeltaEncoder(const TileDeltaParams &params) : params_(params), sinceKeyframe_(0) {
+    params_.tileSize = std::max(params_.tileSize, 8);
+    params_.keyframeInterval = std::max(params_.keyframeInterval, 1);
+}
+
+int TileDeltaEncoder::tileCount(const cv::Mat &image) const {
+    const int size = params_.tileSize;
+    return ((image.cols + size - 1) / size) * ((image.rows + size - 1) / size);
+}
+
+bool TileDeltaEncoder::wantsKeyframe(const cv::Mat &image) const {
+    return reference_.empty() || reference_.size() != image.size() || reference_.type() != image.type() ||
+           sinceKeyframe_ + 1 >= params_.keyframeInterval;
+}
+
+void TileDeltaEncoder::reset() {
+    reference_.release();
+}
+
+bool TileDeltaEncoder::encode(const cv::Mat &image, int quality, bool forceKeyframe, std::vector<uchar> &out,
+                              TileDeltaResult &result, const std::vector<uchar> *keyframeJpeg) {
+    out.clear();
+    if (image.empty()) return false;
+    if (forceKeyframe || wantsKeyframe(image)) return keyframe(image, quality, out, result, keyframeJpeg);
+
+    // One pass over the whole frame, then a count per tile of the channel values that moved
+    cv::absdiff(image, reference_, diff_);
+    cv::compare(diff_.reshape(1), params_.pixelThreshold, changed_, cv::CMP_GT);
+    const int channels = image.channels();
+    const int size = params_.tileSize;
+    tiles_.clear();
+    for (int y = 0; y < image.rows; y += size) {
+        for (int x = 0; x < image.cols; x += size) {
+            const cv::Rect tile(x, y, std::min(size, image.cols - x), std::min(size, image.rows - y));
+            // A few changed pixels per tile are enough, so thin edges and small motion show up
+            const int minChanged = std::max(1, tile.area() / 256);
+            const cv::Rect values(tile.x * channels, tile.y, tile.width * channels, tile.height);
+            if (cv::countNonZero(changed_(values)) >= minChanged) tiles_.push_back(tile);
+        }
+    }
+
+    result.totalTiles = tileCount(image);
+    result.changedTiles = static_cast<int>(tiles_.size());
+    ++sinceKeyframe_;
+    if (tiles_.empty()) {
+        result.kind = kDeltaUnchanged;
+        return true;
+    }
+    if (tiles_.size() >= params_.keyframeFraction * result.totalTiles) {
+        return keyframe(image, quality, out, result, keyframeJpeg);
+    }
+
+    putU16(out, result.changedTiles);
+    for (size_t i = 0; i < tiles_.size(); ++i) {
+        const cv::Rect &tile = tiles_[i];
+        if (!imencodeJpeg(image(tile), quality, tileJpeg_)) {
+            reset();
+            return false;
+        }
+        putU16(out, tile.x);
+        putU16(out, tile.y);
+        putU16(out, tile.width);
+        putU16(out, tile.height);
+        putU32(out, tileJpeg_.size());
+        out.insert(out.end(), tileJpeg_.begin(), tileJpeg_.end());
+        image(tile).copyTo(reference_(tile));
+    }
+    result.kind = kDeltaTiles;
+    return true;
+}
+
+bool TileDeltaEncoder::keyframe(const cv::Mat &image, int quality, std::vector<uchar> &out,
+                                TileDeltaResult &result, const std::vector<uchar> *keyframeJpeg) {
+    if (keyframeJpeg != nullptr && !keyframeJpeg->empty()) {
+        out.assign(keyframeJpeg->begin(), keyframeJpeg->end());
+    } else if (!imencodeJpeg(image, quality, out)) {
+        reset();
+        return false;
+    }
+    image.copyTo(reference_);
+    sinceKeyframe_ = 0;
+    result.kind = kDeltaKeyframe;
+    result.totalTiles = tileCount(image);
+    result.changedTiles = result.totalTiles;
+    return true;
+}
+
+} // namespace ffddas
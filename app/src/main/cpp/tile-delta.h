@@ -0,0 +1,77 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+
+#include <vector>
+
+namespace ffddas {
+
+// What TileDeltaEncoder::encode() produced; values mirror TileDeltaEncoder.KIND_* in Kotlin
+enum TileDeltaKind {
+    kDeltaUnchanged = 0,  // nothing differs from what the client shows; no payload
+    kDeltaKeyframe = 1,   // the payload is a JPEG of the whole frame
+    kDeltaTiles = 2       // the payload holds only the changed tiles
+};
+
+struct TileDeltaParams {
+    int tileSize;            // tile edge in pixels; edge tiles are cropped to the frame
+    int keyframeInterval;    // a full frame at least every this many encodes
+    int pixelThreshold;      // a channel differing by more than this counts as changed (noise floor)
+    double keyframeFraction; // send a keyframe instead once this share of tiles changed
+};
+
+struct TileDeltaResult {
+    TileDeltaKind kind;
+    int changedTiles;        // all of them for a keyframe
+    int totalTiles;
+};
+
+extern const TileDeltaParams kDefaultTileDeltaParams;
+
+/**
+ * Delta encoder for one streaming client. It keeps the picture the client
+ * currently shows (the last keyframe with every tile sent since pasted in)
+ * and, per frame, JPEG-encodes only the tiles that differ from it by more
+ * than the noise floor. A keyframe is sent first, every keyframeInterval
+ * frames, on a size change, and whenever so much changed that one JPEG is
+ * cheaper than many tiles.
+ *
+ * kDeltaTiles payload, little-endian:
+ *   u16 tileCount, then per tile u16 x, u16 y, u16 width, u16 height, u32 jpegBytes, JPEG
+ *
+ * Works on the gray or BGR image imencode takes; not thread-safe, one per client.
+ */
+class TileDeltaEncoder {
+public:
+    explicit TileDeltaEncoder(const TileDeltaParams &params = kDefaultTileDeltaParams);
+
+    // True if the next encode() of image will be a keyframe whatever the content
+    bool wantsKeyframe(const cv::Mat &image) const;
+
+    // Writes the message payload for image to out (empty for kDeltaUnchanged). keyframeJpeg, if
+    // given, is this image already encoded at quality and is copied instead of encoding again.
+    // False if encoding failed; the next encode() is then a keyframe.
+    bool encode(const cv::Mat &image, int quality, bool forceKeyframe, std::vector<uchar> &out,
+                TileDeltaResult &result, const std::vector<uchar> *keyframeJpeg = nullptr);
+
+    // The next encode() is a keyframe
+    void reset();
+
+private:
+    TileDeltaEncoder(const TileDeltaEncoder &);
+    TileDeltaEncoder &operator=(const TileDeltaEncoder &);
+
+    bool keyframe(const cv::Mat &image, int quality, std::vector<uchar> &out,
+                  TileDeltaResult &result, const std::vector<uchar> *keyframeJpeg);
+    int tileCount(const cv::Mat &image) const;
+
+    TileDeltaParams params_;
+    cv::Mat reference_;            // what the client shows, at full resolution
+    cv::Mat diff_;
+    cv::Mat changed_;              // per channel value: differs by more than pixelThreshold
+    std::vector<cv::Rect> tiles_;  // changed tiles of the current frame
+    std::vector<uchar> tileJpeg_;
+    int sinceKeyframe_;
+};
+
+} // namespace ffddas
@@ -0,0 +1,63 @@
+#define LOG_TAG "WorkPool"
+
+#include "work-pool.h"
+#include "native-log.h"
+
+#include <opencv2/core.hpp>
+#include <opencv2/core/parallel/parallel_backend.hpp>
+
+namespace ffddas {
+
+namespace {
+
+// cv::parallel_for_ on top of workPool(). Thread 0 is whoever called parallel_for_,
+// workers are 1..n, matching getNumThreads() = workers + 1.
+class WorkPoolParallelBackend : public cv::parallel::ParallelForAPI {
+public:
+    void parallel_for(int tasks, FN_parallel_for_body_cb_t body_callback, void *callback_data) CV_OVERRIDE {
+        workPool().parallelFor(0, tasks, [&](int begin, int end) {
+            body_callback(begin, end, callback_data);
+        });
+    }
+
+    int getThreadNum() const CV_OVERRIDE {
+        return workPool().currentWorker() + 1;
+    }
+
+    int getNumThreads() const CV_OVERRIDE {
+        return workPool().workerCount() + 1;
+    }
+
+    int setNumThreads(int nThreads) CV_OVERRIDE {
+        // The pool is sized by configureWorkPool(); cv::setNumThreads() must not restart it under running work
+        const int current = getNumThreads();
+        if (nThreads != current) {
+            LOGW("Ignoring cv::setNumThreads(%d): ffddas work pool has %d threads", nThreads, current);
+        }
+        return current;
+    }
+
+    const char *getName() const CV_OVERRIDE {
+        return "ffddas";
+    }
+};
+
+} // namespace
+
+bool installWorkPoolAsOpenCvBackend() {
+    static bool installed = false;
+    if (installed) return true;
+    try {
+        std::shared_ptr<cv::parallel::ParallelForAPI> backend(new WorkPoolParallelBackend());
+        cv::parallel::setParallelForBackend(backend, false);
+    } catch (const cv::Exception &e) {
+        LOGE("Failed to install the work pool as OpenCV backend: %s", e.what());
+        return false;
+    }
+    installed = true;
+    workPool().setOpenCvBackend(true);
+    LOGI("cv::parallel_for_ now runs on the ffddas work pool (%d threads)", workPool().workerCount() + 1);
+    return true;
+}
+
+} // namespace ffddas
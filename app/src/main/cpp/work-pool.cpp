@@ -0,0 +1,348 @@
+#include "work-pool.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace ffddas {
+
+namespace {
+
+const int kSpinRounds = 64;        // yields before a worker with nothing to do parks
+const int kChunksPerThread = 4;    // default parallelFor split, leaves room for stealing
+
+thread_local const WorkStealingPool *tlsPool = nullptr;
+thread_local int tlsWorker = -1;
+// Crew the worker belongs to, so one that is being retired can tell its crew from the new one
+thread_local const void *tlsCrew = nullptr;
+
+bool pinCurrentThread(const std::vector<int> &cpus) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (size_t i = 0; i < cpus.size(); ++i) {
+        if (cpus[i] >= 0 && cpus[i] < CPU_SETSIZE) CPU_SET(cpus[i], &set);
+    }
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)cpus;
+    return false;
+#endif
+}
+
+} // namespace
+
+struct WorkStealingPool::Crew {
+    std::vector<std::unique_ptr<Worker> > workers;
+    std::vector<std::thread> threads;
+    std::vector<int> cpus;
+    std::atomic<bool> running;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<int> queued;   // tasks sitting in any of its deques
+    std::atomic<int> sleepers;
+
+    Crew() : running(true), queued(0), sleepers(0) {}
+};
+
+// One parallelFor() call. Shared with the helper tasks, which may only start after
+// every chunk is gone (they then touch nothing but the counters).
+struct WorkStealingPool::RangeJob {
+    const RangeBody *body;
+    int begin;
+    int end;
+    int chunkSize;
+    int chunks;
+    std::atomic<int> next;
+    std::atomic<int> done;
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::exception_ptr error; // first exception thrown by body, rethrown to the caller
+
+    RangeJob() : body(nullptr), begin(0), end(0), chunkSize(1), chunks(0), next(0), done(0) {}
+};
+
+WorkStealingPool::WorkStealingPool()
+        : workerCount_(0), pinnedCpus_(0), nextVictim_(0), openCvBackend_(false),
+          pinFailures_(0), submitted_(0), executed_(0), stolen_(0), parks_(0), failed_(0) {}
+
+WorkStealingPool::~WorkStealingPool() {
+    stop();
+}
+
+void WorkStealingPool::start(int workers, const std::vector<int> &cpus) {
+    std::lock_guard<std::mutex> lock(lifecycleMutex_);
+    if (workers < 0) workers = 0;
+    std::shared_ptr<Crew> old = std::atomic_load(&crew_);
+    if (old && static_cast<int>(old->workers.size()) == workers && old->cpus == cpus) return;
+    if (!old && workers == 0) return;
+
+    std::shared_ptr<Crew> crew;
+    if (workers > 0) {
+        crew = std::make_shared<Crew>();
+        crew->cpus = cpus;
+        for (int i = 0; i < workers; ++i) crew->workers.push_back(std::unique_ptr<Worker>(new Worker()));
+        pinFailures_.store(0);
+        for (int i = 0; i < workers; ++i) {
+            crew->threads.push_back(std::thread(&WorkStealingPool::workerLoop, this, crew, i));
+        }
+    }
+    std::atomic_store(&crew_, crew);
+    workerCount_.store(workers);
+    pinnedCpus_.store(crew ? static_cast<int64_t>(cpus.size()) : 0);
+    if (old) retire(*old);
+}
+
+void WorkStealingPool::retire(Crew &crew) {
+    // Close every deque first so a submit() that still holds the old crew retries on the new one
+    std::vector<Task> leftovers;
+    for (size_t i = 0; i < crew.workers.size(); ++i) {
+        Worker &worker = *crew.workers[i];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.retired = true;
+        for (size_t k = 0; k < worker.tasks.size(); ++k) leftovers.push_back(std::move(worker.tasks[k]));
+        crew.queued.fetch_sub(static_cast<int>(worker.tasks.size()));
+        worker.tasks.clear();
+    }
+    for (size_t i = 0; i < leftovers.size(); ++i) submit(leftovers[i]);
+
+    crew.running.store(false);
+    {
+        std::lock_guard<std::mutex> sleepLock(crew.sleepMutex);
+    }
+    crew.wake.notify_all();
+    // Running tasks finish first; anything they submit goes to the new crew
+    for (size_t i = 0; i < crew.threads.size(); ++i) crew.threads[i].join();
+    crew.threads.clear();
+}
+
+void WorkStealingPool::stop() {
+    start(0);
+}
+
+int WorkStealingPool::workerCount() const {
+    return workerCount_.load();
+}
+
+int WorkStealingPool::currentWorker() const {
+    if (tlsPool != this || tlsWorker < 0) return -1;
+    // A retiring worker is not one of the workerCount() slots any more
+    std::shared_ptr<Crew> crew = std::atomic_load(&crew_);
+    return crew && tlsCrew == crew.get() ? tlsWorker : -1;
+}
+
+void WorkStealingPool::wakeOne(Crew &crew) {
+    if (crew.sleepers.load() == 0) return;
+    {
+        // Empty critical section orders the push before a parking worker's predicate check
+        std::lock_guard<std::mutex> lock(crew.sleepMutex);
+    }
+    crew.wake.notify_one();
+}
+
+void WorkStealingPool::submit(const Task &task) {
+    for (;;) {
+        std::shared_ptr<Crew> crew = std::atomic_load(&crew_);
+        if (!crew) {
+            runTask(task);
+            return;
+        }
+        const int self = tlsPool == this && tlsCrew == crew.get() ? tlsWorker : -1;
+        const size_t target = self >= 0 ? static_cast<size_t>(self)
+                                        : nextVictim_.fetch_add(1, std::memory_order_relaxed) % crew->workers.size();
+        Worker &worker = *crew->workers[target];
+        {
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            // Lost a race with start(): the replacement crew is already published
+            if (worker.retired) continue;
+            worker.tasks.push_back(task);
+            crew->queued.fetch_add(1);
+        }
+        submitted_.fetch_add(1, std::memory_order_relaxed);
+        wakeOne(*crew);
+        return;
+    }
+}
+
+bool WorkStealingPool::popOwn(Crew &crew, int index, Task &task) {
+    Worker &worker = *crew.workers[index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.tasks.empty()) return false;
+    task = std::move(worker.tasks.back());
+    worker.tasks.pop_back();
+    crew.queued.fetch_sub(1);
+    return true;
+}
+
+bool WorkStealingPool::steal(Crew &crew, int thief, Task &task) {
+    const int n = static_cast<int>(crew.workers.size());
+    for (int k = 1; k <= n; ++k) {
+        const int victim = ((thief < 0 ? 0 : thief) + k) % n;
+        if (victim == thief) continue;
+        Worker &worker = *crew.workers[victim];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.tasks.empty()) continue;
+        // Oldest first: the owner is working on the other end
+        task = std::move(worker.tasks.front());
+        worker.tasks.pop_front();
+        crew.queued.fetch_sub(1);
+        stolen_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+bool WorkStealingPool::runOne(Crew &crew, int self) {
+    if (crew.queued.load() <= 0) return false;
+    Task task;
+    if (!(self >= 0 && popOwn(crew, self, task)) && !steal(crew, self, task)) return false;
+    runTask(task);
+    return true;
+}
+
+void WorkStealingPool::runTask(const Task &task) {
+    // Nobody is left to catch it: an escaping exception would terminate the process
+    try {
+        task();
+    } catch (...) {
+        failed_.fetch_add(1, std::memory_order_relaxed);
+    }
+    executed_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void WorkStealingPool::workerLoop(std::shared_ptr<Crew> crew, int index) {
+    tlsPool = this;
+    tlsCrew = crew.get();
+    tlsWorker = index;
+    if (!crew->cpus.empty() && !pinCurrentThread(crew->cpus)) {
+        pinFailures_.fetch_add(1, std::memory_order_relaxed);
+    }
+    while (crew->running.load()) {
+        if (runOne(*crew, index)) continue;
+        int spins = 0;
+        while (spins < kSpinRounds && crew->queued.load() <= 0 && crew->running.load()) {
+            std::this_thread::yield();
+            ++spins;
+        }
+        if (spins < kSpinRounds) continue;
+
+        crew->sleepers.fetch_add(1);
+        {
+            std::unique_lock<std::mutex> lock(crew->sleepMutex);
+            Crew *c = crew.get();
+            crew->wake.wait(lock, [c] { return c->queued.load() > 0 || !c->running.load(); });
+        }
+        crew->sleepers.fetch_sub(1);
+        parks_.fetch_add(1, std::memory_order_relaxed);
+    }
+    tlsPool = nullptr;
+    tlsCrew = nullptr;
+    tlsWorker = -1;
+}
+
+void WorkStealingPool::runRange(RangeJob &job) {
+    for (;;) {
+        const int chunk = job.next.fetch_add(1);
+        if (chunk >= job.chunks) return;
+        const int from = job.begin + chunk * job.chunkSize;
+        const int to = std::min(job.end, from + job.chunkSize);
+        try {
+            (*job.body)(from, to);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(job.mutex);
+            if (!job.error) job.error = std::current_exception();
+        }
+        if (job.done.fetch_add(1) + 1 == job.chunks) {
+            std::lock_guard<std::mutex> lock(job.mutex);
+            job.finished.notify_all();
+        }
+    }
+}
+
+void WorkStealingPool::parallelFor(int begin, int end, const RangeBody &body, int grain) {
+    if (end <= begin) return;
+    const int count = end - begin;
+    const int threads = workerCount() + 1;
+    if (grain <= 0) grain = std::max(1, count / (threads * kChunksPerThread));
+    if (threads == 1 || count <= grain) {
+        body(begin, end);
+        return;
+    }
+
+    std::shared_ptr<RangeJob> job = std::make_shared<RangeJob>();
+    job->body = &body;
+    job->begin = begin;
+    job->end = end;
+    job->chunkSize = grain;
+    job->chunks = (count + grain - 1) / grain;
+
+    // One helper per worker at most; each keeps taking chunks until none are left
+    const int helpers = std::min(workerCount(), job->chunks - 1);
+    for (int i = 0; i < helpers; ++i) {
+        submit([job] { runRange(*job); });
+    }
+    runRange(*job);
+
+    // A worker waiting on its own nested loop keeps executing tasks so it cannot starve the helpers.
+    // Its own crew, even if it is being retired: the helpers may have been queued there.
+    Crew *own = tlsPool == this ? static_cast<Crew *>(const_cast<void *>(tlsCrew)) : nullptr;
+    while (job->done.load() < job->chunks) {
+        if (own != nullptr && runOne(*own, tlsWorker)) continue;
+        std::unique_lock<std::mutex> lock(job->mutex);
+        job->finished.wait(lock, [&] { return job->done.load() >= job->chunks; });
+    }
+    if (job->error) std::rethrow_exception(job->error);
+}
+
+WorkPoolStats WorkStealingPool::stats() const {
+    WorkPoolStats s;
+    s.workers = workerCount();
+    s.pinnedCpus = pinnedCpus_.load();
+    s.pinFailures = pinFailures_.load(std::memory_order_relaxed);
+    s.openCvBackend = openCvBackend_.load() ? 1 : 0;
+    s.submitted = submitted_.load(std::memory_order_relaxed);
+    s.executed = executed_.load(std::memory_order_relaxed);
+    s.stolen = stolen_.load(std::memory_order_relaxed);
+    s.parks = parks_.load(std::memory_order_relaxed);
+    s.failed = failed_.load(std::memory_order_relaxed);
+    return s;
+}
+
+std::vector<int> WorkStealingPool::fastestCpus() {
+    std::vector<int> cpus;
+    long best = 0;
+    const int possible = std::max(1u, std::thread::hardware_concurrency());
+    for (int cpu = 0; cpu < possible; ++cpu) {
+        char path[96];
+        std::snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/cpuinfo_max_freq", cpu);
+        FILE *f = std::fopen(path, "r");
+        if (f == nullptr) continue;
+        long khz = 0;
+        const bool ok = std::fscanf(f, "%ld", &khz) == 1;
+        std::fclose(f);
+        if (!ok || khz <= 0) continue;
+        if (khz > best) {
+            best = khz;
+            cpus.clear();
+        }
+        if (khz == best) cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+int WorkStealingPool::defaultWorkerCount() {
+    const int cores = static_cast<int>(std::thread::hardware_concurrency());
+    return cores > 2 ? cores - 1 : 1;
+}
+
+WorkStealingPool &workPool() {
+    // Intentionally leaked like framePool(): OpenCV may still call into it during static destruction
+    static WorkStealingPool *pool = new WorkStealingPool();
+    return *pool;
+}
+
+} // namespace ffddas
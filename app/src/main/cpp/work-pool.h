@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ffddas {
+
+struct WorkPoolStats {
+    int64_t workers;
+    int64_t pinnedCpus;     // CPUs the workers are restricted to, 0 = not pinned
+    int64_t pinFailures;    // workers sched_setaffinity refused (they run unpinned)
+    int64_t openCvBackend;  // 1 if cv::parallel_for_ runs on this pool
+    int64_t submitted;      // tasks pushed (parallelFor pushes at most one helper per worker)
+    int64_t executed;
+    int64_t stolen;         // tasks a worker took from another worker's deque
+    int64_t parks;          // times a worker found nothing to do and went to sleep
+    int64_t failed;         // tasks that threw; the exception is swallowed so the worker survives
+};
+
+/**
+ * The one set of threads libffddas uses for data-parallel work.
+ *
+ * Each worker owns a deque: it pushes and pops its own tasks at the back (hot
+ * in cache) and, when empty, steals from the front of the others' before
+ * sleeping. Tasks submitted from outside are spread round-robin. parallelFor()
+ * hands out chunks from a shared counter and the calling thread works too,
+ * so nested calls from inside a task cannot deadlock.
+ *
+ * Workers can be pinned to a CPU set (e.g. the big cores) with
+ * sched_setaffinity. Free of OpenCV and Android so the host benchmark can use it.
+ */
+class WorkStealingPool {
+public:
+    typedef std::function<void()> Task;
+    typedef std::function<void(int, int)> RangeBody; // [begin, end)
+
+    WorkStealingPool();
+    ~WorkStealingPool();
+
+    // (Re)starts with this many workers; cpus empty = no pinning. A no-op when both match
+    // the running set. Otherwise new workers take over: tasks still queued on the old ones
+    // move to them (or run on the caller if there are none) and running tasks finish first.
+    // Safe while work is in flight, but must not be called from a pool worker.
+    void start(int workers, const std::vector<int> &cpus = std::vector<int>());
+    void stop();
+
+    int workerCount() const;
+    // 0..workerCount()-1 on a pool worker, -1 on any other thread
+    int currentWorker() const;
+
+    // Runs task on some worker; runs it inline if the pool has no workers. Exceptions
+    // escaping task are caught and counted in stats().failed.
+    void submit(const Task &task);
+
+    // Calls body over [begin, end) split into chunks of at least grain items and
+    // returns once all of them finished. grain <= 0 picks about 4 chunks per thread.
+    void parallelFor(int begin, int end, const RangeBody &body, int grain = 0);
+
+    WorkPoolStats stats() const;
+    void setOpenCvBackend(bool installed) { openCvBackend_.store(installed); }
+
+    // CPUs with the highest cpuinfo_max_freq (the big cluster); empty if unknown
+    static std::vector<int> fastestCpus();
+    // One thread per core minus the caller's, at least one
+    static int defaultWorkerCount();
+
+private:
+    WorkStealingPool(const WorkStealingPool &);
+    WorkStealingPool &operator=(const WorkStealingPool &);
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        bool retired; // set under mutex once the crew is replaced; pushes must go elsewhere
+
+        Worker() : retired(false) {}
+    };
+    // One set of workers. Never changes once published; start() swaps in a new one, so
+    // submit() and stats can read it without holding the lifecycle lock.
+    struct Crew;
+    struct RangeJob;
+
+    void workerLoop(std::shared_ptr<Crew> crew, int index);
+    void retire(Crew &crew);
+    static bool popOwn(Crew &crew, int index, Task &task);
+    bool steal(Crew &crew, int thief, Task &task);
+    bool runOne(Crew &crew, int self); // pops or steals one task and runs it
+    void runTask(const Task &task);
+    static void wakeOne(Crew &crew);
+    static void runRange(RangeJob &job);
+
+    std::shared_ptr<Crew> crew_;   // read and swapped with std::atomic_load/atomic_store only
+    std::mutex lifecycleMutex_;    // serializes start()/stop()
+    std::atomic<int> workerCount_; // crew_'s size, for the hot paths that only need that
+    std::atomic<int64_t> pinnedCpus_;
+    std::atomic<unsigned> nextVictim_; // round-robin target for outside submissions
+
+    std::atomic<bool> openCvBackend_;
+    std::atomic<int64_t> pinFailures_;
+    std::atomic<int64_t> submitted_;
+    std::atomic<int64_t> executed_;
+    std::atomic<int64_t> stolen_;
+    std::atomic<int64_t> parks_;
+    std::atomic<int64_t> failed_;
+};
+
+// Process-wide pool; JNI_OnLoad starts it with defaultWorkerCount() workers
+WorkStealingPool &workPool();
+
+// Routes cv::parallel_for_ to workPool(). Not thread-safe on OpenCV's side:
+// call once, before any OpenCV work is in flight. Defined in work-pool-backend.cpp.
+bool installWorkPoolAsOpenCvBackend();
+
+} // namespace ffddas
@@ -0,0 +1,78 @@
+package com.example.ffddas
+
+import androidx.camera.core.ImageProxy
+
+/**
+ * Kotlin side of the native async preview pipeline.
+ *
+ * submit() copies the camera planes into the native queue and returns, so the
+ * ImageProxy can be closed right away. Finished frames are published on the
+ * native FrameBus, and its "display" listener thread calls [onResult] with
+ * each lease without copying the pixels. The lease is released when
+ * [onResult] returns unless it calls retain(); while it is retained, newer
+ * frames are coalesced into the latest one. The input queue keeps only the
+ * newest frame too.
+ *
+ * [executionMode] picks NativeOpenCVHelper.ASYNC_MODE_LOW_LATENCY (one worker,
+ * shortest time per frame) or ASYNC_MODE_HIGH_THROUGHPUT (a worker per stage,
+ * more frames per second on multi-core devices at the cost of hand-off latency).
+ * A non-zero [latencyBudgetMs] lets the native scheduler trade resolution and
+ * filter quality for time, and skip frames, to stay under that latency.
+ */
+class AsyncFramePipeline(
+    private val capacity: Int = DEFAULT_CAPACITY,
+    private val executionMode: Int = NativeOpenCVHelper.ASYNC_MODE_LOW_LATENCY,
+    private val latencyBudgetMs: Int = 0,
+    private val onResult: (FrameBus.Lease) -> Unit
+) : AutoCloseable {
+
+    @Volatile private var listener: FrameBus.Listener? = null
+
+    @Synchronized
+    fun start(): Boolean {
+        if (listener != null) return true
+        if (!NativeOpenCVHelper.startAsync(capacity, executionMode)) return false
+        NativeOpenCVHelper.setLatencyTarget(latencyBudgetMs)
+        val display = FrameBus.Listener(DISPLAY_SUBSCRIBER, FrameBus.LIVE_PREVIEW, 1, onResult)
+        if (!display.isOpen) {
+            NativeOpenCVHelper.stopAsync()
+            return false
+        }
+        listener = display
+        return true
+    }
+
+    val isRunning: Boolean get() = listener != null
+
+    /**
+     * Queue a frame; call from the camera executor only (the native queue is single-producer)
+     * @return true if the frame was queued or deliberately skipped by the latency scheduler,
+     *         false if the caller should process it itself
+     */
+    fun submit(image: ImageProxy, outputFormat: Int): Boolean {
+        if (listener == null) return false
+        val planes = image.planes
+        if (planes.size < 3) return false
+        // YUV_420_888 guarantees identical strides for U and V
+        val sequence = NativeOpenCVHelper.submitAsyncFrame(
+            planes[0].buffer, planes[1].buffer, planes[2].buffer,
+            image.width, image.height,
+            planes[0].rowStride, planes[1].rowStride, planes[1].pixelStride,
+            image.imageInfo.rotationDegrees, outputFormat, image.imageInfo.timestamp
+        )
+        return sequence >= 0
+    }
+
+    @Synchronized
+    override fun close() {
+        val display = listener ?: return
+        listener = null
+        NativeOpenCVHelper.stopAsync()
+        display.close()
+    }
+
+    companion object {
+        const val DEFAULT_CAPACITY = 2
+        const val DISPLAY_SUBSCRIBER = "display"
+    }
+}
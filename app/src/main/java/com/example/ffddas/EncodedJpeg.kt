@@ -0,0 +1,58 @@
+package com.example.ffddas
+
+import java.io.InputStream
+import java.nio.ByteBuffer
+import java.util.concurrent.atomic.AtomicBoolean
+
+/**
+ * A frame's JPEG from the native encode-once cache (see jpeg-cache.h). [bytes]
+ * is a read-only view of the cached native buffer, shared with every other
+ * request for the same frame, and stays valid until [close].
+ */
+class EncodedJpeg internal constructor(
+    private val token: Long,
+    buffer: ByteBuffer,
+    val sequence: Long,
+    val width: Int,
+    val height: Int,
+    val encodedNow: Boolean // false when another request already encoded this frame
+) : AutoCloseable {
+    private val released = AtomicBoolean(false)
+    val bytes: ByteBuffer = buffer.asReadOnlyBuffer()
+    val size: Int get() = bytes.capacity()
+
+    /**
+     * Streams the bytes without copying them to the heap first; closing the stream closes
+     * this JPEG, so hand it to a response that closes its body once it has been sent
+     */
+    fun inputStream(): InputStream = object : InputStream() {
+        private val source = bytes.duplicate()
+
+        override fun read(): Int = if (source.hasRemaining()) source.get().toInt() and 0xFF else -1
+
+        override fun read(b: ByteArray, off: Int, len: Int): Int {
+            if (len == 0) return 0
+            if (!source.hasRemaining()) return -1
+            val count = minOf(len, source.remaining())
+            source.get(b, off, count)
+            return count
+        }
+
+        override fun available(): Int = source.remaining()
+
+        override fun close() = this@EncodedJpeg.close()
+    }
+
+    override fun close() {
+        if (released.compareAndSet(false, true)) NativeOpenCVHelper.releaseJpegBuffer(token)
+    }
+
+    companion object {
+        // Values written by NativeOpenCVHelper.encodeBusFrameJpeg()
+        internal const val META_SIZE = 6
+
+        internal fun fromMeta(buffer: ByteBuffer, meta: LongArray) = EncodedJpeg(
+            meta[0], buffer, meta[1], meta[4].toInt(), meta[5].toInt(), meta[3] != 0L
+        )
+    }
+}
@@ -0,0 +1,195 @@
+package com.example.ffddas
+
+import android.util.Log
+import androidx.annotation.Keep
+import java.nio.ByteBuffer
+import java.util.concurrent.atomic.AtomicInteger
+
+/**
+ * Kotlin side of the native frame bus: every frame the live preview or a
+ * PipelineStream finishes is published once, and each subscriber (display, web server, ...) reads the
+ * same native pixels through a [Lease] instead of its own copy.
+ *
+ * A subscription has its own bounded queue, so a slow reader only loses its
+ * own frames. Pixels go back to the native pool when the last lease and the
+ * last queued reference are gone, so close leases promptly.
+ */
+object FrameBus {
+    private const val TAG = "FrameBus"
+
+    /** A full queue evicts its oldest frame: always the newest picture (display, HTTP) */
+    const val DROP_OLDEST = 0
+    /** A full queue refuses new frames until the reader catches up (recorder) */
+    const val DROP_NEWEST = 1
+
+    /** Channel of the live preview pipeline; PipelineStream frames use the stream's id */
+    const val LIVE_PREVIEW = 0
+
+    private const val META_SIZE = 12 + FrameTiming.STAMP_COUNT
+
+    private fun lease(buffer: ByteBuffer, meta: LongArray) = Lease(
+        meta[0], buffer, meta[2].toInt(), meta[3].toInt(), meta[4].toInt(), meta[5].toInt(), meta[6].toInt(),
+        meta[9], meta[10],
+        FrameTiming(meta[1], meta[7], meta[11], meta[8], meta.copyOfRange(12, META_SIZE))
+    )
+
+    /**
+     * One pinned frame. [pixels] is a read-only view of native memory and must not be
+     * touched after the last [release]; [retain] lets another thread share the lease.
+     */
+    class Lease internal constructor(
+        internal val token: Long,
+        buffer: ByteBuffer,
+        val width: Int,
+        val height: Int,
+        val format: Int,
+        val rowStride: Int,
+        val rotationDegrees: Int,
+        val queueLatencyNs: Long,
+        val processNs: Long,
+        val timing: FrameTiming // sequence, sensor timestamp, config version and stage stamps
+    ) : AutoCloseable {
+        private val refs = AtomicInteger(1)
+        val pixels: ByteBuffer = buffer.asReadOnlyBuffer()
+
+        val sequence: Long get() = timing.sequence
+        val timestampNs: Long get() = timing.sensorTimestampNs
+        // NativeOpenCVHelper.publishConfig() version the frame was processed with
+        val configVersion: Long get() = timing.configVersion
+
+        /** True when rows are packed back to back, i.e. the layout ProcessedFrame expects */
+        val isTight: Boolean get() = rowStride == NativeOpenCVHelper.rowStride(format, width)
+
+        /** Take another reference; false if the lease was already released */
+        fun retain(): Boolean {
+            while (true) {
+                val current = refs.get()
+                if (current <= 0) return false
+                if (refs.compareAndSet(current, current + 1)) return true
+            }
+        }
+
+        fun release() {
+            if (refs.decrementAndGet() == 0) NativeOpenCVHelper.releaseBusFrame(token)
+        }
+
+        override fun close() = release()
+
+        /**
+         * This frame as JPEG from the native encode-once cache: only the first request for a
+         * frame and size encodes it. The lease may be released right after; the JPEG stays valid until closed.
+         * @param scaleDivisor One of NativeOpenCVHelper.JPEG_SCALE_DIVISORS
+         */
+        fun encodeJpeg(quality: Int, scaleDivisor: Int = 1): EncodedJpeg? {
+            val meta = LongArray(EncodedJpeg.META_SIZE)
+            val buffer = NativeOpenCVHelper.encodeJpeg(token, quality, scaleDivisor, meta) ?: return null
+            return EncodedJpeg.fromMeta(buffer, meta)
+        }
+
+        /** This frame in the compact edge map wire format, or null if it is not a binary edge map */
+        fun encodeEdges(): ByteArray? = NativeOpenCVHelper.encodeEdgeMap(token)
+
+        /** This frame's edges as simplified polylines (edge-contours.h), or null on error */
+        fun traceContours(
+            epsilon: Double,
+            cannyLow: Double = NativeOpenCVHelper.DEFAULT_CANNY_LOW,
+            cannyHigh: Double = NativeOpenCVHelper.DEFAULT_CANNY_HIGH
+        ): ByteArray? =
+            NativeOpenCVHelper.traceContours(token, epsilon, cannyLow, cannyHigh)
+
+        /** Packs the rows into a heap ProcessedFrame; for consumers that need a ByteArray */
+        fun copyToFrame(): ProcessedFrame {
+            val tightStride = NativeOpenCVHelper.rowStride(format, width)
+            val data = ByteArray(tightStride * height)
+            val source = pixels.duplicate()
+            if (rowStride == tightStride) {
+                source.get(data)
+            } else {
+                for (row in 0 until height) {
+                    source.position(row * rowStride)
+                    source.get(data, row * tightStride, tightStride)
+                }
+            }
+            return ProcessedFrame(data, width, height, format)
+        }
+    }
+
+    /**
+     * A named native subscriber to one pipeline's frames ([LIVE_PREVIEW] or a PipelineStream id).
+     * [next] is meant for a single reading thread; [close] wakes it and releases anything still queued.
+     */
+    class Subscription(
+        val name: String,
+        capacity: Int = 1,
+        policy: Int = DROP_OLDEST,
+        val stream: Int = LIVE_PREVIEW
+    ) : AutoCloseable {
+        @Volatile private var id = NativeOpenCVHelper.subscribeFrames(name, capacity, policy, stream)
+        private val meta = LongArray(META_SIZE)
+
+        val isOpen: Boolean get() = id > 0
+
+        /** Wait up to [timeoutMs] for the next frame; null on timeout, [interrupt] or close */
+        fun next(timeoutMs: Long): Lease? {
+            val subscription = id
+            if (subscription <= 0) return null
+            val buffer = NativeOpenCVHelper.nextBusFrame(subscription, timeoutMs, meta) ?: return null
+            return lease(buffer, meta)
+        }
+
+        fun interrupt() {
+            val subscription = id
+            if (subscription > 0) NativeOpenCVHelper.interruptFrames(subscription)
+        }
+
+        @Synchronized
+        override fun close() {
+            val subscription = id
+            if (subscription <= 0) return
+            id = -1
+            NativeOpenCVHelper.unsubscribeFrames(subscription)
+        }
+    }
+
+    /**
+     * Push delivery of one pipeline's frames: a native thread, attached to the VM once,
+     * calls [onFrame] with each new frame, so nothing polls. The lease is released when
+     * [onFrame] returns unless it calls retain(), e.g. to draw on the UI thread.
+     *
+     * At most [maxInFlight] leases are out at a time. While the consumer still holds them,
+     * newer frames are coalesced natively into the latest one (counted as "coalesced" in
+     * NativeOpenCVHelper.frameListenerStats()), so a slow UI never backs up the pipeline.
+     */
+    class Listener(
+        val name: String,
+        stream: Int = LIVE_PREVIEW,
+        maxInFlight: Int = 1,
+        private val onFrame: (Lease) -> Unit
+    ) : AutoCloseable {
+        @Volatile private var id = NativeOpenCVHelper.registerListener(this, stream, maxInFlight)
+
+        val isOpen: Boolean get() = id > 0
+
+        // Called from native on the listener thread; meta is only valid during the call
+        @Keep
+        fun onNativeFrame(buffer: ByteBuffer, meta: LongArray) {
+            val lease = lease(buffer, meta)
+            try {
+                onFrame(lease)
+            } catch (e: Throwable) {
+                Log.e(TAG, "Listener '$name' failed on frame ${lease.sequence}", e)
+            } finally {
+                lease.release()
+            }
+        }
+
+        /** Stops deliveries; waits for a callback in progress unless called from inside one */
+        @Synchronized
+        override fun close() {
+            val listener = id
+            if (listener <= 0) return
+            id = -1
+            NativeOpenCVHelper.unregisterListener(listener)
+        }
+    }
+}
@@ -0,0 +1,124 @@
+package com.example.ffddas
+
+/**
+ * Latency distributions of displayed and served frames, built from the
+ * FrameTiming stamps the native pipeline carries plus the moment Kotlin shows
+ * or sends the frame. The sensor-based figures are true end-to-end latencies
+ * (capture to screen, capture to browser); the stage figures split them up.
+ */
+object FrameLatency {
+    const val SENSOR_TO_INGEST = "sensorToIngest"       // camera HAL and CameraX delivery
+    const val QUEUE = "queue"                           // ingest -> first stage
+    const val CONVERT = "convert"
+    const val DETECT = "detect"
+    const val COMPOSITE = "composite"
+    const val INGEST_TO_PUBLISH = "ingestToPublish"     // all native processing
+    const val PUBLISH_TO_DISPLAY = "publishToDisplay"   // delivery, Bitmap copy, UI thread, next frame
+    const val SENSOR_TO_DISPLAY = "sensorToDisplay"
+    const val SENSOR_TO_SERVED = "sensorToServed"       // until the HTTP response was handed over
+    const val SENSOR_TO_BROWSER = "sensorToBrowser"     // as reported back by the web viewer
+
+    private val histograms = linkedMapOf(
+        SENSOR_TO_INGEST to LatencyHistogram(),
+        QUEUE to LatencyHistogram(),
+        CONVERT to LatencyHistogram(),
+        DETECT to LatencyHistogram(),
+        COMPOSITE to LatencyHistogram(),
+        INGEST_TO_PUBLISH to LatencyHistogram(),
+        PUBLISH_TO_DISPLAY to LatencyHistogram(),
+        SENSOR_TO_DISPLAY to LatencyHistogram(),
+        SENSOR_TO_SERVED to LatencyHistogram(),
+        SENSOR_TO_BROWSER to LatencyHistogram()
+    )
+
+    private fun record(name: String, ns: Long) {
+        if (ns >= 0) histograms[name]?.record(ns)
+    }
+
+    /** The frame became visible on screen at [nowNs]; also records its native stages */
+    fun recordDisplayed(timing: FrameTiming, nowNs: Long = System.nanoTime()) {
+        val sensorNs = timing.sensorMonotonicNs
+        if (sensorNs > 0 && timing.ingestNs != 0L) record(SENSOR_TO_INGEST, timing.ingestNs - sensorNs)
+        record(QUEUE, timing.between(FrameTiming.STAMP_INGEST, FrameTiming.STAMP_STARTED))
+        record(CONVERT, timing.between(FrameTiming.STAMP_STARTED, FrameTiming.STAMP_CONVERTED))
+        record(DETECT, timing.between(FrameTiming.STAMP_CONVERTED, FrameTiming.STAMP_DETECTED))
+        record(COMPOSITE, timing.between(FrameTiming.STAMP_DETECTED, FrameTiming.STAMP_COMPOSITED))
+        record(INGEST_TO_PUBLISH, timing.between(FrameTiming.STAMP_INGEST, FrameTiming.STAMP_PUBLISHED))
+        if (timing.publishedNs != 0L) record(PUBLISH_TO_DISPLAY, nowNs - timing.publishedNs)
+        record(SENSOR_TO_DISPLAY, timing.sensorAgeNs(nowNs))
+    }
+
+    /** The frame's HTTP response was handed to the server at [nowNs] */
+    fun recordServed(timing: FrameTiming, nowNs: Long = System.nanoTime()) {
+        record(SENSOR_TO_SERVED, timing.sensorAgeNs(nowNs))
+    }
+
+    /** A capture-to-draw latency measured by the web viewer */
+    fun recordBrowser(ms: Double) {
+        if (ms >= 0 && ms < MAX_REPORTED_MS) record(SENSOR_TO_BROWSER, (ms * 1_000_000).toLong())
+    }
+
+    /** Median sensor-to-display latency in ms, or null before the first displayed frame */
+    fun displayMedianMs(): Double? = histograms[SENSOR_TO_DISPLAY]?.percentileMs(50.0)
+
+    /** count, meanMs, p50Ms, p90Ms, p99Ms and maxMs per distribution */
+    fun snapshot(): Map<String, Any> = histograms.mapValues { it.value.snapshot() }
+
+    fun reset() = histograms.values.forEach { it.reset() }
+
+    private const val MAX_REPORTED_MS = 60_000.0
+}
+
+/**
+ * Fixed 1 ms buckets up to [LIMIT_MS], then one overflow bucket; percentiles are
+ * bucket upper bounds, mean and max are exact. Cheap enough to record every frame.
+ */
+class LatencyHistogram {
+    private val buckets = LongArray(LIMIT_MS + 1)
+    private var count = 0L
+    private var sumNs = 0L
+    private var maxNs = 0L
+
+    @Synchronized
+    fun record(ns: Long) {
+        val bucket = (ns / 1_000_000).coerceIn(0, LIMIT_MS.toLong()).toInt()
+        buckets[bucket]++
+        count++
+        sumNs += ns
+        if (ns > maxNs) maxNs = ns
+    }
+
+    @Synchronized
+    fun percentileMs(percentile: Double): Double? {
+        if (count == 0L) return null
+        val rank = kotlin.math.ceil(count * percentile / 100.0).toLong().coerceAtLeast(1)
+        var seen = 0L
+        for (i in buckets.indices) {
+            seen += buckets[i]
+            if (seen >= rank) return if (i == LIMIT_MS) maxNs / 1e6 else (i + 1).toDouble()
+        }
+        return maxNs / 1e6
+    }
+
+    @Synchronized
+    fun snapshot(): Map<String, Any> = linkedMapOf(
+        "count" to count,
+        "meanMs" to if (count > 0) Math.round(sumNs / count / 1e4) / 100.0 else 0.0,
+        "p50Ms" to (percentileMs(50.0) ?: 0.0),
+        "p90Ms" to (percentileMs(90.0) ?: 0.0),
+        "p99Ms" to (percentileMs(99.0) ?: 0.0),
+        "maxMs" to Math.round(maxNs / 1e4) / 100.0
+    )
+
+    @Synchronized
+    fun reset() {
+        buckets.fill(0)
+        count = 0
+        sumNs = 0
+        maxNs = 0
+    }
+
+    companion object {
+        const val LIMIT_MS = 2000
+    }
+}
@@ -0,0 +1,55 @@
+package com.example.ffddas
+
+/**
+ * Identity and timing of one camera frame as the native pipeline recorded it
+ * (see frame-descriptor.h). Every stamp is on the steady clock, the same one
+ * as System.nanoTime(), so Kotlin can add its own display or send stamps and
+ * subtract. A stamp of 0 means the frame never passed that point.
+ */
+class FrameTiming(
+    val sequence: Long,
+    val sensorTimestampNs: Long, // ImageProxy.imageInfo.timestamp, untouched
+    val sensorMonotonicNs: Long, // the sensor instant on System.nanoTime()'s clock, 0 if unknown
+    val configVersion: Long,
+    private val stampsNs: LongArray // indexed by STAMP_*
+) {
+    fun stampNs(point: Int): Long = stampsNs.getOrElse(point) { 0L }
+
+    val ingestNs: Long get() = stampNs(STAMP_INGEST)
+    val publishedNs: Long get() = stampNs(STAMP_PUBLISHED)
+
+    /** Nanoseconds from [from] to [to], or -1 unless both stamps were taken */
+    fun between(from: Int, to: Int): Long {
+        val start = stampNs(from)
+        val end = stampNs(to)
+        return if (start != 0L && end != 0L) end - start else -1L
+    }
+
+    /** How long ago the sensor captured the frame, or -1 if its clock is unknown */
+    fun sensorAgeNs(nowNs: Long = System.nanoTime()): Long =
+        if (sensorMonotonicNs > 0) nowNs - sensorMonotonicNs else -1L
+
+    companion object {
+        // Values mirror FrameStamp in frame-descriptor.h
+        const val STAMP_INGEST = 0
+        const val STAMP_STARTED = 1
+        const val STAMP_CONVERTED = 2
+        const val STAMP_DETECTED = 3
+        const val STAMP_COMPOSITED = 4
+        const val STAMP_PUBLISHED = 5
+        const val STAMP_COUNT = 6
+
+        /**
+         * Timing for a frame processed synchronously on the camera thread, which only
+         * has ingest and publish stamps
+         */
+        fun synchronous(sequence: Long, sensorTimestampNs: Long, ingestNs: Long, publishedNs: Long): FrameTiming {
+            val stamps = LongArray(STAMP_COUNT)
+            stamps[STAMP_INGEST] = ingestNs
+            stamps[STAMP_PUBLISHED] = publishedNs
+            return FrameTiming(
+                sequence, sensorTimestampNs, NativeOpenCVHelper.sensorToMonotonic(sensorTimestampNs), 0, stamps
+            )
+        }
+    }
+}
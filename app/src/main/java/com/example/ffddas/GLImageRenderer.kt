@@ -65,6 +65,28 @@ class GLImageRenderer : GLSurfaceView.Renderer {
                 }\n
             }\n
         """
+
+        // Fragment shader for 1-bit packed edge maps uploaded as a LUMINANCE texture
+        // of rowStride bytes per row; picks the bit (MSB first) under each pixel
+        private const val FRAGMENT_SHADER_PACKED = """
+            #ifdef GL_FRAGMENT_PRECISION_HIGH
+            precision highp float;
+            #else
+            precision mediump float;
+            #endif
+            varying vec2 vTexCoord;
+            uniform sampler2D uTexture;
+            uniform float uImageWidth;
+            uniform float uRowBytes;
+            void main(){
+                float x = min(floor(vTexCoord.x * uImageWidth), uImageWidth - 1.0);
+                float byteIndex = floor(x / 8.0);
+                float bit = 7.0 - (x - byteIndex * 8.0);
+                float value = floor(texture2D(uTexture, vec2((byteIndex + 0.5) / uRowBytes, vTexCoord.y)).r * 255.0 + 0.5);
+                float on = mod(floor(value / exp2(bit)), 2.0);
+                gl_FragColor = vec4(on, on, on, 1.0);
+            }
+        """
     }
 
     // Quad geometry (X,Y,Z; U,V)
@@ -83,18 +105,23 @@ class GLImageRenderer : GLSurfaceView.Renderer {
 
     private var programNormal = 0
     private var programEdge = 0
+    private var programPacked = 0
     @Volatile private var activeProgram = 0
 
     private var aPositionLoc = 0
     private var aTexCoordLoc = 0
     private var uMvpLoc = 0
     private var uTexLoc = 0
+    private var uImageWidthLoc = 0
+    private var uRowBytesLoc = 0
 
     private var textureId = 0
     private var surfaceWidth = 0
     private var surfaceHeight = 0
     private var imageWidth = 0
     private var imageHeight = 0
+    private var textureWidth = 0
+    private var texturePacked = false
 
     // Matrices
     private val mvp = FloatArray(16)
@@ -114,6 +141,9 @@ class GLImageRenderer : GLSurfaceView.Renderer {
     private val pendingUpdate = AtomicBoolean(false)
     private var pendingPixelBuffer: ByteBuffer? = null
     private var pendingFormat: Int = GLES20.GL_RGBA // default
+    private var pendingType: Int = GLES20.GL_UNSIGNED_BYTE
+    private var pendingTextureWidth = 0
+    private var pendingPacked = false
 
     // Visualization modes
     enum class Mode { NORMAL, EDGE }
@@ -123,6 +153,7 @@ class GLImageRenderer : GLSurfaceView.Renderer {
         GLES20.glClearColor(0f,0f,0f,1f)
         programNormal = buildProgram(VERTEX_SHADER, FRAGMENT_SHADER_NORMAL)
         programEdge = buildProgram(VERTEX_SHADER, FRAGMENT_SHADER_EDGE)
+        programPacked = buildProgram(VERTEX_SHADER, FRAGMENT_SHADER_PACKED)
         activeProgram = programNormal
         setupBuffers()
         createTexture()
@@ -152,33 +183,48 @@ class GLImageRenderer : GLSurfaceView.Renderer {
             Log.d(TAG, "FPS: $currentFps")
         }
 
-        // Switch program if mode changed
-        activeProgram = when(mode) {
-            Mode.NORMAL -> programNormal
-            Mode.EDGE -> programEdge
-        }
-        GLES20.glUseProgram(activeProgram)
-        resolveLocations(activeProgram)
-
         // Upload pending texture update
         if (pendingUpdate.compareAndSet(true, false)) {
             pendingPixelBuffer?.let { buf ->
                 GLES20.glBindTexture(GLES20.GL_TEXTURE_2D, textureId)
+                // Gray and packed rows are not 4-byte multiples in general
+                GLES20.glPixelStorei(GLES20.GL_UNPACK_ALIGNMENT, 1)
+                if (pendingPacked != texturePacked) {
+                    // Bits must be sampled exactly; filtering would blend neighbouring bytes
+                    val filter = if (pendingPacked) GLES20.GL_NEAREST else GLES20.GL_LINEAR
+                    GLES20.glTexParameteri(GLES20.GL_TEXTURE_2D, GLES20.GL_TEXTURE_MIN_FILTER, filter)
+                    GLES20.glTexParameteri(GLES20.GL_TEXTURE_2D, GLES20.GL_TEXTURE_MAG_FILTER, filter)
+                    texturePacked = pendingPacked
+                }
+                textureWidth = pendingTextureWidth
                 GLES20.glTexImage2D(
                     GLES20.GL_TEXTURE_2D,
                     0,
                     pendingFormat,
-                    imageWidth,
+                    textureWidth,
                     imageHeight,
                     0,
                     pendingFormat,
-                    GLES20.GL_UNSIGNED_BYTE,
+                    pendingType,
                     buf
                 )
                 updateMvp() // aspect ratio may change
             }
         }
 
+        // Switch program if mode changed; packed frames are already edges and need their own decoder
+        activeProgram = when {
+            texturePacked -> programPacked
+            mode == Mode.EDGE -> programEdge
+            else -> programNormal
+        }
+        GLES20.glUseProgram(activeProgram)
+        resolveLocations(activeProgram)
+        if (texturePacked) {
+            GLES20.glUniform1f(uImageWidthLoc, imageWidth.toFloat())
+            GLES20.glUniform1f(uRowBytesLoc, textureWidth.toFloat())
+        }
+
         GLES20.glBindTexture(GLES20.GL_TEXTURE_2D, textureId)
 
         // Set attributes using VBO
@@ -250,6 +296,8 @@ class GLImageRenderer : GLSurfaceView.Renderer {
         aTexCoordLoc = GLES20.glGetAttribLocation(program, "aTexCoord")
         uMvpLoc = GLES20.glGetUniformLocation(program, "uMVP")
         uTexLoc = GLES20.glGetUniformLocation(program, "uTexture")
+        uImageWidthLoc = GLES20.glGetUniformLocation(program, "uImageWidth")
+        uRowBytesLoc = GLES20.glGetUniformLocation(program, "uRowBytes")
     }
 
     private fun createTexture() {
@@ -296,19 +344,52 @@ class GLImageRenderer : GLSurfaceView.Renderer {
      * Thread-safe; call from any thread. Data copied into direct ByteBuffer.
      */
     fun updateTexture(rgbaBytes: ByteArray, width: Int, height: Int) {
-        if (width <=0 || height <=0 || rgbaBytes.size < width*height*4) {
-            Log.e(TAG, "updateTexture: invalid dimensions or buffer")
+        updateFrame(ProcessedFrame(rgbaBytes, width, height, NativeOpenCVHelper.OUTPUT_RGBA))
+    }
+
+    /**
+     * Update texture with a frame in any native output format. RGB565 and gray are uploaded
+     * as-is (RGB/5_6_5 and LUMINANCE textures); packed edge maps are uploaded one byte per
+     * 8 pixels and expanded by the packed fragment shader, so nothing is widened on the CPU.
+     * Thread-safe; call from any thread. Data copied into direct ByteBuffer.
+     */
+    fun updateFrame(frame: ProcessedFrame) {
+        if (!frame.isValid()) {
+            Log.e(TAG, "updateFrame: invalid dimensions or buffer")
             return
         }
-        imageWidth = width
-        imageHeight = height
-        if (pendingPixelBuffer == null || pendingPixelBuffer!!.capacity() < rgbaBytes.size) {
-            pendingPixelBuffer = ByteBuffer.allocateDirect(rgbaBytes.size).order(ByteOrder.nativeOrder())
+        val size = NativeOpenCVHelper.frameSize(frame.format, frame.width, frame.height)
+        when (frame.format) {
+            NativeOpenCVHelper.OUTPUT_RGB565 -> {
+                pendingFormat = GLES20.GL_RGB
+                pendingType = GLES20.GL_UNSIGNED_SHORT_5_6_5
+                pendingTextureWidth = frame.width
+            }
+            NativeOpenCVHelper.OUTPUT_GRAY8 -> {
+                pendingFormat = GLES20.GL_LUMINANCE
+                pendingType = GLES20.GL_UNSIGNED_BYTE
+                pendingTextureWidth = frame.width
+            }
+            NativeOpenCVHelper.OUTPUT_PACKED_EDGES -> {
+                pendingFormat = GLES20.GL_LUMINANCE
+                pendingType = GLES20.GL_UNSIGNED_BYTE
+                pendingTextureWidth = frame.rowStride
+            }
+            else -> {
+                pendingFormat = GLES20.GL_RGBA
+                pendingType = GLES20.GL_UNSIGNED_BYTE
+                pendingTextureWidth = frame.width
+            }
+        }
+        pendingPacked = frame.format == NativeOpenCVHelper.OUTPUT_PACKED_EDGES
+        imageWidth = frame.width
+        imageHeight = frame.height
+        if (pendingPixelBuffer == null || pendingPixelBuffer!!.capacity() < size) {
+            pendingPixelBuffer = ByteBuffer.allocateDirect(size).order(ByteOrder.nativeOrder())
         }
         pendingPixelBuffer!!.position(0)
-        pendingPixelBuffer!!.put(rgbaBytes)
+        pendingPixelBuffer!!.put(frame.data, 0, size)
         pendingPixelBuffer!!.position(0)
-        pendingFormat = GLES20.GL_RGBA
         pendingUpdate.set(true)
     }
 
@@ -321,11 +402,13 @@ class GLImageRenderer : GLSurfaceView.Renderer {
     fun cleanup() {
         if (programNormal != 0) GLES20.glDeleteProgram(programNormal)
         if (programEdge != 0) GLES20.glDeleteProgram(programEdge)
+        if (programPacked != 0) GLES20.glDeleteProgram(programPacked)
         if (textureId != 0) {
             GLES20.glDeleteTextures(1, IntBuffer.wrap(intArrayOf(textureId)))
         }
         programNormal = 0
         programEdge = 0
+        programPacked = 0
         textureId = 0
         pendingPixelBuffer = null
     }
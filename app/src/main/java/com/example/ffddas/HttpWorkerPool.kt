@@ -0,0 +1,111 @@
+package com.example.ffddas
+
+import android.os.Process
+import android.util.Log
+import fi.iki.elonen.NanoHTTPD
+import java.io.IOException
+import java.io.InputStream
+import java.net.Socket
+import java.util.concurrent.ArrayBlockingQueue
+import java.util.concurrent.ConcurrentHashMap
+import java.util.concurrent.RejectedExecutionException
+import java.util.concurrent.ThreadFactory
+import java.util.concurrent.ThreadPoolExecutor
+import java.util.concurrent.TimeUnit
+import java.util.concurrent.atomic.AtomicInteger
+import java.util.concurrent.atomic.AtomicLong
+
+/**
+ * NanoHTTPD runner that serves connections on at most [threads] worker threads instead
+ * of a new thread per connection. A connection keeps its worker for as long as it is
+ * open: every request on a keep-alive connection, a whole /stream, a WebSocket. Up to
+ * [queueLimit] more connections wait for a free worker; past that a connection is
+ * answered 503 on the accepting thread and closed without ever reaching the server.
+ *
+ * Workers run just below normal priority so a burst of viewers yields the CPU to the
+ * camera pipeline.
+ */
+class HttpWorkerPool(val threads: Int, val queueLimit: Int) : NanoHTTPD.AsyncRunner {
+    // Sockets of connections handed to exec() and not yet closed, so a shed one can be answered
+    private val sockets = ConcurrentHashMap<NanoHTTPD.ClientHandler, Socket>()
+    private val threadCount = AtomicInteger()
+    private val accepted = AtomicLong()
+    private val shed = AtomicLong()
+
+    private val executor = ThreadPoolExecutor(
+        threads, threads, IDLE_SECONDS, TimeUnit.SECONDS, ArrayBlockingQueue(queueLimit),
+        ThreadFactory { task ->
+            Thread({
+                Process.setThreadPriority(Process.THREAD_PRIORITY_DEFAULT + Process.THREAD_PRIORITY_LESS_FAVORABLE)
+                task.run()
+            }, "http-worker-${threadCount.incrementAndGet()}").apply { isDaemon = true }
+        }
+    ).apply { allowCoreThreadTimeOut(true) }
+
+    /** True while connections are waiting; keep-alive connections should then let their worker go */
+    val isBacklogged: Boolean get() = executor.queue.isNotEmpty()
+
+    /** Remembers which socket a handler serves; call from NanoHTTPD.createClientHandler */
+    fun register(handler: NanoHTTPD.ClientHandler, socket: Socket) {
+        sockets[handler] = socket
+    }
+
+    override fun exec(code: NanoHTTPD.ClientHandler) {
+        accepted.incrementAndGet()
+        try {
+            executor.execute(code)
+        } catch (e: RejectedExecutionException) {
+            shed.incrementAndGet()
+            val socket = sockets.remove(code)
+            if (socket != null) refuse(socket)
+            code.close()
+        }
+    }
+
+    override fun closed(clientHandler: NanoHTTPD.ClientHandler) {
+        sockets.remove(clientHandler)
+    }
+
+    override fun closeAll() {
+        // Queued connections never started, so close() is their only cleanup
+        executor.queue.clear()
+        for (handler in sockets.keys.toList()) handler.close()
+        sockets.clear()
+    }
+
+    fun stats(): Map<String, Any> = mapOf(
+        "threads" to executor.poolSize,
+        "maxThreads" to threads,
+        "busy" to executor.activeCount,
+        "queued" to executor.queue.size,
+        "queueLimit" to queueLimit,
+        "connections" to accepted.get(),
+        "shed" to shed.get()
+    )
+
+    // A fresh connection's send buffer is empty, so this small write never blocks the accepting thread
+    private fun refuse(socket: Socket) {
+        try {
+            socket.getOutputStream().write(BUSY_RESPONSE)
+            socket.shutdownOutput()
+            // Unread request bytes would turn the close into a reset that hides the 503
+            val input: InputStream = socket.getInputStream()
+            input.skip(input.available().toLong())
+        } catch (e: IOException) {
+            Log.d(TAG, "Could not refuse connection: ${e.message}")
+        }
+    }
+
+    companion object {
+        private const val TAG = "HttpWorkerPool"
+        // Workers beyond what the load needs exit after this long idle
+        private const val IDLE_SECONDS = 30L
+        private val BUSY_RESPONSE = ("HTTP/1.1 503 Service Unavailable\r\n" +
+            "Content-Type: text/plain\r\n" +
+            "Content-Length: 12\r\n" +
+            "Retry-After: 1\r\n" +
+            "Connection: close\r\n" +
+            "\r\n" +
+            "Server busy\n").toByteArray(Charsets.US_ASCII)
+    }
+}
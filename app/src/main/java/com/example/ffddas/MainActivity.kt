@@ -31,6 +31,7 @@ class MainActivity : AppCompatActivity() {
     private lateinit var binding: ActivityMainBinding
     private var imageCapture: ImageCapture? = null
     private var imageAnalyzer: ImageAnalysis? = null
+    private var frameAnalyzer: OpenCVImageAnalyzer? = null
     private var cameraProvider: ProcessCameraProvider? = null
     private var opencvProcessor: OpenCVProcessor? = null
     private lateinit var cameraExecutor: ExecutorService
@@ -45,9 +46,11 @@ class MainActivity : AppCompatActivity() {
     private var fpsFrames: Int = 0
     private var lastUiFps: Float = 0f
     private var currentLensFacing: Int = CameraSelector.LENS_FACING_BACK
+    private var lowMemoryMode = false // RGB_565 frames end-to-end on low-RAM devices
 
     enum class FilterType {
-        NONE, EDGE_DETECTION, GRAYSCALE
+        NONE, EDGE_DETECTION, GRAYSCALE,
+        COMPARE // Normal, Grayscale, Edge and overlay tiled from one native call
     }
 
     // Permission request launcher
@@ -99,6 +102,18 @@ class MainActivity : AppCompatActivity() {
         cameraExecutor = Executors.newSingleThreadExecutor()
         Log.d(TAG, "Background executor initialized")
 
+        // Keep fewer recycled frame buffers around on low-RAM devices
+        val activityManager = getSystemService(ACTIVITY_SERVICE) as android.app.ActivityManager
+        lowMemoryMode = activityManager.isLowRamDevice
+        NativeOpenCVHelper.configureMatPool(
+            if (lowMemoryMode) LOW_RAM_MAT_POOL_BYTES else DEFAULT_MAT_POOL_BYTES
+        )
+        // One bounded set of native threads for our batches and OpenCV's internal parallelism.
+        // Once per process: a recreated activity (rotation) finds the pool already serving frames.
+        if (!workPoolConfigured) {
+            workPoolConfigured = NativeOpenCVHelper.setupWorkPool(pinToFastCores = PIN_WORK_POOL_TO_FAST_CORES)
+        }
+
         // Initialize web server (optional - doesn't affect camera functionality)
         try {
             webServer = WebServerService(8080).apply {
@@ -123,6 +138,7 @@ class MainActivity : AppCompatActivity() {
                         currentFilter = when(mode.uppercase()) {
                             "GRAYSCALE", "GRAY" -> FilterType.GRAYSCALE
                             "EDGE_DETECTION", "EDGE" -> FilterType.EDGE_DETECTION
+                            "COMPARE" -> FilterType.COMPARE
                             else -> FilterType.NONE
                         }
                         onFilterChanged()
@@ -197,6 +213,7 @@ class MainActivity : AppCompatActivity() {
                 R.id.edgeDetectionRadio -> FilterType.EDGE_DETECTION
                 R.id.grayscaleRadio -> FilterType.GRAYSCALE
                 R.id.faceDetectionRadio -> FilterType.NONE
+                R.id.compareRadio -> FilterType.COMPARE
                 else -> FilterType.NONE
             }
             onFilterChanged()
@@ -206,10 +223,19 @@ class MainActivity : AppCompatActivity() {
 
     private fun onFilterChanged() {
         Log.d(TAG, "=== Filter changed to: $currentFilter ===")
+        // Latency distributions are per mode
+        FrameLatency.reset()
         updateStatusText()
 
-        // Native processing modes are applied in analyzer via NativeOpenCVHelper
-        Log.d(TAG, "Filter applied to native pipeline")
+        // UI and web filter changes both land here; native workers switch at their next frame
+        val previewMode = when (currentFilter) {
+            FilterType.EDGE_DETECTION -> NativeOpenCVHelper.PREVIEW_EDGES
+            FilterType.GRAYSCALE -> NativeOpenCVHelper.PREVIEW_GRAY
+            // Nothing is submitted to the async pipeline: keep the last config
+            FilterType.NONE, FilterType.COMPARE -> return
+        }
+        val version = NativeOpenCVHelper.publishConfig(previewMode)
+        Log.d(TAG, "Filter applied to native pipeline (config v$version)")
     }
 
     private fun updateStatusText() {
@@ -217,6 +243,7 @@ class MainActivity : AppCompatActivity() {
             FilterType.EDGE_DETECTION -> "Edge Detection"
             FilterType.GRAYSCALE -> "Grayscale"
             FilterType.NONE -> "Normal"
+            FilterType.COMPARE -> "Compare"
         }
 
         runOnUiThread {
@@ -224,8 +251,10 @@ class MainActivity : AppCompatActivity() {
                 FilterType.EDGE_DETECTION -> "Edge Detection"
                 FilterType.GRAYSCALE -> "Grayscale"
                 FilterType.NONE -> "Normal"
+                FilterType.COMPARE -> "Compare"
             }
-            binding.statusText.text = "Mode: $filterText | FPS: ${"%.1f".format(lastUiFps)} | Frames: $frameCount"
+            val latency = FrameLatency.displayMedianMs()?.let { " | Latency: ${"%.0f".format(it)} ms" } ?: ""
+            binding.statusText.text = "Mode: $filterText | FPS: ${"%.1f".format(lastUiFps)} | Frames: $frameCount$latency"
         }
     }
 
@@ -307,34 +336,44 @@ class MainActivity : AppCompatActivity() {
                 .setTargetRotation(rotation)
                 .build()
 
-            // Analyzer: show processed frame when filter != NONE, else raw preview
-            imageAnalyzer?.setAnalyzer(
-                cameraExecutor,
-                OpenCVImageAnalyzer({ processedBitmap ->
-                    runOnUiThread {
-                        frameCount++
-                        fpsFrames++
-                        val now = System.currentTimeMillis()
-                        if (now - fpsStartMs >= 1000) {
-                            lastUiFps = fpsFrames * 1000f / (now - fpsStartMs)
-                            fpsFrames = 0
-                            fpsStartMs = now
-                        }
-                        if (currentFilter == FilterType.NONE) {
-                            binding.previewView.alpha = 1f
-                            binding.processedImageView.visibility = View.GONE
-                        } else {
-                            binding.previewView.alpha = 0f
-                            binding.processedImageView.visibility = View.VISIBLE
-                            binding.processedImageView.setImageBitmap(processedBitmap)
-                            // Store latest processed frame for capture overwrite
-                            lastProcessedBitmap = processedBitmap
-                        }
-                        webServer?.updateFrame(processedBitmap)
-                        updateStatusText()
+            // Analyzer: show processed frame when filter != NONE, else raw preview.
+            // Only one analyzer may own the native async pipeline at a time.
+            frameAnalyzer?.close()
+            val analyzer = OpenCVImageAnalyzer({ processedBitmap, timing ->
+                runOnUiThread {
+                    frameCount++
+                    fpsFrames++
+                    val now = System.currentTimeMillis()
+                    if (now - fpsStartMs >= 1000) {
+                        lastUiFps = fpsFrames * 1000f / (now - fpsStartMs)
+                        fpsFrames = 0
+                        fpsStartMs = now
                     }
-                }, { currentFilter }, 100)
-            )
+                    if (currentFilter == FilterType.NONE) {
+                        binding.previewView.alpha = 1f
+                        binding.processedImageView.visibility = View.GONE
+                    } else {
+                        binding.previewView.alpha = 0f
+                        binding.processedImageView.visibility = View.VISIBLE
+                        binding.processedImageView.setImageBitmap(processedBitmap)
+                        // Visible from the next display frame on
+                        binding.processedImageView.postOnAnimation { FrameLatency.recordDisplayed(timing) }
+                        // Store latest processed frame for capture overwrite
+                        lastProcessedBitmap = processedBitmap
+                    }
+                    // The server reuses this bitmap when its filter matches ours
+                    val applied = when (currentFilter) {
+                        FilterType.NONE -> WebServerService.FilterMode.NONE
+                        FilterType.GRAYSCALE -> WebServerService.FilterMode.GRAYSCALE
+                        FilterType.EDGE_DETECTION -> WebServerService.FilterMode.EDGE_DETECTION
+                        FilterType.COMPARE -> null
+                    }
+                    webServer?.updateFrame(processedBitmap, timing, applied)
+                    updateStatusText()
+                }
+            }, { currentFilter }, 100, lowMemoryMode, latencyBudgetMs = LATENCY_BUDGET_MS)
+            frameAnalyzer = analyzer
+            imageAnalyzer?.setAnalyzer(cameraExecutor, analyzer)
 
             provider.bindToLifecycle(
                 this,
@@ -388,6 +427,7 @@ class MainActivity : AppCompatActivity() {
                 FilterType.EDGE_DETECTION -> "EdgeDetection"
                 FilterType.GRAYSCALE -> "Grayscale"
                 FilterType.NONE -> "Normal"
+                FilterType.COMPARE -> "Compare"
             }
             
             val timestamp = System.currentTimeMillis()
@@ -572,6 +612,14 @@ class MainActivity : AppCompatActivity() {
         Log.d(TAG, "onResume called")
     }
 
+    override fun onTrimMemory(level: Int) {
+        super.onTrimMemory(level)
+        if (level >= TRIM_MEMORY_RUNNING_LOW) {
+            Log.d(TAG, "onTrimMemory($level): releasing pooled native buffers")
+            NativeOpenCVHelper.releasePooledBuffers()
+        }
+    }
+
     override fun onDestroy() {
         super.onDestroy()
         Log.d(TAG, "onDestroy called")
@@ -579,7 +627,9 @@ class MainActivity : AppCompatActivity() {
         // Stop web server
         webServer?.stopServer()
 
-        // Shutdown executor
+        // Stop native async workers, then the executor feeding them
+        frameAnalyzer?.close()
+        frameAnalyzer = null
         cameraExecutor.shutdown()
 
         // Unbind camera
@@ -593,6 +643,14 @@ class MainActivity : AppCompatActivity() {
     companion object {
         private const val TAG = "MainActivity"
         private const val FILENAME_FORMAT = "yyyy-MM-dd-HH-mm-ss-SSS"
+        private const val DEFAULT_MAT_POOL_BYTES = 64L * 1024 * 1024
+        private const val LOW_RAM_MAT_POOL_BYTES = 16L * 1024 * 1024
+        // Target submit-to-display latency for the async preview (one frame at 30 fps)
+        private const val LATENCY_BUDGET_MS = 33
+        // Leaves the little cores to CameraX and the UI; off until measured per device
+        private const val PIN_WORK_POOL_TO_FAST_CORES = false
+        // The native pool outlives activities, so it is configured by the first onCreate only
+        private var workPoolConfigured = false
 
         private val REQUIRED_PERMISSIONS = arrayOf(
             Manifest.permission.CAMERA
@@ -6,9 +6,78 @@ import java.nio.ByteBuffer
 
 class NativeOpenCVHelper {
     
+    /**
+     * Parameters of the native blur -> Canny -> morphology pipeline
+     */
+    data class PipelineConfig(
+        val gaussianKernel: Int = 5,
+        val sigmaX: Double = 1.5,
+        val sigmaY: Double = 1.5,
+        val cannyLow: Double = 50.0,
+        val cannyHigh: Double = 150.0,
+        val morphIterations: Int = 1,
+        val outputGray: Boolean = false,
+        val outputFormat: Int = OUTPUT_MATCH_INPUT
+    )
+    
+    /**
+     * One output of processMultiView(): a VIEW_* kind and, for edge views, its own thresholds
+     */
+    data class ViewBranch(
+        val kind: Int,
+        val cannyLow: Double = DEFAULT_CANNY_LOW,
+        val cannyHigh: Double = DEFAULT_CANNY_HIGH,
+        val morphIterations: Int = 1
+    )
+    
+    /**
+     * Result of a batched native call: outputs and status are in input order
+     */
+    class BatchResult<T>(val outputs: T, val status: IntArray) {
+        fun isOk(index: Int) = status[index] == BATCH_OK
+    }
+    
     companion object {
         private const val TAG = "NativeOpenCVHelper"
         
+        // Output pixel formats (must match OutputFormat in edge-pipeline.h)
+        const val OUTPUT_MATCH_INPUT = -1
+        const val OUTPUT_RGBA = 0
+        const val OUTPUT_RGB565 = 1
+        const val OUTPUT_GRAY8 = 2
+        const val OUTPUT_PACKED_EDGES = 3
+        
+        // Live preview modes (must match PreviewMode in edge-pipeline.h)
+        const val PREVIEW_EDGES = 0
+        const val PREVIEW_GRAY = 1
+        
+        // JPEG rendition sizes, as divisors of width and height (must match kJpegScaleDivisors in jpeg-cache.h)
+        val JPEG_SCALE_DIVISORS = intArrayOf(1, 2, 4)
+        
+        // Preview Canny thresholds used until a config says otherwise
+        const val DEFAULT_CANNY_LOW = 50.0
+        const val DEFAULT_CANNY_HIGH = 150.0
+        
+        // Multi-view branch kinds (must match ViewKind in edge-pipeline.h)
+        const val VIEW_NORMAL = 0
+        const val VIEW_GRAY = 1
+        const val VIEW_EDGES = 2
+        const val VIEW_OVERLAY = 3
+        
+        // Normal, Grayscale and Edge side by side, plus the edges over the image
+        val COMPARE_VIEWS = listOf(
+            ViewBranch(VIEW_NORMAL), ViewBranch(VIEW_GRAY), ViewBranch(VIEW_EDGES), ViewBranch(VIEW_OVERLAY)
+        )
+        
+        // Async execution modes (must match ExecutionMode in stage-pipeline.h)
+        const val ASYNC_MODE_LOW_LATENCY = 0     // one worker runs every stage of a frame
+        const val ASYNC_MODE_HIGH_THROUGHPUT = 1 // a thread per stage, consecutive frames overlap
+        
+        // Per-item batch status codes (must match BatchStatus in native-lib.cpp)
+        const val BATCH_OK = 0
+        const val BATCH_INVALID_INPUT = 1
+        const val BATCH_FAILED = 2
+        
         // Native method declarations
         @JvmStatic
         external fun processPhotoFrame(bitmapInput: Bitmap): Bitmap?
@@ -16,6 +85,9 @@ class NativeOpenCVHelper {
         @JvmStatic
         external fun processPreviewFrame(yuvImageBuffer: ByteBuffer, width: Int, height: Int): ByteArray?
         
+        @JvmStatic
+        external fun processPreviewFrameFormat(yuvImageBuffer: ByteBuffer, width: Int, height: Int, outputFormat: Int): ByteArray?
+        
         @JvmStatic
         external fun bitmapToMat(bitmap: Bitmap): Long
         
@@ -31,6 +103,250 @@ class NativeOpenCVHelper {
         @JvmStatic
         external fun releaseMatNative(matAddr: Long)
         
+        @JvmStatic
+        external fun runPipelineOnMatBatch(
+            matAddrs: LongArray, outHandles: LongArray,
+            gaussianKernel: Int, sigmaX: Double, sigmaY: Double,
+            cannyLow: Double, cannyHigh: Double, morphIterations: Int, outputGray: Boolean,
+            outputFormat: Int
+        ): IntArray?
+        
+        @JvmStatic
+        external fun processRgbaBufferBatch(
+            rgbaBuffers: Array<ByteArray?>, widths: IntArray, heights: IntArray, outputs: Array<ByteArray?>,
+            gaussianKernel: Int, sigmaX: Double, sigmaY: Double,
+            cannyLow: Double, cannyHigh: Double, morphIterations: Int, outputGray: Boolean,
+            outputFormat: Int
+        ): IntArray?
+        
+        @JvmStatic
+        external fun unpackEdges(packed: ByteArray, width: Int, height: Int): ByteArray?
+        
+        @JvmStatic
+        external fun processMultiViewFrame(
+            yuvImageBuffer: ByteBuffer, width: Int, height: Int,
+            kinds: IntArray, cannyLow: DoubleArray, cannyHigh: DoubleArray, morphIterations: IntArray,
+            gaussianKernel: Int, scaleDivisor: Int, outputFormat: Int, grid: Boolean, dims: IntArray
+        ): Array<ByteArray>?
+        
+        @JvmStatic
+        external fun startAsyncPipeline(capacity: Int, executionMode: Int): Boolean
+        
+        @JvmStatic
+        external fun stopAsyncPipeline()
+        
+        @JvmStatic
+        external fun submitYuvFrame(
+            yPlane: ByteBuffer, uPlane: ByteBuffer, vPlane: ByteBuffer,
+            width: Int, height: Int, yRowStride: Int, uvRowStride: Int, uvPixelStride: Int,
+            rotationDegrees: Int, outputFormat: Int, timestampNs: Long
+        ): Long
+        
+        @JvmStatic
+        external fun awaitAsyncResult(timeoutMs: Long, meta: LongArray): ByteArray?
+        
+        @JvmStatic
+        external fun getAsyncPipelineStats(): LongArray?
+        
+        @JvmStatic
+        external fun publishPipelineConfig(previewMode: Int, cannyLow: Double, cannyHigh: Double): Long
+        
+        @JvmStatic
+        external fun getPipelineConfig(): LongArray?
+        
+        @JvmStatic
+        external fun setLatencyBudget(targetMs: Int)
+        
+        @JvmStatic
+        external fun getLatencySchedulerStats(): LongArray?
+        
+        @JvmStatic
+        external fun configureWorkPool(workers: Int, pinToFastCores: Boolean, useForOpenCv: Boolean): Boolean
+        
+        @JvmStatic
+        external fun getWorkPoolStats(): LongArray?
+        
+        @JvmStatic
+        external fun busSubscribe(name: String, capacity: Int, policy: Int, stream: Int): Int
+        
+        @JvmStatic
+        external fun busUnsubscribe(subscription: Int)
+        
+        @JvmStatic
+        external fun busInterrupt(subscription: Int)
+        
+        @JvmStatic
+        external fun busNextFrame(subscription: Int, timeoutMs: Long, meta: LongArray): ByteBuffer?
+        
+        @JvmStatic
+        external fun busReleaseFrame(leaseToken: Long)
+        
+        @JvmStatic
+        external fun getFrameBusStats(): LongArray?
+        
+        @JvmStatic
+        external fun getFrameBusSubscribers(): Array<String>?
+        
+        @JvmStatic
+        external fun encodeBusFrameJpeg(leaseToken: Long, quality: Int, scaleDivisor: Int, meta: LongArray): ByteBuffer?
+        
+        @JvmStatic
+        external fun scaleFrameDown(pixels: ByteArray, width: Int, height: Int, format: Int, scaleDivisor: Int): ByteArray?
+        
+        @JvmStatic
+        external fun releaseJpeg(jpegToken: Long)
+        
+        @JvmStatic
+        external fun getJpegCacheStats(): LongArray?
+        
+        @JvmStatic
+        external fun encodeBusFrameEdges(leaseToken: Long): ByteArray?
+        
+        @JvmStatic
+        external fun encodeFrameEdges(pixels: ByteArray, width: Int, height: Int, format: Int): ByteArray?
+        
+        @JvmStatic
+        external fun traceBusFrameContours(leaseToken: Long, epsilon: Double, cannyLow: Double, cannyHigh: Double): ByteArray?
+        
+        @JvmStatic
+        external fun filterBitmapGray(bitmap: Bitmap, mode: Int, cannyLow: Double, cannyHigh: Double): ByteArray?
+        
+        @JvmStatic
+        external fun createTileDelta(tileSize: Int, keyframeInterval: Int): Long
+        
+        @JvmStatic
+        external fun encodeTileDelta(
+            handle: Long, leaseToken: Long, quality: Int, forceKeyframe: Boolean, meta: LongArray
+        ): ByteBuffer?
+        
+        @JvmStatic
+        external fun releaseTileDelta(handle: Long)
+        
+        @JvmStatic
+        external fun sensorTimeToMonotonic(sensorTimestampNs: Long): Long
+        
+        @JvmStatic
+        external fun registerFrameListener(listener: Any, name: String, stream: Int, maxInFlight: Int): Int
+        
+        @JvmStatic
+        external fun unregisterFrameListener(listener: Int)
+        
+        @JvmStatic
+        external fun getFrameListenerStats(): LongArray?
+        
+        @JvmStatic
+        external fun getFrameListenerNames(): Array<String>?
+        
+        @JvmStatic
+        external fun createStream(
+            name: String, weight: Int, capacity: Int, previewMode: Int, cannyLow: Double, cannyHigh: Double,
+            scaleDivisor: Int, gaussianKernel: Int, morphIterations: Int
+        ): Int
+        
+        @JvmStatic
+        external fun destroyStream(stream: Int): Boolean
+        
+        @JvmStatic
+        external fun setStreamWeight(stream: Int, weight: Int): Boolean
+        
+        @JvmStatic
+        external fun publishStreamConfig(stream: Int, previewMode: Int, cannyLow: Double, cannyHigh: Double): Long
+        
+        @JvmStatic
+        external fun submitStreamFrame(
+            stream: Int, yPlane: ByteBuffer, uPlane: ByteBuffer, vPlane: ByteBuffer,
+            width: Int, height: Int, yRowStride: Int, uvRowStride: Int, uvPixelStride: Int,
+            rotationDegrees: Int, outputFormat: Int, timestampNs: Long
+        ): Long
+        
+        @JvmStatic
+        external fun getStreamStats(): LongArray?
+        
+        @JvmStatic
+        external fun getStreamNames(): Array<String>?
+        
+        @JvmStatic
+        external fun setMatPoolRetentionCap(bytes: Long)
+        
+        @JvmStatic
+        external fun trimMatPool()
+        
+        @JvmStatic
+        external fun getMatPoolStats(): LongArray?
+        
+        @JvmStatic
+        external fun getNativeStats(): LongArray?
+        
+        // Order of the values returned by getNativeStats(); each subsystem then adds live/peak/allocations
+        private val NATIVE_STAT_KEYS = arrayOf(
+            "liveBytes", "peakBytes", "allocations", "frames",
+            "lastFrameAllocations", "outstandingHandles", "peakHandles"
+        )
+        private val NATIVE_SUBSYSTEMS = arrayOf("other", "conversion", "pipeline", "handleTable")
+        private val NATIVE_SUBSYSTEM_KEYS = arrayOf("liveBytes", "peakBytes", "allocations")
+        
+        // Order of the values returned by getAsyncPipelineStats()
+        private val ASYNC_STAT_KEYS = arrayOf(
+            "running", "capacity", "queueDepth", "submitted", "processed", "dropped", "failed",
+            "resultsOverwritten", "lastQueueLatencyNs", "avgQueueLatencyNs", "maxQueueLatencyNs", "avgProcessNs",
+            "mode"
+        )
+        // ... followed by ASYNC_STAGE_KEYS for each of ASYNC_STAGES
+        private val ASYNC_STAGES = arrayOf("convert", "detect", "composite")
+        private val ASYNC_STAGE_KEYS = arrayOf("frames", "busyNs", "occupancyPermille", "inputDepth", "inputDropped")
+        
+        // Order of the values returned by getPipelineConfig()
+        private val PIPELINE_CONFIG_KEYS = arrayOf(
+            "version", "previewMode", "cannyLow", "cannyHigh", "published", "retiredPending", "reclaimed"
+        )
+        
+        // Order of the values returned by getLatencySchedulerStats()
+        private val LATENCY_SCHEDULER_STAT_KEYS = arrayOf(
+            "enabled", "targetNs", "level", "scaleDivisor", "gaussianKernel", "morphIterations", "skipInterval",
+            "lastLatencyNs", "avgLatencyNs", "avgConvertNs", "avgDetectNs", "avgCompositeNs",
+            "admitted", "skipped", "downgrades", "upgrades"
+        )
+        
+        // Order of the values returned by getWorkPoolStats()
+        private val WORK_POOL_STAT_KEYS = arrayOf(
+            "workers", "pinnedCpus", "pinFailures", "openCvBackend", "submitted", "executed", "stolen", "parks", "failed"
+        )
+        
+        // Order of the values returned by getFrameBusStats() ...
+        private val FRAME_BUS_STAT_KEYS = arrayOf("published", "fanOut", "unclaimed", "subscriberCount")
+        // ... followed by FRAME_BUS_SUBSCRIBER_KEYS for each of getFrameBusSubscribers()
+        private val FRAME_BUS_SUBSCRIBER_KEYS = arrayOf(
+            "id", "stream", "capacity", "policy", "queued", "delivered", "dropped"
+        )
+        
+        // Order of the values returned by getJpegCacheStats()
+        private val JPEG_CACHE_STAT_KEYS = arrayOf(
+            "requests", "encoded", "scaledEncoded", "failed", "recycled", "lastBytes", "avgBytes",
+            "lastEncodeNs", "avgEncodeNs", "maxEncodeNs", "activeRenditions"
+        )
+        
+        // Order of the values returned by getFrameListenerStats() ...
+        private val FRAME_LISTENER_STAT_KEYS = arrayOf("listenerCount")
+        // ... followed by FRAME_LISTENER_KEYS for each of getFrameListenerNames()
+        private val FRAME_LISTENER_KEYS = arrayOf(
+            "id", "stream", "maxInFlight", "inFlight", "delivered", "coalesced", "failed",
+            "lastLatencyNs", "avgLatencyNs", "maxLatencyNs", "avgCallbackNs", "avgHoldNs"
+        )
+        
+        // Order of the values returned by getStreamStats() ...
+        private val STREAM_STAT_KEYS = arrayOf("maxInFlight", "inFlight", "streamCount")
+        // ... followed by STREAM_KEYS for each of getStreamNames()
+        private val STREAM_KEYS = arrayOf(
+            "id", "weight", "queued", "running", "submitted", "processed", "dropped", "failed",
+            "busyNs", "avgProcessNs", "configVersion"
+        )
+        
+        // Order of the values returned by getMatPoolStats()
+        private val MAT_POOL_STAT_KEYS = arrayOf(
+            "hits", "misses", "bypassed", "released",
+            "retainedBytes", "retainedBlocks", "retentionCap", "pageFaultsAvoided"
+        )
+        
         /**
          * Process a photo frame using native OpenCV
          * @param bitmapInput The input bitmap to process
@@ -61,6 +377,59 @@ class NativeOpenCVHelper {
             }
         }
         
+        /**
+         * Process a preview frame into a specific output pixel format
+         * @param yuvImageBuffer The NV21 image buffer (direct)
+         * @param width The width of the image
+         * @param height The height of the image
+         * @param outputFormat One of the OUTPUT_* formats (not OUTPUT_MATCH_INPUT)
+         * @return The processed image data (see frameSize for its length) or null if processing failed
+         */
+        fun processPreview(yuvImageBuffer: ByteBuffer, width: Int, height: Int, outputFormat: Int): ByteArray? {
+            try {
+                return processPreviewFrameFormat(yuvImageBuffer, width, height, outputFormat)
+            } catch (e: Exception) {
+                Log.e(TAG, "Error processing preview frame: ${e.message}", e)
+                return null
+            }
+        }
+        
+        /**
+         * Bytes per row of a buffer produced with the given output format.
+         * Rows are tightly packed; packed edge rows are rounded up to whole bytes.
+         */
+        fun rowStride(outputFormat: Int, width: Int): Int = when (outputFormat) {
+            OUTPUT_RGB565 -> width * 2
+            OUTPUT_GRAY8 -> width
+            OUTPUT_PACKED_EDGES -> (width + 7) / 8
+            else -> width * 4
+        }
+        
+        /**
+         * Total bytes of a buffer produced with the given output format
+         */
+        fun frameSize(outputFormat: Int, width: Int, height: Int): Int = rowStride(outputFormat, width) * height
+        
+        /**
+         * Expand a packed edge map to one byte per pixel (0 or 255)
+         * @return Gray8 pixels or null on failure
+         */
+        fun unpackEdgeMap(packed: ByteArray, width: Int, height: Int): ByteArray? {
+            return try {
+                unpackEdges(packed, width, height)
+            } catch (e: Exception) {
+                Log.e(TAG, "Error unpacking edge map: ${e.message}", e)
+                null
+            }
+        }
+        
+        /**
+         * Bitmap config matching the given output format. Gray and packed frames have no
+         * Bitmap equivalent and are expanded to ARGB_8888 if they need one.
+         */
+        fun bitmapConfig(outputFormat: Int): Bitmap.Config =
+            if (outputFormat == OUTPUT_RGB565) Bitmap.Config.RGB_565 else Bitmap.Config.ARGB_8888
+        
         /**
          * Convert a Bitmap to OpenCV Mat
          * @param bitmap The bitmap to convert
@@ -131,5 +500,743 @@ class NativeOpenCVHelper {
                 Log.e(TAG, "Error releasing Mat: ${e.message}", e)
             }
         }
+        
+        /**
+         * Limit how many bytes of freed frame buffers the native Mat pool keeps for reuse
+         * @param bytes The retention cap in bytes (0 disables retention)
+         */
+        fun configureMatPool(bytes: Long) {
+            try {
+                setMatPoolRetentionCap(bytes)
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error configuring Mat pool: ${e.message}", e)
+            }
+        }
+        
+        /**
+         * Size the native worker pool that batch calls (and optionally all of OpenCV) run on.
+         * Call once per process; repeating the same settings is a no-op.
+         * @param workers Worker threads; 0 = one per core (per big core when pinning) minus one
+         * @param pinToFastCores Restrict workers to the CPUs with the highest max frequency
+         * @param useForOpenCv Route cv::parallel_for_ to this pool instead of OpenCV's own threads
+         */
+        fun setupWorkPool(workers: Int = 0, pinToFastCores: Boolean = false, useForOpenCv: Boolean = true): Boolean {
+            return try {
+                configureWorkPool(workers, pinToFastCores, useForOpenCv)
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error configuring work pool: ${e.message}", e)
+                false
+            }
+        }
+        
+        /**
+         * Work pool size, pinning and task / steal counters
+         */
+        fun workPoolStats(): Map<String, Long> {
+            return try {
+                val values = getWorkPoolStats() ?: return emptyMap()
+                WORK_POOL_STAT_KEYS.indices.associate { WORK_POOL_STAT_KEYS[it] to values[it] }
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error reading work pool stats: ${e.message}", e)
+                emptyMap()
+            }
+        }
+        
+        /**
+         * Return all retained frame buffers to the system (e.g. on memory pressure)
+         */
+        fun releasePooledBuffers() {
+            try {
+                trimMatPool()
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error trimming Mat pool: ${e.message}", e)
+            }
+        }
+        
+        /**
+         * Read native frame pool counters
+         * @return Map of counter name to value, empty if the native library is unavailable
+         */
+        fun matPoolStats(): Map<String, Long> {
+            return try {
+                val values = getMatPoolStats() ?: return emptyMap()
+                MAT_POOL_STAT_KEYS.indices.associate { MAT_POOL_STAT_KEYS[it] to values[it] }
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error reading Mat pool stats: ${e.message}", e)
+                emptyMap()
+            }
+        }
+        
+        /**
+         * Read native memory telemetry (live/peak bytes, allocations per frame,
+         * outstanding Mat handles) with a per-subsystem breakdown and the Mat pool counters
+         * @return Nested map suitable for JSON serialization, empty if unavailable
+         */
+        fun nativeStats(): Map<String, Any> {
+            return try {
+                val values = getNativeStats() ?: return emptyMap()
+                val result = LinkedHashMap<String, Any>()
+                NATIVE_STAT_KEYS.forEachIndexed { i, key -> result[key] = values[i] }
+                val subsystems = LinkedHashMap<String, Any>()
+                var offset = NATIVE_STAT_KEYS.size
+                for (name in NATIVE_SUBSYSTEMS) {
+                    subsystems[name] = NATIVE_SUBSYSTEM_KEYS.indices.associate { NATIVE_SUBSYSTEM_KEYS[it] to values[offset + it] }
+                    offset += NATIVE_SUBSYSTEM_KEYS.size
+                }
+                result["subsystems"] = subsystems
+                result["matPool"] = matPoolStats()
+                result["asyncPipeline"] = asyncPipelineStats()
+                result["config"] = pipelineConfigStats()
+                result["latencyScheduler"] = latencySchedulerStats()
+                result["workPool"] = workPoolStats()
+                result["frameBus"] = frameBusStats()
+                result["frameListeners"] = frameListenerStats()
+                result["jpegCache"] = jpegCacheStats()
+                result["streams"] = streamStats()
+                result
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error reading native stats: ${e.message}", e)
+                emptyMap()
+            }
+        }
+        
+        /**
+         * Compute several views of one NV21 frame in one native call; luma, blur and color
+         * conversion are shared and the branches run in parallel
+         * @param outputFormat OUTPUT_RGBA, OUTPUT_RGB565 or OUTPUT_GRAY8
+         * @param scaleDivisor Shrinks every view, e.g. 2 keeps a 2x2 grid at the camera's size
+         * @return One frame per branch, in branch order, or null on failure
+         */
+        fun processMultiView(
+            yuvImageBuffer: ByteBuffer, width: Int, height: Int, branches: List<ViewBranch>, outputFormat: Int,
+            gaussianKernel: Int = 5, scaleDivisor: Int = 1
+        ): List<ProcessedFrame>? {
+            val dims = IntArray(2)
+            val views = runMultiView(yuvImageBuffer, width, height, branches, outputFormat,
+                gaussianKernel, scaleDivisor, false, dims) ?: return null
+            return views.map { ProcessedFrame(it, dims[0], dims[1], outputFormat) }
+        }
+        
+        /**
+         * Same as processMultiView() but tiled into one grid image (ceil(sqrt(n)) columns, row-major)
+         */
+        fun processMultiViewGrid(
+            yuvImageBuffer: ByteBuffer, width: Int, height: Int, branches: List<ViewBranch>, outputFormat: Int,
+            gaussianKernel: Int = 5, scaleDivisor: Int = 1
+        ): ProcessedFrame? {
+            val dims = IntArray(2)
+            val views = runMultiView(yuvImageBuffer, width, height, branches, outputFormat,
+                gaussianKernel, scaleDivisor, true, dims) ?: return null
+            return ProcessedFrame(views[0], dims[0], dims[1], outputFormat)
+        }
+        
+        private fun runMultiView(
+            yuvImageBuffer: ByteBuffer, width: Int, height: Int, branches: List<ViewBranch>, outputFormat: Int,
+            gaussianKernel: Int, scaleDivisor: Int, grid: Boolean, dims: IntArray
+        ): Array<ByteArray>? {
+            return try {
+                processMultiViewFrame(
+                    yuvImageBuffer, width, height,
+                    IntArray(branches.size) { branches[it].kind },
+                    DoubleArray(branches.size) { branches[it].cannyLow },
+                    DoubleArray(branches.size) { branches[it].cannyHigh },
+                    IntArray(branches.size) { branches[it].morphIterations },
+                    gaussianKernel, scaleDivisor, outputFormat, grid, dims
+                )
+            } catch (e: Exception) {
+                Log.e(TAG, "Error in multi-view processing: ${e.message}", e)
+                null
+            }
+        }
+        
+        /**
+         * Start the native async preview pipeline (no-op if already running)
+         * @param capacity Queue slots; a full queue drops its oldest frame
+         * @param executionMode ASYNC_MODE_*; a running pipeline in another mode is restarted
+         */
+        fun startAsync(capacity: Int, executionMode: Int = ASYNC_MODE_LOW_LATENCY): Boolean {
+            return try {
+                startAsyncPipeline(capacity, executionMode)
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error starting async pipeline: ${e.message}", e)
+                false
+            }
+        }
+        
+        /**
+         * Stop the async pipeline; wakes any thread blocked in awaitAsyncFrame
+         */
+        fun stopAsync() {
+            try {
+                stopAsyncPipeline()
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error stopping async pipeline: ${e.message}", e)
+            }
+        }
+        
+        /**
+         * Queue a YUV_420_888 frame for async processing; returns immediately
+         * @return The frame's sequence number, or -1 if it was not queued
+         */
+        fun submitAsyncFrame(
+            yPlane: ByteBuffer, uPlane: ByteBuffer, vPlane: ByteBuffer,
+            width: Int, height: Int, yRowStride: Int, uvRowStride: Int, uvPixelStride: Int,
+            rotationDegrees: Int, outputFormat: Int, timestampNs: Long
+        ): Long {
+            return try {
+                submitYuvFrame(
+                    yPlane, uPlane, vPlane, width, height, yRowStride, uvRowStride, uvPixelStride,
+                    rotationDegrees, outputFormat, timestampNs
+                )
+            } catch (e: Exception) {
+                Log.e(TAG, "Error submitting async frame: ${e.message}", e)
+                -1
+            }
+        }
+        
+        /**
+         * Wait for the newest finished async frame
+         * @param meta Receives [sequence, width, height, format, rotationDegrees, timestampNs, queueLatencyNs,
+         *             processNs, configVersion]
+         * @return Pixels in the submitted output format, or null on timeout / shutdown
+         */
+        fun awaitAsyncFrame(timeoutMs: Long, meta: LongArray): ByteArray? {
+            return try {
+                awaitAsyncResult(timeoutMs, meta)
+            } catch (e: Exception) {
+                Log.e(TAG, "Error waiting for async frame: ${e.message}", e)
+                null
+            }
+        }
+        
+        /**
+         * Async pipeline queue depth, drops, latencies and per-stage occupancy
+         */
+        fun asyncPipelineStats(): Map<String, Any> {
+            return try {
+                val values = getAsyncPipelineStats() ?: return emptyMap()
+                val result = LinkedHashMap<String, Any>()
+                ASYNC_STAT_KEYS.forEachIndexed { i, key -> result[key] = values[i] }
+                val stages = LinkedHashMap<String, Any>()
+                var offset = ASYNC_STAT_KEYS.size
+                for (name in ASYNC_STAGES) {
+                    if (offset + ASYNC_STAGE_KEYS.size > values.size) break
+                    stages[name] = ASYNC_STAGE_KEYS.indices.associate { ASYNC_STAGE_KEYS[it] to values[offset + it] }
+                    offset += ASYNC_STAGE_KEYS.size
+                }
+                result["stages"] = stages
+                result
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error reading async pipeline stats: ${e.message}", e)
+                emptyMap()
+            }
+        }
+        
+        /**
+         * Subscribe to every frame a pipeline publishes; see FrameBus.Subscription
+         * @param policy FrameBus.DROP_OLDEST or FrameBus.DROP_NEWEST, applied when [capacity] frames are queued
+         * @param stream FrameBus.LIVE_PREVIEW or a PipelineStream id
+         * @return Subscription id, or -1 on failure
+         */
+        fun subscribeFrames(name: String, capacity: Int, policy: Int, stream: Int = FrameBus.LIVE_PREVIEW): Int {
+            return try {
+                busSubscribe(name, capacity, policy, stream)
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error subscribing '$name' to the frame bus: ${e.message}", e)
+                -1
+            }
+        }
+        
+        fun unsubscribeFrames(subscription: Int) {
+            try {
+                busUnsubscribe(subscription)
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error unsubscribing $subscription from the frame bus: ${e.message}", e)
+            }
+        }
+        
+        /**
+         * Wake a thread blocked in nextBusFrame() on [subscription] without a frame
+         */
+        fun interruptFrames(subscription: Int) {
+            try {
+                busInterrupt(subscription)
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error interrupting frame bus subscription $subscription: ${e.message}", e)
+            }
+        }
+        
+        /**
+         * Take the subscription's next frame without copying it
+         * @param meta Receives [leaseToken, sequence, width, height, format, rowStride, rotationDegrees,
+         *             sensorTimestampNs, configVersion, queueLatencyNs, processNs, sensorMonotonicNs,
+         *             then the FrameTiming.STAMP_* times]
+         * @return Direct buffer over the shared native pixels, valid until releaseBusFrame(meta[0]);
+         *         null on timeout or interrupt
+         */
+        fun nextBusFrame(subscription: Int, timeoutMs: Long, meta: LongArray): ByteBuffer? {
+            return try {
+                busNextFrame(subscription, timeoutMs, meta)
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error reading frame bus subscription $subscription: ${e.message}", e)
+                null
+            }
+        }
+        
+        fun releaseBusFrame(leaseToken: Long) {
+            try {
+                busReleaseFrame(leaseToken)
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error releasing frame bus lease: ${e.message}", e)
+            }
+        }
+        
+        /**
+         * Frame bus totals plus queue depth, deliveries and drops per subscriber (keyed by name)
+         */
+        fun frameBusStats(): Map<String, Any> {
+            return try {
+                val values = getFrameBusStats() ?: return emptyMap()
+                val names = getFrameBusSubscribers() ?: emptyArray()
+                val result = LinkedHashMap<String, Any>()
+                FRAME_BUS_STAT_KEYS.forEachIndexed { i, key -> result[key] = values[i] }
+                val subscribers = LinkedHashMap<String, Any>()
+                var offset = FRAME_BUS_STAT_KEYS.size
+                while (offset + FRAME_BUS_SUBSCRIBER_KEYS.size <= values.size) {
+                    val index = (offset - FRAME_BUS_STAT_KEYS.size) / FRAME_BUS_SUBSCRIBER_KEYS.size
+                    // The two calls can race a subscribe; fall back to the id as the key
+                    val name = names.getOrNull(index) ?: "#${values[offset]}"
+                    subscribers[name] = FRAME_BUS_SUBSCRIBER_KEYS.indices.associate {
+                        FRAME_BUS_SUBSCRIBER_KEYS[it] to values[offset + it]
+                    }
+                    offset += FRAME_BUS_SUBSCRIBER_KEYS.size
+                }
+                result["subscribers"] = subscribers
+                result
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error reading frame bus stats: ${e.message}", e)
+                emptyMap()
+            }
+        }
+        
+        /**
+         * JPEG of a leased bus frame from the native encode-once cache
+         * @param scaleDivisor One of JPEG_SCALE_DIVISORS; each size is cached separately
+         * @param meta Receives [jpegToken, sequence, byteCount, encodedNow, width, height]
+         * @return Direct buffer over the cached bytes, valid until releaseJpegBuffer(meta[0]); null on error
+         */
+        fun encodeJpeg(leaseToken: Long, quality: Int, scaleDivisor: Int, meta: LongArray): ByteBuffer? {
+            return try {
+                encodeBusFrameJpeg(leaseToken, quality, scaleDivisor, meta)
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error encoding frame bus JPEG: ${e.message}", e)
+                null
+            }
+        }
+        
+        fun releaseJpegBuffer(jpegToken: Long) {
+            try {
+                releaseJpeg(jpegToken)
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error releasing cached JPEG: ${e.message}", e)
+            }
+        }
+        
+        /**
+         * Requests served by the native JPEG cache versus frames it actually encoded, with sizes and encode times
+         */
+        fun jpegCacheStats(): Map<String, Long> {
+            return try {
+                val values = getJpegCacheStats() ?: return emptyMap()
+                JPEG_CACHE_STAT_KEYS.indices.associate { JPEG_CACHE_STAT_KEYS[it] to values[it] }
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error reading JPEG cache stats: ${e.message}", e)
+                emptyMap()
+            }
+        }
+        
+        /**
+         * A frame scaled down by [scaleDivisor], for JPEG renditions of frames outside the bus.
+         * Packed edges come back as OUTPUT_GRAY8; any other format is kept.
+         * @return null on error
+         */
+        fun scaleFrame(frame: ProcessedFrame, scaleDivisor: Int): ProcessedFrame? {
+            if (scaleDivisor <= 1) return frame
+            return try {
+                val scaled = scaleFrameDown(frame.data, frame.width, frame.height, frame.format, scaleDivisor)
+                    ?: return null
+                val format = if (frame.format == OUTPUT_PACKED_EDGES) OUTPUT_GRAY8 else frame.format
+                ProcessedFrame(scaled, maxOf(1, frame.width / scaleDivisor), maxOf(1, frame.height / scaleDivisor), format)
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error scaling frame: ${e.message}", e)
+                null
+            }
+        }
+        
+        /**
+         * The frame behind a bus lease in the compact edge map wire format (edge-codec.h)
+         * @return null if the frame is not a binary edge map, or on error
+         */
+        fun encodeEdgeMap(leaseToken: Long): ByteArray? {
+            return try {
+                encodeBusFrameEdges(leaseToken)
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error encoding frame bus edge map: ${e.message}", e)
+                null
+            }
+        }
+        
+        /** Same for a ProcessedFrame: packed edges, or gray holding only 0 and 255 */
+        fun encodeEdgeMap(frame: ProcessedFrame): ByteArray? {
+            if (frame.format != OUTPUT_PACKED_EDGES && frame.format != OUTPUT_GRAY8) return null
+            return try {
+                encodeFrameEdges(frame.data, frame.width, frame.height, frame.format)
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error encoding edge map: ${e.message}", e)
+                null
+            }
+        }
+        
+        /**
+         * Edges of the frame behind a bus lease as Douglas-Peucker simplified polylines, in the
+         * edge-contours.h wire format. Frames that are not already an edge map go through Canny first.
+         * @param epsilon Simplification tolerance in pixels
+         * @return null on error
+         */
+        fun traceContours(leaseToken: Long, epsilon: Double, cannyLow: Double, cannyHigh: Double): ByteArray? {
+            return try {
+                traceBusFrameContours(leaseToken, epsilon, cannyLow, cannyHigh)
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error tracing contours: ${e.message}", e)
+                null
+            }
+        }
+        
+        /**
+         * Gray or Canny edges of a bitmap as an OUTPUT_GRAY8 frame, filtered natively
+         * @param mode PREVIEW_GRAY or PREVIEW_EDGES
+         * @return null on error
+         */
+        fun filterBitmap(
+            bitmap: Bitmap,
+            mode: Int,
+            cannyLow: Double = DEFAULT_CANNY_LOW,
+            cannyHigh: Double = DEFAULT_CANNY_HIGH
+        ): ProcessedFrame? {
+            return try {
+                filterBitmapGray(bitmap, mode, cannyLow, cannyHigh)?.let {
+                    ProcessedFrame(it, bitmap.width, bitmap.height, OUTPUT_GRAY8)
+                }
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error filtering bitmap: ${e.message}", e)
+                null
+            }
+        }
+        
+        /**
+         * Native state of one delta-streaming client; see TileDeltaEncoder
+         * @return Handle for encodeDelta() / closeTileDelta(), or 0 on failure
+         */
+        fun openTileDelta(tileSize: Int, keyframeInterval: Int): Long {
+            return try {
+                createTileDelta(tileSize, keyframeInterval)
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error creating tile delta encoder: ${e.message}", e)
+                0L
+            }
+        }
+        
+        /**
+         * Changed tiles (or a keyframe) of a leased bus frame against what the client already shows
+         * @param meta Receives [kind, changedTiles, totalTiles, payloadBytes]
+         * @return Direct buffer over the payload, valid until the next call on [handle]; null on error
+         */
+        fun encodeDelta(handle: Long, leaseToken: Long, quality: Int, forceKeyframe: Boolean, meta: LongArray): ByteBuffer? {
+            return try {
+                encodeTileDelta(handle, leaseToken, quality, forceKeyframe, meta)
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error encoding tile delta: ${e.message}", e)
+                null
+            }
+        }
+        
+        fun closeTileDelta(handle: Long) {
+            try {
+                releaseTileDelta(handle)
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error releasing tile delta encoder: ${e.message}", e)
+            }
+        }
+        
+        /**
+         * Map a camera sensor timestamp onto System.nanoTime()'s clock, whichever clock the
+         * camera stamps with
+         * @return The capture instant on the monotonic clock, or 0 if it cannot be mapped
+         */
+        fun sensorToMonotonic(sensorTimestampNs: Long): Long {
+            return try {
+                sensorTimeToMonotonic(sensorTimestampNs)
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error mapping sensor timestamp: ${e.message}", e)
+                0L
+            }
+        }
+        
+        /**
+         * Have a native thread push a pipeline's frames to [listener]; see FrameBus.Listener
+         * @return Listener id, or -1 on failure
+         */
+        fun registerListener(listener: FrameBus.Listener, stream: Int, maxInFlight: Int): Int {
+            return try {
+                registerFrameListener(listener, listener.name, stream, maxInFlight)
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error registering frame listener '${listener.name}': ${e.message}", e)
+                -1
+            }
+        }
+        
+        /**
+         * Stop deliveries to a listener; returns once a callback in progress has finished
+         */
+        fun unregisterListener(listener: Int) {
+            try {
+                unregisterFrameListener(listener)
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error unregistering frame listener $listener: ${e.message}", e)
+            }
+        }
+        
+        /**
+         * Deliveries, coalesced frames, callback latency and hold time per frame listener (keyed by name)
+         */
+        fun frameListenerStats(): Map<String, Any> {
+            return try {
+                val values = getFrameListenerStats() ?: return emptyMap()
+                val names = getFrameListenerNames() ?: emptyArray()
+                val result = LinkedHashMap<String, Any>()
+                FRAME_LISTENER_STAT_KEYS.forEachIndexed { i, key -> result[key] = values[i] }
+                val listeners = LinkedHashMap<String, Any>()
+                var offset = FRAME_LISTENER_STAT_KEYS.size
+                while (offset + FRAME_LISTENER_KEYS.size <= values.size) {
+                    val index = (offset - FRAME_LISTENER_STAT_KEYS.size) / FRAME_LISTENER_KEYS.size
+                    val name = names.getOrNull(index) ?: "#${values[offset]}"
+                    listeners[name] = FRAME_LISTENER_KEYS.indices.associate {
+                        FRAME_LISTENER_KEYS[it] to values[offset + it]
+                    }
+                    offset += FRAME_LISTENER_KEYS.size
+                }
+                result["listeners"] = listeners
+                result
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error reading frame listener stats: ${e.message}", e)
+                emptyMap()
+            }
+        }
+        
+        /**
+         * Create an independent pipeline stream; see PipelineStream
+         * @return Stream id (its frame bus channel), or -1 on failure
+         */
+        fun newStream(
+            name: String, weight: Int, capacity: Int, previewMode: Int, cannyLow: Double, cannyHigh: Double,
+            scaleDivisor: Int, gaussianKernel: Int, morphIterations: Int
+        ): Int {
+            return try {
+                createStream(
+                    name, weight, capacity, previewMode, cannyLow, cannyHigh,
+                    scaleDivisor, gaussianKernel, morphIterations
+                )
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error creating stream '$name': ${e.message}", e)
+                -1
+            }
+        }
+        
+        fun closeStream(stream: Int) {
+            try {
+                destroyStream(stream)
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error destroying stream $stream: ${e.message}", e)
+            }
+        }
+        
+        /**
+         * Change a stream's share of the work pool relative to the other streams
+         */
+        fun setStreamShare(stream: Int, weight: Int): Boolean {
+            return try {
+                setStreamWeight(stream, weight)
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error setting weight of stream $stream: ${e.message}", e)
+                false
+            }
+        }
+        
+        /**
+         * Publish a stream's own settings; the live preview is configured with publishConfig()
+         * @return The stream's new config version, or -1
+         */
+        fun publishStreamSettings(stream: Int, previewMode: Int, cannyLow: Double, cannyHigh: Double): Long {
+            return try {
+                publishStreamConfig(stream, previewMode, cannyLow, cannyHigh)
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error publishing config of stream $stream: ${e.message}", e)
+                -1
+            }
+        }
+        
+        /**
+         * Queue a YUV_420_888 frame on a stream; returns immediately
+         * @return The frame's per-stream sequence number, or -1 if it was not queued
+         */
+        fun submitToStream(
+            stream: Int, yPlane: ByteBuffer, uPlane: ByteBuffer, vPlane: ByteBuffer,
+            width: Int, height: Int, yRowStride: Int, uvRowStride: Int, uvPixelStride: Int,
+            rotationDegrees: Int, outputFormat: Int, timestampNs: Long
+        ): Long {
+            return try {
+                submitStreamFrame(
+                    stream, yPlane, uPlane, vPlane, width, height, yRowStride, uvRowStride, uvPixelStride,
+                    rotationDegrees, outputFormat, timestampNs
+                )
+            } catch (e: Exception) {
+                Log.e(TAG, "Error submitting frame to stream $stream: ${e.message}", e)
+                -1
+            }
+        }
+        
+        /**
+         * Scheduler occupancy plus queue, drops, pool time and config version per stream (keyed by name)
+         */
+        fun streamStats(): Map<String, Any> {
+            return try {
+                val values = getStreamStats() ?: return emptyMap()
+                val names = getStreamNames() ?: emptyArray()
+                val result = LinkedHashMap<String, Any>()
+                STREAM_STAT_KEYS.forEachIndexed { i, key -> result[key] = values[i] }
+                val streams = LinkedHashMap<String, Any>()
+                var offset = STREAM_STAT_KEYS.size
+                while (offset + STREAM_KEYS.size <= values.size) {
+                    val index = (offset - STREAM_STAT_KEYS.size) / STREAM_KEYS.size
+                    val name = names.getOrNull(index) ?: "#${values[offset]}"
+                    streams[name] = STREAM_KEYS.indices.associate { STREAM_KEYS[it] to values[offset + it] }
+                    offset += STREAM_KEYS.size
+                }
+                result["streams"] = streams
+                result
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error reading stream stats: ${e.message}", e)
+                emptyMap()
+            }
+        }
+        
+        /**
+         * Publish the live preview settings. Native workers pick the new snapshot up at the
+         * start of their next frame, never halfway through one.
+         * @param previewMode PREVIEW_EDGES or PREVIEW_GRAY
+         * @return The new config version (see FrameBus.Lease.configVersion), or -1
+         */
+        fun publishConfig(
+            previewMode: Int,
+            cannyLow: Double = DEFAULT_CANNY_LOW,
+            cannyHigh: Double = DEFAULT_CANNY_HIGH
+        ): Long {
+            return try {
+                publishPipelineConfig(previewMode, cannyLow, cannyHigh)
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error publishing pipeline config: ${e.message}", e)
+                -1
+            }
+        }
+        
+        /**
+         * Current config snapshot and how many replaced snapshots are still awaiting reclamation
+         */
+        fun pipelineConfigStats(): Map<String, Long> {
+            return try {
+                val values = getPipelineConfig() ?: return emptyMap()
+                PIPELINE_CONFIG_KEYS.indices.associate { PIPELINE_CONFIG_KEYS[it] to values[it] }
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error reading pipeline config: ${e.message}", e)
+                emptyMap()
+            }
+        }
+        
+        /**
+         * Hold async preview latency under a budget by lowering resolution, blur and
+         * morphology (and finally skipping frames) when frames run late
+         * @param targetMs Submit-to-result target, e.g. 33; 0 turns the scheduler off
+         */
+        fun setLatencyTarget(targetMs: Int) {
+            try {
+                setLatencyBudget(targetMs)
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error setting latency budget: ${e.message}", e)
+            }
+        }
+        
+        /**
+         * Latency scheduler state: current quality level and its settings, latencies, stage times
+         */
+        fun latencySchedulerStats(): Map<String, Long> {
+            return try {
+                val values = getLatencySchedulerStats() ?: return emptyMap()
+                LATENCY_SCHEDULER_STAT_KEYS.indices.associate { LATENCY_SCHEDULER_STAT_KEYS[it] to values[it] }
+            } catch (e: Throwable) {
+                Log.e(TAG, "Error reading latency scheduler stats: ${e.message}", e)
+                emptyMap()
+            }
+        }
+        
+        /**
+         * Run the edge pipeline over many Mats in one native call, in parallel on the native worker pool
+         * @param matAddrs Handles of the input Mats (1, 3 or 4 channels)
+         * @param config Pipeline parameters applied to every item
+         * @return Result handles (0 where status != BATCH_OK; caller must releaseMat the others), or null on failure
+         */
+        fun runPipelineBatch(matAddrs: LongArray, config: PipelineConfig = PipelineConfig()): BatchResult<LongArray>? {
+            return try {
+                val handles = LongArray(matAddrs.size)
+                val status = runPipelineOnMatBatch(
+                    matAddrs, handles,
+                    config.gaussianKernel, config.sigmaX, config.sigmaY,
+                    config.cannyLow, config.cannyHigh, config.morphIterations, config.outputGray,
+                    config.outputFormat
+                ) ?: return null
+                BatchResult(handles, status)
+            } catch (e: Exception) {
+                Log.e(TAG, "Error running pipeline batch: ${e.message}", e)
+                null
+            }
+        }
+        
+        /**
+         * Run the edge pipeline over many RGBA buffers in one native call
+         * @param rgbaBuffers Tightly packed RGBA_8888 frames
+         * @param widths Width of each frame
+         * @param heights Height of each frame
+         * @param config Pipeline parameters applied to every item
+         * @return Outputs, RGBA unless config.outputFormat says otherwise (null where status != BATCH_OK), or null on failure
+         */
+        fun processRgbaBatch(
+            rgbaBuffers: Array<ByteArray?>,
+            widths: IntArray,
+            heights: IntArray,
+            config: PipelineConfig = PipelineConfig()
+        ): BatchResult<Array<ByteArray?>>? {
+            return try {
+                val outputs = arrayOfNulls<ByteArray>(rgbaBuffers.size)
+                val status = processRgbaBufferBatch(
+                    rgbaBuffers, widths, heights, outputs,
+                    config.gaussianKernel, config.sigmaX, config.sigmaY,
+                    config.cannyLow, config.cannyHigh, config.morphIterations, config.outputGray,
+                    config.outputFormat
+                ) ?: return null
+                BatchResult(outputs, status)
+            } catch (e: Exception) {
+                Log.e(TAG, "Error processing RGBA batch: ${e.message}", e)
+                null
+            }
+        }
     }
-}
\ No newline at end of file
+}
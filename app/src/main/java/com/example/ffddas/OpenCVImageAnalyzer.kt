@@ -14,21 +14,39 @@ import java.nio.ByteBuffer
 import java.nio.ByteOrder
 
 class OpenCVImageAnalyzer(
-    private val onFrameProcessed: (Bitmap) -> Unit,
+    private val onFrameProcessed: (Bitmap, FrameTiming) -> Unit,
     private val filterProvider: () -> MainActivity.FilterType,
-    private val minFrameInterval: Long = 150 // Configurable frame interval in milliseconds
-) : ImageAnalysis.Analyzer {
+    private val minFrameInterval: Long = 150, // Configurable frame interval in milliseconds
+    private val lowMemoryMode: Boolean = false, // RGB_565 end-to-end (half the bandwidth of RGBA)
+    private val asyncQueueDepth: Int = AsyncFramePipeline.DEFAULT_CAPACITY, // 0 processes on the camera thread
+    private val asyncExecutionMode: Int = NativeOpenCVHelper.ASYNC_MODE_LOW_LATENCY,
+    private val latencyBudgetMs: Int = 0 // > 0: native scheduler adapts quality instead of minFrameInterval
+) : ImageAnalysis.Analyzer, AutoCloseable {
+
+    private val outputFormat = if (lowMemoryMode) NativeOpenCVHelper.OUTPUT_RGB565 else NativeOpenCVHelper.OUTPUT_RGBA
+    private val bitmapConfig = NativeOpenCVHelper.bitmapConfig(outputFormat)
+
+    // Native worker pipeline; frames are handed off and analyze() returns at once
+    private val asyncPipeline: AsyncFramePipeline? =
+        if (asyncQueueDepth > 0) AsyncFramePipeline(asyncQueueDepth, asyncExecutionMode, latencyBudgetMs) { onAsyncResult(it) } else null
+
+    @Volatile private var closed = false
 
     // Frame rate control - process every N milliseconds
     private var lastProcessedTime: Long = 0
 
+    // Sequence numbers of frames processed on the camera thread
+    private var syncSequence = 0L
+
     override fun analyze(image: ImageProxy) {
         try {
             Log.d(TAG, "Analyzing image")
             
-            // Frame rate control - check if enough time has passed since last processing
+            // Frame rate control - check if enough time has passed since last processing.
+            // With a latency budget the native scheduler paces async frames itself.
             val currentTime = System.currentTimeMillis()
-            if (currentTime - lastProcessedTime < minFrameInterval) {
+            val interval = if (latencyBudgetMs > 0 && asyncPipeline?.isRunning == true) 0L else minFrameInterval
+            if (currentTime - lastProcessedTime < interval) {
                 Log.d(TAG, "Skipping frame to control frame rate")
                 image.close()
                 return
@@ -43,6 +61,13 @@ class OpenCVImageAnalyzer(
                 return
             }
 
+            if (submitAsync(image, filter)) {
+                lastProcessedTime = currentTime
+                image.close()
+                return
+            }
+
+            val ingestNs = System.nanoTime()
             val nv21 = yuv420ToNV21(image)
 
             val width = image.width
@@ -54,32 +79,34 @@ class OpenCVImageAnalyzer(
                     val direct = ByteBuffer.allocateDirect(nv21.size).order(ByteOrder.nativeOrder())
                     direct.put(nv21)
                     direct.position(0)
-                    val rgba = NativeOpenCVHelper.processPreview(direct, width, height)
-                    if (rgba != null && rgba.size >= width * height * 4) {
-                        val bmp = Bitmap.createBitmap(width, height, Bitmap.Config.ARGB_8888)
-                        bmp.copyPixelsFromBuffer(ByteBuffer.wrap(rgba))
-                        if (image.imageInfo.rotationDegrees != 0) {
-                            val m = Matrix()
-                            m.postRotate(image.imageInfo.rotationDegrees.toFloat())
-                            val rotated = Bitmap.createBitmap(bmp, 0, 0, bmp.width, bmp.height, m, true)
-                            if (rotated != bmp) bmp.recycle()
-                            rotated
-                        } else bmp
+                    val pixels = NativeOpenCVHelper.processPreview(direct, width, height, outputFormat)
+                    if (pixels != null) {
+                        toBitmap(ProcessedFrame(pixels, width, height, outputFormat), image.imageInfo.rotationDegrees)
                     } else null
                 }
+                MainActivity.FilterType.COMPARE -> {
+                    // All views from one native call sharing luma, blur and color conversion;
+                    // half-size tiles keep the 2x2 grid at the camera's resolution
+                    val direct = ByteBuffer.allocateDirect(nv21.size).order(ByteOrder.nativeOrder())
+                    direct.put(nv21)
+                    direct.position(0)
+                    NativeOpenCVHelper.processMultiViewGrid(
+                        direct, width, height, NativeOpenCVHelper.COMPARE_VIEWS, outputFormat, scaleDivisor = 2
+                    )?.let { toBitmap(it, image.imageInfo.rotationDegrees) }
+                }
                 MainActivity.FilterType.GRAYSCALE -> {
                     // Convert NV21 -> Bitmap once, then native grayscale
                     var baseBitmap = nv21ToBitmap(nv21, width, height, image.imageInfo.rotationDegrees)
                     if (baseBitmap == null || baseBitmap.isRecycled) null else {
-                        if (baseBitmap.config != Bitmap.Config.ARGB_8888 || !baseBitmap.isMutable) {
-                            val copy = baseBitmap.copy(Bitmap.Config.ARGB_8888, true)
+                        if (baseBitmap.config != bitmapConfig || !baseBitmap.isMutable) {
+                            val copy = baseBitmap.copy(bitmapConfig, true)
                             if (copy != baseBitmap) baseBitmap.recycle()
                             baseBitmap = copy
                         }
                         val matAddr = NativeOpenCVHelper.convertBitmapToMat(baseBitmap)
                         if (matAddr == 0L) null else {
                             val grayAddr = NativeOpenCVHelper.convertToGrayscale(matAddr)
-                            val out = Bitmap.createBitmap(baseBitmap.width, baseBitmap.height, Bitmap.Config.ARGB_8888)
+                            val out = Bitmap.createBitmap(baseBitmap.width, baseBitmap.height, bitmapConfig)
                             val ok = (grayAddr != 0L) && NativeOpenCVHelper.convertMatToBitmap(grayAddr, out)
                             NativeOpenCVHelper.releaseMat(grayAddr)
                             NativeOpenCVHelper.releaseMat(matAddr)
@@ -97,7 +124,8 @@ class OpenCVImageAnalyzer(
             }
 
             lastProcessedTime = currentTime
-            onFrameProcessed(processedBitmap)
+            val timing = FrameTiming.synchronous(++syncSequence, image.imageInfo.timestamp, ingestNs, System.nanoTime())
+            onFrameProcessed(processedBitmap, timing)
             image.close()
             Log.d(TAG, "Image analysis completed")
         } catch (e: Exception) {
@@ -110,12 +138,66 @@ class OpenCVImageAnalyzer(
         }
     }
 
+    private fun submitAsync(image: ImageProxy, filter: MainActivity.FilterType): Boolean {
+        val pipeline = asyncPipeline ?: return false
+        if (closed) return false
+        // Edges vs gray is read natively from the published PipelineConfig (see MainActivity.onFilterChanged)
+        if (filter != MainActivity.FilterType.EDGE_DETECTION && filter != MainActivity.FilterType.GRAYSCALE) return false
+        if (!pipeline.isRunning && !pipeline.start()) return false
+        return pipeline.submit(image, outputFormat)
+    }
+
+    // Runs on the async delivery thread
+    private fun onAsyncResult(lease: FrameBus.Lease) {
+        if (filterProvider() == MainActivity.FilterType.NONE) return
+        val bitmap = toBitmap(lease)
+        if (bitmap == null) {
+            Log.e(TAG, "Async frame ${lease.sequence} could not be converted")
+            return
+        }
+        onFrameProcessed(bitmap, lease.timing)
+    }
+
+    private fun toBitmap(lease: FrameBus.Lease): Bitmap? {
+        // Tight rows go straight from the shared native buffer into the Bitmap
+        if (!lease.isTight) return toBitmap(lease.copyToFrame(), lease.rotationDegrees)
+        val bmp = Bitmap.createBitmap(lease.width, lease.height, NativeOpenCVHelper.bitmapConfig(lease.format))
+        bmp.copyPixelsFromBuffer(lease.pixels.duplicate())
+        return rotate(bmp, lease.rotationDegrees)
+    }
+
+    private fun toBitmap(frame: ProcessedFrame, rotationDegrees: Int): Bitmap? {
+        if (!frame.isValid()) return null
+        val bmp = Bitmap.createBitmap(frame.width, frame.height, NativeOpenCVHelper.bitmapConfig(frame.format))
+        bmp.copyPixelsFromBuffer(ByteBuffer.wrap(frame.data))
+        return rotate(bmp, rotationDegrees)
+    }
+
+    private fun rotate(bmp: Bitmap, rotationDegrees: Int): Bitmap {
+        if (rotationDegrees == 0) return bmp
+        val m = Matrix()
+        m.postRotate(rotationDegrees.toFloat())
+        val rotated = Bitmap.createBitmap(bmp, 0, 0, bmp.width, bmp.height, m, true)
+        if (rotated != bmp) bmp.recycle()
+        return rotated
+    }
+
+    /** Stops the native workers; frames still arriving afterwards are processed synchronously */
+    override fun close() {
+        closed = true
+        asyncPipeline?.close()
+    }
+
     private fun nv21ToBitmap(nv21: ByteArray, width: Int, height: Int, rotationDegrees: Int): Bitmap? {
         val yuvImage = YuvImage(nv21, ImageFormat.NV21, width, height, null)
         val out = ByteArrayOutputStream()
         yuvImage.compressToJpeg(Rect(0, 0, width, height), 85, out)
         val imageBytes = out.toByteArray()
-        var bitmap = BitmapFactory.decodeByteArray(imageBytes, 0, imageBytes.size) ?: return null
+        val options = BitmapFactory.Options().apply {
+            inPreferredConfig = bitmapConfig
+            inMutable = true
+        }
+        var bitmap = BitmapFactory.decodeByteArray(imageBytes, 0, imageBytes.size, options) ?: return null
         if (rotationDegrees != 0) {
             val m = Matrix()
             m.postRotate(rotationDegrees.toFloat())
@@ -92,8 +92,8 @@ class OpenCVProcessor(cascadeFile: File) {
                     Log.d(TAG, "Applying GRAYSCALE filter")
                     grayMat
                 }
-                MainActivity.FilterType.NONE -> {
-                    Log.d(TAG, "NONE filter -> grayscale")
+                MainActivity.FilterType.NONE, MainActivity.FilterType.COMPARE -> {
+                    Log.d(TAG, "$currentFilter filter -> grayscale")
                     grayMat
                 }
             }
@@ -0,0 +1,79 @@
+package com.example.ffddas
+
+import androidx.camera.core.ImageProxy
+
+/**
+ * An extra native processing stream next to the live preview, e.g. a second
+ * analysis of the same camera with other thresholds, or a second camera.
+ *
+ * The stream has its own configuration, quality settings, sequence numbers and
+ * statistics. Its frames run on the shared native work pool, where streams
+ * get pool time in proportion to [weight]; the live preview keeps its own
+ * threads, so a heavy stream cannot starve it. Results are published on the
+ * frame bus under [id]; read them with [subscribe].
+ */
+class PipelineStream(
+    val name: String,
+    weight: Int = DEFAULT_WEIGHT,
+    capacity: Int = DEFAULT_CAPACITY,
+    previewMode: Int = NativeOpenCVHelper.PREVIEW_EDGES,
+    cannyLow: Double = NativeOpenCVHelper.DEFAULT_CANNY_LOW,
+    cannyHigh: Double = NativeOpenCVHelper.DEFAULT_CANNY_HIGH,
+    scaleDivisor: Int = 1,
+    gaussianKernel: Int = 1,
+    morphIterations: Int = 0
+) : AutoCloseable {
+
+    @Volatile var id: Int = NativeOpenCVHelper.newStream(
+        name, weight, capacity, previewMode, cannyLow, cannyHigh, scaleDivisor, gaussianKernel, morphIterations
+    )
+        private set
+
+    val isOpen: Boolean get() = id > 0
+
+    /**
+     * Queue a frame; the ImageProxy can be closed as soon as this returns
+     * @return The frame's sequence number within this stream, or -1 if it was not queued
+     */
+    fun submit(image: ImageProxy, outputFormat: Int): Long {
+        val stream = id
+        if (stream <= 0) return -1
+        val planes = image.planes
+        if (planes.size < 3) return -1
+        return NativeOpenCVHelper.submitToStream(
+            stream, planes[0].buffer, planes[1].buffer, planes[2].buffer,
+            image.width, image.height,
+            planes[0].rowStride, planes[1].rowStride, planes[1].pixelStride,
+            image.imageInfo.rotationDegrees, outputFormat, image.imageInfo.timestamp
+        )
+    }
+
+    /** @return The stream's new config version, or -1 */
+    fun publishConfig(
+        previewMode: Int,
+        cannyLow: Double = NativeOpenCVHelper.DEFAULT_CANNY_LOW,
+        cannyHigh: Double = NativeOpenCVHelper.DEFAULT_CANNY_HIGH
+    ): Long = if (isOpen) NativeOpenCVHelper.publishStreamSettings(id, previewMode, cannyLow, cannyHigh) else -1
+
+    fun setWeight(weight: Int): Boolean = isOpen && NativeOpenCVHelper.setStreamShare(id, weight)
+
+    fun subscribe(subscriber: String, capacity: Int = 1, policy: Int = FrameBus.DROP_OLDEST): FrameBus.Subscription =
+        FrameBus.Subscription(subscriber, capacity, policy, id)
+
+    /** Push delivery of this stream's frames from a native thread; see FrameBus.Listener */
+    fun listen(listener: String, maxInFlight: Int = 1, onFrame: (FrameBus.Lease) -> Unit): FrameBus.Listener =
+        FrameBus.Listener(listener, id, maxInFlight, onFrame)
+
+    @Synchronized
+    override fun close() {
+        val stream = id
+        if (stream <= 0) return
+        id = -1
+        NativeOpenCVHelper.closeStream(stream)
+    }
+
+    companion object {
+        const val DEFAULT_WEIGHT = 10 // StreamRegistry::kDefaultWeight
+        const val DEFAULT_CAPACITY = 2
+    }
+}
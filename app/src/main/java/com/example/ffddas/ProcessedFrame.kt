@@ -0,0 +1,18 @@
+package com.example.ffddas
+
+/**
+ * Pixels produced by the native pipeline in one of the NativeOpenCVHelper.OUTPUT_* formats.
+ * Lets gray and packed edge frames reach the renderer and web server without being
+ * widened to RGBA first.
+ */
+class ProcessedFrame(
+    val data: ByteArray,
+    val width: Int,
+    val height: Int,
+    val format: Int
+) {
+    val rowStride: Int get() = NativeOpenCVHelper.rowStride(format, width)
+
+    fun isValid(): Boolean =
+        width > 0 && height > 0 && data.size >= NativeOpenCVHelper.frameSize(format, width, height)
+}
@@ -0,0 +1,45 @@
+package com.example.ffddas
+
+import java.nio.ByteBuffer
+
+/**
+ * Native delta encoder for one streaming client (see tile-delta.h): each frame
+ * becomes either nothing, a keyframe JPEG, or just the tiles that changed
+ * since what the client shows. Use from one thread at a time and [close] it
+ * when the client leaves.
+ */
+class TileDeltaEncoder(tileSize: Int = 0, keyframeInterval: Int = 0) : AutoCloseable {
+    private var handle = NativeOpenCVHelper.openTileDelta(tileSize, keyframeInterval)
+    private val meta = LongArray(META_SIZE)
+
+    val isOpen: Boolean get() = handle != 0L
+
+    /**
+     * [payload] is only valid until the next [encode]: a whole-frame JPEG for KIND_KEYFRAME,
+     * the tile list for KIND_TILES and empty for KIND_UNCHANGED
+     */
+    class Delta(val kind: Int, val changedTiles: Int, val totalTiles: Int, val payload: ByteBuffer)
+
+    /** null on error; the next frame is then a keyframe */
+    fun encode(lease: FrameBus.Lease, quality: Int, forceKeyframe: Boolean = false): Delta? {
+        if (handle == 0L) return null
+        val payload = NativeOpenCVHelper.encodeDelta(handle, lease.token, quality, forceKeyframe, meta) ?: return null
+        return Delta(meta[0].toInt(), meta[1].toInt(), meta[2].toInt(), payload)
+    }
+
+    override fun close() {
+        val current = handle
+        if (current == 0L) return
+        handle = 0L
+        NativeOpenCVHelper.closeTileDelta(current)
+    }
+
+    companion object {
+        // Values mirror TileDeltaKind in tile-delta.h
+        const val KIND_UNCHANGED = 0
+        const val KIND_KEYFRAME = 1
+        const val KIND_TILES = 2
+
+        private const val META_SIZE = 4
+    }
+}
@@ -1,24 +1,97 @@
 package com.example.ffddas
 
 import android.graphics.Bitmap
+import android.graphics.ImageFormat
+import android.graphics.Rect
+import android.graphics.YuvImage
 import android.util.Log
 import fi.iki.elonen.NanoHTTPD
 import fi.iki.elonen.NanoHTTPD.Response
+import fi.iki.elonen.NanoWSD
+import fi.iki.elonen.NanoWSD.WebSocketFrame
 import java.io.ByteArrayInputStream
 import java.io.ByteArrayOutputStream
+import java.io.IOException
+import java.io.InputStream
+import java.io.OutputStream
+import java.io.SequenceInputStream
+import java.net.Socket
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+import java.util.ArrayDeque
+import java.util.Locale
+import java.util.Vector
+import java.util.concurrent.RejectedExecutionException
+import java.util.concurrent.SynchronousQueue
+import java.util.concurrent.ThreadFactory
+import java.util.concurrent.ThreadPoolExecutor
+import java.util.concurrent.TimeUnit
+import java.util.concurrent.atomic.AtomicBoolean
+import java.util.concurrent.atomic.AtomicInteger
+import java.util.concurrent.atomic.AtomicLong
+import java.util.concurrent.atomic.AtomicLongArray
 import java.util.concurrent.atomic.AtomicReference
+import java.util.concurrent.atomic.AtomicReferenceArray
+import java.util.concurrent.locks.ReentrantLock
+import kotlin.concurrent.withLock
 
 /**
  * Embedded HTTP server for serving processed camera frames to web clients
  */
-class WebServerService(port: Int = 8080) : NanoHTTPD("0.0.0.0", port) {
+class WebServerService(port: Int = 8080) : NanoWSD("0.0.0.0", port) {
     
     companion object {
         private const val TAG = "WebServerService"
-        enum class FilterMode { NONE, GRAYSCALE, EDGE_DETECTION }
+        const val HTTP_SUBSCRIBER = "http"
+        // App bitmaps are ignored while the frame bus delivered something this recently
+        private const val BUS_PREFERENCE_NS = 500_000_000L
+        private const val JPEG_QUALITY = 85
+        private const val MJPEG_BOUNDARY = "ffddasframe"
+        // An idle /stream re-checks this often whether the server or the client has gone away
+        private const val STREAM_WAIT_MS = 1000L
+        // /frame?after= holds the request this long (or ?timeout=<ms>, up to the max) for a newer frame
+        private const val LONG_POLL_MS = 5000L
+        private const val MAX_LONG_POLL_MS = 20_000L
+        // ServedFrame.sequence: every frame the server publishes gets the next one
+        private val servedSequence = AtomicLong()
+        // Connections served at once, and how many more may wait for a worker before being shed with 503
+        private const val HTTP_WORKER_THREADS = 16
+        private const val HTTP_QUEUE_LIMIT = 32
+        // Requests that hold a worker for long, capped so they can never take every worker
+        private const val MAX_MJPEG_STREAMS = 4
+        private const val MAX_WEB_SOCKETS = 4
+        private const val PUSH_THREAD_IDLE_SECONDS = 30L
+        private const val MAX_CONTOUR_STREAMS = 2
+        private const val MAX_LONG_POLLS = 4
+        // /api/status gathers native stats; dashboards polling it in a burst get 503 rather than a queue
+        private const val MAX_STATUS_REQUESTS = 2
+        private const val MAX_STREAM_FPS = 60
+        private val PART_END = "\r\n".toByteArray(Charsets.US_ASCII)
+        // /ws binary message header, see FrameSocket
+        private const val WS_HEADER_BYTES = 32
+        private const val WS_VERSION: Byte = 1
+        private const val WS_FORMAT_JPEG: Byte = 1
+        private const val WS_FORMAT_TILES: Byte = 2
+        private const val WS_FORMAT_EDGES: Byte = 3
+        private const val WS_FORMAT_CONTOURS: Byte = 4
+        // /api/contours: one contour set (edge-contours.h), or a stream of them as /ws-style records
+        private const val CONTOURS_MIME = "application/x-ffddas-contours"
+        private const val CONTOUR_STREAM_MIME = "application/x-ffddas-contour-stream"
+        private const val DEFAULT_CONTOUR_EPSILON = 1.5
+        private const val MAX_CONTOUR_EPSILON = 20.0
+        // Binary edge maps in the edge-codec.h layout, for /frame clients that accept it
+        private const val EDGE_MAP_MIME = "application/x-ffddas-edges"
+        // ServedFrame.edges once a frame turned out not to be a binary edge map
+        private val NO_EDGE_MAP = ByteArray(0)
+        private const val DEFAULT_WS_WINDOW = 2
+        private const val MAX_WS_WINDOW = 8
+        // Idle sockets are pinged this often so the client's pongs keep NanoHTTPD's read timeout from closing them
+        private const val WS_PING_INTERVAL_NS = 2_000_000_000L
         private var filterMode: FilterMode = FilterMode.NONE
     }
 
+    enum class FilterMode { NONE, GRAYSCALE, EDGE_DETECTION }
+
     // Callback hooks provided by MainActivity
     private var captureCallback: (() -> Boolean)? = null
     private var switchCameraCallback: (() -> Boolean)? = null
@@ -219,13 +292,21 @@ class WebServerService(port: Int = 8080) : NanoHTTPD("0.0.0.0", port) {
             </div>
         </div>
         <div class="controls">
+            <select id="transport">
+                <option value="ws" selected>WebSocket</option>
+                <option value="tiles">WebSocket (tiles)</option>
+                <option value="mjpeg">MJPEG</option>
+                <option value="poll">Long-poll</option>
+                <option value="contours">Contours</option>
+            </select>
             <select id="refreshRate">
-                <option value="100">Fast (100ms)</option>
-                <option value="250" selected>Normal (250ms)</option>
-                <option value="500">Slow (500ms)</option>
-                <option value="1000">Very Slow (1s)</option>
+                <option value="0" selected>Live</option>
+                <option value="30">30 fps</option>
+                <option value="15">15 fps</option>
+                <option value="5">5 fps</option>
+                <option value="1">1 fps</option>
             </select>
-            <button id="refreshBtn">Refresh Now</button>
+            <button id="refreshBtn">Reconnect</button>
         </div>
     </div>
     
@@ -250,6 +331,14 @@ class WebServerService(port: Int = 8080) : NanoHTTPD("0.0.0.0", port) {
             <div class="stat-label">Resolution</div>
             <div class="stat-value" id="resolution">-</div>
         </div>
+        <div class="stat-item">
+            <div class="stat-label">Latency (p50)</div>
+            <div class="stat-value" id="latency">-</div>
+        </div>
+        <div class="stat-item">
+            <div class="stat-label">Data</div>
+            <div class="stat-value" id="dataRate">-</div>
+        </div>
     </div>
 
     <script>
@@ -264,29 +353,43 @@ class WebServerService(port: Int = 8080) : NanoHTTPD("0.0.0.0", port) {
                 this.frameCountElement = document.getElementById('frameCount');
                 this.errorCountElement = document.getElementById('errorCount');
                 this.resolutionElement = document.getElementById('resolution');
+                this.latencyElement = document.getElementById('latency');
+                this.dataRateElement = document.getElementById('dataRate');
                 this.refreshRateSelect = document.getElementById('refreshRate');
+                this.transportSelect = document.getElementById('transport');
                 this.refreshBtn = document.getElementById('refreshBtn');
                 
                 this.frameCount = 0;
                 this.errorCount = 0;
                 this.lastFrameTime = Date.now();
                 this.fps = 0;
-                this.intervalId = null;
+                this.streamController = null; // aborts the open /stream request
+                this.socket = null;           // or the open /ws socket
+                this.drawChain = Promise.resolve(); // WebSocket frames are drawn in arrival order
+                this.retryId = null;
+                this.halfRoundTrip = 0;       // one-way network estimate from opening the stream
                 this.currentImage = null;
+                this.frameCanvas = null;      // tile mode: the picture tiles are pasted onto
+                this.receivedBytes = 0;       // since the data rate was last shown
                 this.isConnected = false;
+                this.latencies = [];       // recent capture-to-draw samples, ms
+                this.pendingReports = [];  // samples not yet sent to /api/latency
                 
                 this.init();
             }
             
             init() {
-                this.refreshBtn.addEventListener('click', () => this.fetchFrame());
-                this.refreshRateSelect.addEventListener('change', () => this.updateRefreshRate());
+                this.refreshBtn.addEventListener('click', () => this.startStream());
+                this.refreshRateSelect.addEventListener('change', () => this.startStream());
+                this.transportSelect.addEventListener('change', () => this.startStream());
                 
                 // Initial canvas size
                 this.resizeCanvas();
                 window.addEventListener('resize', () => this.resizeCanvas());
                 
-                this.updateRefreshRate();
+                this.startStream();
+                setInterval(() => this.reportLatency(), 2000);
+                setInterval(() => this.updateDataRate(), 1000);
             }
             
             resizeCanvas() {
@@ -313,51 +416,402 @@ class WebServerService(port: Int = 8080) : NanoHTTPD("0.0.0.0", port) {
                 }
             }
             
-            updateRefreshRate() {
-                if (this.intervalId) {
-                    clearInterval(this.intervalId);
+            // Frames are pushed over /ws as binary messages the page acknowledges, or over /stream as
+            // multipart/x-mixed-replace parts, or long-polled from /frame; at most maxFps per second
+            startStream() {
+                this.stopStream();
+                const transport = this.transportSelect.value;
+                const drawn = transport === 'tiles' || transport === 'contours';
+                this.frameCanvas = drawn ? document.createElement('canvas') : null;
+                if (transport === 'contours') {
+                    this.startFetch('/api/contours?maxFps=' + this.refreshRateSelect.value, reader => this.readRecords(reader));
+                } else if (transport === 'poll') {
+                    this.startPoll();
+                } else if (transport !== 'mjpeg' && 'WebSocket' in window) {
+                    this.startSocket(transport === 'tiles');
+                } else {
+                    this.frameCanvas = null;
+                    this.startFetch('/stream?maxFps=' + this.refreshRateSelect.value, reader => this.readParts(reader));
+                }
+            }
+            
+            // With delta the server sends only the tiles that changed between keyframes
+            startSocket(delta) {
+                const opened = performance.now();
+                const scheme = location.protocol === 'https:' ? 'wss://' : 'ws://';
+                const socket = new WebSocket(scheme + location.host + '/ws?' + (delta ? 'delta=1&' : '') +
+                    'window=2&maxFps=' + this.refreshRateSelect.value);
+                socket.binaryType = 'arraybuffer';
+                this.socket = socket;
+                socket.onopen = () => {
+                    this.halfRoundTrip = (performance.now() - opened) / 2;
+                };
+                socket.onmessage = (event) => {
+                    const received = performance.now();
+                    this.receivedBytes += event.data.byteLength;
+                    this.drawChain = this.drawChain.then(() => this.showMessage(socket, event.data, received));
+                };
+                socket.onclose = () => {
+                    if (this.socket !== socket) return;
+                    this.socket = null;
+                    this.errorCount++;
+                    this.updateStatus(false);
+                    this.updateStats();
+                    this.retryId = setTimeout(() => this.startStream(), 1000);
+                };
+            }
+            
+            // Header layout as documented on WebServerService.FrameSocket (little-endian)
+            async showMessage(socket, data, received) {
+                const view = new DataView(data);
+                const headerBytes = view.getUint16(0, true);
+                const format = view.getUint8(3);
+                const sequence = view.getFloat64(8, true);
+                const age = view.getFloat32(24, true);
+                const length = view.getUint32(28, true);
+                try {
+                    if (format === 2) {
+                        await this.showTiles(data, headerBytes, age >= 0 ? age : NaN, received);
+                    } else if (format === 3) {
+                        const edges = this.decodeEdgeMap(new Uint8Array(data, headerBytes, length));
+                        this.showBitmap(await createImageBitmap(edges), age >= 0 ? age : NaN, received);
+                    } else {
+                        const jpeg = new Blob([new Uint8Array(data, headerBytes, length)], { type: 'image/jpeg' });
+                        await this.showImage(jpeg, age >= 0 ? age : NaN, received);
+                    }
+                } catch (error) {
+                    console.error('Frame decode error:', error);
+                    this.errorCount++;
+                } finally {
+                    // Acknowledge once drawn, so the server's window counts frames the page has really shown
+                    if (socket.readyState === WebSocket.OPEN) socket.send('ack ' + sequence);
                 }
-                
-                const rate = parseInt(this.refreshRateSelect.value);
-                this.intervalId = setInterval(() => this.fetchFrame(), rate);
-                this.fetchFrame(); // Immediate fetch
             }
             
-            async fetchFrame() {
+            // A pushed HTTP stream (/stream or /api/contours) whose body read() consumes
+            async startFetch(url, read) {
+                const controller = new AbortController();
+                this.streamController = controller;
                 try {
-                    const response = await fetch('/frame?' + Date.now(), {
+                    const requested = performance.now();
+                    const response = await fetch(url, {
                         cache: 'no-store',
-                        signal: AbortSignal.timeout(5000)
+                        signal: controller.signal
                     });
-                    
-                    if (!response.ok) {
+                    if (!response.ok || !response.body) {
                         throw new Error('HTTP ' + response.status);
                     }
-                    
-                    const blob = await response.blob();
-                    const img = await this.loadImage(blob);
-                    
-                    this.currentImage = img;
-                    this.frameCount++;
-                    this.updateStatus(true);
+                    this.halfRoundTrip = (performance.now() - requested) / 2;
+                    await read(response.body.getReader());
+                } catch (error) {
+                    if (controller.signal.aborted) return;
+                    console.error('Stream error:', error);
+                    this.errorCount++;
+                    this.updateStatus(false);
                     this.updateStats();
-                    this.resizeCanvas();
-                    
+                }
+                // The stream ended or failed on its own: reconnect unless a newer one replaced it
+                if (this.streamController === controller) {
+                    this.streamController = null;
+                    this.retryId = setTimeout(() => this.startStream(), 1000);
+                }
+            }
+            
+            // Each /frame request names the frame already shown (after=); the server holds it until
+            // there is another one and answers 304 if none arrived in time, so nothing is sent twice
+            async startPoll() {
+                const controller = new AbortController();
+                this.streamController = controller;
+                const rate = parseInt(this.refreshRateSelect.value);
+                let shown = -1;
+                try {
+                    while (this.streamController === controller) {
+                        const requested = performance.now();
+                        const response = await fetch('/frame?after=' + shown, {
+                            cache: 'no-store',
+                            signal: controller.signal
+                        });
+                        if (response.status === 304) continue;
+                        if (!response.ok) throw new Error('HTTP ' + response.status);
+                        const jpeg = await response.blob();
+                        const received = performance.now();
+                        shown = parseInt(response.headers.get('X-Served-Sequence'));
+                        this.receivedBytes += jpeg.size;
+                        // The time the server held the request is not network time
+                        const held = parseFloat(response.headers.get('X-Frame-Server-Ms')) || 0;
+                        this.halfRoundTrip = Math.max(0, received - requested - held) / 2;
+                        await this.showImage(jpeg, parseFloat(response.headers.get('X-Frame-Age-Ms')), received);
+                        const wait = rate > 0 ? requested + 1000 / rate - performance.now() : 0;
+                        if (wait > 0) await new Promise(resolve => setTimeout(resolve, wait));
+                    }
                 } catch (error) {
-                    console.error('Frame fetch error:', error);
+                    if (controller.signal.aborted) return;
+                    console.error('Poll error:', error);
                     this.errorCount++;
                     this.updateStatus(false);
                     this.updateStats();
                 }
+                if (this.streamController === controller) {
+                    this.streamController = null;
+                    this.retryId = setTimeout(() => this.startStream(), 1000);
+                }
+            }
+            
+            stopStream() {
+                if (this.retryId) {
+                    clearTimeout(this.retryId);
+                    this.retryId = null;
+                }
+                const controller = this.streamController;
+                this.streamController = null;
+                if (controller) controller.abort();
+                const socket = this.socket;
+                this.socket = null;
+                if (socket) socket.close();
+            }
+            
+            // Splits the body into parts by their Content-Length, so the JPEG data is never
+            // scanned for the boundary. Drawing before reading on lets a slow page push back
+            // on the socket, and the server then skips to its newest frame.
+            async readParts(reader) {
+                let buffer = new Uint8Array(0);
+                while (true) {
+                    const chunk = await reader.read();
+                    if (chunk.done) return;
+                    this.receivedBytes += chunk.value.length;
+                    buffer = this.concat(buffer, chunk.value);
+                    while (true) {
+                        const headerEnd = this.indexOfBlankLine(buffer);
+                        if (headerEnd < 0) break;
+                        const headers = this.parseHeaders(buffer.subarray(0, headerEnd));
+                        const length = parseInt(headers['content-length']);
+                        if (isNaN(length)) throw new Error('Part without Content-Length');
+                        const start = headerEnd + 4;
+                        if (buffer.length < start + length) break;
+                        const jpeg = new Blob([buffer.slice(start, start + length)], { type: 'image/jpeg' });
+                        buffer = buffer.slice(start + length);
+                        await this.showImage(jpeg, parseFloat(headers['x-frame-age-ms']), performance.now());
+                    }
+                }
+            }
+            
+            // /api/contours records: the /ws header (payload length at byte 28) around one contour set
+            async readRecords(reader) {
+                let buffer = new Uint8Array(0);
+                while (true) {
+                    const chunk = await reader.read();
+                    if (chunk.done) return;
+                    this.receivedBytes += chunk.value.length;
+                    buffer = this.concat(buffer, chunk.value);
+                    while (buffer.length >= 32) {
+                        const view = new DataView(buffer.buffer, buffer.byteOffset, buffer.length);
+                        const headerBytes = view.getUint16(0, true);
+                        const length = view.getUint32(28, true);
+                        if (buffer.length < headerBytes + length) break;
+                        const age = view.getFloat32(24, true);
+                        this.drawContours(buffer.subarray(headerBytes, headerBytes + length), age >= 0 ? age : NaN, performance.now());
+                        buffer = buffer.slice(headerBytes + length);
+                    }
+                }
+            }
+            
+            // Contour set (edge-contours.h): u16 width, u16 height, varint count, then per polyline a
+            // varint point count and zigzag varint dx, dy pairs, each point relative to the previous
+            // one and each first point to the previous polyline's first point
+            drawContours(bytes, age, received) {
+                let offset = 4;
+                const varint = () => {
+                    let value = 0;
+                    let shift = 0;
+                    let byte;
+                    do {
+                        byte = bytes[offset++];
+                        value += (byte & 0x7F) * Math.pow(2, shift);
+                        shift += 7;
+                    } while (byte & 0x80);
+                    return value;
+                };
+                const signed = () => {
+                    const value = varint();
+                    return value % 2 ? -(value + 1) / 2 : value / 2;
+                };
+                const frame = this.frameCanvas;
+                const width = bytes[0] | (bytes[1] << 8);
+                const height = bytes[2] | (bytes[3] << 8);
+                if (frame.width !== width || frame.height !== height) {
+                    frame.width = width;
+                    frame.height = height;
+                }
+                const ctx = frame.getContext('2d');
+                ctx.fillStyle = '#000';
+                ctx.fillRect(0, 0, width, height);
+                ctx.strokeStyle = '#00e5ff';
+                ctx.lineWidth = 1;
+                ctx.beginPath();
+                const count = varint();
+                let originX = 0;
+                let originY = 0;
+                for (let i = 0; i < count; i++) {
+                    const points = varint();
+                    let x = originX;
+                    let y = originY;
+                    for (let j = 0; j < points; j++) {
+                        x += signed();
+                        y += signed();
+                        if (j === 0) {
+                            ctx.moveTo(x + 0.5, y + 0.5);
+                            originX = x;
+                            originY = y;
+                        } else {
+                            ctx.lineTo(x + 0.5, y + 0.5);
+                        }
+                    }
+                    if (points > 1) ctx.closePath();
+                }
+                ctx.stroke();
+                this.presentFrame(frame, age, received);
             }
             
-            loadImage(blob) {
-                return new Promise((resolve, reject) => {
-                    const img = new Image();
-                    img.onload = () => resolve(img);
-                    img.onerror = reject;
-                    img.src = URL.createObjectURL(blob);
+            async showImage(jpeg, age, received) {
+                this.showBitmap(await createImageBitmap(jpeg), age, received);
+            }
+            
+            showBitmap(bitmap, age, received) {
+                const frame = this.frameCanvas;
+                if (!frame) {
+                    this.presentFrame(bitmap, age, received);
+                    return;
+                }
+                // A keyframe in tile mode: keep it so later tiles can be pasted onto it
+                frame.width = bitmap.width;
+                frame.height = bitmap.height;
+                frame.getContext('2d').drawImage(bitmap, 0, 0);
+                bitmap.close();
+                this.presentFrame(frame, age, received);
+            }
+            
+            // Pastes a tile message onto the last picture. Payload (tile-delta.h, little-endian):
+            // u16 count, then per tile u16 x, y, width, height, u32 length and that many JPEG bytes
+            async showTiles(data, offset, age, received) {
+                const frame = this.frameCanvas;
+                if (!frame || frame.width === 0) throw new Error('Tiles before a keyframe');
+                const view = new DataView(data);
+                const count = view.getUint16(offset, true);
+                let position = offset + 2;
+                const tiles = [];
+                for (let i = 0; i < count; i++) {
+                    const length = view.getUint32(position + 8, true);
+                    const jpeg = new Blob([new Uint8Array(data, position + 12, length)], { type: 'image/jpeg' });
+                    tiles.push({
+                        x: view.getUint16(position, true),
+                        y: view.getUint16(position + 2, true),
+                        bitmap: createImageBitmap(jpeg) // decoded in parallel, pasted in order
+                    });
+                    position += 12 + length;
+                }
+                const ctx = frame.getContext('2d');
+                for (const tile of tiles) {
+                    const bitmap = await tile.bitmap;
+                    ctx.drawImage(bitmap, tile.x, tile.y);
+                    bitmap.close();
+                }
+                this.presentFrame(frame, age, received);
+            }
+            
+            // Edge map payload (edge-codec.h): u16 width, u16 height, u8 encoding, then packed rows
+            // (0) or LEB128 runs alternating clear / set over all pixels (1); edges are drawn white
+            decodeEdgeMap(bytes) {
+                const width = bytes[0] | (bytes[1] << 8);
+                const height = bytes[2] | (bytes[3] << 8);
+                const image = new ImageData(width, height);
+                const pixels = new Uint32Array(image.data.buffer);
+                pixels.fill(0xFF000000); // opaque black
+                const white = 0xFFFFFFFF;
+                if (bytes[4] === 0) {
+                    const stride = (width + 7) >> 3;
+                    for (let y = 0; y < height; y++) {
+                        const row = 5 + y * stride;
+                        for (let x = 0; x < width; x++) {
+                            if (bytes[row + (x >> 3)] & (0x80 >> (x & 7))) pixels[y * width + x] = white;
+                        }
+                    }
+                    return image;
+                }
+                const total = width * height;
+                let position = 0;
+                let offset = 5;
+                let set = false;
+                while (position < total && offset < bytes.length) {
+                    let run = 0;
+                    let shift = 0;
+                    let byte;
+                    do {
+                        byte = bytes[offset++];
+                        run += (byte & 0x7F) * Math.pow(2, shift);
+                        shift += 7;
+                    } while (byte & 0x80);
+                    if (set) pixels.fill(white, position, position + run);
+                    position += run;
+                    set = !set;
+                }
+                return image;
+            }
+            
+            presentFrame(image, age, received) {
+                if (this.currentImage && this.currentImage !== image && this.currentImage.close) this.currentImage.close();
+                this.currentImage = image;
+                this.frameCount++;
+                this.updateStatus(true);
+                this.updateStats();
+                this.resizeCanvas();
+                this.recordLatency(age, received);
+            }
+            
+            concat(a, b) {
+                const out = new Uint8Array(a.length + b.length);
+                out.set(a);
+                out.set(b, a.length);
+                return out;
+            }
+            
+            // Index of the CRLF CRLF ending a part's headers, or -1
+            indexOfBlankLine(bytes) {
+                for (let i = 0; i + 3 < bytes.length; i++) {
+                    if (bytes[i] === 13 && bytes[i + 1] === 10 && bytes[i + 2] === 13 && bytes[i + 3] === 10) return i;
+                }
+                return -1;
+            }
+            
+            parseHeaders(bytes) {
+                const headers = {};
+                new TextDecoder('ascii').decode(bytes).split('\r\n').forEach(line => {
+                    const colon = line.indexOf(':');
+                    if (colon > 0) headers[line.slice(0, colon).trim().toLowerCase()] = line.slice(colon + 1).trim();
                 });
+                return headers;
+            }
+            
+            // Capture-to-draw: the frame's age when the server sent it, the one-way network
+            // estimate and everything since it arrived
+            recordLatency(age, received) {
+                if (isNaN(age)) return;
+                const latency = age + this.halfRoundTrip + (performance.now() - received);
+                this.latencies.push(latency);
+                if (this.latencies.length > 60) this.latencies.shift();
+                this.pendingReports.push(latency.toFixed(1));
+                const sorted = this.latencies.slice().sort((a, b) => a - b);
+                this.latencyElement.textContent = Math.round(sorted[Math.floor(sorted.length / 2)]) + ' ms';
+            }
+            
+            updateDataRate() {
+                this.dataRateElement.textContent = Math.round(this.receivedBytes / 1024) + ' KB/s';
+                this.receivedBytes = 0;
+            }
+            
+            reportLatency() {
+                if (this.pendingReports.length === 0) return;
+                const samples = this.pendingReports.splice(0, 100).join(',');
+                fetch('/api/latency?ms=' + samples, { cache: 'no-store' }).catch(() => {});
             }
             
             drawImage() {
@@ -408,11 +862,160 @@ class WebServerService(port: Int = 8080) : NanoHTTPD("0.0.0.0", port) {
 </html>
 """
     
+    // Latest frame to serve: a Bitmap from the app, a compact frame from the native pipeline,
+    // or a native frame shared through the frame bus (pinned until it is replaced)
+    private sealed class ServedFrame(val width: Int, val height: Int, val timing: FrameTiming?) {
+        // Server-side frame number for /frame?after= and the ETag; also counts frames without timing
+        val sequence = servedSequence.incrementAndGet()
+        // Kotlin-encoded JPEG per rendition (index into JPEG_SCALE_DIVISORS), kept after the first request
+        val jpegs = AtomicReferenceArray<ByteArray?>(NativeOpenCVHelper.JPEG_SCALE_DIVISORS.size)
+        // Edge map wire format, or NO_EDGE_MAP; null until someone asked
+        @Volatile var edges: ByteArray? = null
+        // Traced contours, for the tolerance they were simplified with
+        @Volatile var contours: Pair<Double, ByteArray>? = null
+
+        class Image(val bitmap: Bitmap, timing: FrameTiming?) : ServedFrame(bitmap.width, bitmap.height, timing)
+        class Raw(val frame: ProcessedFrame, timing: FrameTiming?) : ServedFrame(frame.width, frame.height, timing)
+        class Shared(val lease: FrameBus.Lease) : ServedFrame(lease.width, lease.height, lease.timing)
+    }
+
+    /**
+     * The size a client asked for with ?w=<pixels> or ?scale=<fraction>: the smallest rendition
+     * (full, 1/2 or 1/4) that is still at least that wide, so nothing is ever scaled up.
+     */
+    private class RenditionRequest(private val width: Int, private val scale: Double) {
+        fun index(frameWidth: Int): Int {
+            val wanted = if (width > 0) width.toDouble() else frameWidth * scale
+            val divisors = NativeOpenCVHelper.JPEG_SCALE_DIVISORS
+            var index = 0
+            while (index + 1 < divisors.size && frameWidth / divisors[index + 1] >= wanted) index++
+            return index
+        }
+    }
+
+    private fun renditionRequest(session: IHTTPSession): RenditionRequest = RenditionRequest(
+        session.parameters["w"]?.firstOrNull()?.toIntOrNull() ?: 0,
+        session.parameters["scale"]?.firstOrNull()?.toDoubleOrNull()?.coerceIn(0.0, 1.0) ?: 1.0
+    )
+
+    /**
+     * At most [max] requests of one kind at a time; the rest are answered 503. [active] counts
+     * the slots handed out by [tryAcquire]: plain requests hold one through [limited], a stream
+     * or socket takes the slot it was admitted with and gives it back when it closes.
+     */
+    private class EndpointLimit(val max: Int, val active: AtomicInteger = AtomicInteger()) {
+        val rejected = AtomicLong()
+
+        // Claimed at admission, so concurrent opens on different workers cannot overshoot [max]
+        fun tryAcquire(): Slot? {
+            while (true) {
+                val current = active.get()
+                if (current >= max) return null
+                if (active.compareAndSet(current, current + 1)) return Slot()
+            }
+        }
+
+        fun stats(): Map<String, Any> = mapOf("active" to active.get(), "max" to max, "rejected" to rejected.get())
+
+        /** One admitted request; release() may be called from every cleanup path, only the first counts */
+        inner class Slot {
+            private val released = AtomicBoolean()
+
+            fun release() {
+                if (released.compareAndSet(false, true)) active.decrementAndGet()
+            }
+        }
+    }
+
+    private inline fun limited(limit: EndpointLimit, serve: () -> Response): Response {
+        val slot = limit.tryAcquire() ?: return busy(limit)
+        try {
+            return serve()
+        } finally {
+            slot.release()
+        }
+    }
+
+    private fun busy(limit: EndpointLimit): Response {
+        limit.rejected.incrementAndGet()
+        val response = newFixedLengthResponse(Response.Status.SERVICE_UNAVAILABLE, "text/plain", "Too many requests of this kind")
+        response.addHeader("Retry-After", "1")
+        return response
+    }
+
     // Store the latest frame
-    private val latestFrame = AtomicReference<Bitmap?>(null)
-    private var servedFrames = 0L
+    private val latestFrame = AtomicReference<ServedFrame?>(null)
+    // /frame?after= requests, and /frame requests answered 304 (long-poll timeouts and If-None-Match hits)
+    private val longPolls = AtomicLong()
+    private val notModifiedFrames = AtomicLong()
+    // JPEG responses and stream parts per rendition
+    private val renditionRequests = AtomicLongArray(NativeOpenCVHelper.JPEG_SCALE_DIVISORS.size)
+    private val servedFrames = AtomicLong()
+    private val encodedFrames = AtomicLong()  // Kotlin encodes; the native cache reports its own
+    // /api/contours streams open, contour sets sent and their average size
+    private val activeContourStreams = AtomicInteger()
+    private val contourRecords = AtomicLong()
+    @Volatile private var avgContourBytes = 0L
+    // Frames sent as compact edge maps instead of JPEG, and their average size
+    private val edgeMapFrames = AtomicLong()
+    @Volatile private var avgEdgeMapBytes = 0L
+
+    // Signalled whenever latestFrame changes, for /stream clients waiting for a new frame
+    private val frameLock = ReentrantLock()
+    private val frameChanged = frameLock.newCondition()
+
+    // /stream clients connected, parts sent, and newer frames published while a client was busy
+    private val activeStreams = AtomicInteger()
+    private val streamedParts = AtomicLong()
+    private val streamSkipped = AtomicLong()
+
+    // /ws clients connected, messages pushed, frames skipped, and the time from send to ack
+    private val activeSockets = AtomicInteger()
+    private val socketMessages = AtomicLong()
+    private val socketSkipped = AtomicLong()
+    private val socketBytes = AtomicLong()
+    @Volatile private var avgAckNs = 0L
+    // ?delta=1 sockets: keyframes, tile messages and frames that needed no message at all
+    private val deltaKeyframes = AtomicLong()
+    private val deltaTileMessages = AtomicLong()
+    private val deltaUnchanged = AtomicLong()
+
+    // Bitmap frames served as the app filtered them, and frames filtered again for filterMode
+    private val reusedFilterFrames = AtomicLong()
+    private val serverFilteredFrames = AtomicLong()
 
-    private fun toJson(map: Map<String, Any?>): String = buildString {
+    // Connections run on a bounded pool instead of a thread each (see HttpWorkerPool)
+    private val workerPool = HttpWorkerPool(HTTP_WORKER_THREADS, HTTP_QUEUE_LIMIT)
+    // Keep-alive connections closed after a response because others were waiting for a worker
+    private val keepAliveReleased = AtomicLong()
+    private val mjpegLimit = EndpointLimit(MAX_MJPEG_STREAMS, activeStreams)
+    private val socketLimit = EndpointLimit(MAX_WEB_SOCKETS, activeSockets)
+    private val contourLimit = EndpointLimit(MAX_CONTOUR_STREAMS, activeContourStreams)
+    private val longPollLimit = EndpointLimit(MAX_LONG_POLLS)
+    private val statusLimit = EndpointLimit(MAX_STATUS_REQUESTS)
+    // Hands the /ws slot from upgradeWebSocket() to the FrameSocket NanoWSD creates on the same thread
+    private val pendingSocketSlot = ThreadLocal<EndpointLimit.Slot?>()
+    // One thread per open /ws socket pushes its frames; socketLimit admits no more sockets than threads
+    private val socketPushThreads = AtomicInteger()
+    private val socketPushers = ThreadPoolExecutor(
+        0, MAX_WEB_SOCKETS, PUSH_THREAD_IDLE_SECONDS, TimeUnit.SECONDS, SynchronousQueue(),
+        ThreadFactory { task ->
+            Thread(task, "ws-push-${socketPushThreads.incrementAndGet()}").apply { isDaemon = true }
+        }
+    )
+
+    init {
+        setAsyncRunner(workerPool)
+    }
+
+    override fun createClientHandler(finalAccept: Socket, inputStream: InputStream): ClientHandler =
+        super.createClientHandler(finalAccept, inputStream).also { workerPool.register(it, finalAccept) }
+
+    // Receives async pipeline frames from the native frame bus while the server runs
+    private var busListener: FrameBus.Listener? = null
+    @Volatile private var lastBusFrameNs = 0L
+
+    private fun toJson(map: Map<*, *>): String = buildString {
         append("{")
         var first = true
         for ((k,v) in map) {
@@ -421,6 +1024,7 @@ class WebServerService(port: Int = 8080) : NanoHTTPD("0.0.0.0", port) {
             when (v) {
                 null -> append("null")
                 is Number, is Boolean -> append(v.toString())
+                is Map<*, *> -> append(toJson(v))
                 else -> append("\"").append(v.toString().replace("\"","\\\"")).append("\"")
             }
             first = false
@@ -430,80 +1034,637 @@ class WebServerService(port: Int = 8080) : NanoHTTPD("0.0.0.0", port) {
     
     /**
      * Update the latest frame to be served to web clients
+     * @param timing Capture and pipeline stamps, for the latency headers of /frame
+     * @param applied The filter the bitmap already shows (the app's), or null if it matches none;
+     *   when that is the server filter the bitmap is served as-is, otherwise it is filtered natively
+     */
+    fun updateFrame(bitmap: Bitmap, timing: FrameTiming? = null, applied: FilterMode? = FilterMode.NONE) {
+        // The same picture is already arriving from the frame bus, filtered natively
+        if (System.nanoTime() - lastBusFrameNs < BUS_PREFERENCE_NS) return
+        val mode = filterMode
+        if (mode == FilterMode.NONE || mode == applied) {
+            reusedFilterFrames.incrementAndGet()
+            setLatest(ServedFrame.Image(bitmap, timing))
+            return
+        }
+        val previewMode = if (mode == FilterMode.GRAYSCALE) NativeOpenCVHelper.PREVIEW_GRAY else NativeOpenCVHelper.PREVIEW_EDGES
+        val filtered = NativeOpenCVHelper.filterBitmap(bitmap, previewMode) ?: return
+        serverFilteredFrames.incrementAndGet()
+        setLatest(ServedFrame.Raw(filtered, timing))
+    }
+
+    /**
+     * Update the latest frame with native pipeline output in any OUTPUT_* format.
+     * Gray and packed edge frames are served as-is (they already are the filtered image)
+     * and encoded straight from their compact form.
+     */
+    fun updateFrame(frame: ProcessedFrame, timing: FrameTiming? = null) {
+        if (!frame.isValid()) {
+            Log.w(TAG, "Ignoring invalid frame ${frame.width}x${frame.height} format=${frame.format}")
+            return
+        }
+        setLatest(ServedFrame.Raw(frame, timing))
+    }
+
+    private fun setLatest(frame: ServedFrame?) {
+        val previous = latestFrame.getAndSet(frame)
+        if (previous is ServedFrame.Shared) previous.lease.release()
+        frameLock.withLock { frameChanged.signalAll() }
+    }
+
+    // Returns the latest frame with its lease retained (release it after encoding), or null
+    private fun acquireLatest(): ServedFrame? {
+        while (true) {
+            val frame = latestFrame.get() ?: return null
+            // A shared frame released between get() and retain() has just been replaced; read again
+            if (frame !is ServedFrame.Shared || frame.lease.retain()) return frame
+        }
+    }
+
+    // Waits up to timeoutMs for a latest frame other than [seen]; retained like acquireLatest()
+    private fun awaitFrame(seen: ServedFrame?, timeoutMs: Long): ServedFrame? {
+        var remainingNs = TimeUnit.MILLISECONDS.toNanos(timeoutMs)
+        frameLock.withLock {
+            while (latestFrame.get().let { it == null || it === seen }) {
+                if (remainingNs <= 0) return null
+                remainingNs = frameChanged.awaitNanos(remainingNs)
+            }
+        }
+        return acquireLatest()
+    }
+
+    // Waits up to timeoutMs while the latest frame is still number [shown] (or there is none), then
+    // returns the latest frame retained like acquireLatest(). Any other number counts as newer, so a
+    // client holding a number from before a server restart gets a frame right away.
+    private fun awaitNewer(shown: Long, timeoutMs: Long): ServedFrame? {
+        var remainingNs = TimeUnit.MILLISECONDS.toNanos(timeoutMs)
+        frameLock.withLock {
+            while (latestFrame.get().let { it == null || it.sequence == shown }) {
+                if (remainingNs <= 0) break
+                remainingNs = frameChanged.awaitNanos(remainingNs)
+            }
+        }
+        return acquireLatest()
+    }
+
+    // Runs on the native listener thread; the served frame keeps its own reference
+    private fun onBusFrame(lease: FrameBus.Lease) {
+        if (!lease.retain()) return
+        lastBusFrameNs = System.nanoTime()
+        setLatest(ServedFrame.Shared(lease))
+    }
+
+    // Lets the viewer measure capture-to-draw latency: the frame's age when the response leaves,
+    // plus how long the server held the request (to subtract from its round trip)
+    private fun addTimingHeaders(response: Response, timing: FrameTiming, requestNs: Long) {
+        val nowNs = System.nanoTime()
+        response.addHeader("X-Frame-Sequence", timing.sequence.toString())
+        response.addHeader("X-Frame-Server-Ms", "%.2f".format(Locale.US, (nowNs - requestNs) / 1e6))
+        val ageNs = timing.sensorAgeNs(nowNs)
+        if (ageNs >= 0) {
+            response.addHeader("X-Frame-Age-Ms", "%.2f".format(Locale.US, ageNs / 1e6))
+            FrameLatency.recordServed(timing, nowNs)
+        }
+    }
+
+    private class FrameBody(val stream: InputStream, val size: Long)
+
+    // Every request for a frame and rendition gets the bytes its first request encoded: bus frames
+    // from the native JPEG cache, streamed straight out of native memory, anything else from
+    // frame.jpegs. Closing the stream closes a native JPEG; responses do that once the body has been sent.
+    private fun jpegBody(frame: ServedFrame, rendition: Int = 0): FrameBody? {
+        renditionRequests.incrementAndGet(rendition)
+        if (frame is ServedFrame.Shared) {
+            val jpeg = frame.lease.encodeJpeg(JPEG_QUALITY, NativeOpenCVHelper.JPEG_SCALE_DIVISORS[rendition])
+            if (jpeg != null) return FrameBody(jpeg.inputStream(), jpeg.size.toLong())
+        }
+        val bytes = cachedJpeg(frame, rendition) ?: return null
+        return FrameBody(ByteArrayInputStream(bytes), bytes.size.toLong())
+    }
+
+    // A binary edge map frame in the edge-codec.h wire format, encoded once per frame; null for
+    // anything else (color, real gray, or a Bitmap from the app)
+    private fun edgeMap(frame: ServedFrame): ByteArray? {
+        frame.edges?.let { return it.takeIf { it !== NO_EDGE_MAP } }
+        val encoded = when (frame) {
+            is ServedFrame.Shared -> frame.lease.encodeEdges()
+            is ServedFrame.Raw -> NativeOpenCVHelper.encodeEdgeMap(frame.frame)
+            is ServedFrame.Image -> null
+        }
+        frame.edges = encoded ?: NO_EDGE_MAP
+        if (encoded != null) {
+            edgeMapFrames.incrementAndGet()
+            val average = avgEdgeMapBytes
+            avgEdgeMapBytes = if (average == 0L) encoded.size.toLong() else average + (encoded.size - average) / 8
+        }
+        return encoded
+    }
+
+    // The frame's edges as polylines simplified with epsilon, traced once per frame and tolerance;
+    // only native frames can be traced
+    private fun contours(frame: ServedFrame, epsilon: Double): ByteArray? {
+        frame.contours?.let { (tolerance, bytes) -> if (tolerance == epsilon) return bytes }
+        if (frame !is ServedFrame.Shared) return null
+        val traced = frame.lease.traceContours(epsilon) ?: return null
+        frame.contours = epsilon to traced
+        val average = avgContourBytes
+        avgContourBytes = if (average == 0L) traced.size.toLong() else average + (traced.size - average) / 8
+        return traced
+    }
+
+    private fun cachedJpeg(frame: ServedFrame, rendition: Int): ByteArray? {
+        frame.jpegs.get(rendition)?.let { return it }
+        synchronized(frame) {
+            frame.jpegs.get(rendition)?.let { return it }
+            val outputStream = ByteArrayOutputStream()
+            if (!encodeJpeg(frame, NativeOpenCVHelper.JPEG_SCALE_DIVISORS[rendition], outputStream)) return null
+            encodedFrames.incrementAndGet()
+            return outputStream.toByteArray().also { frame.jpegs.set(rendition, it) }
+        }
+    }
+
+    private fun encodeJpeg(frame: ServedFrame, scaleDivisor: Int, out: OutputStream): Boolean {
+        if (scaleDivisor > 1) {
+            val scaled = when (frame) {
+                is ServedFrame.Image -> {
+                    val bitmap = Bitmap.createScaledBitmap(
+                        frame.bitmap, maxOf(1, frame.width / scaleDivisor), maxOf(1, frame.height / scaleDivisor), true
+                    )
+                    val ok = bitmap.compress(Bitmap.CompressFormat.JPEG, JPEG_QUALITY, out)
+                    if (bitmap !== frame.bitmap) bitmap.recycle()
+                    return ok
+                }
+                is ServedFrame.Raw -> NativeOpenCVHelper.scaleFrame(frame.frame, scaleDivisor)
+                is ServedFrame.Shared -> NativeOpenCVHelper.scaleFrame(frame.lease.copyToFrame(), scaleDivisor)
+            }
+            return scaled != null && encodeJpeg(scaled, out)
+        }
+        return when (frame) {
+            is ServedFrame.Image -> frame.bitmap.compress(Bitmap.CompressFormat.JPEG, JPEG_QUALITY, out)
+            is ServedFrame.Raw -> encodeJpeg(frame.frame, out)
+            is ServedFrame.Shared -> encodeJpeg(frame.lease, out)
+        }
+    }
+
+    // Encodes straight from the shared native pixels; only packed edges and padded rows need a copy
+    private fun encodeJpeg(lease: FrameBus.Lease, out: OutputStream): Boolean {
+        val w = lease.width
+        val h = lease.height
+        return when {
+            lease.format == NativeOpenCVHelper.OUTPUT_GRAY8 -> {
+                val lumaSize = w * h
+                val nv21 = ByteArray(lumaSize + 2 * ((w + 1) / 2) * ((h + 1) / 2))
+                val source = lease.pixels.duplicate()
+                for (row in 0 until h) {
+                    source.position(row * lease.rowStride)
+                    source.get(nv21, row * w, w)
+                }
+                nv21.fill(128.toByte(), lumaSize, nv21.size)
+                YuvImage(nv21, ImageFormat.NV21, w, h, null).compressToJpeg(Rect(0, 0, w, h), JPEG_QUALITY, out)
+            }
+            lease.format != NativeOpenCVHelper.OUTPUT_PACKED_EDGES && lease.isTight -> {
+                val bitmap = Bitmap.createBitmap(w, h, NativeOpenCVHelper.bitmapConfig(lease.format))
+                bitmap.copyPixelsFromBuffer(lease.pixels.duplicate())
+                val ok = bitmap.compress(Bitmap.CompressFormat.JPEG, JPEG_QUALITY, out)
+                bitmap.recycle()
+                ok
+            }
+            else -> encodeJpeg(lease.copyToFrame(), out)
+        }
+    }
+
+    private fun encodeJpeg(frame: ProcessedFrame, out: OutputStream): Boolean {
+        val w = frame.width
+        val h = frame.height
+        return when (frame.format) {
+            NativeOpenCVHelper.OUTPUT_GRAY8, NativeOpenCVHelper.OUTPUT_PACKED_EDGES -> {
+                val gray = if (frame.format == NativeOpenCVHelper.OUTPUT_PACKED_EDGES) {
+                    NativeOpenCVHelper.unpackEdgeMap(frame.data, w, h) ?: return false
+                } else {
+                    frame.data
+                }
+                // Single-channel JPEG through the NV21 encoder: gray is the Y plane, chroma is neutral
+                val lumaSize = w * h
+                val nv21 = ByteArray(lumaSize + 2 * ((w + 1) / 2) * ((h + 1) / 2))
+                System.arraycopy(gray, 0, nv21, 0, lumaSize)
+                nv21.fill(128.toByte(), lumaSize, nv21.size)
+                YuvImage(nv21, ImageFormat.NV21, w, h, null).compressToJpeg(Rect(0, 0, w, h), JPEG_QUALITY, out)
+            }
+            else -> {
+                val bitmap = Bitmap.createBitmap(w, h, NativeOpenCVHelper.bitmapConfig(frame.format))
+                bitmap.copyPixelsFromBuffer(
+                    ByteBuffer.wrap(frame.data, 0, NativeOpenCVHelper.frameSize(frame.format, w, h))
+                )
+                val ok = bitmap.compress(Bitmap.CompressFormat.JPEG, JPEG_QUALITY, out)
+                bitmap.recycle()
+                ok
+            }
+        }
+    }
+
+    /**
+     * Body of a /stream response: an endless multipart/x-mixed-replace MJPEG in which every
+     * part is the newest frame at the moment the client is ready for another one. NanoHTTPD
+     * pulls from it only as fast as the socket drains, so a slow client skips straight to the
+     * latest frame instead of queueing stale ones, and [minIntervalNs] caps its frame rate.
+     * Parts are the same cached JPEG bytes /frame serves, in the [size] the client asked for;
+     * each carries its Content-Length, sequence and age so the viewer can split the stream
+     * without scanning for the boundary.
      */
-    fun updateFrame(bitmap: Bitmap) {
-        // Apply simple filter transformations similar to app (lightweight)
-        val processed = when(filterMode) {
-            FilterMode.NONE -> bitmap
-            FilterMode.GRAYSCALE -> bitmap.toGrayscale()
-            FilterMode.EDGE_DETECTION -> bitmap.toEdge()
-        }
-        latestFrame.set(processed)
-    }
-
-    // Simple bitmap filters (avoid heavy OpenCV in server thread)
-    private fun Bitmap.toGrayscale(): Bitmap {
-        val w = width
-        val h = height
-        val out = Bitmap.createBitmap(w, h, Bitmap.Config.ARGB_8888)
-        for (y in 0 until h) {
-            for (x in 0 until w) {
-                val c = getPixel(x, y)
-                val r = (c shr 16) and 0xFF
-                val g = (c shr 8) and 0xFF
-                val b = c and 0xFF
-                val gray = (0.299*r + 0.587*g + 0.114*b).toInt()
-                out.setPixel(x, y, (0xFF shl 24) or (gray shl 16) or (gray shl 8) or gray)
-            }
-        }
-        return out
-    }
-
-    private fun Bitmap.toEdge(): Bitmap {
-        // Very lightweight Sobel approximation
-        val w = width
-        val h = height
-        val out = Bitmap.createBitmap(w, h, Bitmap.Config.ARGB_8888)
-        // Precompute grayscale
-        val gray = IntArray(w*h)
-        for (y in 0 until h) {
-            for (x in 0 until w) {
-                val c = getPixel(x, y)
-                val r = (c shr 16) and 0xFF
-                val g = (c shr 8) and 0xFF
-                val b = c and 0xFF
-                gray[y*w + x] = (0.299*r + 0.587*g + 0.114*b).toInt()
-            }
-        }
-        val gx = intArrayOf(-1,0,1,-2,0,2,-1,0,1)
-        val gy = intArrayOf(-1,-2,-1,0,0,0,1,2,1)
-        for (y in 1 until h-1) {
-            for (x in 1 until w-1) {
-                var sx = 0
-                var sy = 0
-                var k = 0
-                for (dy in -1..1) {
-                    for (dx in -1..1) {
-                        val v = gray[(y+dy)*w + (x+dx)]
-                        sx += v * gx[k]
-                        sy += v * gy[k]
-                        k++
+    private inner class MjpegStream(
+        private val minIntervalNs: Long,
+        private val size: RenditionRequest,
+        private val slot: EndpointLimit.Slot
+    ) : InputStream() {
+        private var part: InputStream? = null
+        private var lastFrame: ServedFrame? = null
+        private var lastSequence = -1L
+        private var lastPartNs = 0L
+        @Volatile private var closed = false
+
+        override fun read(): Int {
+            val one = ByteArray(1)
+            return if (read(one, 0, 1) <= 0) -1 else one[0].toInt() and 0xFF
+        }
+
+        override fun read(b: ByteArray, off: Int, len: Int): Int {
+            if (len == 0) return 0
+            while (!closed) {
+                val current = part ?: nextPart() ?: return -1
+                val count = current.read(b, off, len)
+                if (count > 0) return count
+                current.close()
+                part = null
+            }
+            return -1
+        }
+
+        // Waits for a frame newer than the last part (and for the pacing interval); null ends the stream
+        private fun nextPart(): InputStream? {
+            val pacingNs = lastPartNs + minIntervalNs - System.nanoTime()
+            if (pacingNs > 0) Thread.sleep(pacingNs / 1_000_000, (pacingNs % 1_000_000).toInt())
+            while (!closed && isAlive) {
+                val frame = awaitFrame(lastFrame, STREAM_WAIT_MS) ?: continue
+                val body = try {
+                    jpegBody(frame, size.index(frame.width))
+                } finally {
+                    if (frame is ServedFrame.Shared) frame.lease.release()
+                }
+                lastFrame = frame
+                if (body == null) continue
+                val nowNs = System.nanoTime()
+                val header = StringBuilder()
+                    .append("--").append(MJPEG_BOUNDARY).append("\r\n")
+                    .append("Content-Type: image/jpeg\r\n")
+                    .append("Content-Length: ").append(body.size).append("\r\n")
+                frame.timing?.let { timing ->
+                    header.append("X-Frame-Sequence: ").append(timing.sequence).append("\r\n")
+                    if (lastSequence >= 0 && timing.sequence > lastSequence + 1) {
+                        streamSkipped.addAndGet(timing.sequence - lastSequence - 1)
+                    }
+                    lastSequence = timing.sequence
+                    val ageNs = timing.sensorAgeNs(nowNs)
+                    if (ageNs >= 0) {
+                        header.append("X-Frame-Age-Ms: ").append("%.2f".format(Locale.US, ageNs / 1e6)).append("\r\n")
+                        FrameLatency.recordServed(timing, nowNs)
                     }
                 }
-                val mag = kotlin.math.min(255, kotlin.math.abs(sx) + kotlin.math.abs(sy))
-                out.setPixel(x, y, (0xFF shl 24) or (mag shl 16) or (mag shl 8) or mag)
+                header.append("\r\n")
+                lastPartNs = nowNs
+                streamedParts.incrementAndGet()
+                val pieces = Vector<InputStream>(3)
+                pieces.add(ByteArrayInputStream(header.toString().toByteArray(Charsets.US_ASCII)))
+                pieces.add(body.stream)
+                pieces.add(ByteArrayInputStream(PART_END))
+                // SequenceInputStream closes each piece, and so the JPEG, as it moves past it
+                return SequenceInputStream(pieces.elements()).also { part = it }
             }
+            return null
+        }
+
+        override fun close() {
+            if (closed) return
+            closed = true
+            part?.close()
+            part = null
+            lastFrame = null
+            slot.release()
+            Log.i(TAG, "MJPEG stream closed (active=${activeStreams.get()})")
         }
-        return out
     }
-    
+
+    // A /ws message, also a /api/contours record: the FrameSocket header followed by payloadBytes
+    // written by fill(message, WS_HEADER_BYTES)
+    private inline fun framedMessage(
+        frame: ServedFrame, format: Byte, payloadBytes: Int, fill: (ByteArray, Int) -> Unit
+    ): ByteArray {
+        val message = ByteArray(WS_HEADER_BYTES + payloadBytes)
+        fill(message, WS_HEADER_BYTES)
+        val timing = frame.timing
+        val nowNs = System.nanoTime()
+        val ageNs = timing?.sensorAgeNs(nowNs) ?: -1L
+        ByteBuffer.wrap(message).order(ByteOrder.LITTLE_ENDIAN)
+            .putShort(WS_HEADER_BYTES.toShort())
+            .put(WS_VERSION)
+            .put(format)
+            .putShort(frame.width.toShort())
+            .putShort(frame.height.toShort())
+            .putDouble(timing?.sequence?.toDouble() ?: -1.0)
+            .putDouble(timing?.sensorTimestampNs?.toDouble() ?: 0.0)
+            .putFloat(if (ageNs >= 0) (ageNs / 1e6).toFloat() else -1f)
+            .putInt(payloadBytes)
+        if (timing != null && ageNs >= 0) FrameLatency.recordServed(timing, nowNs)
+        return message
+    }
+
+    /**
+     * Body of a streamed /api/contours response: one record per frame the client is ready for,
+     * each the /ws message layout (32-byte header, format WS_FORMAT_CONTOURS) around the contour
+     * set, so readers split the stream by the payload length in the header. Paced and skipping
+     * to the newest frame like MjpegStream.
+     */
+    private inner class ContourStream(
+        private val minIntervalNs: Long,
+        private val epsilon: Double,
+        private val slot: EndpointLimit.Slot
+    ) : InputStream() {
+        private var record: InputStream? = null
+        private var lastFrame: ServedFrame? = null
+        private var lastRecordNs = 0L
+        @Volatile private var closed = false
+
+        override fun read(): Int {
+            val one = ByteArray(1)
+            return if (read(one, 0, 1) <= 0) -1 else one[0].toInt() and 0xFF
+        }
+
+        override fun read(b: ByteArray, off: Int, len: Int): Int {
+            if (len == 0) return 0
+            while (!closed) {
+                val current = record ?: nextRecord() ?: return -1
+                val count = current.read(b, off, len)
+                if (count > 0) return count
+                record = null
+            }
+            return -1
+        }
+
+        private fun nextRecord(): InputStream? {
+            val pacingNs = lastRecordNs + minIntervalNs - System.nanoTime()
+            if (pacingNs > 0) Thread.sleep(pacingNs / 1_000_000, (pacingNs % 1_000_000).toInt())
+            while (!closed && isAlive) {
+                val frame = awaitFrame(lastFrame, STREAM_WAIT_MS) ?: continue
+                val message = try {
+                    contours(frame, epsilon)?.let { payload ->
+                        framedMessage(frame, WS_FORMAT_CONTOURS, payload.size) { out, offset -> payload.copyInto(out, offset) }
+                    }
+                } finally {
+                    if (frame is ServedFrame.Shared) frame.lease.release()
+                }
+                lastFrame = frame
+                if (message == null) continue
+                lastRecordNs = System.nanoTime()
+                contourRecords.incrementAndGet()
+                return ByteArrayInputStream(message).also { record = it }
+            }
+            return null
+        }
+
+        override fun close() {
+            if (closed) return
+            closed = true
+            record = null
+            lastFrame = null
+            slot.release()
+        }
+    }
+
+    // ?maxFps= caps a pushed stream's frame rate; 0 or absent sends every frame the client keeps up with
+    private fun minIntervalNs(session: IHTTPSession): Long {
+        val maxFps = session.parameters["maxFps"]?.firstOrNull()?.toIntOrNull() ?: 0
+        return if (maxFps > 0) 1_000_000_000L / maxFps.coerceAtMost(MAX_STREAM_FPS) else 0L
+    }
+
+    // The socket is admitted before NanoWSD builds it, which happens on this same thread
+    private fun upgradeWebSocket(session: IHTTPSession): Response {
+        val slot = socketLimit.tryAcquire() ?: return busy(socketLimit)
+        pendingSocketSlot.set(slot)
+        val response = try {
+            super.serve(session)
+        } catch (e: Throwable) {
+            slot.release()
+            throw e
+        } finally {
+            pendingSocketSlot.remove()
+        }
+        // Not upgraded (plain GET, bad handshake): no socket will ever close to give the slot back
+        if (response.status != Response.Status.SWITCH_PROTOCOL) slot.release()
+        return response
+    }
+
+    override fun openWebSocket(handshake: IHTTPSession): WebSocket = FrameSocket(handshake, pendingSocketSlot.get())
+
+    /**
+     * /ws: frames pushed as binary WebSocket messages, each a little-endian header followed by
+     * the same cached JPEG bytes /frame serves:
+     *
+     *     u16 headerBytes (WS_HEADER_BYTES), u8 version, u8 format (WS_FORMAT_JPEG),
+     *     u16 width, u16 height, f64 sequence (-1 if unknown), f64 sensorTimestampNs (0 if unknown),
+     *     f32 ageMs when sent (-1 if unknown), u32 payloadBytes
+     *
+     * The client answers each message with the text "ack <sequence>" once it has drawn it. No
+     * more than ?window= messages (default DEFAULT_WS_WINDOW) are unacknowledged at a time, so on
+     * a slow link frames wait on the phone, where newer ones replace them, instead of in socket
+     * buffers; when a slot frees up the client gets the newest frame. ?maxFps= caps the rate.
+     *
+     * With ?delta=1 native frames go through a per-client TileDeltaEncoder: a keyframe is a
+     * WS_FORMAT_JPEG message, otherwise a WS_FORMAT_TILES message carries only the tiles that
+     * changed since what the client shows (layout in tile-delta.h), and an unchanged frame is
+     * not sent at all. The client pastes tiles onto its last picture.
+     *
+     * Frames that are only a binary edge map (EDGE_DETECTION) go out as WS_FORMAT_EDGES in the
+     * compact 1-bit layout of edge-codec.h instead of a JPEG, in either mode.
+     */
+    private inner class FrameSocket(
+        handshake: IHTTPSession,
+        private val slot: EndpointLimit.Slot?
+    ) : WebSocket(handshake) {
+        private val window = handshake.parameters["window"]?.firstOrNull()?.toIntOrNull()
+            ?.coerceIn(1, MAX_WS_WINDOW) ?: DEFAULT_WS_WINDOW
+        private val minIntervalNs = minIntervalNs(handshake)
+        private val delta = handshake.parameters["delta"]?.firstOrNull() == "1"
+        private var deltaEncoder: TileDeltaEncoder? = null // push thread only
+        private var forceKeyframe = false
+        private val ackLock = ReentrantLock()
+        private val acked = ackLock.newCondition()
+        private val sentNs = ArrayDeque<Long>() // send times of unacknowledged messages, oldest first
+        @Volatile private var running = false
+        @Volatile private var pushing = false
+
+        override fun onOpen() {
+            running = true
+            Log.i(TAG, "WebSocket opened (window=$window, active=${activeSockets.get()})")
+            // The slot stays taken until the push thread is done, so socketPushers always has one free
+            pushing = true
+            try {
+                socketPushers.execute { pushFrames() }
+            } catch (e: RejectedExecutionException) {
+                pushing = false
+                Log.w(TAG, "No push thread for WebSocket, closing it")
+                try {
+                    close(WebSocketFrame.CloseCode.InternalServerError, "Server busy", false)
+                } catch (closeError: IOException) {
+                    Log.d(TAG, "WebSocket close failed: ${closeError.message}")
+                }
+            }
+        }
+
+        override fun onClose(code: WebSocketFrame.CloseCode?, reason: String?, initiatedByRemote: Boolean) {
+            if (!pushing) slot?.release()
+            if (!running) return
+            running = false
+            ackLock.withLock { acked.signalAll() }
+            Log.i(TAG, "WebSocket closed: $code (active=${activeSockets.get()})")
+        }
+
+        override fun onMessage(message: WebSocketFrame) {
+            if (!message.textPayload.orEmpty().startsWith("ack")) return
+            val nowNs = System.nanoTime()
+            ackLock.withLock {
+                val sent = sentNs.pollFirst() ?: return
+                val ackNs = nowNs - sent
+                avgAckNs = if (avgAckNs == 0L) ackNs else avgAckNs + (ackNs - avgAckNs) / 8
+                acked.signalAll()
+            }
+        }
+
+        override fun onPong(pong: WebSocketFrame) {}
+
+        override fun onException(exception: IOException) {
+            Log.d(TAG, "WebSocket error: ${exception.message}")
+        }
+
+        // Waits up to STREAM_WAIT_MS for a free slot in the window; false on timeout or close
+        private fun awaitWindow(): Boolean {
+            var remainingNs = TimeUnit.MILLISECONDS.toNanos(STREAM_WAIT_MS)
+            ackLock.withLock {
+                while (running && sentNs.size >= window) {
+                    if (remainingNs <= 0) return false
+                    remainingNs = acked.awaitNanos(remainingNs)
+                }
+            }
+            return running
+        }
+
+        private fun pushFrames() {
+            var lastFrame: ServedFrame? = null
+            var lastSequence = -1L
+            var lastSendNs = System.nanoTime()
+            if (delta) deltaEncoder = TileDeltaEncoder().takeIf { it.isOpen }
+            try {
+                while (running && isAlive) {
+                    val frame = if (awaitWindow()) awaitFrame(lastFrame, STREAM_WAIT_MS) else null
+                    if (frame == null) {
+                        if (running && System.nanoTime() - lastSendNs > WS_PING_INTERVAL_NS) {
+                            ping(ByteArray(0))
+                            lastSendNs = System.nanoTime()
+                        }
+                        continue
+                    }
+                    val message = try {
+                        frameMessage(frame)
+                    } finally {
+                        if (frame is ServedFrame.Shared) frame.lease.release()
+                    }
+                    lastFrame = frame
+                    // A delta frame with nothing to send still counts as delivered, not skipped
+                    frame.timing?.let { timing ->
+                        if (lastSequence >= 0 && timing.sequence > lastSequence + 1) {
+                            socketSkipped.addAndGet(timing.sequence - lastSequence - 1)
+                        }
+                        lastSequence = timing.sequence
+                    }
+                    if (message == null) continue
+                    ackLock.withLock { sentNs.addLast(System.nanoTime()) }
+                    send(message)
+                    socketMessages.incrementAndGet()
+                    socketBytes.addAndGet(message.size.toLong())
+                    lastSendNs = System.nanoTime()
+                    if (minIntervalNs > 0) Thread.sleep(minIntervalNs / 1_000_000, (minIntervalNs % 1_000_000).toInt())
+                }
+            } catch (e: IOException) {
+                Log.d(TAG, "WebSocket push stopped: ${e.message}")
+            } catch (e: InterruptedException) {
+                Thread.currentThread().interrupt()
+            } finally {
+                deltaEncoder?.close()
+                deltaEncoder = null
+                slot?.release()
+            }
+        }
+
+        // The frame in the /ws message layout, or null if there is nothing to send
+        private fun frameMessage(frame: ServedFrame): ByteArray? {
+            edgeMap(frame)?.let { edges ->
+                forceKeyframe = true
+                return framedMessage(frame, WS_FORMAT_EDGES, edges.size) { out, offset -> edges.copyInto(out, offset) }
+            }
+            val encoder = deltaEncoder
+            if (encoder != null && frame is ServedFrame.Shared) {
+                val result = encoder.encode(frame.lease, JPEG_QUALITY, forceKeyframe)
+                if (result != null) {
+                    forceKeyframe = false
+                    val payload = result.payload
+                    return when (result.kind) {
+                        TileDeltaEncoder.KIND_UNCHANGED -> {
+                            deltaUnchanged.incrementAndGet()
+                            null
+                        }
+                        TileDeltaEncoder.KIND_KEYFRAME -> {
+                            deltaKeyframes.incrementAndGet()
+                            framedMessage(frame, WS_FORMAT_JPEG, payload.remaining()) { out, offset -> payload.get(out, offset, out.size - offset) }
+                        }
+                        else -> {
+                            deltaTileMessages.incrementAndGet()
+                            framedMessage(frame, WS_FORMAT_TILES, payload.remaining()) { out, offset -> payload.get(out, offset, out.size - offset) }
+                        }
+                    }
+                }
+            }
+            // A full frame from elsewhere replaces the client's picture; deltas restart from a keyframe
+            forceKeyframe = true
+            val body = jpegBody(frame) ?: return null
+            body.stream.use { stream ->
+                return framedMessage(frame, WS_FORMAT_JPEG, body.size.toInt()) { out, start ->
+                    var offset = start
+                    while (offset < out.size) {
+                        val count = stream.read(out, offset, out.size - offset)
+                        if (count < 0) return null
+                        offset += count
+                    }
+                }
+            }
+        }
+    }
+
     override fun serve(session: IHTTPSession): Response {
+        val response = route(session)
+        // While connections wait for a worker, a keep-alive connection gives its worker up after
+        // this response instead of idling on it; the upgrade to a WebSocket must stay open
+        if (workerPool.isBacklogged && response.status != Response.Status.SWITCH_PROTOCOL) {
+            response.addHeader("Connection", "close")
+            keepAliveReleased.incrementAndGet()
+        }
+        return response
+    }
+
+    private fun route(session: IHTTPSession): Response {
         val uri = session.uri
 
         return try {
             when {
                 uri == "/" || uri == "/index.html" -> {
-                    val htmlWithFilters = viewerHtml.replace("</div>\n    <div class=\"viewer-container\">", "</div>\n    <div style=\"padding:10px;background:#222;display:flex;gap:10px;\">Filters: <button onclick=\"setFilter('NONE')\">None</button><button onclick=\"setFilter('GRAYSCALE')\">Grayscale</button><button onclick=\"setFilter('EDGE_DETECTION')\">Edge</button><button onclick=\"capturePhoto()\">Capture</button><button onclick=\"switchCam()\">Switch Cam</button></div>\n    <div class=\"viewer-container\">")
+                    val htmlWithFilters = viewerHtml.replace("</div>\n    <div class=\"viewer-container\">", "</div>\n    <div style=\"padding:10px;background:#222;display:flex;gap:10px;\">Filters: <button onclick=\"setFilter('NONE')\">None</button><button onclick=\"setFilter('GRAYSCALE')\">Grayscale</button><button onclick=\"setFilter('EDGE_DETECTION')\">Edge</button><button onclick=\"setFilter('COMPARE')\">Compare</button><button onclick=\"capturePhoto()\">Capture</button><button onclick=\"switchCam()\">Switch Cam</button></div>\n    <div class=\"viewer-container\">")
                     val augmented = htmlWithFilters.replace("</script>", "function setFilter(m){fetch('/api/setFilter?mode='+m).then(()=>console.log('filter '+m));}\nfunction capturePhoto(){fetch('/api/capture').then(r=>r.json()).then(j=>console.log(j));}\nfunction switchCam(){fetch('/api/switchCamera').then(r=>r.json()).then(j=>console.log(j));}\nfunction refreshStatus(){fetch('/api/status').then(r=>r.json()).then(j=>console.log(j));}\n</script>")
                     Log.d(TAG, "Serving viewer page")
                     newFixedLengthResponse(Response.Status.OK, "text/html", augmented)
@@ -516,9 +1677,59 @@ class WebServerService(port: Int = 8080) : NanoHTTPD("0.0.0.0", port) {
                     val ok = switchCameraCallback?.invoke() ?: false
                     newFixedLengthResponse(Response.Status.OK, "application/json", toJson(mapOf("switched" to ok)))
                 }
-                uri.startsWith("/api/status") -> {
+                uri.startsWith("/api/status") -> limited(statusLimit) {
                     val base = statusCallback?.invoke() ?: emptyMap()
-                    val extra = mapOf("serverFilter" to filterMode.name, "servedFrames" to servedFrames)
+                    val extra = mapOf(
+                        "serverFilter" to filterMode.name,
+                        "renditionRequests" to NativeOpenCVHelper.JPEG_SCALE_DIVISORS.indices.associate {
+                            "1/${NativeOpenCVHelper.JPEG_SCALE_DIVISORS[it]}" to renditionRequests.get(it)
+                        },
+                        "serverFilterFrames" to mapOf(
+                            "reused" to reusedFilterFrames.get(),
+                            "filtered" to serverFilteredFrames.get()
+                        ),
+                        "servedFrames" to servedFrames.get(),
+                        "frameRequests" to mapOf(
+                            "longPolls" to longPolls.get(),
+                            "notModified" to notModifiedFrames.get(),
+                            "sequence" to servedSequence.get()
+                        ),
+                        "encodedFrames" to encodedFrames.get(),
+                        "contours" to mapOf(
+                            "activeStreams" to activeContourStreams.get(),
+                            "records" to contourRecords.get(),
+                            "avgBytes" to avgContourBytes
+                        ),
+                        "edgeMaps" to mapOf(
+                            "frames" to edgeMapFrames.get(),
+                            "avgBytes" to avgEdgeMapBytes
+                        ),
+                        "webSockets" to mapOf(
+                            "active" to activeSockets.get(),
+                            "messages" to socketMessages.get(),
+                            "skipped" to socketSkipped.get(),
+                            "bytes" to socketBytes.get(),
+                            "avgAckMs" to Math.round(avgAckNs / 1e4) / 100.0,
+                            "deltaKeyframes" to deltaKeyframes.get(),
+                            "deltaTileMessages" to deltaTileMessages.get(),
+                            "deltaUnchanged" to deltaUnchanged.get()
+                        ),
+                        "streams" to mapOf(
+                            "active" to activeStreams.get(),
+                            "parts" to streamedParts.get(),
+                            "skipped" to streamSkipped.get()
+                        ),
+                        "httpServer" to workerPool.stats() + ("keepAliveReleased" to keepAliveReleased.get()),
+                        "endpointLimits" to mapOf(
+                            "stream" to mjpegLimit.stats(),
+                            "ws" to socketLimit.stats(),
+                            "contours" to contourLimit.stats(),
+                            "longPoll" to longPollLimit.stats(),
+                            "status" to statusLimit.stats()
+                        ),
+                        "latency" to FrameLatency.snapshot(),
+                        "native" to NativeOpenCVHelper.nativeStats()
+                    )
                     newFixedLengthResponse(Response.Status.OK, "application/json", toJson(base + extra))
                 }
                 uri.startsWith("/api/gallery") -> {
@@ -546,28 +1757,34 @@ class WebServerService(port: Int = 8080) : NanoHTTPD("0.0.0.0", port) {
                     Log.i(TAG, "Filter mode changed to $filterMode via web")
                     newFixedLengthResponse(Response.Status.OK, "application/json", toJson(mapOf("mode" to filterMode.name, "accepted" to callbackAccepted)))
                 }
+                uri.startsWith("/api/latency") -> {
+                    // Capture-to-draw samples measured by the viewer, comma separated ms
+                    val samples = session.parameters["ms"]?.firstOrNull().orEmpty()
+                        .split(",").mapNotNull { it.trim().toDoubleOrNull() }
+                    samples.forEach { FrameLatency.recordBrowser(it) }
+                    newFixedLengthResponse(Response.Status.OK, "application/json", toJson(mapOf("recorded" to samples.size)))
+                }
+                // WebSocket upgrade, handled by NanoWSD through openWebSocket()
+                uri == "/ws" -> upgradeWebSocket(session)
+                uri.startsWith("/api/contours") -> serveContours(session)
+                uri.startsWith("/stream") -> {
+                    val slot = mjpegLimit.tryAcquire() ?: return busy(mjpegLimit)
+                    // ?maxFps= caps this client's frame rate; 0 or absent sends every frame it can keep up with.
+                    // ?w= / ?scale= pick a smaller rendition, as for /frame.
+                    Log.i(TAG, "MJPEG stream opened (active=${activeStreams.get()})")
+                    // NanoHTTPD closes the stream, which frees the slot, when the response ends
+                    val response = newChunkedResponse(
+                        Response.Status.OK,
+                        "multipart/x-mixed-replace; boundary=$MJPEG_BOUNDARY",
+                        MjpegStream(minIntervalNs(session), renditionRequest(session), slot)
+                    )
+                    response.addHeader("Cache-Control", "no-store, no-cache, must-revalidate")
+                    response.addHeader("Pragma", "no-cache")
+                    response
+                }
                 uri.startsWith("/frame") -> {
-                    val frame = latestFrame.get()
-                    if (frame != null) {
-                        val outputStream = ByteArrayOutputStream()
-                        frame.compress(Bitmap.CompressFormat.JPEG, 85, outputStream)
-                        val imageBytes = outputStream.toByteArray()
-                        servedFrames++
-                        Log.d(TAG, "Serving frame: ${frame.width}x${frame.height}, ${imageBytes.size} bytes (served=$servedFrames)")
-                        val response = newFixedLengthResponse(
-                            Response.Status.OK,
-                            "image/jpeg",
-                            ByteArrayInputStream(imageBytes),
-                            imageBytes.size.toLong()
-                        )
-                        response.addHeader("Cache-Control", "no-store, no-cache, must-revalidate")
-                        response.addHeader("Pragma", "no-cache")
-                        response.addHeader("Expires", "0")
-                        response
-                    } else {
-                        Log.w(TAG, "No frame available")
-                        newFixedLengthResponse(Response.Status.NOT_FOUND, "text/plain", "No frame available")
-                    }
+                    // Only long polls hold their worker; plain requests return straight away
+                    if (session.parameters.containsKey("after")) limited(longPollLimit) { serveFrame(session) } else serveFrame(session)
                 }
                 else -> {
                     Log.w(TAG, "Unknown URI: $uri")
@@ -580,6 +1797,101 @@ class WebServerService(port: Int = 8080) : NanoHTTPD("0.0.0.0", port) {
         }
     }
     
+    // /frame: the latest frame, numbered by its ServedFrame.sequence in X-Served-Sequence and the ETag.
+    // ?after=<seq> long-polls: the request is held while the latest frame is still <seq>, and answered
+    // 304 if no other frame arrives within ?timeout=<ms>. If-None-Match naming the latest frame is
+    // answered 304 as well, so an unchanged frame is neither encoded nor sent again. Plain GETs get
+    // the latest frame straight away, as always.
+    private fun serveFrame(session: IHTTPSession): Response {
+        val requestNs = System.nanoTime()
+        val after = session.parameters["after"]?.firstOrNull()?.toLongOrNull()
+        val frame = if (after != null) {
+            longPolls.incrementAndGet()
+            val timeoutMs = session.parameters["timeout"]?.firstOrNull()?.toLongOrNull()
+                ?.coerceIn(0L, MAX_LONG_POLL_MS) ?: LONG_POLL_MS
+            awaitNewer(after, timeoutMs)
+        } else {
+            acquireLatest()
+        }
+        if (frame == null) {
+            Log.w(TAG, "No frame available")
+            return newFixedLengthResponse(Response.Status.NOT_FOUND, "text/plain", "No frame available")
+        }
+        val etag = "\"${frame.sequence}\""
+        val cached = session.headers["if-none-match"]?.split(',')?.any { it.trim().removePrefix("W/") == etag } == true
+        if (frame.sequence == after || cached) {
+            if (frame is ServedFrame.Shared) frame.lease.release()
+            notModifiedFrames.incrementAndGet()
+            val response = newFixedLengthResponse(Response.Status.NOT_MODIFIED, "text/plain", "")
+            addFrameIdHeaders(response, frame, etag)
+            return response
+        }
+
+        // ?w=<px> or ?scale=<0..1> asks for a smaller JPEG; only the sizes someone asks for get encoded
+        val rendition = renditionRequest(session).index(frame.width)
+        // Clients that understand the compact edge map get it instead of a full-size JPEG when they can
+        val wantsEdges = rendition == 0 && session.headers["accept"]?.contains(EDGE_MAP_MIME) == true
+        var mimeType = "image/jpeg"
+        val body = try {
+            val edges = if (wantsEdges) edgeMap(frame) else null
+            if (edges != null) {
+                mimeType = EDGE_MAP_MIME
+                FrameBody(ByteArrayInputStream(edges), edges.size.toLong())
+            } else {
+                jpegBody(frame, rendition)
+            }
+        } finally {
+            if (frame is ServedFrame.Shared) frame.lease.release()
+        } ?: return newFixedLengthResponse(
+            Response.Status.INTERNAL_ERROR, "text/plain", "Failed to encode frame"
+        )
+        val response = newFixedLengthResponse(Response.Status.OK, mimeType, body.stream, body.size)
+        val served = servedFrames.incrementAndGet()
+        Log.d(TAG, "Serving frame: ${frame.width}x${frame.height} (served=$served, encoded=${encodedFrames.get()})")
+        addFrameIdHeaders(response, frame, etag)
+        response.addHeader("Pragma", "no-cache")
+        response.addHeader("Expires", "0")
+        frame.timing?.let { addTimingHeaders(response, it, requestNs) }
+        return response
+    }
+
+    // Browsers may keep a /frame response but must revalidate it, which costs a 304 while the frame is unchanged
+    private fun addFrameIdHeaders(response: Response, frame: ServedFrame, etag: String) {
+        response.addHeader("ETag", etag)
+        response.addHeader("X-Served-Sequence", frame.sequence.toString())
+        response.addHeader("Cache-Control", "no-cache")
+        response.addHeader("Vary", "Accept")
+    }
+
+    // /api/contours?epsilon=<px>&maxFps=<n> streams contour records; with once=1 it returns the
+    // latest frame's contour set alone, for simple polling consumers
+    private fun serveContours(session: IHTTPSession): Response {
+        val epsilon = session.parameters["epsilon"]?.firstOrNull()?.toDoubleOrNull()
+            ?.coerceIn(0.0, MAX_CONTOUR_EPSILON) ?: DEFAULT_CONTOUR_EPSILON
+        if (session.parameters["once"]?.firstOrNull() != "1") {
+            val slot = contourLimit.tryAcquire() ?: return busy(contourLimit)
+            val response = newChunkedResponse(
+                Response.Status.OK, CONTOUR_STREAM_MIME, ContourStream(minIntervalNs(session), epsilon, slot)
+            )
+            response.addHeader("Cache-Control", "no-store")
+            return response
+        }
+        val requestNs = System.nanoTime()
+        val frame = acquireLatest()
+            ?: return newFixedLengthResponse(Response.Status.NOT_FOUND, "text/plain", "No frame available")
+        val bytes = try {
+            contours(frame, epsilon)
+        } finally {
+            if (frame is ServedFrame.Shared) frame.lease.release()
+        } ?: return newFixedLengthResponse(
+            Response.Status.SERVICE_UNAVAILABLE, "text/plain", "Contours need a native pipeline frame"
+        )
+        val response = newFixedLengthResponse(Response.Status.OK, CONTOURS_MIME, ByteArrayInputStream(bytes), bytes.size.toLong())
+        response.addHeader("Cache-Control", "no-store")
+        frame.timing?.let { addTimingHeaders(response, it, requestNs) }
+        return response
+    }
+
     /**
      * Start the web server
      */
@@ -587,6 +1899,7 @@ class WebServerService(port: Int = 8080) : NanoHTTPD("0.0.0.0", port) {
         return try {
             start(NanoHTTPD.SOCKET_READ_TIMEOUT, false)
             Log.i(TAG, "Web server started on port $listeningPort")
+            startBusReader()
             true
         } catch (e: Exception) {
             Log.e(TAG, "Failed to start web server: ${e.message}", e)
@@ -600,9 +1913,26 @@ class WebServerService(port: Int = 8080) : NanoHTTPD("0.0.0.0", port) {
     fun stopServer() {
         try {
             stop()
+            stopBusReader()
             Log.i(TAG, "Web server stopped")
         } catch (e: Exception) {
             Log.e(TAG, "Error stopping web server: ${e.message}", e)
         }
     }
+
+    @Synchronized
+    private fun startBusReader() {
+        if (busListener != null) return
+        // The served frame holds one lease until the next one replaces it, so allow two in flight
+        val listener = FrameBus.Listener(HTTP_SUBSCRIBER, FrameBus.LIVE_PREVIEW, 2) { onBusFrame(it) }
+        if (listener.isOpen) busListener = listener
+    }
+
+    @Synchronized
+    private fun stopBusReader() {
+        val listener = busListener ?: return
+        busListener = null
+        listener.close()
+        if (latestFrame.get() is ServedFrame.Shared) setLatest(null)
+    }
 }
@@ -1,22 +1,37 @@
-"use strict";
-var __awaiter = (this && this.__awaiter) || function (thisArg, _arguments, P, generator) {
-    function adopt(value) { return value instanceof P ? value : new P(function (resolve) { resolve(value); }); }
-    return new (P || (P = Promise))(function (resolve, reject) {
-        function fulfilled(value) { try { step(generator.next(value)); } catch (e) { reject(e); } }
-        function rejected(value) { try { step(generator["throw"](value)); } catch (e) { reject(e); } }
-        function step(result) { result.done ? resolve(result.value) : adopt(result.value).then(fulfilled, rejected); }
-        step((generator = generator.apply(thisArg, _arguments || [])).next());
-    });
-};
 class FrameViewer {
-    constructor() {
-        this.currentImage = null;
-        this.frameCount = 0;
-        this.errorCount = 0;
-        this.lastFrameTime = performance.now();
-        this.fps = 0;
-        this.intervalId = null;
-        this.currentFilter = 'NONE';
+    canvas;
+    ctx;
+    statusDot;
+    statusText;
+    fpsEl;
+    frameCountEl;
+    errorCountEl;
+    resolutionEl;
+    filterNameEl;
+    latencyEl;
+    dataRateEl;
+    refreshRateSelect;
+    transportSelect;
+    refreshBtn;
+    filterButtons;
+    currentImage = null;
+    frameCanvas = null;
+    receivedBytes = 0;
+    frameCount = 0;
+    errorCount = 0;
+    lastFrameTime = performance.now();
+    fps = 0;
+    currentFilter = 'NONE';
+    // The open /stream, /frame poll or /ws socket, a pending reconnect, and the one-way network estimate taken when it opened
+    streamController = null;
+    socket = null;
+    retryId = null;
+    halfRoundTrip = 0;
+    drawChain = Promise.resolve();
+    // Recent capture-to-draw latencies (ms) and those not yet reported to /api/latency
+    latencies = [];
+    pendingReports = [];
+    constructor(){
         this.canvas = document.getElementById('canvas');
         this.ctx = this.canvas.getContext('2d');
         this.statusDot = document.getElementById('statusDot');
@@ -26,75 +41,320 @@ class FrameViewer {
         this.errorCountEl = document.getElementById('errorCount');
         this.resolutionEl = document.getElementById('resolution');
         this.filterNameEl = document.getElementById('filterName');
+        this.latencyEl = document.getElementById('latency');
+        this.dataRateEl = document.getElementById('dataRate');
         this.refreshRateSelect = document.getElementById('refreshRate');
+        this.transportSelect = document.getElementById('transport');
         this.refreshBtn = document.getElementById('refreshBtn');
         this.filterButtons = document.getElementById('filterButtons');
         this.bindEvents();
-        this.updateRefreshRate();
+        this.startStream();
+        window.setInterval(()=>this.reportLatency(), 2000);
+        window.setInterval(()=>this.updateDataRate(), 1000);
     }
     bindEvents() {
-        this.refreshBtn.addEventListener('click', () => this.fetchFrame());
-        this.refreshRateSelect.addEventListener('change', () => this.updateRefreshRate());
-        this.filterButtons.querySelectorAll('button').forEach(btn => {
-            btn.addEventListener('click', () => {
-                this.filterButtons.querySelectorAll('button').forEach(b => b.classList.remove('active'));
+        this.refreshBtn.addEventListener('click', ()=>this.startStream());
+        this.refreshRateSelect.addEventListener('change', ()=>this.startStream());
+        this.transportSelect.addEventListener('change', ()=>this.startStream());
+        this.filterButtons.querySelectorAll('button').forEach((btn)=>{
+            btn.addEventListener('click', ()=>{
+                this.filterButtons.querySelectorAll('button').forEach((b)=>b.classList.remove('active'));
                 btn.classList.add('active');
                 this.setFilter(btn.getAttribute('data-filter') || 'NONE');
             });
         });
-        window.addEventListener('resize', () => this.resizeCanvas());
+        window.addEventListener('resize', ()=>this.resizeCanvas());
     }
     setFilter(mode) {
         this.currentFilter = mode;
-        fetch('/setFilter?mode=' + encodeURIComponent(mode)).then(() => {
+        fetch('/setFilter?mode=' + encodeURIComponent(mode)).then(()=>{
             this.filterNameEl.textContent = this.humanFilter(mode);
-        }).catch(() => { });
+        }).catch(()=>{});
     }
     humanFilter(m) {
-        switch (m) {
-            case 'GRAYSCALE': return 'Grayscale';
-            case 'EDGE_DETECTION': return 'Edge';
-            default: return 'Normal';
-        }
-    }
-    updateRefreshRate() {
-        if (this.intervalId)
-            window.clearInterval(this.intervalId);
-        const rate = parseInt(this.refreshRateSelect.value, 10);
-        this.intervalId = window.setInterval(() => this.fetchFrame(), rate);
-        this.fetchFrame();
-    }
-    fetchFrame() {
-        return __awaiter(this, void 0, void 0, function* () {
-            try {
-                const controller = new AbortController();
-                const timeout = setTimeout(() => controller.abort(), 5000);
-                const res = yield fetch('/frame?' + Date.now(), { cache: 'no-store', signal: controller.signal });
-                clearTimeout(timeout);
-                if (!res.ok)
-                    throw new Error('HTTP ' + res.status);
-                const blob = yield res.blob();
-                const img = yield this.loadImage(blob);
-                this.currentImage = img;
-                this.frameCount++;
-                this.updateStatus(true);
-                this.updateStats();
-                this.resizeCanvas();
+        switch(m){
+            case 'GRAYSCALE':
+                return 'Grayscale';
+            case 'EDGE_DETECTION':
+                return 'Edge';
+            default:
+                return 'Normal';
+        }
+    }
+    // Frames are pushed as acknowledged binary messages over /ws or as multipart/x-mixed-replace parts
+    // over /stream, or long-polled from /frame; at most maxFps per second, reconnecting every second
+    startStream() {
+        this.stopStream();
+        const transport = this.transportSelect.value;
+        const rate = this.refreshRateSelect.value;
+        if (transport === 'contours') {
+            this.frameCanvas = document.createElement('canvas');
+            this.startFetch('/api/contours?maxFps=' + rate, (reader)=>this.readRecords(reader));
+            return;
+        }
+        if (transport === 'poll') {
+            this.frameCanvas = null;
+            this.startPoll(parseInt(rate, 10));
+            return;
+        }
+        const socket = transport !== 'mjpeg' && 'WebSocket' in window;
+        this.frameCanvas = socket && transport === 'tiles' ? document.createElement('canvas') : null;
+        if (socket) this.startSocket(this.frameCanvas !== null);
+        else this.startFetch('/stream?maxFps=' + rate, (reader)=>this.readParts(reader));
+    }
+    // With delta the server sends only the tiles that changed between keyframes
+    startSocket(delta) {
+        const opened = performance.now();
+        const scheme = location.protocol === 'https:' ? 'wss://' : 'ws://';
+        const socket = new WebSocket(scheme + location.host + '/ws?' + (delta ? 'delta=1&' : '') + 'window=2&maxFps=' + this.refreshRateSelect.value);
+        socket.binaryType = 'arraybuffer';
+        this.socket = socket;
+        socket.onopen = ()=>{
+            this.halfRoundTrip = (performance.now() - opened) / 2;
+        };
+        socket.onmessage = (ev)=>{
+            const received = performance.now();
+            this.receivedBytes += ev.data.byteLength;
+            this.drawChain = this.drawChain.then(()=>this.showMessage(socket, ev.data, received));
+        };
+        socket.onclose = ()=>{
+            if (this.socket !== socket) return;
+            this.socket = null;
+            this.errorCount++;
+            this.updateStatus(false);
+            this.updateStats();
+            this.retryId = window.setTimeout(()=>this.startStream(), 1000);
+        };
+    }
+    // Little-endian header: u16 headerBytes, u8 version, u8 format, u16 width, u16 height,
+    // f64 sequence, f64 sensorTimestampNs, f32 ageMs (-1 if unknown), u32 payloadBytes; then the
+    // payload: a JPEG for format 1, changed tiles for format 2, a compact edge map for format 3
+    async showMessage(socket, data, received) {
+        const view = new DataView(data);
+        const headerBytes = view.getUint16(0, true);
+        const format = view.getUint8(3);
+        const sequence = view.getFloat64(8, true);
+        const age = view.getFloat32(24, true);
+        const length = view.getUint32(28, true);
+        try {
+            if (format === 2) await this.showTiles(data, headerBytes, age >= 0 ? age : NaN, received);
+            else if (format === 3) this.showBitmap(await createImageBitmap(decodeEdgeMap(new Uint8Array(data, headerBytes, length))), age >= 0 ? age : NaN, received);
+            else await this.showImage(new Blob([
+                new Uint8Array(data, headerBytes, length)
+            ], {
+                type: 'image/jpeg'
+            }), age >= 0 ? age : NaN, received);
+        } catch (e) {
+            this.errorCount++;
+        } finally{
+            // Acknowledge once drawn, so the server's window counts frames the page has really shown
+            if (socket.readyState === WebSocket.OPEN) socket.send('ack ' + sequence);
+        }
+    }
+    // A pushed HTTP stream (/stream or /api/contours) whose body read() consumes
+    async startFetch(url, read) {
+        const controller = new AbortController();
+        this.streamController = controller;
+        try {
+            const requested = performance.now();
+            const res = await fetch(url, {
+                cache: 'no-store',
+                signal: controller.signal
+            });
+            if (!res.ok || !res.body) throw new Error('HTTP ' + res.status);
+            this.halfRoundTrip = (performance.now() - requested) / 2;
+            await read(res.body.getReader());
+        } catch (e) {
+            if (controller.signal.aborted) return;
+            this.errorCount++;
+            this.updateStatus(false);
+            this.updateStats();
+        }
+        if (this.streamController === controller) {
+            this.streamController = null;
+            this.retryId = window.setTimeout(()=>this.startStream(), 1000);
+        }
+    }
+    // Each /frame request names the frame already shown (after=); the server holds it until there is
+    // another one and answers 304 if none arrived in time, so no frame is encoded or sent twice
+    async startPoll(rate) {
+        const controller = new AbortController();
+        this.streamController = controller;
+        let shown = -1;
+        try {
+            while(this.streamController === controller){
+                const requested = performance.now();
+                const res = await fetch('/frame?after=' + shown, {
+                    cache: 'no-store',
+                    signal: controller.signal
+                });
+                if (res.status === 304) continue;
+                if (!res.ok) throw new Error('HTTP ' + res.status);
+                const jpeg = await res.blob();
+                const received = performance.now();
+                shown = parseInt(res.headers.get('X-Served-Sequence') || '-1', 10);
+                this.receivedBytes += jpeg.size;
+                // The time the server held the request is not network time
+                const held = parseFloat(res.headers.get('X-Frame-Server-Ms') || '') || 0;
+                this.halfRoundTrip = Math.max(0, received - requested - held) / 2;
+                await this.showImage(jpeg, parseFloat(res.headers.get('X-Frame-Age-Ms') || ''), received);
+                const wait = rate > 0 ? requested + 1000 / rate - performance.now() : 0;
+                if (wait > 0) await new Promise((resolve)=>window.setTimeout(resolve, wait));
             }
-            catch (e) {
-                this.errorCount++;
-                this.updateStatus(false);
-                this.updateStats();
+        } catch (e) {
+            if (controller.signal.aborted) return;
+            this.errorCount++;
+            this.updateStatus(false);
+            this.updateStats();
+        }
+        if (this.streamController === controller) {
+            this.streamController = null;
+            this.retryId = window.setTimeout(()=>this.startStream(), 1000);
+        }
+    }
+    stopStream() {
+        if (this.retryId) {
+            window.clearTimeout(this.retryId);
+            this.retryId = null;
+        }
+        const controller = this.streamController;
+        this.streamController = null;
+        if (controller) controller.abort();
+        const socket = this.socket;
+        this.socket = null;
+        if (socket) socket.close();
+    }
+    // Parts are split by their Content-Length header, never by scanning the JPEG for the boundary.
+    // Drawing before reading on lets a slow page push back, and the server skips to its newest frame.
+    async readParts(reader) {
+        let buffer = new Uint8Array(0);
+        for(;;){
+            const chunk = await reader.read();
+            if (chunk.done) return;
+            this.receivedBytes += chunk.value.length;
+            const joined = new Uint8Array(buffer.length + chunk.value.length);
+            joined.set(buffer);
+            joined.set(chunk.value, buffer.length);
+            buffer = joined;
+            for(;;){
+                const headerEnd = indexOfBlankLine(buffer);
+                if (headerEnd < 0) break;
+                const headers = parseHeaders(buffer.subarray(0, headerEnd));
+                const length = parseInt(headers['content-length'], 10);
+                if (isNaN(length)) throw new Error('Part without Content-Length');
+                const start = headerEnd + 4;
+                if (buffer.length < start + length) break;
+                const jpeg = new Blob([
+                    buffer.slice(start, start + length)
+                ], {
+                    type: 'image/jpeg'
+                });
+                buffer = buffer.slice(start + length);
+                await this.showImage(jpeg, parseFloat(headers['x-frame-age-ms'] || ''), performance.now());
             }
-        });
+        }
     }
-    loadImage(blob) {
-        return new Promise((resolve, reject) => {
-            const img = new Image();
-            img.onload = () => resolve(img);
-            img.onerror = reject;
-            img.src = URL.createObjectURL(blob);
-        });
+    // /api/contours records: the /ws header (payload length at byte 28) around one contour set
+    async readRecords(reader) {
+        let buffer = new Uint8Array(0);
+        for(;;){
+            const chunk = await reader.read();
+            if (chunk.done) return;
+            this.receivedBytes += chunk.value.length;
+            const joined = new Uint8Array(buffer.length + chunk.value.length);
+            joined.set(buffer);
+            joined.set(chunk.value, buffer.length);
+            buffer = joined;
+            while(buffer.length >= 32){
+                const view = new DataView(buffer.buffer, buffer.byteOffset, buffer.length);
+                const headerBytes = view.getUint16(0, true);
+                const length = view.getUint32(28, true);
+                if (buffer.length < headerBytes + length) break;
+                const age = view.getFloat32(24, true);
+                const frame = this.frameCanvas;
+                drawContours(frame, buffer.subarray(headerBytes, headerBytes + length));
+                this.presentFrame(frame, age >= 0 ? age : NaN, performance.now());
+                buffer = buffer.slice(headerBytes + length);
+            }
+        }
+    }
+    async showImage(jpeg, age, received) {
+        this.showBitmap(await createImageBitmap(jpeg), age, received);
+    }
+    showBitmap(bitmap, age, received) {
+        const frame = this.frameCanvas;
+        if (!frame) {
+            this.presentFrame(bitmap, age, received);
+            return;
+        }
+        // A keyframe in tile mode: keep it so later tiles can be pasted onto it
+        frame.width = bitmap.width;
+        frame.height = bitmap.height;
+        frame.getContext('2d').drawImage(bitmap, 0, 0);
+        bitmap.close();
+        this.presentFrame(frame, age, received);
+    }
+    // Pastes a tile message onto the last picture. Payload (tile-delta.h, little-endian):
+    // u16 count, then per tile u16 x, y, width, height, u32 length and that many JPEG bytes
+    async showTiles(data, offset, age, received) {
+        const frame = this.frameCanvas;
+        if (!frame || frame.width === 0) throw new Error('Tiles before a keyframe');
+        const view = new DataView(data);
+        const count = view.getUint16(offset, true);
+        let position = offset + 2;
+        const tiles = [];
+        for(let i = 0; i < count; i++){
+            const length = view.getUint32(position + 8, true);
+            const jpeg = new Blob([
+                new Uint8Array(data, position + 12, length)
+            ], {
+                type: 'image/jpeg'
+            });
+            // Decoded in parallel, pasted in order
+            tiles.push({
+                x: view.getUint16(position, true),
+                y: view.getUint16(position + 2, true),
+                bitmap: createImageBitmap(jpeg)
+            });
+            position += 12 + length;
+        }
+        const ctx = frame.getContext('2d');
+        for (const tile of tiles){
+            const bitmap = await tile.bitmap;
+            ctx.drawImage(bitmap, tile.x, tile.y);
+            bitmap.close();
+        }
+        this.presentFrame(frame, age, received);
+    }
+    presentFrame(image, age, received) {
+        if (this.currentImage instanceof ImageBitmap && this.currentImage !== image) this.currentImage.close();
+        this.currentImage = image;
+        this.frameCount++;
+        this.updateStatus(true);
+        this.updateStats();
+        this.resizeCanvas();
+        this.recordLatency(age, received);
+    }
+    // Capture-to-draw: the frame's age when the server sent it, the one-way network estimate,
+    // and everything since it arrived
+    recordLatency(age, received) {
+        if (isNaN(age)) return;
+        const latency = age + this.halfRoundTrip + (performance.now() - received);
+        this.latencies.push(latency);
+        if (this.latencies.length > 60) this.latencies.shift();
+        this.pendingReports.push(latency.toFixed(1));
+        const sorted = this.latencies.slice().sort((a, b)=>a - b);
+        this.latencyEl.textContent = Math.round(sorted[Math.floor(sorted.length / 2)]) + ' ms';
+    }
+    updateDataRate() {
+        this.dataRateEl.textContent = Math.round(this.receivedBytes / 1024) + ' KB/s';
+        this.receivedBytes = 0;
+    }
+    reportLatency() {
+        if (this.pendingReports.length === 0) return;
+        fetch('/api/latency?ms=' + this.pendingReports.splice(0, 100).join(','), {
+            cache: 'no-store'
+        }).catch(()=>{});
     }
     resizeCanvas() {
         const container = this.canvas.parentElement;
@@ -114,14 +374,16 @@ class FrameViewer {
             this.resolutionEl.textContent = this.currentImage.width + 'x' + this.currentImage.height;
         }
     }
-    drawImage() { if (!this.currentImage)
-        return; this.ctx.clearRect(0, 0, this.canvas.width, this.canvas.height); this.ctx.drawImage(this.currentImage, 0, 0, this.canvas.width, this.canvas.height); }
+    drawImage() {
+        if (!this.currentImage) return;
+        this.ctx.clearRect(0, 0, this.canvas.width, this.canvas.height);
+        this.ctx.drawImage(this.currentImage, 0, 0, this.canvas.width, this.canvas.height);
+    }
     updateStatus(connected) {
         if (connected) {
             this.statusDot.className = 'dot connected';
             this.statusText.textContent = 'Connected';
-        }
-        else {
+        } else {
             this.statusDot.className = 'dot disconnected';
             this.statusText.textContent = 'Disconnected';
         }
@@ -138,5 +400,108 @@ class FrameViewer {
         this.errorCountEl.textContent = String(this.errorCount);
     }
 }
-window.addEventListener('DOMContentLoaded', () => new FrameViewer());
+// Edge map payload (edge-codec.h): u16 width, u16 height, u8 encoding, then packed rows (0) or
+// LEB128 runs alternating clear / set over all pixels in row-major order (1); edges are drawn white
+function decodeEdgeMap(bytes) {
+    const width = bytes[0] | bytes[1] << 8;
+    const height = bytes[2] | bytes[3] << 8;
+    const image = new ImageData(width, height);
+    const pixels = new Uint32Array(image.data.buffer);
+    const white = 0xFFFFFFFF;
+    pixels.fill(0xFF000000); // opaque black
+    if (bytes[4] === 0) {
+        const stride = width + 7 >> 3;
+        for(let y = 0; y < height; y++){
+            const row = 5 + y * stride;
+            for(let x = 0; x < width; x++)if (bytes[row + (x >> 3)] & 0x80 >> (x & 7)) pixels[y * width + x] = white;
+        }
+        return image;
+    }
+    const total = width * height;
+    let position = 0;
+    let offset = 5;
+    let set = false;
+    while(position < total && offset < bytes.length){
+        let run = 0;
+        let shift = 0;
+        let byte;
+        do {
+            byte = bytes[offset++];
+            run += (byte & 0x7F) * Math.pow(2, shift);
+            shift += 7;
+        }while (byte & 0x80)
+        if (set) pixels.fill(white, position, position + run);
+        position += run;
+        set = !set;
+    }
+    return image;
+}
+// Contour set (edge-contours.h): u16 width, u16 height, varint count, then per polyline a varint
+// point count and zigzag varint dx, dy pairs, each point relative to the previous one and each
+// first point to the previous polyline's first point. Polylines are closed.
+function drawContours(canvas, bytes) {
+    let offset = 4;
+    const varint = ()=>{
+        let value = 0;
+        let shift = 0;
+        let byte;
+        do {
+            byte = bytes[offset++];
+            value += (byte & 0x7F) * Math.pow(2, shift);
+            shift += 7;
+        }while (byte & 0x80)
+        return value;
+    };
+    const signed = ()=>{
+        const value = varint();
+        return value % 2 ? -(value + 1) / 2 : value / 2;
+    };
+    const width = bytes[0] | bytes[1] << 8;
+    const height = bytes[2] | bytes[3] << 8;
+    if (canvas.width !== width || canvas.height !== height) {
+        canvas.width = width;
+        canvas.height = height;
+    }
+    const ctx = canvas.getContext('2d');
+    ctx.fillStyle = '#000';
+    ctx.fillRect(0, 0, width, height);
+    ctx.strokeStyle = '#00e5ff';
+    ctx.lineWidth = 1;
+    ctx.beginPath();
+    const count = varint();
+    let originX = 0;
+    let originY = 0;
+    for(let i = 0; i < count; i++){
+        const points = varint();
+        let x = originX;
+        let y = originY;
+        for(let j = 0; j < points; j++){
+            x += signed();
+            y += signed();
+            if (j === 0) {
+                ctx.moveTo(x + 0.5, y + 0.5);
+                originX = x;
+                originY = y;
+            } else ctx.lineTo(x + 0.5, y + 0.5);
+        }
+        if (points > 1) ctx.closePath();
+    }
+    ctx.stroke();
+}
+// Index of the CRLF CRLF that ends a part's headers, or -1
+function indexOfBlankLine(bytes) {
+    for(let i = 0; i + 3 < bytes.length; i++){
+        if (bytes[i] === 13 && bytes[i + 1] === 10 && bytes[i + 2] === 13 && bytes[i + 3] === 10) return i;
+    }
+    return -1;
+}
+function parseHeaders(bytes) {
+    const headers = {};
+    new TextDecoder('ascii').decode(bytes).split('\r\n').forEach((line)=>{
+        const colon = line.indexOf(':');
+        if (colon > 0) headers[line.slice(0, colon).trim().toLowerCase()] = line.slice(colon + 1).trim();
+    });
+    return headers;
+}
+window.addEventListener('DOMContentLoaded', ()=>new FrameViewer());
 //# sourceMappingURL=index.js.map
\ No newline at end of file